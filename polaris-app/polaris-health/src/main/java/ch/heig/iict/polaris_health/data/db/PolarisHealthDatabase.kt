@@ -1,6 +1,7 @@
 package ch.heig.iict.polaris_health.data.db
 
 import android.content.Context
+import androidx.room.AutoMigration
 import androidx.room.Database
 import androidx.room.Room
 import androidx.room.RoomDatabase
@@ -23,7 +24,10 @@ import ch.heig.iict.polaris_health.data.entities.VisitEntity
         VisitEntity::class,
         PoLTokenEntity::class
     ],
-    version = 1
+    version = 2,
+    autoMigrations = [
+        AutoMigration(from = 1, to = 2) // Merkle proof of the tokens
+    ]
 )
 @TypeConverters(Converters::class)
 abstract class PolarisHealthDatabase : RoomDatabase() {
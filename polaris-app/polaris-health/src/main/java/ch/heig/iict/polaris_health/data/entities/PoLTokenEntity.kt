@@ -28,6 +28,10 @@ data class PoLTokenEntity(
     @ColumnInfo(typeAffinity = ColumnInfo.BLOB) val beaconPk: ByteArray,
     @ColumnInfo(typeAffinity = ColumnInfo.BLOB) val phoneSig: ByteArray,
     @ColumnInfo(typeAffinity = ColumnInfo.BLOB) val beaconSig: ByteArray,
+    @ColumnInfo(name = "merkle_leaf_index", defaultValue = "0") val merkleLeafIndex: Byte = 0,
+    @ColumnInfo(name = "merkle_leaf_count", defaultValue = "0") val merkleLeafCount: Byte = 0,
+    @ColumnInfo(name = "merkle_path", typeAffinity = ColumnInfo.BLOB, defaultValue = "x''")
+    val merklePath: ByteArray = ByteArray(0),
     @ColumnInfo(name = "is_synced", defaultValue = "0") var isSynced: Boolean = false
 
 ) {
@@ -49,6 +53,9 @@ data class PoLTokenEntity(
         if (!beaconPk.contentEquals(other.beaconPk)) return false
         if (!phoneSig.contentEquals(other.phoneSig)) return false
         if (!beaconSig.contentEquals(other.beaconSig)) return false
+        if (merkleLeafIndex != other.merkleLeafIndex) return false
+        if (merkleLeafCount != other.merkleLeafCount) return false
+        if (!merklePath.contentEquals(other.merklePath)) return false
 
         return true
     }
@@ -66,6 +73,9 @@ data class PoLTokenEntity(
         result = 31 * result + beaconPk.contentHashCode()
         result = 31 * result + phoneSig.contentHashCode()
         result = 31 * result + beaconSig.contentHashCode()
+        result = 31 * result + merkleLeafIndex
+        result = 31 * result + merkleLeafCount
+        result = 31 * result + merklePath.contentHashCode()
         return result
     }
 
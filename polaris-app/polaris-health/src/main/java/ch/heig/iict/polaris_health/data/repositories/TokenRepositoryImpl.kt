@@ -55,7 +55,10 @@ private fun PoLToken.toEntity(visitId: Long): PoLTokenEntity {
         phonePk = this.phonePk.asByteArray(),
         beaconPk = this.beaconPk.asByteArray(),
         phoneSig = this.phoneSig.asByteArray(),
-        beaconSig = this.beaconSig.asByteArray()
+        beaconSig = this.beaconSig.asByteArray(),
+        merkleLeafIndex = this.merkleLeafIndex.toByte(),
+        merkleLeafCount = this.merkleLeafCount.toByte(),
+        merklePath = this.merklePath.asByteArray()
     )
 }
 
@@ -70,6 +73,9 @@ private fun PoLTokenEntity.toPoLToken(): PoLToken {
         this.phonePk.asUByteArray(),
         this.beaconPk.asUByteArray(),
         this.phoneSig.asUByteArray(),
-        this.beaconSig.asUByteArray()
+        this.beaconSig.asUByteArray(),
+        this.merkleLeafIndex.toUByte(),
+        this.merkleLeafCount.toUByte(),
+        this.merklePath.asUByteArray()
     )
 }
\ No newline at end of file
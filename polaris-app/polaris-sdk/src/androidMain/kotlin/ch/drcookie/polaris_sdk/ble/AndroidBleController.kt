@@ -9,6 +9,8 @@ import ch.drcookie.polaris_sdk.ble.model.CommonScanFilter
 import ch.drcookie.polaris_sdk.ble.model.CommonBleScanResult
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
 import ch.drcookie.polaris_sdk.ble.model.ScanConfig
 import kotlinx.coroutines.*
 import kotlinx.coroutines.flow.*
@@ -24,7 +26,13 @@ import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import ch.drcookie.polaris_sdk.ble.model.FoundBeacon
 import ch.drcookie.polaris_sdk.ble.model.ConnectionState
 import ch.drcookie.polaris_sdk.ble.model.DiscriminatedScanResult
+import ch.drcookie.polaris_sdk.protocol.model.PoLErrorCode
+import ch.drcookie.polaris_sdk.protocol.model.poLErrorFromBytes
+import ch.drcookie.polaris_sdk.protocol.model.poLErrorRetryAfterSeconds
+import ch.drcookie.polaris_sdk.protocol.model.pipelineAnswersFromBytes
+import ch.drcookie.polaris_sdk.protocol.model.pipelineFrameToBytes
 import ch.drcookie.polaris_sdk.protocol.model.poLResponseFromBytes
+import ch.drcookie.polaris_sdk.protocol.model.poLSessionTokenFromBytes
 import ch.drcookie.polaris_sdk.protocol.model.toBytes
 
 private val Log = KotlinLogging.logger {}
@@ -139,6 +147,10 @@ internal class AndroidBleController(
                 return SdkResult.Failure(SdkError.PreconditionError("Bluetooth is not enabled."))
             }
             val response = performRequestResponse(request.toBytes(), config.tokenWriteUuid, config.tokenIndicateUuid)
+            poLErrorFromBytes(response)?.let {
+                val retryAfter = poLErrorRetryAfterSeconds(response)
+                throw IOException("Beacon rejected the PoL request: $it (retry after ${retryAfter}s)")
+            }
             poLResponseFromBytes(response) ?: throw IOException("Failed to parse PoLResponse from beacon data.")
         }.fold(
             onSuccess = { polResponse -> SdkResult.Success(polResponse) },
@@ -150,6 +162,55 @@ internal class AndroidBleController(
         )
     }
 
+    override suspend fun requestSessionToken(request: PoLSessionRequest): SdkResult<PoLSessionToken, SdkError> {
+        return runCatching {
+            if (!gattManager.isReady()) {
+                return SdkResult.Failure(SdkError.PreconditionError("Bluetooth is not enabled."))
+            }
+            val response = performRequestResponse(request.toBytes(), config.tokenWriteUuid, config.tokenIndicateUuid)
+            poLErrorFromBytes(response)?.let {
+                if (it == PoLErrorCode.UNKNOWN_SESSION || it == PoLErrorCode.INVALID_SIGNATURE) {
+                    return SdkResult.Failure(SdkError.ProtocolError("Beacon rejected the session: $it"))
+                }
+                val retryAfter = poLErrorRetryAfterSeconds(response)
+                throw IOException("Beacon rejected the session request: $it (retry after ${retryAfter}s)")
+            }
+            poLSessionTokenFromBytes(response) ?: throw IOException("Failed to parse PoLSessionToken from beacon data.")
+        }.fold(
+            onSuccess = { token -> SdkResult.Success(token) },
+            onFailure = { throwable ->
+                SdkResult.Failure(
+                    SdkError.BleError(throwable.message ?: "$unknownErr during session transaction")
+                )
+            }
+        )
+    }
+
+    override suspend fun requestPoLs(requests: List<PoLRequest>): SdkResult<List<PoLResponse?>, SdkError> {
+        return runCatching {
+            if (!gattManager.isReady()) {
+                return SdkResult.Failure(SdkError.PreconditionError("Bluetooth is not enabled."))
+            }
+            val frame = pipelineFrameToBytes(requests.map { it.toBytes() })
+            val response = performRequestResponse(frame, config.tokenWriteUuid, config.tokenIndicateUuid)
+            poLErrorFromBytes(response)?.let {
+                throw IOException("Beacon rejected the pipelined requests: $it")
+            }
+            val answers = pipelineAnswersFromBytes(response)
+                ?: throw IOException("Failed to parse the pipelined answers from beacon data.")
+
+            // A rejected request gets an error answer, which does not parse as a response.
+            requests.indices.map { id -> answers[id]?.let { poLResponseFromBytes(it) } }
+        }.fold(
+            onSuccess = { responses -> SdkResult.Success(responses) },
+            onFailure = { throwable ->
+                SdkResult.Failure(
+                    SdkError.BleError(throwable.message ?: "$unknownErr during pipelined pol transaction")
+                )
+            }
+        )
+    }
+
     override suspend fun exchangeSecurePayload(encryptedBlob: ByteArray): SdkResult<ByteArray, SdkError> {
         return runCatching {
             performRequestResponse(encryptedBlob, config.encryptedWriteUuid, config.encryptedIndicateUuid)
@@ -200,14 +261,14 @@ internal class AndroidBleController(
             .mapNotNull { legacyResult ->
                 val commonScanResult = legacyResult.result
                 // Parse the advertisement data
-                val (beaconId, statusByte) = beaconDataParser.parseConnectableBeaconAd(
+                val (beaconId, statusByte, featuresByte) = beaconDataParser.parseConnectableBeaconAd(
                     commonScanResult,
                     config.manufacturerId
                 )
                 if (beaconId != null) {
                     val matchedInfo = beaconsToFind.find { it.id == beaconId }
                     if (matchedInfo != null) {
-                        FoundBeacon(matchedInfo, commonScanResult.deviceAddress, statusByte)
+                        FoundBeacon(matchedInfo, commonScanResult.deviceAddress, statusByte, featuresByte)
                     } else null
                 } else null
             }
@@ -8,6 +8,7 @@ import ch.drcookie.polaris_sdk.ble.model.ScanMode
 import ch.drcookie.polaris_sdk.ble.model.VerifiedBroadcast
 import ch.drcookie.polaris_sdk.network.NetworkClient
 import ch.drcookie.polaris_sdk.ble.BleController
+import ch.drcookie.polaris_sdk.crypto.TeslaVerifier
 import ch.drcookie.polaris_sdk.protocol.ProtocolHandler
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import kotlinx.coroutines.flow.Flow
@@ -19,7 +20,8 @@ import kotlinx.coroutines.flow.map
 /**
  * A high-level use case for monitoring non-connectable BLE broadcast advertisements.
  *
- * This use case operation initiates a continuous scan and, for each advertisement, verifies its signature.
+ * This use case operation initiates a continuous scan and, for each advertisement, verifies its signature. The
+ * hash-chain sections of the verified broadcasts prove the intervals during which the beacon was received.
  *
  * @property bleController For the underlying BLE scan.
  * @property networkClient To access the list of `knownBeacons` for public keys.
@@ -60,6 +62,7 @@ public class MonitorBroadcasts(
             is SdkResult.Success -> broadcastResult.value
             is SdkResult.Failure -> return flowOf(broadcastResult)
         }
+        val teslaVerifier = TeslaVerifier()
         return beaconFlow.distinctUntilChanged()
             .map<BroadcastPayload, SdkResult<VerifiedBroadcast, SdkError>> { payload ->
                 val beacon = networkClient.knownBeacons.find { it.id == payload.beaconId }
@@ -69,7 +72,9 @@ public class MonitorBroadcasts(
                     false // We don't have a key for this beacon
                 }
 
-                SdkResult.Success(VerifiedBroadcast(payload, isVerified))
+                val proven = if (isVerified) teslaVerifier.process(payload, beacon!!) else emptyList()
+
+                SdkResult.Success(VerifiedBroadcast(payload, isVerified, proven))
             }
             .catch { e ->
                 // If the underlying BLE scan itself throws an exception, catch it...
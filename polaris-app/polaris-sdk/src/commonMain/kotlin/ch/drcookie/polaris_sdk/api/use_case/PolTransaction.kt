@@ -2,6 +2,7 @@ package ch.drcookie.polaris_sdk.api.use_case
 
 import ch.drcookie.polaris_sdk.api.SdkError
 import ch.drcookie.polaris_sdk.api.SdkResult
+import ch.drcookie.polaris_sdk.ble.model.BeaconFeature
 import ch.drcookie.polaris_sdk.ble.model.ConnectionState
 import ch.drcookie.polaris_sdk.ble.model.FoundBeacon
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
@@ -9,6 +10,7 @@ import ch.drcookie.polaris_sdk.protocol.model.PoLToken
 import ch.drcookie.polaris_sdk.network.NetworkClient
 import ch.drcookie.polaris_sdk.ble.BleController
 import ch.drcookie.polaris_sdk.storage.KeyStore
+import ch.drcookie.polaris_sdk.storage.SessionStore
 import ch.drcookie.polaris_sdk.protocol.ProtocolHandler
 import kotlinx.coroutines.flow.filter
 import kotlinx.coroutines.flow.first
@@ -76,8 +78,13 @@ public class PolTransaction(
             }
 
             // Construct the request
+            // Beacons that batch their signatures sign the responses of crowds with one Merkle root, and
+            // beacons supporting sessions serve the next visits with a MAC (see SessionTransaction).
+            var flags: UByte = 0u
+            if (foundBeacon.supports(BeaconFeature.MERKLE_TOKENS)) flags = flags or PoLRequest.FLAG_MERKLE
+            if (foundBeacon.supports(BeaconFeature.SESSIONS)) flags = flags or PoLRequest.FLAG_SESSION
             val request = PoLRequest(
-                flags = 0u,
+                flags = flags,
                 phoneId = phoneId,
                 beaconId = foundBeacon.info.id,
                 nonce = protocolHandler.generateNonce(),
@@ -100,6 +107,12 @@ public class PolTransaction(
                 return SdkResult.Failure(SdkError.ProtocolError("Invalid beacon signature during PoL transaction!"))
             }
 
+            if (signedRequest.flags and PoLRequest.FLAG_SESSION != 0.toUByte()) {
+                SessionStore.put(
+                    protocolHandler.openSession(signedRequest, response, phoneSk, foundBeacon.info.publicKey)
+                )
+            }
+
             // Create and return the final token
             val token = PoLToken.create(signedRequest, response, foundBeacon.info.publicKey)
             return SdkResult.Success(token)
@@ -39,6 +39,9 @@ public class PullAndForward(
         if (!foundBeacon.hasDataPending) {
             return SdkResult.Failure(SdkError.PreconditionError("Beacon does not have the 'data pending' flag set."))
         }
+        if (!foundBeacon.acceptsDataPull) {
+            return SdkResult.Failure(SdkError.PreconditionError("Beacon overloaded, retry the data pull later."))
+        }
 
         try {
             // Connect to the beacon (includes waiting for Ready state)
@@ -50,6 +53,10 @@ public class PullAndForward(
                 is SdkResult.Success -> pullResult.value
                 is SdkResult.Failure -> return pullResult
             }
+            // The beacon became overloaded since its advertisement: it answered with the busy byte.
+            if (beaconData.size == 1 && beaconData[0] == PULL_RESPONSE_BUSY) {
+                return SdkResult.Failure(SdkError.PreconditionError("Beacon overloaded, retry the data pull later."))
+            }
 
             // Forward data to the server
             val id = foundBeacon.info.id
@@ -89,4 +96,9 @@ public class PullAndForward(
             else -> SdkResult.Failure(SdkError.BleError("Unexpected connection state: $finalState"))
         }
     }
-}
\ No newline at end of file
+
+    private companion object {
+        /** The single byte a beacon answers to a data pull refused under load. */
+        const val PULL_RESPONSE_BUSY: Byte = 0x00
+    }
+}
@@ -0,0 +1,91 @@
+package ch.drcookie.polaris_sdk.api.use_case
+
+import ch.drcookie.polaris_sdk.api.SdkError
+import ch.drcookie.polaris_sdk.api.SdkResult
+import ch.drcookie.polaris_sdk.ble.BleController
+import ch.drcookie.polaris_sdk.ble.model.ConnectionState
+import ch.drcookie.polaris_sdk.ble.model.FoundBeacon
+import ch.drcookie.polaris_sdk.protocol.ProtocolHandler
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
+import ch.drcookie.polaris_sdk.storage.SessionStore
+import kotlinx.coroutines.flow.filter
+import kotlinx.coroutines.flow.first
+import kotlinx.coroutines.withTimeoutOrNull
+
+/**
+ * A high-level use case that gets a token from a beacon the phone has an open session with.
+ *
+ * A session is opened by a [PolTransaction] with a beacon advertising
+ * [ch.drcookie.polaris_sdk.ble.model.BeaconFeature.SESSIONS]. The exchange then costs a MAC on both sides instead
+ * of Ed25519 operations. If there is no open session, or the beacon dropped it, this fails with a
+ * [SdkError.PreconditionError] or a [SdkError.ProtocolError] and the caller should run a [PolTransaction].
+ *
+ * @property bleController The controller for the BLE connection and data exchange.
+ * @property protocolHandler The handler for authenticating the request and verifying the token.
+ */
+public class SessionTransaction(
+    private val bleController: BleController,
+    private val protocolHandler: ProtocolHandler,
+) {
+    /** `true` if the phone has an open session with the beacon. */
+    public fun hasSession(foundBeacon: FoundBeacon): Boolean = SessionStore.get(foundBeacon.info.id) != null
+
+    /**
+     * Executes the session transaction with a given beacon.
+     *
+     * @param foundBeacon The [FoundBeacon] to connect to.
+     * @return An [SdkResult] containing the verified [PoLSessionToken] on success.
+     */
+    @OptIn(ExperimentalUnsignedTypes::class)
+    public suspend operator fun invoke(foundBeacon: FoundBeacon): SdkResult<PoLSessionToken, SdkError> {
+        val session = SessionStore.get(foundBeacon.info.id)
+            ?: return SdkResult.Failure(SdkError.PreconditionError("No open session with this beacon."))
+
+        try {
+            when (val connectResult = bleController.connect(foundBeacon.address)) {
+                is SdkResult.Failure -> return connectResult
+                is SdkResult.Success -> { /* Continue */
+                }
+            }
+
+            val status = withTimeoutOrNull(10000L) {
+                bleController.connectionState
+                    .filter { it is ConnectionState.Ready || it is ConnectionState.Failed }
+                    .first()
+            }
+
+            when (status) {
+                is ConnectionState.Ready -> { /* Connection successful, continue */}
+                is ConnectionState.Failed -> return SdkResult.Failure(SdkError.BleError("Connection failed: ${status.error}"))
+                null -> return SdkResult.Failure(SdkError.BleError("Connection timed out."))
+                else -> return SdkResult.Failure(SdkError.BleError("Unexpected connection state: $status"))
+            }
+
+            val request = protocolHandler.authenticateSessionRequest(
+                PoLSessionRequest(session.phoneId, foundBeacon.info.id, protocolHandler.generateNonce()),
+                session
+            )
+
+            val token = when (val tokenResult = bleController.requestSessionToken(request)) {
+                is SdkResult.Success -> tokenResult.value
+                is SdkResult.Failure -> {
+                    // The beacon no longer knows the session (reboot, eviction): a signed request reopens it.
+                    if (tokenResult.error is SdkError.ProtocolError) {
+                        SessionStore.remove(foundBeacon.info.id)
+                    }
+                    return tokenResult
+                }
+            }
+
+            if (!protocolHandler.verifySessionToken(token, request, session)) {
+                SessionStore.remove(foundBeacon.info.id)
+                return SdkResult.Failure(SdkError.ProtocolError("Invalid beacon MAC during session transaction!"))
+            }
+            return SdkResult.Success(token)
+
+        } finally {
+            bleController.disconnect()
+        }
+    }
+}
@@ -11,6 +11,8 @@ import ch.drcookie.polaris_sdk.ble.model.ScanConfig
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.StateFlow
 
@@ -59,6 +61,25 @@ public interface BleController {
      */
     public suspend fun requestPoL(request: PoLRequest): SdkResult<PoLResponse, SdkError>
 
+    /**
+     * Session PoL transaction: a request authenticated with the key of an open session.
+     *
+     * @param request The authenticated [PoLSessionRequest] to send to the beacon.
+     * @return An [SdkResult] containing the beacon's [PoLSessionToken] on success. A [SdkError.ProtocolError]
+     * means the beacon rejected the session, and the phone must send a signed request.
+     */
+    public suspend fun requestSessionToken(request: PoLSessionRequest): SdkResult<PoLSessionToken, SdkError>
+
+    /**
+     * Pipelined PoL transaction: several requests sent in one frame, answered in one frame.
+     * Requires a beacon advertising [ch.drcookie.polaris_sdk.ble.model.BeaconFeature.PIPELINE].
+     *
+     * @param requests The signed [PoLRequest]s to send, at most [ch.drcookie.polaris_sdk.protocol.model.PoLPipeline.MAX_REQUESTS].
+     * @return An [SdkResult] containing the beacon's [PoLResponse] to each request, in the order of the requests,
+     * or `null` for a request the beacon rejected.
+     */
+    public suspend fun requestPoLs(requests: List<PoLRequest>): SdkResult<List<PoLResponse?>, SdkError>
+
     /**
      * Sends an encrypted payload and waits for an encrypted ACK.
      *
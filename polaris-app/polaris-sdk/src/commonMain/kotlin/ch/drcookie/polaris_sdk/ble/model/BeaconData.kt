@@ -25,12 +25,14 @@ public enum class ScanCallbackType {
  *
  * @property info Information about the beacon.
  * @property address The MAC address of the beacon discovered during the scan.
- * @property statusByte Flag that indicate if the beacon has an encrypted payload to deliver
+ * @property statusByte Status flags and load hints of the beacon (data pending, queue depth, token load, shed level)
+ * @property featuresByte The protocol features supported by the beacon, `null` for older firmwares
  */
 public data class FoundBeacon(
     public val info: Beacon,
     public val address: String,
-    public val statusByte: Byte?
+    public val statusByte: Byte?,
+    public val featuresByte: Byte? = null
 ) {
     public val name: String get() = info.name
 
@@ -40,6 +42,56 @@ public data class FoundBeacon(
      */
     public val hasDataPending: Boolean
         get() = statusByte?.let { (it.toInt() and 0x01) == 1 } ?: false
+
+    /**
+     * The bucketed depth of the beacon outgoing queue.
+     * @return 0 (empty), 1 (1-2 messages), 2 (3-8 messages) or 3 (more than 8 messages).
+     */
+    public val outgoingQueueLevel: Int
+        get() = statusByte?.let { (it.toInt() shr 1) and 0x03 } ?: 0
+
+    /**
+     * The load of the beacon token service.
+     * @return 0 (idle), 1 (light), 2 (busy) or 3 (saturated).
+     */
+    public val tokenLoadLevel: Int
+        get() = statusByte?.let { (it.toInt() shr 3) and 0x03 } ?: 0
+
+    /** `true` if the beacon currently drops token requests and should be skipped if possible. */
+    public val isTokenServiceSaturated: Boolean
+        get() = tokenLoadLevel == 3
+
+    /**
+     * The load shedding level of the beacon.
+     * @return 0 (normal), 1 (elevated), 2 (high) or 3 (critical, data pull refused).
+     */
+    public val shedLevel: Int
+        get() = statusByte?.let { (it.toInt() shr 5) and 0x03 } ?: 0
+
+    /** `false` while the beacon refuses the data pull requests, the phone should retry later. */
+    public val acceptsDataPull: Boolean
+        get() = shedLevel < 3
+
+    /**
+     * Checks if the beacon advertises a protocol feature.
+     * @param feature One of the [BeaconFeature] bits.
+     */
+    public fun supports(feature: Int): Boolean =
+        featuresByte?.let { (it.toInt() and feature) != 0 } ?: false
+}
+
+/**
+ * The protocol feature bits advertised by the beacons in their connectable advertisement.
+ */
+public object BeaconFeature {
+    public const val SIGNED_BROADCAST: Int = 0x01
+    public const val ENCRYPTED_CHANNEL: Int = 0x02
+    public const val DATA_PULL: Int = 0x04
+    public const val PERIODIC_BROADCAST: Int = 0x08
+    public const val MERKLE_TOKENS: Int = 0x10
+    public const val SESSIONS: Int = 0x20
+    public const val PIPELINE: Int = 0x40
+    public const val TESLA_BROADCAST: Int = 0x80
 }
 
 
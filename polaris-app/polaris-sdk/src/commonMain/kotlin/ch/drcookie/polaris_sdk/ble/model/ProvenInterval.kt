@@ -0,0 +1,15 @@
+package ch.drcookie.polaris_sdk.ble.model
+
+/**
+ * An interval of a beacon counter during which the phone received the beacon, proven by the hash chain of its
+ * broadcasts (see [ch.drcookie.polaris_sdk.protocol.model.BroadcastTesla]).
+ *
+ * @property beaconId The ID of the beacon.
+ * @property counter The counter of the epoch.
+ * @property interval The interval, 1 to 60.
+ */
+public data class ProvenInterval(
+    public val beaconId: UInt,
+    public val counter: ULong,
+    public val interval: Int,
+)
@@ -7,8 +7,11 @@ import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
  *
  * @property payload The original [BroadcastPayload] parsed from the BLE advertisement.
  * @property isSignatureValid `true` if the payload's signature was verified, `false` otherwise.
+ * @property provenIntervals The intervals proven by the key disclosed in this broadcast, from the tags of the
+ * earlier broadcasts of the beacon.
  */
 public data class VerifiedBroadcast(
     public val payload: BroadcastPayload,
-    public val isSignatureValid: Boolean
+    public val isSignatureValid: Boolean,
+    public val provenIntervals: List<ProvenInterval> = emptyList(),
 )
\ No newline at end of file
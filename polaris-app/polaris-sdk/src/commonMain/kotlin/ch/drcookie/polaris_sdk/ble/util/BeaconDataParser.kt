@@ -13,19 +13,23 @@ internal object BeaconDataParser {
      *
      * @param scanResult The raw scan result from the BLE stack.
      * @param legacyManufId The manufacturer ID to look for in the advertisement data.
-     * @return A [Pair] containing the parsed beacon ID and status byte.
+     * @return A [Triple] containing the parsed beacon ID, status byte and features byte.
      */
-    internal fun parseConnectableBeaconAd(scanResult: CommonBleScanResult, legacyManufId: Int): Pair<UInt?, Byte?> {
-        val manufData = scanResult.manufacturerData[legacyManufId] ?: return null to null
+    internal fun parseConnectableBeaconAd(
+        scanResult: CommonBleScanResult,
+        legacyManufId: Int
+    ): Triple<UInt?, Byte?, Byte?> {
+        val manufData = scanResult.manufacturerData[legacyManufId] ?: return Triple(null, null, null)
 
-        if (manufData.size < 4) return null to null
+        if (manufData.size < 4) return Triple(null, null, null)
 
         val beaconId = manufData.sliceArray(0 until 4).toUByteArray().toUIntLE()
 
-        // The status byte is optional
+        // The status and features bytes are optional (older firmwares)
         val statusByte = if (manufData.size >= 5) manufData[4] else null
+        val featuresByte = if (manufData.size >= 6) manufData[5] else null
 
-        return beaconId to statusByte
+        return Triple(beaconId, statusByte, featuresByte)
     }
 
     /**
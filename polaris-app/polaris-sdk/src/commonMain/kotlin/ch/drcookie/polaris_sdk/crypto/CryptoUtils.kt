@@ -3,11 +3,22 @@ package ch.drcookie.polaris_sdk.crypto
 import ch.drcookie.polaris_sdk.ble.model.Beacon
 import io.github.oshai.kotlinlogging.KotlinLogging
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
+import ch.drcookie.polaris_sdk.protocol.model.BroadcastTesla
 import ch.drcookie.polaris_sdk.protocol.model.Constants
+import ch.drcookie.polaris_sdk.protocol.model.MerkleProof
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSession
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
+import ch.drcookie.polaris_sdk.protocol.model.getAnchorSignedData
 import ch.drcookie.polaris_sdk.protocol.model.getEffectivelySignedData
+import ch.drcookie.polaris_sdk.protocol.model.getMacData
 import ch.drcookie.polaris_sdk.protocol.model.getSignedData
+import ch.drcookie.polaris_sdk.util.ByteConversionUtils.toUByteArrayLE
+import com.ionspin.kotlin.crypto.auth.Auth
+import com.ionspin.kotlin.crypto.generichash.GenericHash
+import com.ionspin.kotlin.crypto.scalarmult.ScalarMultiplication
 import com.ionspin.kotlin.crypto.signature.InvalidSignatureException
 import com.ionspin.kotlin.crypto.signature.Signature
 import com.ionspin.kotlin.crypto.signature.SignatureKeyPair
@@ -47,7 +58,16 @@ internal object CryptoUtils {
             Log.error { "Nonce mismatch in response verification!" }
             return false
         }
-        val dataActuallySignedByBeacon = resp.getEffectivelySignedData(originalSignedReq)
+        val signedData = resp.getEffectivelySignedData(originalSignedReq)
+
+        // In a Merkle batch, the beacon signed the root of the tree the response is a leaf of.
+        val dataActuallySignedByBeacon = resp.proof?.let { proof ->
+            val root = merkleRoot(signedData, proof) ?: run {
+                Log.error { "Malformed Merkle proof in response verification!" }
+                return false
+            }
+            MERKLE_SIGNATURE_CONTEXT.encodeToByteArray().toUByteArray() + root
+        } ?: signedData
         return try {
             // verifyDetached throws on failure, returns Unit on success
             Signature.verifyDetached(resp.beaconSig, dataActuallySignedByBeacon, beaconPk)
@@ -61,6 +81,80 @@ internal object CryptoUtils {
         }
     }
 
+    /**
+     * Derives the key of the [PoLSession] opened by a verified exchange, as the beacon does.
+     *
+     * Both Ed25519 keys are converted to X25519, and the shared secret keys a BLAKE2b hash of the context,
+     * both public keys, the request nonce and the response counter.
+     */
+    internal fun openSession(
+        signedRequest: PoLRequest,
+        response: PoLResponse,
+        phoneSk: UByteArray,
+        beaconPk: UByteArray,
+    ): PoLSession {
+        val phoneCurveSk = Signature.ed25519SkToCurve25519(phoneSk)
+        val beaconCurvePk = Signature.ed25519PkToCurve25519(beaconPk)
+        val shared = ScalarMultiplication.scalarMultiplication(phoneCurveSk, beaconCurvePk)
+
+        val context = SESSION_KDF_CONTEXT.encodeToByteArray().asUByteArray()
+        val key = GenericHash.genericHash(
+            context + signedRequest.phonePk + beaconPk + signedRequest.nonce + response.counter.toUByteArrayLE(),
+            Constants.SESSION_KEY,
+            shared,
+        )
+        phoneCurveSk.fill(0u)
+        shared.fill(0u)
+        return PoLSession(signedRequest.phoneId, response.beaconId, key)
+    }
+
+    /** Authenticates a [PoLSessionRequest] with the session key and returns a new, authenticated instance. */
+    internal fun authenticateSessionRequest(request: PoLSessionRequest, session: PoLSession): PoLSessionRequest {
+        return request.copy(mac = Auth.auth(request.getMacData(), session.key))
+    }
+
+    /** Verifies a [PoLSessionToken], checking the nonce and the MAC. */
+    internal fun verifySessionToken(token: PoLSessionToken, request: PoLSessionRequest, session: PoLSession): Boolean {
+        if (!token.nonce.contentEquals(request.nonce)) {
+            Log.error { "Nonce mismatch in session token verification!" }
+            return false
+        }
+        return Auth.authVerify(token.mac, token.getMacData(request.phoneId), session.key)
+    }
+
+    private const val SESSION_KDF_CONTEXT = "polaris-session"
+
+    /**
+     * Recomputes the Merkle root of a batch from the data of one leaf and its authentication path.
+     * @return The root, or `null` if the proof does not match the leaf count.
+     */
+    private fun merkleRoot(leafData: UByteArray, proof: MerkleProof): UByteArray? {
+        var index = proof.leafIndex.toInt()
+        var count = proof.leafCount.toInt()
+        if (index >= count) return null
+
+        var node = GenericHash.genericHash(ubyteArrayOf(MERKLE_LEAF_DOMAIN) + leafData, Constants.MERKLE_HASH)
+        var offset = 0
+        while (count > 1) {
+            // A node without sibling at this level is promoted unchanged.
+            val hasSibling = index % 2 == 1 || index + 1 < count
+            if (hasSibling) {
+                if (offset + Constants.MERKLE_HASH > proof.path.size) return null
+                val sibling = proof.path.sliceArray(offset until offset + Constants.MERKLE_HASH)
+                offset += Constants.MERKLE_HASH
+                val (left, right) = if (index % 2 == 1) sibling to node else node to sibling
+                node = GenericHash.genericHash(ubyteArrayOf(MERKLE_NODE_DOMAIN) + left + right, Constants.MERKLE_HASH)
+            }
+            index /= 2
+            count = (count + 1) / 2
+        }
+        return if (offset == proof.path.size) node else null
+    }
+
+    private const val MERKLE_LEAF_DOMAIN: UByte = 0x00u
+    private const val MERKLE_NODE_DOMAIN: UByte = 0x01u
+    private const val MERKLE_SIGNATURE_CONTEXT = "polaris-merkle"
+
     /** Verifies the signature of a [BroadcastPayload]. */
     internal fun verifyBeaconBroadcast(payload: BroadcastPayload, knownBeacon: Beacon): Boolean {
 
@@ -80,4 +174,40 @@ internal object CryptoUtils {
             false
         }
     }
-}
\ No newline at end of file
+
+    /** Verifies the signature of the hash-chain anchor of a [BroadcastPayload]. */
+    internal fun verifyTeslaAnchor(payload: BroadcastPayload, knownBeacon: Beacon): Boolean {
+        val signedData = payload.getAnchorSignedData() ?: return false
+        return try {
+            Signature.verifyDetached(payload.tesla!!.anchorSignature, signedData, knownBeacon.publicKey)
+            true
+        } catch (e: InvalidSignatureException) {
+            Log.warn(e) { "Anchor signature verification failed for beacon #${payload.beaconId}" }
+            false
+        }
+    }
+
+    /**
+     * Derives the key of an interval from a later disclosed key, and checks that it hashes to the anchor.
+     *
+     * @param disclosedKey The disclosed key `K(disclosedIndex)`.
+     * @param anchor The verified anchor `K(0)` of the same chain.
+     * @return `K(interval)`, or `null` if the key does not belong to the chain.
+     */
+    internal fun teslaIntervalKey(disclosedKey: UByteArray, disclosedIndex: Int, interval: Int, anchor: UByteArray): UByteArray? {
+        if (interval !in 1..disclosedIndex || disclosedIndex > BroadcastTesla.INTERVALS) return null
+        var key = disclosedKey
+        var intervalKey: UByteArray? = null
+        for (index in disclosedIndex downTo 1) {
+            if (index == interval) intervalKey = key
+            key = GenericHash.genericHash(key, Constants.TESLA_KEY)
+        }
+        return if (key.contentEquals(anchor)) intervalKey else null
+    }
+
+    /** Checks a tag received during [interval] against the key of that interval. */
+    internal fun verifyTeslaTag(tag: UByteArray, intervalKey: UByteArray, beaconId: UInt, counter: ULong, interval: UByte): Boolean {
+        val data = beaconId.toUByteArrayLE() + counter.toUByteArrayLE() + ubyteArrayOf(interval)
+        return GenericHash.genericHash(data, Constants.TESLA_TAG, intervalKey).contentEquals(tag)
+    }
+}
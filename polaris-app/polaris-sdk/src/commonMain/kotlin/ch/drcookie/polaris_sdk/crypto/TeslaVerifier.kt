@@ -0,0 +1,92 @@
+package ch.drcookie.polaris_sdk.crypto
+
+import ch.drcookie.polaris_sdk.ble.model.Beacon
+import ch.drcookie.polaris_sdk.ble.model.ProvenInterval
+import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
+import ch.drcookie.polaris_sdk.protocol.model.BroadcastTesla
+import kotlin.time.TimeSource
+
+/**
+ * Checks the hash-chain (TESLA) sections of the broadcasts of the known beacons.
+ *
+ * For each beacon, it keeps the verified anchor and the tags received for the current counter and the previous one.
+ * A tag is only kept if, on the phone's clock, its key cannot have been disclosed yet: the interval of the first
+ * broadcast of the counter gives the time of the disclosures. Once the key of a kept tag is disclosed, hashes to the
+ * anchor and authenticates the tag, the interval is proven.
+ *
+ * Not thread-safe: meant for a single broadcast stream.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+internal class TeslaVerifier {
+
+    private class Chain(val counter: ULong, val anchor: UByteArray, val firstInterval: Int) {
+        val firstSeen = TimeSource.Monotonic.markNow()
+        val tags = mutableMapOf<Int, UByteArray>()
+        var disclosedIndex = 0
+    }
+
+    private class BeaconChains(var current: Chain, var previous: Chain?)
+
+    private val chains = mutableMapOf<UInt, BeaconChains>()
+
+    /**
+     * Processes a broadcast whose signature was verified.
+     *
+     * @return The intervals proven by the key this broadcast discloses.
+     */
+    fun process(payload: BroadcastPayload, knownBeacon: Beacon): List<ProvenInterval> {
+        val tesla = payload.tesla ?: return emptyList()
+        val interval = tesla.interval.toInt()
+        if (interval !in 1..BroadcastTesla.INTERVALS) return emptyList()
+
+        val state = chains[payload.beaconId]
+        val chain = when {
+            state != null && state.current.counter == payload.counter -> {
+                if (!state.current.anchor.contentEquals(tesla.anchor)) return emptyList()
+                state.current
+            }
+            state != null && state.current.counter > payload.counter -> return emptyList()
+            else -> {
+                if (!CryptoUtils.verifyTeslaAnchor(payload, knownBeacon)) return emptyList()
+                val chain = Chain(payload.counter, tesla.anchor, interval)
+                val previous = state?.current?.takeIf { it.counter + 1u == payload.counter }
+                chains[payload.beaconId] = BeaconChains(chain, previous)
+                chain
+            }
+        }
+
+        // The first intervals disclose the last keys of the previous chain.
+        val disclosing = if (interval > BroadcastTesla.DISCLOSURE_DELAY) chain else chains[payload.beaconId]!!.previous
+        val proven = disclosing?.let { disclose(it, tesla, payload.beaconId) } ?: emptyList()
+
+        if (interval > chain.disclosedIndex && interval !in chain.tags && isUndisclosed(chain, interval)) {
+            chain.tags[interval] = tesla.tag
+        }
+        return proven
+    }
+
+    /** Whether the key of [interval] cannot have been disclosed yet, on the phone's clock. */
+    private fun isUndisclosed(chain: Chain, interval: Int): Boolean {
+        // The first broadcast was received at most one interval after the start of its interval.
+        val intervalsLeft = interval + BroadcastTesla.DISCLOSURE_DELAY - chain.firstInterval - 1
+        return chain.firstSeen.elapsedNow().inWholeMilliseconds < intervalsLeft * BroadcastTesla.INTERVAL_MS
+    }
+
+    private fun disclose(chain: Chain, tesla: BroadcastTesla, beaconId: UInt): List<ProvenInterval> {
+        val index = tesla.disclosedIndex.toInt()
+        if (index <= chain.disclosedIndex) return emptyList()
+        // The section is not signed, a key that does not hash to the anchor is ignored.
+        CryptoUtils.teslaIntervalKey(tesla.disclosedKey, index, index, chain.anchor) ?: return emptyList()
+        chain.disclosedIndex = index
+
+        val proven = mutableListOf<ProvenInterval>()
+        for (interval in chain.tags.keys.filter { it <= index }) {
+            val tag = chain.tags.remove(interval)!!
+            val key = CryptoUtils.teslaIntervalKey(tesla.disclosedKey, index, interval, chain.anchor) ?: continue
+            if (CryptoUtils.verifyTeslaTag(tag, key, beaconId, chain.counter, interval.toUByte())) {
+                proven.add(ProvenInterval(beaconId, chain.counter, interval))
+            }
+        }
+        return proven
+    }
+}
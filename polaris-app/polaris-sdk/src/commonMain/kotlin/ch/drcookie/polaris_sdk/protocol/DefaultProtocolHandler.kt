@@ -5,6 +5,9 @@ import ch.drcookie.polaris_sdk.crypto.CryptoUtils
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSession
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
 
 /**
  * The default implementation of the [ProtocolHandler] interface.
@@ -27,6 +30,23 @@ internal class DefaultProtocolHandler(private val cryptoUtils: CryptoUtils) : Pr
         return cryptoUtils.verifyPoLResponse(response, signedRequest, beaconPublicKey)
     }
 
+    override fun openSession(
+        signedRequest: PoLRequest,
+        response: PoLResponse,
+        secretKey: UByteArray,
+        beaconPublicKey: UByteArray,
+    ): PoLSession {
+        return cryptoUtils.openSession(signedRequest, response, secretKey, beaconPublicKey)
+    }
+
+    override fun authenticateSessionRequest(request: PoLSessionRequest, session: PoLSession): PoLSessionRequest {
+        return cryptoUtils.authenticateSessionRequest(request, session)
+    }
+
+    override fun verifySessionToken(token: PoLSessionToken, request: PoLSessionRequest, session: PoLSession): Boolean {
+        return cryptoUtils.verifySessionToken(token, request, session)
+    }
+
     override fun verifyBroadcast(payload: BroadcastPayload, knownBeacon: Beacon): Boolean {
         return cryptoUtils.verifyBeaconBroadcast(payload, knownBeacon)
     }
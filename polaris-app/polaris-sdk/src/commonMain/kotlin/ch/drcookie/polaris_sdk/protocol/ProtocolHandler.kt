@@ -4,6 +4,9 @@ import ch.drcookie.polaris_sdk.ble.model.Beacon
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSession
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
 
 /**
  * Provides an interface for low-level, **synchronous** cryptographic operations related to the Polaris protocol.
@@ -38,6 +41,41 @@ public interface ProtocolHandler {
      */
     public fun verifyPoLResponse(response: PoLResponse, signedRequest: PoLRequest, beaconPublicKey: UByteArray): Boolean
 
+    /**
+     * Derives the [PoLSession] opened by a verified exchange whose request carried [PoLRequest.FLAG_SESSION].
+     *
+     * @param signedRequest The signed request that was sent to the beacon.
+     * @param response The verified response of the beacon.
+     * @param secretKey The Ed25519 secret key of the phone.
+     * @param beaconPublicKey The known public key of the beacon.
+     * @return The session, holding the key shared with the beacon.
+     */
+    public fun openSession(
+        signedRequest: PoLRequest,
+        response: PoLResponse,
+        secretKey: UByteArray,
+        beaconPublicKey: UByteArray,
+    ): PoLSession
+
+    /**
+     * Authenticates a [PoLSessionRequest] with the key of a [PoLSession].
+     *
+     * @param request The request to authenticate.
+     * @param session The open session with the beacon.
+     * @return A new [PoLSessionRequest] instance with the `mac` field populated.
+     */
+    public fun authenticateSessionRequest(request: PoLSessionRequest, session: PoLSession): PoLSessionRequest
+
+    /**
+     * Verifies the MAC and the nonce of a [PoLSessionToken].
+     *
+     * @param token The token received from the beacon.
+     * @param request The authenticated request that was sent to the beacon.
+     * @param session The session the request was authenticated with.
+     * @return `true` if the MAC and nonce are valid, `false` otherwise.
+     */
+    public fun verifySessionToken(token: PoLSessionToken, request: PoLSessionRequest, session: PoLSession): Boolean
+
     /**
      * Verifies the signature of a broadcast advertisement payload.
      *
@@ -8,12 +8,15 @@ package ch.drcookie.polaris_sdk.protocol.model
  * @property beaconId Unique identifier of the beacon sending the broadcast.
  * @property counter Monotonic counter from the beacon.
  * @property signature Ed25519 signature of the concatenated [beaconId] and [counter]
+ * @property tesla The hash-chain section, sent by the beacons advertising
+ * [ch.drcookie.polaris_sdk.ble.model.BeaconFeature.TESLA_BROADCAST].
  */
 @OptIn(ExperimentalUnsignedTypes::class)
 public data class BroadcastPayload(
     public val beaconId: UInt,
     public val counter: ULong,
-    public val signature: UByteArray
+    public val signature: UByteArray,
+    public val tesla: BroadcastTesla? = null,
 ) {
     init {
         // Enforce size constraint for the signature
@@ -34,6 +37,7 @@ public data class BroadcastPayload(
         var result = beaconId.hashCode()
         result = 31 * result + counter.hashCode()
         result = 31 * result + signature.contentHashCode()
+        result = 31 * result + (tesla?.hashCode() ?: 0)
         return result
     }
 
@@ -46,7 +50,83 @@ public data class BroadcastPayload(
         if (beaconId != other.beaconId) return false
         if (counter != other.counter) return false
         if (!signature.contentEquals(other.signature)) return false
+        if (tesla != other.tesla) return false
 
         return true
     }
-}
\ No newline at end of file
+}
+
+/**
+ * The hash-chain (TESLA) section of a broadcast, appended after the signature.
+ *
+ * The beacon draws a one-way key chain per counter, `K(i-1) = BLAKE2b-128(K(i))`, and signs its [anchor] `K(0)`.
+ * During [interval] i, the broadcast carries a [tag] keyed with `K(i)` and discloses an earlier key. A phone keeps
+ * the tag; once `K(i)` is disclosed and hashes to the signed anchor, the tag proves the beacon was in range during
+ * interval i.
+ *
+ * @property anchor The anchor of the chain of [BroadcastPayload.counter].
+ * @property anchorSignature Ed25519 signature of `"polaris-tesla" || beaconId || counter || anchor`.
+ * @property interval The current interval, 1 to 60.
+ * @property disclosedIndex The index of [disclosedKey]. During the first [DISCLOSURE_DELAY] intervals, it is the
+ * index `INTERVALS - DISCLOSURE_DELAY + interval` in the previous counter's chain, or 0 for the anchor (nothing to
+ * disclose after a reboot).
+ * @property disclosedKey The disclosed key.
+ * @property tag BLAKE2b-128 keyed with `K(interval)` over `beaconId || counter || interval`.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public data class BroadcastTesla(
+    public val anchor: UByteArray,
+    public val anchorSignature: UByteArray,
+    public val interval: UByte,
+    public val disclosedIndex: UByte,
+    public val disclosedKey: UByteArray,
+    public val tag: UByteArray,
+) {
+    init {
+        require(anchor.size == Constants.TESLA_KEY) { "Invalid anchor size" }
+        require(anchorSignature.size == Constants.SIG) { "Invalid anchor signature size" }
+        require(disclosedKey.size == Constants.TESLA_KEY) { "Invalid disclosed key size" }
+        require(tag.size == Constants.TESLA_TAG) { "Invalid tag size" }
+    }
+
+    public companion object {
+        /** The packed size in bytes of the section. */
+        public const val PACKED_SIZE: Int = Constants.TESLA_KEY + Constants.SIG + 2 + Constants.TESLA_KEY +
+                Constants.TESLA_TAG
+
+        /** The number of intervals of a counter. */
+        public const val INTERVALS: Int = 60
+
+        /** The length of an interval. */
+        public const val INTERVAL_MS: Long = 1000
+
+        /** The number of intervals between the use of a key and its disclosure. */
+        public const val DISCLOSURE_DELAY: Int = 2
+    }
+
+    public override fun hashCode(): Int {
+        var result = anchor.contentHashCode()
+        result = 31 * result + anchorSignature.contentHashCode()
+        result = 31 * result + interval.hashCode()
+        result = 31 * result + disclosedIndex.hashCode()
+        result = 31 * result + disclosedKey.contentHashCode()
+        result = 31 * result + tag.contentHashCode()
+        return result
+    }
+
+    public override fun equals(other: Any?): Boolean {
+        if (this === other) return true
+        if (other == null || this::class != other::class) return false
+
+        other as BroadcastTesla
+
+        if (!anchor.contentEquals(other.anchor)) return false
+        if (!anchorSignature.contentEquals(other.anchorSignature)) return false
+        if (interval != other.interval) return false
+        if (disclosedIndex != other.disclosedIndex) return false
+        if (!disclosedKey.contentEquals(other.disclosedKey)) return false
+        if (!tag.contentEquals(other.tag)) return false
+
+        return true
+    }
+}
@@ -28,8 +28,27 @@ public fun broadcastPayloadFromBytes(data: UByteArray): BroadcastPayload? {
 
     // Parse signature (64 bytes)
     val signature = data.sliceArray(offset until offset + Constants.SIG)
+    offset += Constants.SIG
 
-    return BroadcastPayload(beaconId, counter, signature)
+    // The hash-chain section is optional, older beacons stop after the signature
+    val tesla = if (data.size - offset >= BroadcastTesla.PACKED_SIZE) teslaFromBytes(data, offset) else null
+
+    return BroadcastPayload(beaconId, counter, signature, tesla)
+}
+
+@OptIn(ExperimentalUnsignedTypes::class)
+private fun teslaFromBytes(data: UByteArray, start: Int): BroadcastTesla {
+    var offset = start
+    val anchor = data.sliceArray(offset until offset + Constants.TESLA_KEY)
+    offset += Constants.TESLA_KEY
+    val anchorSignature = data.sliceArray(offset until offset + Constants.SIG)
+    offset += Constants.SIG
+    val interval = data[offset++]
+    val disclosedIndex = data[offset++]
+    val disclosedKey = data.sliceArray(offset until offset + Constants.TESLA_KEY)
+    offset += Constants.TESLA_KEY
+    val tag = data.sliceArray(offset until offset + Constants.TESLA_TAG)
+    return BroadcastTesla(anchor, anchorSignature, interval, disclosedIndex, disclosedKey, tag)
 }
 
 /**
@@ -41,4 +60,15 @@ public fun broadcastPayloadFromBytes(data: UByteArray): BroadcastPayload? {
 public fun BroadcastPayload.getSignedData(): UByteArray {
     // Concatenate the little-endian byte representations of beaconId and counter
     return beaconId.toUByteArrayLE() + counter.toUByteArrayLE()
-}
\ No newline at end of file
+}
+
+/**
+ * Reconstructs the data signed by the beacon with the anchor of its hash chain.
+ *
+ * @return `"polaris-tesla" || beaconId || counter || anchor`, or `null` without hash-chain section.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun BroadcastPayload.getAnchorSignedData(): UByteArray? {
+    val section = tesla ?: return null
+    return "polaris-tesla".encodeToByteArray().toUByteArray() + getSignedData() + section.anchor
+}
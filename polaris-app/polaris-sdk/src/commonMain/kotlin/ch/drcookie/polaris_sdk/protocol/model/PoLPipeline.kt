@@ -0,0 +1,69 @@
+package ch.drcookie.polaris_sdk.protocol.model
+
+/**
+ * Framing of pipelined PoL requests: several requests sent in one write, each tagged with a request ID.
+ *
+ * Frame layout, in both directions: `[FLAG][count]` then, for each entry, `[request ID][length][bytes]`.
+ * The beacon answers a frame with a single frame holding the answer of each request, matched by ID. An
+ * entry with a zero length got no answer. A malformed frame is answered with a compact error response.
+ *
+ * Only supported by the beacons advertising [ch.drcookie.polaris_sdk.ble.model.BeaconFeature.PIPELINE].
+ */
+public object PoLPipeline {
+    /** The first byte of a frame, never set in the flags of a [PoLRequest]. */
+    public const val FLAG: UByte = 0x08u
+
+    /** The maximum number of requests in a frame. */
+    public const val MAX_REQUESTS: Int = 4
+
+    /** The size of the header of a frame, and of the header of each of its entries. */
+    public const val HEADER_SIZE: Int = 2
+}
+
+/**
+ * Builds a pipelined frame. The request ID of each request is its index in the list.
+ * @param requests The serialized requests ([PoLRequest] or [PoLSessionRequest]), at most
+ * [PoLPipeline.MAX_REQUESTS].
+ * @return The serialized frame.
+ */
+public fun pipelineFrameToBytes(requests: List<ByteArray>): ByteArray {
+    require(requests.isNotEmpty() && requests.size <= PoLPipeline.MAX_REQUESTS) { "Invalid request count" }
+    require(requests.all { it.size <= UByte.MAX_VALUE.toInt() }) { "Request too large for a frame" }
+
+    val size = PoLPipeline.HEADER_SIZE + requests.sumOf { PoLPipeline.HEADER_SIZE + it.size }
+    val buffer = ByteArray(size)
+    var offset = 0
+    buffer[offset++] = PoLPipeline.FLAG.toByte()
+    buffer[offset++] = requests.size.toByte()
+    requests.forEachIndexed { id, request ->
+        buffer[offset++] = id.toByte()
+        buffer[offset++] = request.size.toByte()
+        request.copyInto(buffer, offset)
+        offset += request.size
+    }
+    return buffer
+}
+
+/**
+ * Parses the answers of a pipelined frame.
+ * @param data The raw byte array received over BLE.
+ * @return The answers by request ID, an empty array for a request without answer, or `null` if the data is
+ * not a well-formed frame.
+ */
+public fun pipelineAnswersFromBytes(data: ByteArray): Map<Int, ByteArray>? {
+    if (data.size < PoLPipeline.HEADER_SIZE || data[0].toUByte() != PoLPipeline.FLAG) return null
+    val count = data[1].toUByte().toInt()
+
+    val answers = mutableMapOf<Int, ByteArray>()
+    var offset = PoLPipeline.HEADER_SIZE
+    repeat(count) {
+        if (offset + PoLPipeline.HEADER_SIZE > data.size) return null
+        val id = data[offset].toUByte().toInt()
+        val length = data[offset + 1].toUByte().toInt()
+        offset += PoLPipeline.HEADER_SIZE
+        if (offset + length > data.size) return null
+        answers[id] = data.copyOfRange(offset, offset + length)
+        offset += length
+    }
+    return if (offset == data.size) answers else null
+}
@@ -11,6 +11,12 @@ internal object Constants {
     const val FLAGS = 1
     const val BEACON_ID = 4
     const val BEACON_COUNTER = 8
+    const val MERKLE_HASH = 32
+    const val MERKLE_MAX_DEPTH = 3
+    const val SESSION_KEY = 32
+    const val SESSION_MAC = 32
+    const val TESLA_KEY = 16
+    const val TESLA_TAG = 16
 }
 
 /**
@@ -39,6 +45,12 @@ public data class PoLRequest(
     }
 
     public companion object {
+        /** Request flag asking the beacon to sign its response as part of a Merkle batch. */
+        public const val FLAG_MERKLE: UByte = 0x01u
+
+        /** Request flag opening a [PoLSession] with the beacon. */
+        public const val FLAG_SESSION: UByte = 0x02u
+
         /** The size in bytes of the data within a [PoLRequest] that is covered by the phone's signature. */
         public const val SIGNED_DATA_SIZE: Int =
             Constants.FLAGS + // 1
@@ -82,7 +94,8 @@ public data class PoLRequest(
  * @property beaconId The unique ID of the responding beacon.
  * @property counter The beacon internal counter at the time of the transaction.
  * @property nonce The same nonce that was provided in the original [PoLRequest], returned for verification.
- * @property beaconSig The beacon signature.
+ * @property beaconSig The beacon signature, over the Merkle root of the batch if [proof] is set.
+ * @property proof The authentication path of the response in its batch, with [FLAG_MERKLE] only.
  */
 @OptIn(ExperimentalUnsignedTypes::class)
 public data class PoLResponse(
@@ -91,6 +104,7 @@ public data class PoLResponse(
     val counter: ULong,
     val nonce: UByteArray,
     val beaconSig: UByteArray,
+    val proof: MerkleProof? = null,
 ) {
     init {
         require(nonce.size == Constants.PROTOCOL_NONCE) { "Invalid nonce size" }
@@ -98,6 +112,8 @@ public data class PoLResponse(
     }
 
     public companion object {
+        /** Response flag marking a beacon signature over a Merkle root, followed by a [MerkleProof]. */
+        public const val FLAG_MERKLE: UByte = 0x01u
 
         /** Size in bytes of the data that the beacon effectively signed, including context from the original request. */
         public const val EFFECTIVE_SIGNED_DATA_SIZE: Int =
@@ -124,6 +140,7 @@ public data class PoLResponse(
         result = 31 * result + counter.hashCode()
         result = 31 * result + nonce.contentHashCode()
         result = 31 * result + beaconSig.contentHashCode()
+        result = 31 * result + (proof?.hashCode() ?: 0)
         return result
     }
 
@@ -136,6 +153,71 @@ public data class PoLResponse(
         if (counter != other.counter) return false
         if (!nonce.contentEquals(other.nonce)) return false
         if (!beaconSig.contentEquals(other.beaconSig)) return false
+        if (proof != other.proof) return false
+        return true
+    }
+}
+
+/**
+ * The authentication path of a response in a beacon Merkle batch.
+ *
+ * Leaves are `BLAKE2b-256(0x00 || signed data)` and inner nodes `BLAKE2b-256(0x01 || left || right)`.
+ * A node without sibling is promoted unchanged, so the path has no entry for that level.
+ *
+ * @property leafIndex The position of the response in the batch.
+ * @property leafCount The number of responses in the batch.
+ * @property path The concatenated sibling hashes, leaf level first.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public data class MerkleProof(
+    val leafIndex: UByte,
+    val leafCount: UByte,
+    val path: UByteArray,
+) {
+    init {
+        require(path.size % Constants.MERKLE_HASH == 0) { "Invalid Merkle path size" }
+    }
+
+    public override fun hashCode(): Int {
+        var result = leafIndex.hashCode()
+        result = 31 * result + leafCount.hashCode()
+        result = 31 * result + path.contentHashCode()
+        return result
+    }
+
+    public override fun equals(other: Any?): Boolean {
+        if (this === other) return true
+        if (other == null || this::class != other::class) return false
+        other as MerkleProof
+        if (leafIndex != other.leafIndex) return false
+        if (leafCount != other.leafCount) return false
+        if (!path.contentEquals(other.path)) return false
         return true
     }
-}
\ No newline at end of file
+}
+
+/**
+ * The reason a beacon rejected a [PoLRequest], carried by its compact error response.
+ *
+ * @property code The error code on the wire.
+ */
+public enum class PoLErrorCode(public val code: UByte) {
+    INVALID_LENGTH(0x01u),
+    WRONG_BEACON(0x02u),
+    UNSUPPORTED_FLAGS(0x03u),
+    REPLAY(0x04u),
+    RATE_LIMITED(0x05u),
+    INVALID_SIGNATURE(0x06u),
+    UNKNOWN_SESSION(0x07u),
+    REVOKED(0x08u),
+    SIGNING_FAILED(0x09u),
+    UNKNOWN(0xFFu);
+
+    public companion object {
+        /** [PoLResponse] flag marking a compact error response: `[flags][error code]`. */
+        public const val FLAG_ERROR: UByte = 0x80u
+
+        /** Returns the [PoLErrorCode] of a wire code, or [UNKNOWN]. */
+        public fun fromCode(code: UByte): PoLErrorCode = entries.firstOrNull { it.code == code } ?: UNKNOWN
+    }
+}
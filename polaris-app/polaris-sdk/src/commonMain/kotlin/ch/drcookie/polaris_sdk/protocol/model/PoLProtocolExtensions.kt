@@ -104,6 +104,29 @@ public fun PoLResponse.getEffectivelySignedData(originalRequest: PoLRequest): UB
     return buffer
 }
 
+/**
+ * Checks whether raw response data is a compact error response from the beacon
+ * (`[flags][error code][retry after]`).
+ * @param data The raw byte array received over BLE.
+ * @return The [PoLErrorCode] sent by the beacon, or `null` if the data is not an error response.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun poLErrorFromBytes(data: ByteArray): PoLErrorCode? {
+    if (data.size < Constants.FLAGS + 1) return null
+    val flags = data[0].toUByte()
+    if (flags and PoLErrorCode.FLAG_ERROR == 0.toUByte()) return null
+    return PoLErrorCode.fromCode(data[Constants.FLAGS].toUByte())
+}
+
+/**
+ * Reads the retry delay of a compact error response.
+ * @param data The raw byte array of an error response.
+ * @return The delay in seconds after which the phone may retry, 0 if the beacon did not set one.
+ */
+public fun poLErrorRetryAfterSeconds(data: ByteArray): Int {
+    return if (data.size > Constants.FLAGS + 1) data[Constants.FLAGS + 1].toUByte().toInt() else 0
+}
+
 /**
  * Attempts to parse a [PoLResponse] from a raw byte array.
  * @param data The raw byte array received over BLE.
@@ -124,9 +147,23 @@ public fun poLResponseFromBytes(data: ByteArray): PoLResponse? {
     val nonce = uData.sliceArray(offset until offset + Constants.PROTOCOL_NONCE)
     offset += Constants.PROTOCOL_NONCE
     val beaconSig = uData.sliceArray(offset until offset + Constants.SIG)
-    offset += Constants.SIG // If we ever want to add something after that
+    offset += Constants.SIG
+
+    if (flags and PoLResponse.FLAG_MERKLE == 0.toUByte()) {
+        return PoLResponse(flags, beaconId, counter, nonce, beaconSig)
+    }
 
-    return PoLResponse(flags, beaconId, counter, nonce, beaconSig)
+    // Merkle proof: [leaf index][leaf count][path]
+    if (uData.size < offset + 2) return null
+    val leafIndex = uData[offset++]
+    val leafCount = uData[offset++]
+    val pathSize = uData.size - offset
+    if (pathSize % Constants.MERKLE_HASH != 0 || pathSize > Constants.MERKLE_MAX_DEPTH * Constants.MERKLE_HASH) {
+        return null
+    }
+    val path = uData.sliceArray(offset until uData.size)
+
+    return PoLResponse(flags, beaconId, counter, nonce, beaconSig, MerkleProof(leafIndex, leafCount, path))
 }
 
 /**
@@ -136,12 +173,87 @@ public fun poLResponseFromBytes(data: ByteArray): PoLResponse? {
  */
 @OptIn(ExperimentalUnsignedTypes::class)
 public fun PoLResponse.toBytes(): ByteArray {
-    val buffer = UByteArray(PACKED_SIZE)
+    val buffer = UByteArray(PACKED_SIZE + (proof?.let { 2 + it.path.size } ?: 0))
     var offset = 0
     buffer[offset] = flags; offset += 1
     beaconId.toUByteArrayLE().copyInto(buffer, offset); offset += 4
     counter.toUByteArrayLE().copyInto(buffer, offset); offset += 8
     nonce.copyInto(buffer, offset); offset += Constants.PROTOCOL_NONCE
-    beaconSig.copyInto(buffer, offset)
+    beaconSig.copyInto(buffer, offset); offset += Constants.SIG
+    proof?.let {
+        buffer[offset++] = it.leafIndex
+        buffer[offset++] = it.leafCount
+        it.path.copyInto(buffer, offset)
+    }
     return buffer.asByteArray()
-}
\ No newline at end of file
+}
+
+/**
+ * Reconstructs the portion of a [PoLSessionRequest] that is covered by the session MAC.
+ * @return A [UByteArray] containing the data to be authenticated.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun PoLSessionRequest.getMacData(): UByteArray {
+    val buffer = UByteArray(PoLSessionRequest.MAC_DATA_SIZE)
+    var offset = 0
+    buffer[offset] = flags; offset += 1
+    phoneId.toUByteArrayLE().copyInto(buffer, offset); offset += 8
+    beaconId.toUByteArrayLE().copyInto(buffer, offset); offset += 4
+    nonce.copyInto(buffer, offset)
+    return buffer
+}
+
+/**
+ * Serializes a [PoLSessionRequest] into a [ByteArray] for BLE transmission.
+ * @return The serialized byte array representation of the request.
+ * @throws IllegalStateException if the request has not been authenticated.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun PoLSessionRequest.toBytes(): ByteArray {
+    val requestMac = mac ?: throw IllegalStateException("PoLSessionRequest must be authenticated before serialization")
+    val buffer = UByteArray(PoLSessionRequest.PACKED_SIZE)
+    getMacData().copyInto(buffer, 0)
+    requestMac.copyInto(buffer, PoLSessionRequest.MAC_DATA_SIZE)
+    return buffer.asByteArray()
+}
+
+/**
+ * Reconstructs the data the beacon authenticated for a [PoLSessionToken].
+ * @param phoneId The phone ID of the request.
+ * @return A [UByteArray] containing the data to be verified against the session MAC.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun PoLSessionToken.getMacData(phoneId: ULong): UByteArray {
+    val buffer = UByteArray(PoLSessionToken.MAC_DATA_SIZE)
+    var offset = 0
+    buffer[offset] = flags; offset += 1
+    beaconId.toUByteArrayLE().copyInto(buffer, offset); offset += 4
+    counter.toUByteArrayLE().copyInto(buffer, offset); offset += 8
+    nonce.copyInto(buffer, offset); offset += Constants.PROTOCOL_NONCE
+    phoneId.toUByteArrayLE().copyInto(buffer, offset)
+    return buffer
+}
+
+/**
+ * Attempts to parse a [PoLSessionToken] from a raw byte array.
+ * @param data The raw byte array received over BLE.
+ * @return A parsed [PoLSessionToken] object, or `null` if the data is malformed or has an incorrect length.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public fun poLSessionTokenFromBytes(data: ByteArray): PoLSessionToken? {
+    if (data.size != PoLSessionToken.PACKED_SIZE) return null
+    var offset = 0
+    val uData = data.toUByteArray()
+
+    val flags = uData[offset]
+    offset += Constants.FLAGS
+    val beaconId = uData.sliceArray(offset until offset + Constants.BEACON_ID).toUIntLE()
+    offset += Constants.BEACON_ID
+    val counter = uData.sliceArray(offset until offset + Constants.BEACON_COUNTER).toULongLE()
+    offset += Constants.BEACON_COUNTER
+    val nonce = uData.sliceArray(offset until offset + Constants.PROTOCOL_NONCE)
+    offset += Constants.PROTOCOL_NONCE
+    val mac = uData.sliceArray(offset until offset + Constants.SESSION_MAC)
+
+    return PoLSessionToken(flags, beaconId, counter, nonce, mac)
+}
@@ -0,0 +1,150 @@
+package ch.drcookie.polaris_sdk.protocol.model
+
+import kotlin.time.Duration
+import kotlin.time.Duration.Companion.hours
+import kotlin.time.TimeSource
+
+/**
+ * A session opened with a beacon by a signed PoL exchange carrying [PoLRequest.FLAG_SESSION].
+ *
+ * Both sides derive [key] from the exchange. Until the session expires, the phone gets tokens with a
+ * [PoLSessionRequest] authenticated with a MAC instead of a signature.
+ *
+ * @property phoneId The ID of the phone that opened the session.
+ * @property beaconId The ID of the beacon.
+ * @property key The session key (HMAC-SHA-512-256 key).
+ * @property openedAt When the session was opened.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public class PoLSession(
+    public val phoneId: ULong,
+    public val beaconId: UInt,
+    public val key: UByteArray,
+    public val openedAt: TimeSource.Monotonic.ValueTimeMark = TimeSource.Monotonic.markNow(),
+) {
+    init {
+        require(key.size == Constants.SESSION_KEY) { "Invalid session key size" }
+    }
+
+    /** `true` once the beacon has dropped the session. */
+    public val isExpired: Boolean
+        get() = openedAt.elapsedNow() >= LIFETIME
+
+    public companion object {
+        /** The lifetime of a session on the beacon. */
+        public val LIFETIME: Duration = 1.hours
+    }
+}
+
+/**
+ * Request sent to a beacon with an open [PoLSession], authenticated with the session key.
+ *
+ * @property phoneId The ID of the phone that opened the session.
+ * @property beaconId The ID of the target beacon.
+ * @property nonce A random value ensuring the uniqueness of this request.
+ * @property mac The MAC of the preceding fields, under the session key.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public data class PoLSessionRequest(
+    val phoneId: ULong,
+    val beaconId: UInt,
+    val nonce: UByteArray,
+    val mac: UByteArray? = null,
+) {
+    init {
+        require(nonce.size == Constants.PROTOCOL_NONCE) { "Invalid nonce size" }
+        mac?.let { require(it.size == Constants.SESSION_MAC) { "Invalid MAC size" } }
+    }
+
+    /** The flags byte, which tells a session request apart from a [PoLRequest]. */
+    val flags: UByte get() = FLAG_SESSION_MAC
+
+    public companion object {
+        /** Flags of a session request. */
+        public const val FLAG_SESSION_MAC: UByte = 0x04u
+
+        /** The size in bytes of the data covered by the MAC. */
+        public const val MAC_DATA_SIZE: Int =
+            Constants.FLAGS + Constants.PHONE_ID + Constants.BEACON_ID + Constants.PROTOCOL_NONCE
+
+        /** The total packed size in bytes of a serialized [PoLSessionRequest]. */
+        public const val PACKED_SIZE: Int = MAC_DATA_SIZE + Constants.SESSION_MAC // 61 bytes
+    }
+
+    public override fun hashCode(): Int {
+        var result = phoneId.hashCode()
+        result = 31 * result + beaconId.hashCode()
+        result = 31 * result + nonce.contentHashCode()
+        result = 31 * result + (mac?.contentHashCode() ?: 0)
+        return result
+    }
+
+    public override fun equals(other: Any?): Boolean {
+        if (this === other) return true
+        if (other == null || this::class != other::class) return false
+        other as PoLSessionRequest
+        if (phoneId != other.phoneId) return false
+        if (beaconId != other.beaconId) return false
+        if (!nonce.contentEquals(other.nonce)) return false
+        if (!mac.contentEquals(other.mac)) return false
+        return true
+    }
+}
+
+/**
+ * Token sent by a beacon in answer to a [PoLSessionRequest], authenticated with the session key.
+ *
+ * Unlike a [PoLToken], it is verifiable by the phone only, which holds the session key.
+ *
+ * @property flags Protocol-specific flags.
+ * @property beaconId The unique ID of the responding beacon.
+ * @property counter The beacon internal counter at the time of the transaction.
+ * @property nonce The nonce of the request.
+ * @property mac The MAC of the token and of the phone ID, under the session key.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+public data class PoLSessionToken(
+    val flags: UByte,
+    val beaconId: UInt,
+    val counter: ULong,
+    val nonce: UByteArray,
+    val mac: UByteArray,
+) {
+    init {
+        require(nonce.size == Constants.PROTOCOL_NONCE) { "Invalid nonce size" }
+        require(mac.size == Constants.SESSION_MAC) { "Invalid MAC size" }
+    }
+
+    public companion object {
+        /** The size in bytes of the data covered by the MAC, including the phone ID of the request. */
+        public const val MAC_DATA_SIZE: Int =
+            Constants.FLAGS + Constants.BEACON_ID + Constants.BEACON_COUNTER + Constants.PROTOCOL_NONCE +
+                Constants.PHONE_ID
+
+        /** The total packed size in bytes of a serialized [PoLSessionToken]. */
+        public const val PACKED_SIZE: Int =
+            Constants.FLAGS + Constants.BEACON_ID + Constants.BEACON_COUNTER + Constants.PROTOCOL_NONCE +
+                Constants.SESSION_MAC // 61 bytes
+    }
+
+    public override fun hashCode(): Int {
+        var result = flags.hashCode()
+        result = 31 * result + beaconId.hashCode()
+        result = 31 * result + counter.hashCode()
+        result = 31 * result + nonce.contentHashCode()
+        result = 31 * result + mac.contentHashCode()
+        return result
+    }
+
+    public override fun equals(other: Any?): Boolean {
+        if (this === other) return true
+        if (other == null || this::class != other::class) return false
+        other as PoLSessionToken
+        if (flags != other.flags) return false
+        if (beaconId != other.beaconId) return false
+        if (counter != other.counter) return false
+        if (!nonce.contentEquals(other.nonce)) return false
+        if (!mac.contentEquals(other.mac)) return false
+        return true
+    }
+}
@@ -14,7 +14,10 @@ import kotlinx.serialization.Serializable
  * @property phonePk The public key of the phone.
  * @property beaconPk The public key of the beacon.
  * @property phoneSig The phone's signature over the request data.
- * @property beaconSig The beacon's signature over the response data.
+ * @property beaconSig The beacon's signature over the response data, or over the Merkle root of its batch.
+ * @property merkleLeafIndex The position of the response in its Merkle batch ([PoLRequest.FLAG_MERKLE] only).
+ * @property merkleLeafCount The number of responses in the Merkle batch, 0 if the response was signed alone.
+ * @property merklePath The authentication path of the response in its Merkle batch.
  */
 @Serializable
 @OptIn(ExperimentalUnsignedTypes::class)
@@ -32,7 +35,11 @@ public data class PoLToken(
     @Serializable(with = UByteArrayBase64Serializer::class)
     public val phoneSig: UByteArray,
     @Serializable(with = UByteArrayBase64Serializer::class)
-    public val beaconSig: UByteArray
+    public val beaconSig: UByteArray,
+    public val merkleLeafIndex: UByte = 0u,
+    public val merkleLeafCount: UByte = 0u,
+    @Serializable(with = UByteArrayBase64Serializer::class)
+    public val merklePath: UByteArray = UByteArray(0),
 ) {
     init {
         require(nonce.size == Constants.PROTOCOL_NONCE)
@@ -64,6 +71,9 @@ public data class PoLToken(
                 beaconPk = beaconPk,
                 phoneSig = pSig,
                 beaconSig = response.beaconSig,
+                merkleLeafIndex = response.proof?.leafIndex ?: 0u,
+                merkleLeafCount = response.proof?.leafCount ?: 0u,
+                merklePath = response.proof?.path ?: UByteArray(0),
             )
         }
     }
@@ -78,6 +88,9 @@ public data class PoLToken(
         result = 31 * result + beaconId.hashCode()
         result = 31 * result + beaconCounter.hashCode()
         result = 31 * result + beaconSig.contentHashCode()
+        result = 31 * result + merkleLeafIndex.hashCode()
+        result = 31 * result + merkleLeafCount.hashCode()
+        result = 31 * result + merklePath.contentHashCode()
         return result
     }
 
@@ -96,6 +109,9 @@ public data class PoLToken(
         if (!beaconPk.contentEquals(other.beaconPk)) return false
         if (!phoneSig.contentEquals(other.phoneSig)) return false
         if (!beaconSig.contentEquals(other.beaconSig)) return false
+        if (merkleLeafIndex != other.merkleLeafIndex) return false
+        if (merkleLeafCount != other.merkleLeafCount) return false
+        if (!merklePath.contentEquals(other.merklePath)) return false
 
         return true
     }
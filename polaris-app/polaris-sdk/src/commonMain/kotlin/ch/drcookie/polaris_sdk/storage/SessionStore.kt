@@ -0,0 +1,32 @@
+package ch.drcookie.polaris_sdk.storage
+
+import ch.drcookie.polaris_sdk.protocol.model.PoLSession
+
+/**
+ * In-memory store of the [PoLSession]s opened with beacons, keyed by beacon ID.
+ *
+ * Sessions are short-lived and cheap to reopen, so they are not persisted. Expired sessions are dropped on access.
+ */
+internal object SessionStore {
+    private val sessions = mutableMapOf<UInt, PoLSession>()
+
+    /** Stores a session, replacing the previous one with the same beacon. */
+    fun put(session: PoLSession) {
+        sessions[session.beaconId] = session
+    }
+
+    /** Returns the open session with a beacon, or `null`. */
+    fun get(beaconId: UInt): PoLSession? {
+        val session = sessions[beaconId] ?: return null
+        if (session.isExpired) {
+            sessions.remove(beaconId)
+            return null
+        }
+        return session
+    }
+
+    /** Forgets the session with a beacon. */
+    fun remove(beaconId: UInt) {
+        sessions.remove(beaconId)
+    }
+}
@@ -12,6 +12,8 @@ import ch.drcookie.polaris_sdk.ble.model.ScanConfig
 import ch.drcookie.polaris_sdk.protocol.model.BroadcastPayload
 import ch.drcookie.polaris_sdk.protocol.model.PoLRequest
 import ch.drcookie.polaris_sdk.protocol.model.PoLResponse
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionRequest
+import ch.drcookie.polaris_sdk.protocol.model.PoLSessionToken
 import kotlinx.coroutines.flow.Flow
 import kotlinx.coroutines.flow.StateFlow
 import platform.darwin.NSObject
@@ -42,6 +44,14 @@ internal class IosBleController(
         TODO("Not yet implemented")
     }
 
+    override suspend fun requestSessionToken(request: PoLSessionRequest): SdkResult<PoLSessionToken, SdkError> {
+        TODO("Not yet implemented")
+    }
+
+    override suspend fun requestPoLs(requests: List<PoLRequest>): SdkResult<List<PoLResponse?>, SdkError> {
+        TODO("Not yet implemented")
+    }
+
     override suspend fun exchangeSecurePayload(encryptedBlob: ByteArray): SdkResult<ByteArray, SdkError> {
         TODO("Not yet implemented")
     }
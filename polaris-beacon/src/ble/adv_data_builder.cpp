@@ -0,0 +1,88 @@
+#include "adv_data_builder.h"
+
+#include <string.h>
+
+namespace {
+int hexValue(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+}  // namespace
+
+AdvDataBuilder::AdvDataBuilder(size_t maxLen)
+    : _maxLen(maxLen < EXTENDED_MAX_LEN ? maxLen : EXTENDED_MAX_LEN) {
+}
+
+void AdvDataBuilder::clear() {
+    _len = 0;
+}
+
+bool AdvDataBuilder::addFlags(uint8_t flags) {
+    return addField(AD_TYPE_FLAGS, &flags, sizeof(flags));
+}
+
+bool AdvDataBuilder::addManufacturerData(uint16_t manufacturerId, const uint8_t* data,
+                                         size_t len) {
+    uint8_t field[EXTENDED_MAX_LEN];
+    if (len + sizeof(manufacturerId) > sizeof(field)) {
+        return false;
+    }
+    field[0] = (uint8_t)(manufacturerId & 0xFF);
+    field[1] = (uint8_t)(manufacturerId >> 8);
+    if (len > 0) {
+        memcpy(field + sizeof(manufacturerId), data, len);
+    }
+    return addField(AD_TYPE_MANUFACTURER_DATA, field, len + sizeof(manufacturerId));
+}
+
+bool AdvDataBuilder::addCompleteUuid128(const char* uuid) {
+    // The string is big-endian, the AD structure carries the UUID little-endian.
+    uint8_t bytes[16];
+    size_t count = 0;
+    for (const char* p = uuid; *p && count < sizeof(bytes); ++p) {
+        if (*p == '-')
+            continue;
+        int hi = hexValue(p[0]);
+        int lo = hexValue(p[1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        bytes[sizeof(bytes) - 1 - count++] = (uint8_t)((hi << 4) | lo);
+        ++p;
+    }
+    if (count != sizeof(bytes)) {
+        return false;
+    }
+    return addField(AD_TYPE_COMPLETE_UUID128, bytes, sizeof(bytes));
+}
+
+bool AdvDataBuilder::addCompleteName(const char* name) {
+    return addField(AD_TYPE_COMPLETE_NAME, reinterpret_cast<const uint8_t*>(name), strlen(name));
+}
+
+bool AdvDataBuilder::addField(uint8_t type, const uint8_t* data, size_t len) {
+    // [len][type][data...], where len covers the type byte and the data.
+    if (len > 254 || _len + 2 + len > _maxLen) {
+        return false;
+    }
+    _buffer[_len++] = (uint8_t)(len + 1);
+    _buffer[_len++] = type;
+    if (len > 0) {
+        memcpy(_buffer + _len, data, len);
+        _len += len;
+    }
+    return true;
+}
+
+const uint8_t* AdvDataBuilder::data() const {
+    return _buffer;
+}
+
+size_t AdvDataBuilder::size() const {
+    return _len;
+}
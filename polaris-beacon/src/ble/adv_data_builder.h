@@ -0,0 +1,92 @@
+#ifndef ADV_DATA_BUILDER_H
+#define ADV_DATA_BUILDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class AdvDataBuilder
+ * @brief Builds raw advertising data (a sequence of [len][type][data] AD structures).
+ *
+ * The builder works on a fixed internal buffer so it can be used in any context without heap
+ * allocation, and its output can be handed to any IBleMultiAdvertiser backend.
+ */
+class AdvDataBuilder {
+public:
+    /// @brief AD type: Flags.
+    static constexpr uint8_t AD_TYPE_FLAGS = 0x01;
+
+    /// @brief AD type: Complete list of 128-bit service UUIDs.
+    static constexpr uint8_t AD_TYPE_COMPLETE_UUID128 = 0x07;
+
+    /// @brief AD type: Complete local name.
+    static constexpr uint8_t AD_TYPE_COMPLETE_NAME = 0x09;
+
+    /// @brief AD type: Manufacturer specific data.
+    static constexpr uint8_t AD_TYPE_MANUFACTURER_DATA = 0xFF;
+
+    /// @brief Flags bit: LE General Discoverable Mode.
+    static constexpr uint8_t FLAG_GENERAL_DISCOVERABLE = 0x02;
+
+    /// @brief Flags bit: BR/EDR Not Supported.
+    static constexpr uint8_t FLAG_BREDR_NOT_SUPPORTED = 0x04;
+
+    /// @brief The maximum size of a legacy advertising or scan response payload.
+    static constexpr size_t LEGACY_MAX_LEN = 31;
+
+    /// @brief The maximum size of an extended advertising payload handled by the builder.
+    static constexpr size_t EXTENDED_MAX_LEN = 251;
+
+    /**
+     * @brief Constructs an empty builder.
+     * @param maxLen The capacity of the payload (at most EXTENDED_MAX_LEN).
+     */
+    explicit AdvDataBuilder(size_t maxLen = LEGACY_MAX_LEN);
+
+    /** @brief Clears the payload. */
+    void clear();
+
+    /** @brief Adds a Flags AD structure. */
+    bool addFlags(uint8_t flags);
+
+    /**
+     * @brief Adds a Manufacturer Specific Data AD structure.
+     * @param manufacturerId The company identifier, written little-endian.
+     * @param data The manufacturer data following the company identifier.
+     * @param len The length of the data.
+     */
+    bool addManufacturerData(uint16_t manufacturerId, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Adds a Complete 128-bit Service UUID AD structure.
+     * @param uuid The UUID in its canonical string form ("xxxxxxxx-xxxx-...").
+     */
+    bool addCompleteUuid128(const char* uuid);
+
+    /** @brief Adds a Complete Local Name AD structure. */
+    bool addCompleteName(const char* name);
+
+    /**
+     * @brief Adds an arbitrary AD structure.
+     * @return False if the structure does not fit in the remaining capacity.
+     */
+    bool addField(uint8_t type, const uint8_t* data, size_t len);
+
+    /** @brief Gets a pointer to the built payload. */
+    const uint8_t* data() const;
+
+    /** @brief Gets the size of the built payload. */
+    size_t size() const;
+
+private:
+    /// @brief The raw payload.
+    uint8_t _buffer[EXTENDED_MAX_LEN];
+
+    /// @brief The capacity of the payload.
+    size_t _maxLen;
+
+    /// @brief The number of bytes written so far.
+    size_t _len = 0;
+};
+
+#endif  // ADV_DATA_BUILDER_H
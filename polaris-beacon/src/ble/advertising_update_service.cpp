@@ -0,0 +1,276 @@
+#include "advertising_update_service.h"
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+AdvertisingUpdateService::AdvertisingUpdateService() {
+}
+
+AdvertisingUpdateService::~AdvertisingUpdateService() {
+    stop();
+}
+
+bool AdvertisingUpdateService::begin(IBleMultiAdvertiser& advertiser) {
+    _advertiser = &advertiser;
+    _shutdownRequested = false;
+
+    // Refresh handlers may sign payloads, hence the stack size.
+    BaseType_t res = xTaskCreatePinnedToCore(ownerTask, "AdvUpd", 6144, this, 1, &_task,
+                                             tskNO_AFFINITY);
+    if (res != pdPASS) {
+        Serial.printf("%s CRITICAL: Failed to create owner task!\n", TAG);
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void AdvertisingUpdateService::stop() {
+    if (_task == nullptr) {
+        return;
+    }
+    _shutdownRequested = true;
+    xTaskNotify(_task, 0, eNoAction);
+    vTaskDelay(pdMS_TO_TICKS(100));  // Give the task a moment to see the shutdown flag.
+    if (_task != nullptr) {
+        vTaskDelete(_task);
+        _task = nullptr;
+    }
+}
+
+AdvertisingUpdateService::Handle AdvertisingUpdateService::registerTemplate(
+    uint8_t instance, Target target, const uint8_t* data, size_t len, uint32_t minIntervalMs) {
+    if (len > MAX_PAYLOAD_SIZE) {
+        Serial.printf("%s Template too large (%zu bytes).\n", TAG, len);
+        return INVALID_HANDLE;
+    }
+
+    for (size_t i = 0; i < MAX_SLOTS; ++i) {
+        Slot& slot = _slots[i];
+        if (slot.used) {
+            continue;
+        }
+        taskENTER_CRITICAL(&_lock);
+        slot.used = true;
+        slot.instance = instance;
+        slot.target = target;
+        slot.len = len;
+        slot.minIntervalMs = minIntervalMs;
+        memcpy(slot.staging, data, len);
+        slot.dirty = true;
+        slot.urgent = true;  // The first version is never delayed.
+        taskEXIT_CRITICAL(&_lock);
+
+        if (_task) {
+            xTaskNotify(_task, NOTIFY_SLOTS_DIRTY, eSetBits);
+        }
+        return static_cast<Handle>(i);
+    }
+
+    Serial.printf("%s No free template slot.\n", TAG);
+    return INVALID_HANDLE;
+}
+
+bool AdvertisingUpdateService::patch(Handle slot, size_t offset, const uint8_t* data, size_t len,
+                                     bool urgent) {
+    if (!isValidSlot(slot) || offset + len > _slots[slot].len) {
+        return false;
+    }
+
+    Slot& s = _slots[slot];
+    taskENTER_CRITICAL(&_lock);
+    if (memcmp(s.staging + offset, data, len) != 0) {
+        memcpy(s.staging + offset, data, len);
+        s.dirty = true;
+        s.urgent = s.urgent || urgent;
+    }
+    bool notify = s.dirty;
+    taskEXIT_CRITICAL(&_lock);
+
+    if (notify && _task) {
+        xTaskNotify(_task, NOTIFY_SLOTS_DIRTY, eSetBits);
+    }
+    return true;
+}
+
+bool AdvertisingUpdateService::patchBits(Handle slot, size_t offset, uint8_t mask, uint8_t value,
+                                         bool urgent) {
+    if (!isValidSlot(slot) || offset >= _slots[slot].len) {
+        return false;
+    }
+
+    Slot& s = _slots[slot];
+    taskENTER_CRITICAL(&_lock);
+    uint8_t updated = (s.staging[offset] & ~mask) | (value & mask);
+    if (updated != s.staging[offset]) {
+        s.staging[offset] = updated;
+        s.dirty = true;
+        s.urgent = s.urgent || urgent;
+    }
+    bool notify = s.dirty;
+    taskEXIT_CRITICAL(&_lock);
+
+    if (notify && _task) {
+        xTaskNotify(_task, NOTIFY_SLOTS_DIRTY, eSetBits);
+    }
+    return true;
+}
+
+AdvertisingUpdateService::Handle AdvertisingUpdateService::registerRefreshHandler(
+    std::function<void()> handler) {
+    for (size_t i = 0; i < MAX_REFRESH_HANDLERS; ++i) {
+        if (!_refreshHandlers[i]) {
+            _refreshHandlers[i] = handler;
+            return static_cast<Handle>(i);
+        }
+    }
+    Serial.printf("%s No free refresh handler.\n", TAG);
+    return INVALID_HANDLE;
+}
+
+void AdvertisingUpdateService::requestRefresh(Handle handler) {
+    if (handler < 0 || handler >= (Handle)MAX_REFRESH_HANDLERS || !_task) {
+        return;
+    }
+    xTaskNotify(_task, 1u << (NOTIFY_REFRESH_SHIFT + handler), eSetBits);
+}
+
+bool AdvertisingUpdateService::setInstanceEnabled(uint8_t instance, bool enabled) {
+    if (instance >= MAX_INSTANCES) {
+        return false;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    _instanceRequests[instance].pending = true;
+    _instanceRequests[instance].enabled = enabled;
+    taskEXIT_CRITICAL(&_lock);
+
+    if (_task) {
+        xTaskNotify(_task, NOTIFY_INSTANCES, eSetBits);
+    }
+    return true;
+}
+
+bool AdvertisingUpdateService::isValidSlot(Handle slot) const {
+    return slot >= 0 && slot < (Handle)MAX_SLOTS && _slots[slot].used;
+}
+
+// ========== OWNER TASK ==========
+void AdvertisingUpdateService::ownerTask(void* pvParameters) {
+    static_cast<AdvertisingUpdateService*>(pvParameters)->run();
+    static_cast<AdvertisingUpdateService*>(pvParameters)->_task = nullptr;
+    vTaskDelete(NULL);
+}
+
+void AdvertisingUpdateService::run() {
+    Serial.printf("%s Owner task started.\n", TAG);
+
+    // Apply the templates registered and the requests made before the task existed.
+    applyInstanceRequests();
+    TickType_t wait = applyDirtySlots();
+
+    while (!_shutdownRequested) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+        if (_shutdownRequested) {
+            break;
+        }
+
+        if (bits & NOTIFY_INSTANCES) {
+            applyInstanceRequests();
+        }
+        for (size_t i = 0; i < MAX_REFRESH_HANDLERS; ++i) {
+            if ((bits & (1u << (NOTIFY_REFRESH_SHIFT + i))) && _refreshHandlers[i]) {
+                _refreshHandlers[i]();
+            }
+        }
+
+        wait = applyDirtySlots();
+    }
+    Serial.printf("%s Owner task shutting down.\n", TAG);
+}
+
+void AdvertisingUpdateService::applyInstanceRequests() {
+    for (uint8_t instance = 0; instance < MAX_INSTANCES; ++instance) {
+        taskENTER_CRITICAL(&_lock);
+        InstanceRequest request = _instanceRequests[instance];
+        _instanceRequests[instance].pending = false;
+        taskEXIT_CRITICAL(&_lock);
+        if (!request.pending) {
+            continue;
+        }
+
+        // A connect and a disconnect coalesced into a start are still applied: the stack may
+        // have stopped the connectable instance by itself.
+        bool ok = request.enabled ? _advertiser->start(instance) : _advertiser->stop(instance);
+        if (!ok) {
+            Serial.printf("%s Failed to %s instance %u.\n", TAG,
+                          request.enabled ? "start" : "stop", instance);
+        }
+    }
+}
+
+TickType_t AdvertisingUpdateService::applyDirtySlots() {
+    TickType_t nextWait = portMAX_DELAY;
+    uint32_t now = millis();
+
+    for (Slot& slot : _slots) {
+        if (!slot.used) {
+            continue;
+        }
+
+        taskENTER_CRITICAL(&_lock);
+        bool due = false;
+        uint32_t remaining = 0;
+        if (slot.dirty) {
+            uint32_t elapsed = now - slot.lastApplyMs;
+            uint32_t interval = slot.minIntervalMs;
+            if (slot.failed && interval < RETRY_DELAY_MS) {
+                interval = RETRY_DELAY_MS;
+            }
+            if ((slot.urgent && !slot.failed) || elapsed >= interval) {
+                // Copy the new version. The published buffer is only read below, by this task. The
+                // slot stays dirty until the stack accepted it.
+                memcpy(slot.published, slot.staging, slot.len);
+                due = true;
+            } else {
+                remaining = interval - elapsed;
+            }
+        }
+        taskEXIT_CRITICAL(&_lock);
+
+        if (remaining > 0) {
+            TickType_t ticks = pdMS_TO_TICKS(remaining) + 1;
+            nextWait = ticks < nextWait ? ticks : nextWait;
+            continue;
+        }
+        if (!due) {
+            continue;
+        }
+
+        bool ok = slot.target == Target::Periodic
+                      ? _advertiser->setPeriodicAdvertisingData(slot.instance, slot.published,
+                                                                slot.len)
+                      : _advertiser->setAdvertisingData(slot.instance, slot.published, slot.len);
+        slot.lastApplyMs = now;
+
+        // The slot stays dirty if the update was refused, or if a patch was made meanwhile.
+        taskENTER_CRITICAL(&_lock);
+        slot.failed = !ok;
+        if (ok && memcmp(slot.published, slot.staging, slot.len) == 0) {
+            slot.dirty = false;
+            slot.urgent = false;
+        }
+        taskEXIT_CRITICAL(&_lock);
+
+        if (!ok) {
+            Serial.printf("%s Failed to update instance %u (%s), retrying.\n", TAG, slot.instance,
+                          slot.target == Target::Periodic ? "periodic" : "adv");
+            uint32_t retryMs =
+                slot.minIntervalMs > RETRY_DELAY_MS ? slot.minIntervalMs : RETRY_DELAY_MS;
+            TickType_t ticks = pdMS_TO_TICKS(retryMs) + 1;
+            nextWait = ticks < nextWait ? ticks : nextWait;
+        }
+    }
+    return nextWait;
+}
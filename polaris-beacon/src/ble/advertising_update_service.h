@@ -0,0 +1,233 @@
+#ifndef ADVERTISING_UPDATE_SERVICE_H
+#define ADVERTISING_UPDATE_SERVICE_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <functional>
+
+#include "stack/ible_stack.h"
+
+/**
+ * @class AdvertisingUpdateService
+ * @brief Owns every runtime change of the advertising payloads.
+ *
+ * Each advertised payload is registered once as a raw template (a slot). Producers then only
+ * patch the bytes that change, from any task or timer context: a patch is a short copy into the
+ * slot staging buffer and a task notification, no allocation and no call into the BLE stack.
+ *
+ * A single owner task applies the pending changes. It copies the staging buffer into the
+ * published buffer (the one handed to the controller) and pushes it to the stack. Several patches
+ * made before the owner task runs are coalesced into one update, and a slot can enforce a minimum
+ * interval between two updates, except for patches flagged as urgent.
+ *
+ * Producers that need real work to compute their bytes (e.g. a signature) register a refresh
+ * handler. Requesting a refresh is cheap, and the handler runs in the owner task.
+ *
+ * Starting and stopping an instance (e.g. the connectable one around a connection) is requested
+ * the same way, and applied by the owner task.
+ */
+class AdvertisingUpdateService {
+public:
+    /**
+     * @enum Target
+     * @brief Which data of an advertising instance a slot holds.
+     */
+    enum class Target : uint8_t {
+        Advertising,  ///< The advertising data of the instance.
+        Periodic      ///< The data of the periodic train attached to the instance.
+    };
+
+    /// @brief The identifier of a registered template, or of a refresh handler.
+    using Handle = int8_t;
+
+    /// @brief The value returned when a registration fails.
+    static constexpr Handle INVALID_HANDLE = -1;
+
+    /// @brief The maximum number of templates.
+    static constexpr size_t MAX_SLOTS = 4;
+
+    /// @brief The maximum number of refresh handlers.
+    static constexpr size_t MAX_REFRESH_HANDLERS = 4;
+
+    /// @brief The maximum size of a template (an extended advertising payload).
+    static constexpr size_t MAX_PAYLOAD_SIZE = 251;
+
+    /// @brief The number of advertising instances whose start and stop can be requested.
+    static constexpr size_t MAX_INSTANCES = 4;
+
+    /// @brief The minimum time before retrying an update refused by the stack.
+    static constexpr uint32_t RETRY_DELAY_MS = 500;
+
+    AdvertisingUpdateService();
+    ~AdvertisingUpdateService();
+
+    /**
+     * @brief Starts the owner task.
+     * @param advertiser The multi-advertising controller the payloads are applied to.
+     * @return True on success, false otherwise.
+     */
+    bool begin(IBleMultiAdvertiser& advertiser);
+
+    /**
+     * @brief Stops the owner task. Pending changes are discarded.
+     */
+    void stop();
+
+    /**
+     * @brief Registers a payload template. It is applied as soon as the owner task runs.
+     *
+     * Must be called during setup, before any patch of the slot.
+     * @param instance The advertising instance ID.
+     * @param target Which data of the instance the template holds.
+     * @param data The complete raw payload.
+     * @param len The length of the payload.
+     * @param minIntervalMs The minimum time between two non-urgent updates of the slot.
+     * @return A handle to the slot, or INVALID_HANDLE on failure.
+     */
+    Handle registerTemplate(uint8_t instance, Target target, const uint8_t* data, size_t len,
+                            uint32_t minIntervalMs = 0);
+
+    /**
+     * @brief Overwrites some bytes of a template.
+     * @param slot The slot handle.
+     * @param offset The offset of the first byte to overwrite.
+     * @param data The new bytes.
+     * @param len The number of bytes.
+     * @param urgent True to bypass the minimum interval of the slot.
+     * @return False if the handle or the range is invalid.
+     */
+    bool patch(Handle slot, size_t offset, const uint8_t* data, size_t len, bool urgent = false);
+
+    /**
+     * @brief Replaces some bits of a template byte, atomically.
+     * @param slot The slot handle.
+     * @param offset The offset of the byte.
+     * @param mask The bits to replace.
+     * @param value The new value of the bits.
+     * @param urgent True to bypass the minimum interval of the slot.
+     * @return False if the handle or the offset is invalid.
+     */
+    bool patchBits(Handle slot, size_t offset, uint8_t mask, uint8_t value, bool urgent = false);
+
+    /**
+     * @brief Registers a function the owner task runs on request.
+     *
+     * Must be called during setup.
+     * @return A handle to pass to `requestRefresh`, or INVALID_HANDLE on failure.
+     */
+    Handle registerRefreshHandler(std::function<void()> handler);
+
+    /**
+     * @brief Asks the owner task to run a refresh handler. Requests made before it runs are
+     * coalesced.
+     */
+    void requestRefresh(Handle handler);
+
+    /**
+     * @brief Asks the owner task to start or stop an advertising instance. Safe from the BLE host
+     * callbacks.
+     *
+     * Only the last request made before the owner task runs is applied. Requests made before
+     * `begin` are applied when the task starts.
+     * @param instance The advertising instance ID.
+     * @param enabled True to start the instance, false to stop it.
+     * @return False if the instance ID is invalid.
+     */
+    bool setInstanceEnabled(uint8_t instance, bool enabled);
+
+private:
+    AdvertisingUpdateService(const AdvertisingUpdateService&) = delete;
+    AdvertisingUpdateService& operator=(const AdvertisingUpdateService&) = delete;
+
+    /**
+     * @struct Slot
+     * @brief A registered template and its double buffer.
+     */
+    struct Slot {
+        bool used = false;
+        uint8_t instance = 0;
+        Target target = Target::Advertising;
+        size_t len = 0;
+        uint32_t minIntervalMs = 0;
+
+        /// @brief The time (millis) of the last update pushed to the stack.
+        uint32_t lastApplyMs = 0;
+
+        /// @brief True if staging differs from what was last accepted by the stack.
+        bool dirty = false;
+
+        /// @brief True if the pending change must bypass the minimum interval.
+        bool urgent = false;
+
+        /// @brief True if the last update was refused by the stack, it is retried after
+        /// RETRY_DELAY_MS at least.
+        bool failed = false;
+
+        /// @brief The buffer written by the producers.
+        uint8_t staging[MAX_PAYLOAD_SIZE];
+
+        /// @brief The buffer handed to the stack, only touched by the owner task.
+        uint8_t published[MAX_PAYLOAD_SIZE];
+    };
+
+    /**
+     * @struct InstanceRequest
+     * @brief The last requested state of an advertising instance.
+     */
+    struct InstanceRequest {
+        /// @brief True until the owner task applied the request.
+        bool pending = false;
+        bool enabled = false;
+    };
+
+    /// @brief Notification bits signaling dirty slots and instance requests. Refresh handlers use
+    /// the following bits.
+    static constexpr uint32_t NOTIFY_SLOTS_DIRTY = 1u << 0;
+    static constexpr uint32_t NOTIFY_INSTANCES = 1u << 1;
+    static constexpr uint32_t NOTIFY_REFRESH_SHIFT = 2;
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[AdvUpdate]";
+
+    /** @brief The FreeRTOS task function of the owner task. */
+    static void ownerTask(void* pvParameters);
+
+    /** @brief The owner task main loop. */
+    void run();
+
+    /**
+     * @brief Pushes the due slots to the stack.
+     * @return The delay until the next deferred slot is due, or portMAX_DELAY if none.
+     */
+    TickType_t applyDirtySlots();
+
+    /** @brief Starts or stops the instances with a pending request. */
+    void applyInstanceRequests();
+
+    /** @brief Checks a slot handle. */
+    bool isValidSlot(Handle slot) const;
+
+    /// @brief The multi-advertising controller.
+    IBleMultiAdvertiser* _advertiser = nullptr;
+
+    /// @brief The owner task handle.
+    TaskHandle_t _task = nullptr;
+
+    /// @brief Protects the staging buffers, the dirty flags and the instance requests.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief A flag to signal the owner task to shut down.
+    volatile bool _shutdownRequested = false;
+
+    /// @brief The templates.
+    Slot _slots[MAX_SLOTS];
+
+    /// @brief The refresh handlers.
+    std::function<void()> _refreshHandlers[MAX_REFRESH_HANDLERS];
+
+    /// @brief The start and stop requests, by instance ID.
+    InstanceRequest _instanceRequests[MAX_INSTANCES];
+};
+
+#endif  // ADVERTISING_UPDATE_SERVICE_H
@@ -1,60 +1,58 @@
 #include "ble_manager.h"
 
-#include <BLE2902.h>         // For standard descriptors like CCCD
-#include <BLEAdvertising.h>  // For BLEMultiAdvertising and BLEAdvertisementData
-#include <BLEDevice.h>
-#include <BLEUUID.h>
-#include <BLEUtils.h>        // For helper functions like esp_err_to_name
+#include <Arduino.h>
 #include <HardwareSerial.h>  // For Serial output
 
 #include <algorithm>
 
+#include "adv_data_builder.h"
 #include "characteristics/indicate_characteristic.h"
 #include "characteristics/write_characteristic.h"
+#include "protocol/transport/fragmentation_header.h"
+#include "stack/ble_stack_factory.h"
 
 // ========== SERVER CALLBACKS ==========
 BleManager::ServerCallbacks::ServerCallbacks(BleManager* mngr) : _parentManager(mngr) {
 }
 
-void BleManager::ServerCallbacks::onMtuChanged(BLEServer* _, esp_ble_gatts_cb_param_t* param) {
-    Serial.printf("[BLE] Negotiated MTU: %u bytes\n", param->mtu.mtu);
+void BleManager::ServerCallbacks::onMtuChanged(uint16_t mtu) {
+    Serial.printf("[BLE] Negotiated MTU: %u bytes\n", mtu);
     if (_parentManager) {
-        _parentManager->updateMtu(param->mtu.mtu);
+        _parentManager->updateMtu(mtu);
     }
 }
 
-void BleManager::ServerCallbacks::onConnect(BLEServer* _) {
+void BleManager::ServerCallbacks::onConnect() {
     if (!_parentManager)
         return;
 
     Serial.println("[BLE] Client connected.");
 
     // While in a connection, we stop the connectable advertisement.
-    // It will be restarted on disconnect.
-    if (_parentManager->getMultiAdvertiser()) {
-        _parentManager->getMultiAdvertiser()->stop(1, &LEGACY_TOKEN_ADV_INSTANCE);
+    // It will be restarted on disconnect, by the advertising owner task.
+    if (_parentManager->_advUpdates) {
+        _parentManager->_advUpdates->setInstanceEnabled(LEGACY_TOKEN_ADV_INSTANCE, false);
     }
 }
 
-void BleManager::ServerCallbacks::onDisconnect(BLEServer* _) {
-    if (_parentManager && _parentManager->getMultiAdvertiser()) {
+void BleManager::ServerCallbacks::onDisconnect() {
+    if (_parentManager && _parentManager->_advUpdates) {
         Serial.println("[BLE] Client disconnected. Restarting legacy adv instance.");
-        _parentManager->getMultiAdvertiser()->start(1, LEGACY_TOKEN_ADV_INSTANCE);
+        _parentManager->_advUpdates->setInstanceEnabled(LEGACY_TOKEN_ADV_INSTANCE, true);
     }
 }
 
 // ========== CONSTRUCTOR & DESTRUCTOR ==========
-BleManager::BleManager() {
-    // We create a multi-advertising instance to manage different advertising sets.
-    _multiAdvertiserPtr =
-        std::unique_ptr<BLEMultiAdvertising>(new BLEMultiAdvertising(NUM_ADV_INSTANCES));
+BleManager::BleManager() : BleManager(createBleStack()) {
+}
 
+BleManager::BleManager(std::unique_ptr<IBleStack> stack) : _stack(std::move(stack)) {
     // Create a dedicated FreeRTOS queue for each type of incoming request.
     // This decouples the BLE callback (which should be fast) from the potentially
     // slow processing of the request itself.
-    _tokenQueue = xQueueCreate(4, sizeof(TokenRequestMessage));
-    _encryptedQueue = xQueueCreate(4, sizeof(EncryptedRequestMessage));
-    _pullQueue = xQueueCreate(4, sizeof(uint8_t));
+    _tokenQueue = xQueueCreate(REQUEST_QUEUE_DEPTH, sizeof(TokenRequestMessage));
+    _encryptedQueue = xQueueCreate(REQUEST_QUEUE_DEPTH, sizeof(EncryptedRequestMessage));
+    _pullQueue = xQueueCreate(REQUEST_QUEUE_DEPTH, sizeof(uint8_t));
 }
 
 BleManager::~BleManager() {
@@ -62,30 +60,27 @@ BleManager::~BleManager() {
 }
 
 void BleManager::begin(const std::string& deviceName) {
-    // Standard BLE stack initialization.
+    // Standard BLE stack initialization, requesting a large MTU for faster data transfer.
     Serial.println("[BLE] Initializing BLE Device stack...");
-    BLEDevice::init("");
-
-    // Request a large MTU for faster data transfer.
-    Serial.println("[BLE] Setting global MTU...");
-    BLEDevice::setMTU(517);
-
-    // Create the main GATT server and register our callback handler.
-    Serial.println("[BLE] Creating GATT Server...");
-    _pServer = BLEDevice::createServer();
-    if (!_pServer) {
-        Serial.println("[BLE] CRITICAL: Failed to create BLE server!");
+    if (!_stack || !_stack->init(517)) {
+        Serial.println("[BLE] CRITICAL: Failed to initialize BLE stack!");
         stop();
         return;
     }
 
+    // Create the main GATT server and register our callback handler.
+    Serial.println("[BLE] Creating GATT Server...");
     _serverCallbacks = std::unique_ptr<ServerCallbacks>(new ServerCallbacks(this));
     if (!_serverCallbacks) {
         Serial.println("[BLE] CRITICAL: Failed to allocate server callback!");
         stop();
         return;
     }
-    _pServer->setCallbacks(_serverCallbacks.get());
+    if (!_stack->createServer(_serverCallbacks.get())) {
+        Serial.println("[BLE] CRITICAL: Failed to create BLE server!");
+        stop();
+        return;
+    }
 
     // Setup all characteristics
     // The manager creates the characteristic wrappers. Each wrapper onWrite callback
@@ -125,18 +120,17 @@ void BleManager::begin(const std::string& deviceName) {
     // silently and you will loose your mind trying to find why...
     Serial.println("[BLE] Creating pol service and Characteristics...");
     int numHandles = 20;
-    BLEService* polService = _pServer->createService(BLEUUID(POL_SERVICE), numHandles, 0);
-    if (!polService) {
+    if (!_stack->createService(POL_SERVICE, numHandles)) {
         Serial.println("[BLE] Failed to create token service!");
         stop();
         return;
     }
 
     // Add all the created characteristic wrappers to the service. The wrapper `configure` method
-    // does the actual work of calling the underlying BLE library `createCharacteristic`.
+    // does the actual work of creating the characteristic in the stack backend.
     for (const auto& charWrapper : _polServiceChars) {
         Serial.printf("[BLE] Adding %s characteristic...\n", charWrapper->getName().c_str());
-        if (!charWrapper->configure(*polService)) {
+        if (!charWrapper->configure(*_stack)) {
             Serial.printf(
                 "[BLE] CRITICAL: Failed to configure a characteristic for PoL service.\n");
             stop();
@@ -156,18 +150,38 @@ void BleManager::begin(const std::string& deviceName) {
     Serial.println("[BLE] Configuring Extended Advertisement...");
     if (!configureExtendedAdvertisement()) {
         Serial.println("[BLE] WARNING: Failed to configure extended advertisement.");
+    } else {
+        Serial.println("[BLE] Configuring Periodic Advertisement...");
+        _periodicConfigured = configurePeriodicAdvertisement();
+        if (!_periodicConfigured) {
+            Serial.println("[BLE] WARNING: Periodic advertising unavailable, extended only.");
+        }
     }
 
     // Commit and start the service, making it visible to clients.
-    polService->start();
+    if (!_stack->startService()) {
+        Serial.println("[BLE] CRITICAL: Failed to start PoL service!");
+        stop();
+        return;
+    }
 
     // Start all configured advertising instances.
     Serial.println("[BLE] Starting Multi-Advertising instances...");
-    if (!_multiAdvertiserPtr->start(NUM_ADV_INSTANCES, 0)) {
+    IBleMultiAdvertiser* multiAdv = getMultiAdvertiser();
+    if (!multiAdv->start(LEGACY_TOKEN_ADV_INSTANCE)) {
         Serial.printf("[BLE] CRITICAL: Failed to start multi-advertising.\n");
         stop();
         return;
     }
+    if (!multiAdv->start(EXTENDED_BROADCAST_ADV_INSTANCE)) {
+        Serial.println("[BLE] WARNING: Failed to start extended advertising.");
+    }
+    // The sync info is only added to the extended advertisement once the train runs.
+    if (_periodicConfigured &&
+        !multiAdv->startPeriodicAdvertising(EXTENDED_BROADCAST_ADV_INSTANCE)) {
+        Serial.println("[BLE] WARNING: Failed to start periodic advertising.");
+        _periodicConfigured = false;
+    }
 
     _shutdownRequested = false;
 
@@ -213,7 +227,16 @@ void BleManager::stop() {
         _pullProcessorTask = nullptr;
     }
 
-    _multiAdvertiserPtr->stop(NUM_ADV_INSTANCES, 0);
+    IBleMultiAdvertiser* multiAdv = getMultiAdvertiser();
+    if (multiAdv && _stack->isInitialized()) {
+        if (_periodicConfigured) {
+            multiAdv->stopPeriodicAdvertising(EXTENDED_BROADCAST_ADV_INSTANCE);
+            _periodicConfigured = false;
+        }
+        for (uint8_t instance = 0; instance < NUM_ADV_INSTANCES; ++instance) {
+            multiAdv->stop(instance);
+        }
+    }
 
     if (_tokenQueue != nullptr) {
         vQueueDelete(_tokenQueue);
@@ -228,10 +251,9 @@ void BleManager::stop() {
         _pullQueue = nullptr;
     }
 
-    if (BLEDevice::getInitialized()) {
-        BLEDevice::deinit(true);
+    if (_stack) {
+        _stack->deinit();
     }
-    _pServer = nullptr;
 }
 
 // These methods are designed to be called from fast BLE callbacks. They just
@@ -254,13 +276,23 @@ void BleManager::queueTokenRequest(const uint8_t* data, size_t len) {
         return;
     }
 
+    if (!admitTokenRequest(data, len)) {
+        Serial.println("[BLE] Phone served recently and queue almost full, dropping request.");
+        reportTokenLoad(true);
+        return;
+    }
+
     TokenRequestMessage msg;
     memcpy(msg.data, data, len);
     msg.len = len;
+    msg.writeUs = micros();
 
     if (xQueueSend(_tokenQueue, &msg, pdMS_TO_TICKS(10)) != pdTRUE) {
         Serial.println("[BLE] Request queue full, dropping request.");
+        reportTokenLoad(true);
+        return;
     }
+    reportTokenLoad();
 }
 
 // ========== QUEUE ENCRYPTED REQUEST ==========
@@ -292,8 +324,13 @@ void BleManager::queueEncryptedRequest(const uint8_t* data, size_t len) {
 void BleManager::queuePullRequest() {
     if (!_pullQueue)
         return;
-    uint8_t dummy = 1;  // The value doesn't matter, it just a signal.
-    if (xQueueSend(_pullQueue, &dummy, 0) != pdTRUE) {
+    // A refused request is still queued, so that the pull task answers that the beacon is busy.
+    uint8_t trigger = PULL_TRIGGER_ACCEPTED;
+    if (_loadShedder && _loadShedder->refusesPullRequests()) {
+        Serial.println("[BLE] Beacon overloaded, pull request refused.");
+        trigger = PULL_TRIGGER_REFUSED;
+    }
+    if (xQueueSend(_pullQueue, &trigger, 0) != pdTRUE) {
         Serial.println("[BLE] Pull request queue full, dropping request.");
     }
 }
@@ -311,13 +348,28 @@ void BleManager::processTokenRequests() {
     Serial.println("[BLE] PoL processor task started.");
     TokenRequestMessage msg;
     while (!_shutdownRequested) {
-        if (xQueueReceive(_tokenQueue, &msg, pdMS_TO_TICKS(100)) == pdTRUE) {
-            if (_tokenRequestProcessor) {
-                _tokenRequestProcessor->process(msg.data, msg.len);
-            } else {
-                Serial.println("[BLE] No request processor set, request ignored.");
+        if (xQueueReceive(_tokenQueue, &msg, pdMS_TO_TICKS(100)) != pdTRUE) {
+            continue;
+        }
+        if (!_tokenRequestProcessor) {
+            Serial.println("[BLE] No request processor set, request ignored.");
+            continue;
+        }
+
+        // Hand over every pending request before flushing, so that the processor can verify
+        // them as a batch.
+        uint32_t busyStartUs = micros();
+        do {
+            if (_tokenLatency) {
+                _tokenLatency->markArrival(msg.writeUs, micros());
             }
+            _tokenRequestProcessor->process(msg.data, msg.len);
+        } while (xQueueReceive(_tokenQueue, &msg, 0) == pdTRUE);
+        _tokenRequestProcessor->flush();
+        if (_loadShedder) {
+            _loadShedder->addTokenBusyTime(micros() - busyStartUs);
         }
+        reportTokenLoad();
     }
 }
 
@@ -350,12 +402,12 @@ void BleManager::pullProcessorTask(void* pvParameters) {
 
 void BleManager::processPullRequests() {
     Serial.println("[BLE] Data Pull processor task started.");
-    uint8_t dummy;
+    uint8_t trigger;
     while (!_shutdownRequested) {
-        if (xQueueReceive(_pullQueue, &dummy, pdMS_TO_TICKS(100)) == pdTRUE) {
+        if (xQueueReceive(_pullQueue, &trigger, pdMS_TO_TICKS(100)) == pdTRUE) {
             if (_pullRequestProcessor) {
-                // The process method doesn't need any data, it's just a trigger.
-                _pullRequestProcessor->process(nullptr, 0);
+                // The trigger tells whether the request was refused under load.
+                _pullRequestProcessor->process(&trigger, sizeof(trigger));
             } else {
                 Serial.println("[BLE] No pull request processor set, request ignored.");
             }
@@ -366,13 +418,13 @@ void BleManager::processPullRequests() {
 
 // ========== UTILS ==========
 
-BLECharacteristic* BleManager::getCharacteristicByUUID(const BLEUUID& uuid) const {
+IBleCharacteristic* BleManager::getCharacteristicByUUID(const std::string& uuid) const {
     // This uses a lambda with std::find_if to search our vector of
     // characteristic wrappers for one with a matching UUID.
     auto it = std::find_if(_polServiceChars.begin(), _polServiceChars.end(),
                            [&](const std::unique_ptr<ICharacteristic>& ptr) {
                                if (ptr) {
-                                   return const_cast<BLEUUID&>(ptr->getUUID()).equals(uuid);
+                                   return ptr->getUUID() == uuid;
                                }
                                return false;
                            });
@@ -402,102 +454,155 @@ void BleManager::setOutgoingMessageService(OutgoingMessageService* service) {
     _outgoingMessageService = service;
 }
 
+void BleManager::setTokenLoadCallback(TokenLoadCallback callback) {
+    _tokenLoadCallback = callback;
+}
+
+void BleManager::setTokenRateLimiter(RateLimiter* limiter) {
+    _tokenRateLimiter = limiter;
+}
+
+void BleManager::setTokenLatencyTracker(LatencyTracker* tracker) {
+    _tokenLatency = tracker;
+}
+
+void BleManager::setLoadShedder(LoadShedder* shedder) {
+    _loadShedder = shedder;
+}
+
+void BleManager::setAdvertisingUpdateService(AdvertisingUpdateService* service) {
+    _advUpdates = service;
+}
+
+bool BleManager::admitTokenRequest(const uint8_t* data, size_t len) {
+    if (!_tokenRateLimiter || uxQueueMessagesWaiting(_tokenQueue) + 1 < REQUEST_QUEUE_DEPTH) {
+        return true;
+    }
+
+    uint8_t packetType = data[0] & fragmentation::MASK_TYPE;
+    if (packetType != fragmentation::FLAG_START && packetType != fragmentation::FLAG_UNFRAGMENTED) {
+        return true;
+    }
+
+    const uint8_t* payload = data + fragmentation::Header::SIZE;
+    size_t payloadLen = len - fragmentation::Header::SIZE;
+
+    // A pipelined frame is admitted on its first request.
+    if (payloadLen > 0 && payload[0] == POL_FRAME_PIPELINE) {
+        size_t skip = std::min(2 * POL_FRAME_HEADER_SIZE, payloadLen);
+        payload += skip;
+        payloadLen -= skip;
+    }
+
+    uint64_t phoneId;
+    if (!PoLRequest::peekPhoneId(payload, payloadLen, phoneId)) {
+        return true;  // Malformed, the token processor rejects it cheaply.
+    }
+    return !_tokenRateLimiter->wasServedRecently(phoneId, millis());
+}
+
+void BleManager::reportTokenLoad(bool saturated) {
+    if (!_tokenQueue) {
+        return;
+    }
+    size_t pending = saturated ? REQUEST_QUEUE_DEPTH : uxQueueMessagesWaiting(_tokenQueue);
+    if (_loadShedder) {
+        _loadShedder->reportTokenQueue(pending, REQUEST_QUEUE_DEPTH, saturated);
+    }
+    if (_tokenLoadCallback) {
+        _tokenLoadCallback(pending, REQUEST_QUEUE_DEPTH);
+    }
+}
+
 void BleManager::registerTransportForMtuUpdates(FragmentationTransport* transport) {
     _transportsForMtuUpdate.push_back(transport);
 }
 
-BLEMultiAdvertising* BleManager::getMultiAdvertiser() {
-    return _multiAdvertiserPtr.get();
+IBleMultiAdvertiser* BleManager::getMultiAdvertiser() {
+    return _stack ? _stack->getMultiAdvertiser() : nullptr;
+}
+
+bool BleManager::isPeriodicAdvertisingEnabled() const {
+    return _periodicConfigured;
+}
+
+uint8_t BleManager::getFeatures() const {
+    uint8_t features = BEACON_FEATURES;
+    if (!_periodicConfigured) {
+        features &= ~BEACON_FEATURE_PERIODIC_BROADCAST;
+    }
+    return features;
 }
 
 bool BleManager::configureTokenSrvcAdvertisement(const std::string& deviceName, uint8_t instanceNum,
                                                  const char* serviceUuid) {
-    esp_ble_gap_ext_adv_params_t legacyParams = {
-        .type = ESP_BLE_GAP_SET_EXT_ADV_PROP_LEGACY_IND,  // Legacy advertising (BLE 4.2)
-        .interval_min = 0x190,  // 500ms (intervals must be multiplied by 1.25 to get seconds)
-        .interval_max = 0x190,  // 500ms (intervals must be multiplied by 1.25 to get seconds)
-        .channel_map = ADV_CHNL_ALL,
-        .own_addr_type = BLE_ADDR_TYPE_PUBLIC,               // Same address as the device
-        .filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,  // Allows scan & connection
-        .tx_power = EXT_ADV_TX_PWR_NO_PREFERENCE,            // No preference for tx power
-        .primary_phy = ESP_BLE_GAP_PHY_1M,                   // 1Mb/s
-        .secondary_phy = ESP_BLE_GAP_PHY_1M,                 // 1Mb/s
+    IBleMultiAdvertiser* multiAdv = getMultiAdvertiser();
+
+    BleAdvParams legacyParams = {
+        .legacy = true,  // Legacy advertising (BLE 4.2)
+        .connectable = true,
+        .scannable = true,
+        .intervalMin = 0x190,  // 500ms (intervals must be multiplied by 1.25 to get seconds)
+        .intervalMax = 0x190,  // 500ms (intervals must be multiplied by 1.25 to get seconds)
+        .primaryPhy = BlePhy::Phy1M,    // 1Mb/s
+        .secondaryPhy = BlePhy::Phy1M,  // 1Mb/s
         .sid = instanceNum,
-        .scan_req_notif = false,
     };
 
-    if (!_multiAdvertiserPtr->setAdvertisingParams(instanceNum, &legacyParams)) {
+    if (!multiAdv->setAdvertisingParams(instanceNum, legacyParams)) {
         Serial.println("[BLE] Failed to set legacy advertising parameters.");
         return false;
     }
 
     // Set the initial, default advertising data. ConnectableAdvertiser will overwrite this
-    BLEAdvertisementData advData;
-    advData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
-
-    uint8_t manufDataPayload[6];
-    uint16_t manufId = MANUFACTURER_ID;
-    // Manufacturer id for development/testing
-    memcpy(manufDataPayload, &manufId, sizeof(manufId));
+    AdvDataBuilder advData;
+    advData.addFlags(AdvDataBuilder::FLAG_GENERAL_DISCOVERABLE |
+                     AdvDataBuilder::FLAG_BREDR_NOT_SUPPORTED);
 
     // Here we specify the beacon id in the adv data
-    memcpy(manufDataPayload + sizeof(manufId), &BEACON_ID, sizeof(BEACON_ID));
-    advData.setManufacturerData(
-        std::string(reinterpret_cast<const char*>(manufDataPayload), sizeof(manufDataPayload)));
-    advData.setCompleteServices(BLEUUID(serviceUuid));
-
-    std::string advPayload = advData.getPayload();
-    if (advPayload.length() > ESP_BLE_ADV_DATA_LEN_MAX) {
-        Serial.printf("[BLE] WARNING: Legacy adv payload too long (%zu bytes, max 31).\n",
-                      advPayload.length());
-    }
-    if (!_multiAdvertiserPtr->setAdvertisingData(
-            instanceNum, advPayload.length(),
-            reinterpret_cast<const uint8_t*>(advPayload.data()))) {
+    uint8_t manufDataPayload[sizeof(BEACON_ID)];
+    memcpy(manufDataPayload, &BEACON_ID, sizeof(BEACON_ID));
+    bool fits = advData.addManufacturerData(MANUFACTURER_ID, manufDataPayload,
+                                            sizeof(manufDataPayload)) &&
+                advData.addCompleteUuid128(serviceUuid);
+    if (!fits) {
+        Serial.println("[BLE] WARNING: Legacy adv payload too long (max 31 bytes).");
+    }
+    if (!multiAdv->setAdvertisingData(instanceNum, advData.data(), advData.size())) {
         Serial.println("[BLE] Failed to set legacy advertising data.");
         return false;
     }
 
     // Set the scan response data, which contains the device name.
-    BLEAdvertisementData scanRspData;
-    scanRspData.setName(deviceName);
-
-    std::string scanRspPayload = scanRspData.getPayload();
-    if (scanRspPayload.length() > ESP_BLE_SCAN_RSP_DATA_LEN_MAX) {
-        Serial.printf("[BLE] WARNING: Legacy scan response payload too long "
-                      "(%zu bytes, max 31).\n",
-                      scanRspPayload.length());
-    }
-    if (!scanRspPayload.empty()) {
-        if (!_multiAdvertiserPtr->setScanRspData(
-                instanceNum, scanRspPayload.length(),
-                reinterpret_cast<const uint8_t*>(scanRspPayload.data()))) {
+    AdvDataBuilder scanRspData;
+    if (!scanRspData.addCompleteName(deviceName.c_str())) {
+        Serial.println("[BLE] WARNING: Legacy scan response payload too long (max 31 bytes).");
+    }
+    if (scanRspData.size() > 0) {
+        if (!multiAdv->setScanResponseData(instanceNum, scanRspData.data(), scanRspData.size())) {
             Serial.println("[BLE] Failed to set legacy scan response data.");
             return false;
         }
     }
-
-    _multiAdvertiserPtr->setDuration(instanceNum, 0, 0);  // Advertise indefinitely
     return true;
 }
 
 bool BleManager::configureExtendedAdvertisement() {
-    esp_ble_gap_ext_adv_params_t extParams = {
-        // Non-Connectable and Non-Scannable Undirected advertising
-        .type = ESP_BLE_GAP_SET_EXT_ADV_PROP_NONCONN_NONSCANNABLE_UNDIRECTED,
-        .interval_min = 0x320,  // 1s (intervals must be multiplied by 1.25 to get seconds)
-        .interval_max = 0x320,  // 1s (intervals must be multiplied by 1.25 to get seconds)
-        .channel_map = ADV_CHNL_ALL,
-        .own_addr_type = BLE_ADDR_TYPE_PUBLIC,
-        .filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
-        .tx_power = EXT_ADV_TX_PWR_NO_PREFERENCE,
-        .primary_phy = ESP_BLE_GAP_PHY_1M,       // 1Mb/s
-        .secondary_phy = ESP_BLE_GAP_PHY_CODED,  // 500 kb/s but longer range
+    IBleMultiAdvertiser* multiAdv = getMultiAdvertiser();
+
+    // Non-Connectable and Non-Scannable Undirected advertising
+    BleAdvParams extParams = {
+        .legacy = false,
+        .connectable = false,
+        .scannable = false,
+        .intervalMin = 0x320,  // 1s (intervals must be multiplied by 1.25 to get seconds)
+        .intervalMax = 0x320,  // 1s (intervals must be multiplied by 1.25 to get seconds)
+        .primaryPhy = BlePhy::Phy1M,    // 1Mb/s
+        .secondaryPhy = BlePhy::Coded,  // 500 kb/s but longer range
         .sid = EXTENDED_BROADCAST_ADV_INSTANCE,
-        .scan_req_notif = false,
     };
 
-    if (!_multiAdvertiserPtr->setAdvertisingParams(EXTENDED_BROADCAST_ADV_INSTANCE, &extParams)) {
+    if (!multiAdv->setAdvertisingParams(EXTENDED_BROADCAST_ADV_INSTANCE, extParams)) {
         Serial.println("[BLE] Failed to set extended advertising parameters.");
         return false;
     }
@@ -505,13 +610,32 @@ bool BleManager::configureExtendedAdvertisement() {
     // Set a minimal placeholder for the advertising data. BroadcastAdvertiser will overwrite this
     uint8_t placeholder_data[] = {0x02, 0x01, 0x06};
 
-    if (!_multiAdvertiserPtr->setAdvertisingData(EXTENDED_BROADCAST_ADV_INSTANCE,
-                                                 sizeof(placeholder_data), placeholder_data)) {
+    if (!multiAdv->setAdvertisingData(EXTENDED_BROADCAST_ADV_INSTANCE, placeholder_data,
+                                      sizeof(placeholder_data))) {
         Serial.println("[BLE] Failed to set extended advertising data.");
         return false;
     }
+    return true;
+}
+
+bool BleManager::configurePeriodicAdvertisement() {
+    IBleMultiAdvertiser* multiAdv = getMultiAdvertiser();
+
+    if (!multiAdv->setPeriodicAdvertisingParams(EXTENDED_BROADCAST_ADV_INSTANCE,
+                                                PERIODIC_BROADCAST_INTERVAL,
+                                                PERIODIC_BROADCAST_INTERVAL)) {
+        Serial.println("[BLE] Failed to set periodic advertising parameters.");
+        return false;
+    }
 
-    _multiAdvertiserPtr->setDuration(EXTENDED_BROADCAST_ADV_INSTANCE, 0, 0);
+    // Same placeholder as the extended advertisement. BroadcastAdvertiser will overwrite this
+    uint8_t placeholder_data[] = {0x02, 0x01, 0x06};
+
+    if (!multiAdv->setPeriodicAdvertisingData(EXTENDED_BROADCAST_ADV_INSTANCE, placeholder_data,
+                                              sizeof(placeholder_data))) {
+        Serial.println("[BLE] Failed to set periodic advertising data.");
+        return false;
+    }
     return true;
 }
 
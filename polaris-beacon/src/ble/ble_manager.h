@@ -1,12 +1,11 @@
 #ifndef BLE_MANAGER_H
 #define BLE_MANAGER_H
 
-#include <BLECharacteristic.h>
-#include <BLEServer.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
 #include <freertos/task.h>
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,13 +13,17 @@
 #include "../protocol/handlers/imessage_handler.h"
 #include "../protocol/messages/encrypted_message.h"
 #include "../protocol/messages/pol_request.h"
+#include "advertising_update_service.h"
 #include "characteristics/icharacteristic.h"
 #include "connectable_advertiser.h"
 #include "protocol/handlers/outgoing_message_service.h"
 #include "protocol/transport/fragmentation_transport.h"
+#include "stack/ible_stack.h"
+#include "utils/latency_tracker.h"
+#include "utils/load_shedder.h"
+#include "utils/rate_limiter.h"
 
 // Forward declarations
-class BLEMultiAdvertising;
 class FragmentationTransport;
 
 /// @brief The advertising instance ID for the connectable, legacy advertisement.
@@ -29,6 +32,10 @@ static constexpr uint8_t LEGACY_TOKEN_ADV_INSTANCE = 0;
 /// @brief The advertising instance ID for the non-connectable, extended advertisement.
 static constexpr uint8_t EXTENDED_BROADCAST_ADV_INSTANCE = 1;
 
+/// @brief The interval of the periodic train attached to the extended advertisement (1.25 ms
+/// units).
+static constexpr uint16_t PERIODIC_BROADCAST_INTERVAL = 0x320;  // 1s
+
 /// @brief The total number of advertising instances used by this beacon.
 static constexpr uint8_t NUM_ADV_INSTANCES = 2;
 
@@ -39,13 +46,28 @@ static constexpr uint8_t NUM_ADV_INSTANCES = 2;
  * This class manes the entire BLE stack, including the GATT server,
  * services, characteristics, and multi-set advertising. It uses a queue-per-task
  * model to process incoming requests from different characteristics asynchronously.
+ * The host stack itself is accessed through IBleStack, so the backend (Bluedroid, NimBLE or
+ * fake) is chosen at compile time, see `stack/ble_backend_config.h`.
  */
 class BleManager {
 public:
     /**
-     * @brief Constructs the BleManager.
+     * @brief A function type for the token service load callback.
+     * @param pending The number of token requests waiting to be processed.
+     * @param capacity The capacity of the token request queue.
+     */
+    using TokenLoadCallback = std::function<void(size_t pending, size_t capacity)>;
+
+    /**
+     * @brief Constructs the BleManager with the backend selected at compile time.
      */
     explicit BleManager();
+
+    /**
+     * @brief Constructs the BleManager on a given BLE stack backend.
+     * @param stack The BLE stack to use. The manager takes ownership.
+     */
+    explicit BleManager(std::unique_ptr<IBleStack> stack);
     ~BleManager();
 
     /**
@@ -80,14 +102,60 @@ public:
     /** @brief Injects the dependency for the outgoing message service. */
     void setOutgoingMessageService(OutgoingMessageService* service);
 
+    /**
+     * @brief Registers the rate limiter used for the token queue admission.
+     *
+     * When a single slot is left in the token queue, requests of phones served recently are
+     * dropped, so that a phone flooding the beacon cannot starve the others.
+     */
+    void setTokenRateLimiter(RateLimiter* limiter);
+
+    /**
+     * @brief Registers the tracker receiving the arrival time of each token request chunk.
+     *
+     * The write time and the dequeue time of a chunk are marked just before it is processed.
+     */
+    void setTokenLatencyTracker(LatencyTracker* tracker);
+
+    /**
+     * @brief Registers the load shedder.
+     *
+     * It receives the token queue occupancy and drops, and the time the token processor task
+     * spends on requests. The data pull requests it refuses are answered at once with
+     * PULL_RESPONSE_BUSY.
+     */
+    void setLoadShedder(LoadShedder* shedder);
+
+    /**
+     * @brief Registers the service applying the advertising changes.
+     *
+     * The connectable instance is stopped on connect and started again on disconnect through its
+     * owner task, never from the BLE host callbacks. Must be called before `begin`.
+     */
+    void setAdvertisingUpdateService(AdvertisingUpdateService* service);
+
+    /** @brief Registers the callback notified when the token request queue occupancy changes. */
+    void setTokenLoadCallback(TokenLoadCallback callback);
+
     /** @brief Registers a transport layer to receive MTU update notifications. */
     void registerTransportForMtuUpdates(FragmentationTransport* transport);
 
     /** @brief gets a raw characteristic pointer by its UUID. */
-    BLECharacteristic* getCharacteristicByUUID(const BLEUUID& targetUuid) const;
+    IBleCharacteristic* getCharacteristicByUUID(const std::string& targetUuid) const;
 
     /** @brief Gets a pointer to the multi-advertising controller. */
-    BLEMultiAdvertising* getMultiAdvertiser();
+    IBleMultiAdvertiser* getMultiAdvertiser();
+
+    /** @brief Checks whether the periodic train of the broadcast instance is running. */
+    bool isPeriodicAdvertisingEnabled() const;
+
+    /**
+     * @brief Gets the features byte of the connectable advertisement.
+     *
+     * The BEACON_FEATURES of the firmware, without the periodic broadcast bit when the train
+     * could not be started, so that phones do not wait for a sync that never comes.
+     */
+    uint8_t getFeatures() const;
 
     // --- Service and Characteristic UUIDs --
     static constexpr const char* POL_SERVICE = "f44dce36-ffb2-565b-8494-25fa5a7a7cd6";
@@ -107,21 +175,27 @@ private:
      * @class ServerCallbacks
      * @brief An inner class to handle global BLE server events.
      */
-    class ServerCallbacks : public BLEServerCallbacks {
+    class ServerCallbacks : public IBleServerListener {
     public:
         explicit ServerCallbacks(BleManager* parentServer);
-        void onConnect(BLEServer* pServer) override;
-        void onDisconnect(BLEServer* pServer) override;
-        void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
+        void onConnect() override;
+        void onDisconnect() override;
+        void onMtuChanged(uint16_t mtu) override;
 
     private:
         BleManager* _parentManager;
     };
 
+    /// @brief The depth of each request queue.
+    static constexpr size_t REQUEST_QUEUE_DEPTH = 4;
+
     /// @brief A message structure for the token request queue.
     struct TokenRequestMessage {
         uint8_t data[MAX_BLE_PAYLOAD_SIZE];
         size_t len;
+
+        /// @brief The time (micros) of the write callback.
+        uint32_t writeUs;
     };
 
     /// @brief A message structure for the encrypted request queue.
@@ -139,6 +213,21 @@ private:
     /// @brief The FreeRTOS queue for incoming token requests.
     QueueHandle_t _tokenQueue = nullptr;
 
+    /// @brief The callback notified of the token queue occupancy.
+    TokenLoadCallback _tokenLoadCallback;
+
+    /// @brief The rate limiter used for the token queue admission.
+    RateLimiter* _tokenRateLimiter = nullptr;
+
+    /// @brief The tracker of the token latency.
+    LatencyTracker* _tokenLatency = nullptr;
+
+    /// @brief The load shedder, if any.
+    LoadShedder* _loadShedder = nullptr;
+
+    /// @brief The service applying the advertising changes.
+    AdvertisingUpdateService* _advUpdates = nullptr;
+
     /// @brief The transport layer for the encrypted message channel.
     FragmentationTransport* _encryptedDataTransport = nullptr;
 
@@ -163,18 +252,18 @@ private:
     /// @brief A list of transport layers that need to be notified of MTU changes.
     std::vector<FragmentationTransport*> _transportsForMtuUpdate;
 
-    /// @brief A pointer to the main BLE server instance.
-    BLEServer* _pServer = nullptr;
+    /// @brief The BLE host stack backend.
+    std::unique_ptr<IBleStack> _stack;
 
     /// @brief A unique pointer to the server callback handler instance.
     std::unique_ptr<ServerCallbacks> _serverCallbacks;
 
+    /// @brief True if the periodic train of the extended advertisement is configured.
+    bool _periodicConfigured = false;
+
     /// @brief A flag to signal all processor tasks to shut down.
     volatile bool _shutdownRequested = false;
 
-    /// @brief A unique pointer to the multi-advertising controller.
-    std::unique_ptr<BLEMultiAdvertising> _multiAdvertiserPtr;
-
     /// @brief A vector that owns all the characteristic wrapper objects.
     std::vector<std::unique_ptr<ICharacteristic>> _polServiceChars;
 
@@ -203,6 +292,20 @@ private:
     /** @brief Sets up the parameters for the non-connectable (extended) advertisement. */
     bool configureExtendedAdvertisement();
 
+    /** @brief Attaches a periodic advertising train to the extended advertisement. */
+    bool configurePeriodicAdvertisement();
+
+    /** @brief Reports the current token queue occupancy to the load callback. */
+    void reportTokenLoad(bool saturated = false);
+
+    /**
+     * @brief Decides whether a token request chunk may take a queue slot.
+     *
+     * Only the first chunk of a request carries the phone ID, the following ones are always
+     * admitted so that a started reassembly is not broken.
+     */
+    bool admitTokenRequest(const uint8_t* data, size_t len);
+
     /** @brief Notifies registered listeners of an MTU change. */
     void updateMtu(uint16_t newMtu);
 };
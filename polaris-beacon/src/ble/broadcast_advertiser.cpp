@@ -1,25 +1,76 @@
 #include "broadcast_advertiser.h"
 
-#include <BLEAdvertising.h>
+#include <Arduino.h>
 #include <HardwareSerial.h>
+#include <sodium.h>
 
-const uint8_t EXTENDED_BROADCAST_ADV_INSTANCE = 1;
+#include "adv_data_builder.h"
+#include "ble_manager.h"
 
 BroadcastAdvertiser::BroadcastAdvertiser(uint32_t beaconId, const CryptoService& cryptoService,
-                                         BeaconCounter& counter, BLEMultiAdvertising& advertiser)
+                                         BeaconCounter& counter, AdvertisingUpdateService& updater,
+                                         bool usePeriodicTrain)
     : _beaconId(beaconId),
       _cryptoService(cryptoService),
       _counterRef(counter),
-      _advertiserRef(advertiser) {
+      _updater(updater),
+      _presigner(beaconId, cryptoService, counter),
+      _usePeriodicTrain(usePeriodicTrain) {
 }
 
 void BroadcastAdvertiser::begin() {
     Serial.println("[BeaconAdv] Beginning initial advertisement setup.");
 
+    // Construct the advertising data template (e.g., Manufacturer Specific Data)
+    // Format: [Len1][Type1][ManufID_LSB][ManufID_MSB][BroadcastPayload_Bytes]
+    // The template is signed once here, so that no unsigned payload is ever published.
+    const uint16_t manufacturerId = MANUFACTURER_ID;  // company ID
+    const size_t dataLenForAdv = 2 + BroadcastPayload::packedSize();  // ManufID + Payload
+    static_assert(1 + 1 + 2 + BroadcastPayload::packedSize() <=
+                      AdvertisingUpdateService::MAX_PAYLOAD_SIZE,
+                  "The broadcast must fit in one extended advertising PDU");
+
+    uint8_t rawAdvPayload[1 + 1 + dataLenForAdv] = {};
+    size_t idx = 0;
+
+    rawAdvPayload[idx++] = 1 + dataLenForAdv;  // Length of this AD structure field (Type + Data)
+    rawAdvPayload[idx++] = AdvDataBuilder::AD_TYPE_MANUFACTURER_DATA;  // Type
+    rawAdvPayload[idx++] = (uint8_t)(manufacturerId & 0xFF);           // Manuf ID LSB
+    rawAdvPayload[idx++] = (uint8_t)(manufacturerId >> 8);             // Manuf ID MSB
+
+    memcpy(&rawAdvPayload[idx], &_beaconId, sizeof(_beaconId));
+    idx += sizeof(_beaconId);
+    size_t epochLen = buildEpoch(&rawAdvPayload[idx]);
+    if (epochLen == 0) {
+        Serial.println("[BeaconAdv] CRITICAL: No signed payload, the broadcast is not started.");
+        return;
+    }
+    idx += epochLen;
+
+    _advSlot = _updater.registerTemplate(EXTENDED_BROADCAST_ADV_INSTANCE,
+                                         AdvertisingUpdateService::Target::Advertising,
+                                         rawAdvPayload, idx);
+
+    // Publish the same payload on the periodic train, so that synced phones receive it without
+    // scanning.
+    if (_usePeriodicTrain) {
+        _periodicSlot = _updater.registerTemplate(EXTENDED_BROADCAST_ADV_INSTANCE,
+                                                  AdvertisingUpdateService::Target::Periodic,
+                                                  rawAdvPayload, idx);
+    }
+
+    // The next epochs are signed ahead in the background, the updater task only swaps them in.
+    _presigner.begin();
+    _refreshHandle = _updater.registerRefreshHandler([this]() { this->refreshPayload(); });
+    _intervalHandle = _updater.registerRefreshHandler([this]() { this->refreshInterval(); });
+
     _counterRef.setIncrementCallback(BroadcastAdvertiser::onCounterIncremented, this);
+    _intervalTicker.attach_ms(TeslaChain::INTERVAL_MS / INTERVAL_TICKS,
+                              BroadcastAdvertiser::onIntervalTick, this);
+}
 
-    // initial update to set the first advertisement
-    updateAdvertisement();
+void BroadcastAdvertiser::onIntervalTick(BroadcastAdvertiser* advertiser) {
+    advertiser->_updater.requestRefresh(advertiser->_intervalHandle);
 }
 
 void BroadcastAdvertiser::onCounterIncremented(void* context) {
@@ -33,46 +84,93 @@ void BroadcastAdvertiser::handleCounterIncrement() {
 }
 
 void BroadcastAdvertiser::updateAdvertisement() {
-    uint64_t currentCounter = _counterRef.getValue();
-    BroadcastPayload payloadContent;
-    payloadContent.beaconId = _beaconId;
-    payloadContent.counter = currentCounter;
-
-    // Sign beaconId and counter
-    _cryptoService.signBeaconBroadcast(payloadContent.signature, _beaconId, currentCounter);
+    _updater.requestRefresh(_refreshHandle);
+}
 
-    // Construct the advertising data (e.g., Manufacturer Specific Data)
-    // Format: [Len1][Type1][ManufID_LSB][ManufID_MSB][BroadcastPayload_Bytes]
-    const uint16_t manufacturerId = MANUFACTURER_ID;  // company ID
-    const size_t payloadDataSize = sizeof(payloadContent.beaconId) +
-                                   sizeof(payloadContent.counter) +
-                                   sizeof(payloadContent.signature);
+size_t BroadcastAdvertiser::buildEpoch(uint8_t* out) {
+    uint64_t currentCounter = _counterRef.getValue();
+    BroadcastPresigner::Epoch epoch;
+    if (!_presigner.take(currentCounter, epoch)) {
+        // At boot, after a counter reset, or when the presigner is late
+        Serial.printf("[BeaconAdv] No presigned epoch for counter %llu, signing inline.\n",
+                      currentCounter);
+        if (!_presigner.signEpoch(currentCounter, epoch)) {
+            Serial.println("[BeaconAdv] Failed to sign the broadcast epoch.");
+            sodium_memzero(epoch.lastKey, TESLA_KEY_SIZE);
+            return 0;
+        }
+    }
 
-    const size_t dataLenForAdv = 2 + payloadDataSize;  // ManufID + Payload
+    // Manually copy each member to ensure there is no padding.
+    size_t len = 0;
+    memcpy(out + len, &currentCounter, sizeof(currentCounter));
+    len += sizeof(currentCounter);
+    memcpy(out + len, epoch.signature, SIG_SIZE);
+    len += SIG_SIZE;
+
+    // A new chain per epoch, its anchor bound to the counter by a single signature.
+    _chain.start(epoch.lastKey);
+    sodium_memzero(epoch.lastKey, TESLA_KEY_SIZE);
+    _epochCounter = currentCounter;
+    _epochStartMs = millis();
+    _interval = 1;
+    memcpy(out + len, _chain.anchor(), TESLA_KEY_SIZE);
+    len += TESLA_KEY_SIZE;
+    memcpy(out + len, epoch.anchorSignature, SIG_SIZE);
+    len += SIG_SIZE;
+
+    return len + buildInterval(out + len);
+}
 
-    uint8_t rawAdvPayload[1 + 1 + dataLenForAdv];
-    size_t idx = 0;
+size_t BroadcastAdvertiser::buildInterval(uint8_t* out) const {
+    uint8_t index = 0;
+    const uint8_t* disclosed = _chain.disclosedKey(_interval, index);
+
+    size_t len = 0;
+    out[len++] = _interval;
+    out[len++] = index;
+    memcpy(out + len, disclosed, TESLA_KEY_SIZE);
+    len += TESLA_KEY_SIZE;
+    _chain.computeTag(out + len, _interval, _beaconId, _epochCounter);
+    return len + TESLA_TAG_SIZE;
+}
 
-    rawAdvPayload[idx++] = 1 + dataLenForAdv;  // Length of this AD structure field (Type + Data)
-    rawAdvPayload[idx++] = ESP_BLE_AD_MANUFACTURER_SPECIFIC_TYPE;  // Type
-    rawAdvPayload[idx++] = (uint8_t)(manufacturerId & 0xFF);       // Manuf ID LSB
-    rawAdvPayload[idx++] = (uint8_t)(manufacturerId >> 8);         // Manuf ID MSB
+void BroadcastAdvertiser::refreshPayload() {
+    // The counter, the signature and the TESLA section are contiguous in the template, so they are
+    // patched together.
+    uint8_t patch[EPOCH_PATCH_SIZE];
+    size_t len = buildEpoch(patch);
+    if (len == 0) {
+        // The previous payload stays published, the next counter increment tries again.
+        return;
+    }
 
-    // Manually copy each member to ensure there is no padding.
-    memcpy(&rawAdvPayload[idx], &payloadContent.beaconId, sizeof(payloadContent.beaconId));
-    idx += sizeof(payloadContent.beaconId);
+    patchTemplates(COUNTER_OFFSET, patch, len);
+    Serial.printf("[BeaconAdv] Extended advertisement updated. Counter: %llu\n", _epochCounter);
+}
 
-    memcpy(&rawAdvPayload[idx], &payloadContent.counter, sizeof(payloadContent.counter));
-    idx += sizeof(payloadContent.counter);
+void BroadcastAdvertiser::refreshInterval() {
+    uint32_t elapsed = millis() - _epochStartMs;
+    uint32_t interval = elapsed / TeslaChain::INTERVAL_MS + 1;
+    if (interval > TeslaChain::INTERVALS) {
+        interval = TeslaChain::INTERVALS;  // The counter is late, keep the last interval.
+    }
+    if (interval == _interval) {
+        return;
+    }
+    _interval = (uint8_t)interval;
 
-    memcpy(&rawAdvPayload[idx], &payloadContent.signature, sizeof(payloadContent.signature));
-    idx += sizeof(payloadContent.signature);
+    uint8_t patch[INTERVAL_PATCH_SIZE];
+    size_t len = buildInterval(patch);
+    patchTemplates(INTERVAL_OFFSET, patch, len);
+}
 
-    // Update the advertising data for the extended instance
-    if (!_advertiserRef.setAdvertisingData(EXTENDED_BROADCAST_ADV_INSTANCE, idx, rawAdvPayload)) {
+void BroadcastAdvertiser::patchTemplates(size_t offset, const uint8_t* data, size_t len) {
+    if (!_updater.patch(_advSlot, offset, data, len)) {
         Serial.println("[BeaconAdv] Failed to update extended advertising data.");
-    } else {
-        Serial.printf("[BeaconAdv] Extended advertisement updated. Counter: %llu\n",
-                      currentCounter);
     }
-}
\ No newline at end of file
+
+    if (_usePeriodicTrain) {
+        _updater.patch(_periodicSlot, offset, data, len);
+    }
+}
@@ -1,22 +1,37 @@
 #ifndef BROADCAST_ADVERTISER_H
 #define BROADCAST_ADVERTISER_H
 
-#include <BLEAdvertising.h>
+#include <Ticker.h>
 #include <stdint.h>
 
 #include "../protocol/pol_constants.h"
 #include "../utils/beacon_counter.h"
 #include "../utils/crypto_service.h"
-
-class BLEMultiAdvertising;
+#include "../utils/tesla_chain.h"
+#include "advertising_update_service.h"
+#include "broadcast_presigner.h"
 
 /**
  * @class BroadcastAdvertiser
  * @brief Manages the dynamic payload of the extended (non-connectable) BLE advertisement.
  *
  * This class is responsible for periodically updating the extended advertisement
- * with a signed payload containing the beacon ID and current counter value.
+ * with a signed payload containing the beacon ID and current counter value. The same payload is
+ * published on the periodic advertising train attached to the extended advertisement.
+ *
+ * The payload is registered once as a template in the AdvertisingUpdateService. On each counter
+ * increment, the updater task takes the epoch signed ahead of time by a BroadcastPresigner and
+ * only the counter and signature bytes are patched; it only signs when no epoch is ready.
  * It listens for updates from a BeaconCounter to trigger these changes.
+ *
+ * The signed payload is followed by a TESLA section (see TeslaChain), giving sub-second presence
+ * proofs without connection:
+ *
+ * [anchor (16)][anchor signature (64)][interval (1)][disclosed index (1)][disclosed key (16)]
+ * [tag (16)]
+ *
+ * The chain and its anchor signature are renewed with the counter. A ticker requests a refresh of
+ * the interval part, which only costs a keyed hash, several times per interval.
  */
 class BroadcastAdvertiser {
 public:
@@ -25,21 +40,25 @@ public:
      * @param beaconId The unique ID of this beacon.
      * @param cryptoService Reference to the service for signing the payload.
      * @param counter Reference to the counter that provides the dynamic value.
-     * @param advertiser Reference to the main BLEMultiAdvertising instance.
+     * @param updater Reference to the service applying the advertising payload changes.
+     * @param usePeriodicTrain True to also publish the payload on the periodic train.
      */
     BroadcastAdvertiser(uint32_t beaconId, const CryptoService& cryptoService,
-                        BeaconCounter& counter, BLEMultiAdvertising& advertiser);
+                        BeaconCounter& counter, AdvertisingUpdateService& updater,
+                        bool usePeriodicTrain);
 
     /**
      * @brief Initializes the advertiser.
      *
-     * Sets up the callback with the BeaconCounter and performs the first
-     * advertisement update.
+     * Registers the signed payload templates and sets up the callback with the BeaconCounter.
+     * Nothing is advertised if the first epoch cannot be signed.
      */
     void begin();
 
     /**
      * @brief Manually triggers an update of the advertisement data.
+     *
+     * The update is asynchronous, it runs in the updater task.
      */
     void updateAdvertisement();  // Public method to trigger an update
 
@@ -55,6 +74,61 @@ private:
      */
     void handleCounterIncrement();
 
+    /**
+     * @brief Static trampoline function for the interval Ticker.
+     * @param advertiser The BroadcastAdvertiser instance.
+     */
+    static void onIntervalTick(BroadcastAdvertiser* advertiser);
+
+    /**
+     * @brief Writes the current counter followed by its signature, then starts the chain of the
+     * epoch and writes the TESLA section of its first interval. The epoch comes from the
+     * presigner, or is signed inline if not ready.
+     * @param out The output buffer, at least EPOCH_PATCH_SIZE bytes.
+     * @return The number of bytes written, or 0 if the epoch could not be signed (the chain is
+     * then not restarted).
+     */
+    size_t buildEpoch(uint8_t* out);
+
+    /**
+     * @brief Writes the interval part of the TESLA section.
+     * @param out The output buffer, at least INTERVAL_PATCH_SIZE bytes.
+     * @return The number of bytes written.
+     */
+    size_t buildInterval(uint8_t* out) const;
+
+    /**
+     * @brief Swaps in the epoch of the current counter and patches the templates. Runs in the
+     * updater task.
+     */
+    void refreshPayload();
+
+    /**
+     * @brief Patches the interval part of the templates when the interval changed. Runs in the
+     * updater task.
+     */
+    void refreshInterval();
+
+    /** @brief Patches both templates. */
+    void patchTemplates(size_t offset, const uint8_t* data, size_t len);
+
+    /// @brief The offset of the counter in the templates ([len][type][manuf ID][beacon ID]).
+    static constexpr size_t COUNTER_OFFSET = 1 + 1 + 2 + sizeof(uint32_t);
+
+    /// @brief The size of the interval part of the TESLA section.
+    static constexpr size_t INTERVAL_PATCH_SIZE = 1 + 1 + TESLA_KEY_SIZE + TESLA_TAG_SIZE;
+
+    /// @brief The size of the part patched on each counter increment, from COUNTER_OFFSET.
+    static constexpr size_t EPOCH_PATCH_SIZE =
+        sizeof(uint64_t) + SIG_SIZE + TESLA_KEY_SIZE + SIG_SIZE + INTERVAL_PATCH_SIZE;
+
+    /// @brief The offset of the interval part in the templates.
+    static constexpr size_t INTERVAL_OFFSET =
+        COUNTER_OFFSET + EPOCH_PATCH_SIZE - INTERVAL_PATCH_SIZE;
+
+    /// @brief The number of interval refresh requests per interval.
+    static constexpr uint32_t INTERVAL_TICKS = 4;
+
     /// @brief The unique ID of this beacon.
     const uint32_t _beaconId;
 
@@ -64,8 +138,41 @@ private:
     /// @brief A reference to the beacon counter.
     BeaconCounter& _counterRef;
 
-    /// @brief A reference to the ESP32 multi-advertising controller.
-    BLEMultiAdvertising& _advertiserRef;
+    /// @brief A reference to the service applying the advertising payload changes.
+    AdvertisingUpdateService& _updater;
+
+    /// @brief Signs the next epochs ahead of time.
+    BroadcastPresigner _presigner;
+
+    /// @brief True to also publish the payload on the periodic train.
+    const bool _usePeriodicTrain;
+
+    /// @brief The template slot of the extended advertisement.
+    AdvertisingUpdateService::Handle _advSlot = AdvertisingUpdateService::INVALID_HANDLE;
+
+    /// @brief The template slot of the periodic train.
+    AdvertisingUpdateService::Handle _periodicSlot = AdvertisingUpdateService::INVALID_HANDLE;
+
+    /// @brief The refresh handler computing the signed payload.
+    AdvertisingUpdateService::Handle _refreshHandle = AdvertisingUpdateService::INVALID_HANDLE;
+
+    /// @brief The refresh handler computing the interval part.
+    AdvertisingUpdateService::Handle _intervalHandle = AdvertisingUpdateService::INVALID_HANDLE;
+
+    /// @brief The hash chain of the current epoch.
+    TeslaChain _chain;
+
+    /// @brief The counter of the current epoch.
+    uint64_t _epochCounter = 0;
+
+    /// @brief The time (millis) the current epoch started.
+    uint32_t _epochStartMs = 0;
+
+    /// @brief The current interval, 1 to TeslaChain::INTERVALS.
+    uint8_t _interval = 0;
+
+    /// @brief The ticker requesting the interval refreshes.
+    Ticker _intervalTicker;
 
     /**
      * @struct BroadcastPayload
@@ -81,11 +188,26 @@ private:
         /// @brief The Ed25519 signature of the beaconId and counter.
         uint8_t signature[SIG_SIZE];
 
+        /// @brief The anchor of the hash chain of the epoch, and its signature.
+        uint8_t anchor[TESLA_KEY_SIZE];
+        uint8_t anchorSignature[SIG_SIZE];
+
+        /// @brief The current interval.
+        uint8_t interval;
+
+        /// @brief The index of the disclosed key, and the key.
+        uint8_t disclosedIndex;
+        uint8_t disclosedKey[TESLA_KEY_SIZE];
+
+        /// @brief The tag of the current interval.
+        uint8_t tag[TESLA_TAG_SIZE];
+
         /**
          * @brief The total size of the packed payload structure.
          */
         static constexpr size_t packedSize() {
-            return sizeof(beaconId) + sizeof(counter) + SIG_SIZE;
+            return sizeof(beaconId) + sizeof(counter) + SIG_SIZE + TESLA_KEY_SIZE + SIG_SIZE +
+                   sizeof(interval) + sizeof(disclosedIndex) + TESLA_KEY_SIZE + TESLA_TAG_SIZE;
         }
     };
 };
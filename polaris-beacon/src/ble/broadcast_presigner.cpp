@@ -0,0 +1,91 @@
+#include "broadcast_presigner.h"
+
+#include <HardwareSerial.h>
+#include <sodium.h>
+#include <string.h>
+
+#include "../utils/tesla_chain.h"
+
+BroadcastPresigner::BroadcastPresigner(uint32_t beaconId, const CryptoService& cryptoService,
+                                       const BeaconCounter& counter)
+    : _beaconId(beaconId), _cryptoService(cryptoService), _counterRef(counter) {
+}
+
+BroadcastPresigner::~BroadcastPresigner() {
+    if (_task != nullptr) {
+        vTaskDelete(_task);
+        _task = nullptr;
+    }
+}
+
+bool BroadcastPresigner::begin() {
+    // Idle priority: the signatures only use the CPU time left by the BLE and token tasks.
+    BaseType_t res = xTaskCreatePinnedToCore(signerTask, "Presign", TASK_STACK_SIZE, this,
+                                             tskIDLE_PRIORITY, &_task, tskNO_AFFINITY);
+    if (res != pdPASS) {
+        Serial.printf("%s Failed to create the signing task, signing inline.\n", TAG);
+        _task = nullptr;
+        return false;
+    }
+    xTaskNotifyGive(_task);
+    return true;
+}
+
+bool BroadcastPresigner::take(uint64_t counter, Epoch& epochOut) {
+    Slot& slot = _ring[counter % RING_SIZE];
+    taskENTER_CRITICAL(&_lock);
+    bool ready = slot.ready && slot.epoch.counter == counter;
+    if (ready) {
+        epochOut = slot.epoch;
+        slot.ready = false;
+        sodium_memzero(slot.epoch.lastKey, TESLA_KEY_SIZE);
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    if (_task != nullptr) {
+        xTaskNotifyGive(_task);
+    }
+    return ready;
+}
+
+bool BroadcastPresigner::signEpoch(uint64_t counter, Epoch& epochOut) const {
+    epochOut.counter = counter;
+    TeslaChain::draw(epochOut.lastKey, epochOut.anchor);
+    return _cryptoService.signBeaconBroadcast(epochOut.signature, _beaconId, counter) &&
+           _cryptoService.signChainAnchor(epochOut.anchorSignature, _beaconId, counter,
+                                          epochOut.anchor);
+}
+
+void BroadcastPresigner::signerTask(void* pvParameters) {
+    BroadcastPresigner* self = static_cast<BroadcastPresigner*>(pvParameters);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->fill();
+    }
+}
+
+void BroadcastPresigner::fill() {
+    // The current epoch is already published, the ring holds the next ones.
+    uint64_t current = _counterRef.getValue();
+    for (uint64_t counter = current + 1; counter <= current + RING_SIZE; ++counter) {
+        Slot& slot = _ring[counter % RING_SIZE];
+        taskENTER_CRITICAL(&_lock);
+        bool ready = slot.ready && slot.epoch.counter == counter;
+        taskEXIT_CRITICAL(&_lock);
+        if (ready) {
+            continue;
+        }
+
+        Epoch epoch;
+        if (!signEpoch(counter, epoch)) {
+            Serial.printf("%s Failed to sign the epoch of counter %llu.\n", TAG, counter);
+            sodium_memzero(epoch.lastKey, TESLA_KEY_SIZE);
+            return;
+        }
+        taskENTER_CRITICAL(&_lock);
+        slot.epoch = epoch;
+        slot.ready = true;
+        taskEXIT_CRITICAL(&_lock);
+        sodium_memzero(epoch.lastKey, TESLA_KEY_SIZE);
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef BROADCAST_PRESIGNER_H
+#define BROADCAST_PRESIGNER_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../protocol/pol_constants.h"
+#include "../utils/beacon_counter.h"
+#include "../utils/crypto_service.h"
+
+/**
+ * @class BroadcastPresigner
+ * @brief Signs the signed part of the extended advertisement of the next counter values ahead of
+ * time.
+ *
+ * Each counter epoch of the broadcast needs two Ed25519 signatures: the one of the beacon ID and
+ * counter, and the one of the anchor of the TESLA chain of the epoch (see TeslaChain). A
+ * low-priority task computes them for the next RING_SIZE counter values into a ring, so that on
+ * a counter increment the advertiser only swaps in a ready epoch instead of signing twice.
+ *
+ * The ring slot of a counter is `counter % RING_SIZE`. A slot is taken once: each epoch has its
+ * own chain. Taking a slot wakes the task, which refills the ring. A counter without a ready slot
+ * (at boot, after a reset of the counter, or when the task is late) is signed inline by the
+ * caller with `signEpoch`, the same computation.
+ */
+class BroadcastPresigner {
+public:
+    /// @brief The number of counter values signed ahead.
+    static constexpr size_t RING_SIZE = 4;
+
+    /// @brief The stack of the task. Ed25519 signing needs a few KB.
+    static constexpr uint32_t TASK_STACK_SIZE = 6144;
+
+    /**
+     * @struct Epoch
+     * @brief The signed data of a counter epoch.
+     */
+    struct Epoch {
+        /// @brief The counter value.
+        uint64_t counter;
+
+        /// @brief The signature of the beacon ID and counter.
+        uint8_t signature[SIG_SIZE];
+
+        /// @brief The last key of the TESLA chain of the epoch, secret until its disclosure.
+        uint8_t lastKey[TESLA_KEY_SIZE];
+
+        /// @brief The anchor of the chain, and its signature.
+        uint8_t anchor[TESLA_KEY_SIZE];
+        uint8_t anchorSignature[SIG_SIZE];
+    };
+
+    /**
+     * @brief Constructs the BroadcastPresigner.
+     * @param beaconId The unique ID of this beacon.
+     * @param cryptoService Reference to the service for signing the epochs.
+     * @param counter Reference to the counter whose next values are signed.
+     */
+    BroadcastPresigner(uint32_t beaconId, const CryptoService& cryptoService,
+                       const BeaconCounter& counter);
+
+    ~BroadcastPresigner();
+
+    /**
+     * @brief Creates the signing task, which fills the ring at once.
+     * @return True if the task was created. Otherwise, every epoch is signed inline.
+     */
+    bool begin();
+
+    /**
+     * @brief Takes the presigned epoch of a counter value, and wakes the task to refill the ring.
+     * @param counter The counter value.
+     * @param epochOut Receives the epoch.
+     * @return False if the epoch of this counter is not ready.
+     */
+    bool take(uint64_t counter, Epoch& epochOut);
+
+    /**
+     * @brief Draws the chain of an epoch and signs it.
+     * @return False if a signature failed.
+     */
+    bool signEpoch(uint64_t counter, Epoch& epochOut) const;
+
+private:
+    /**
+     * @struct Slot
+     * @brief A ring slot.
+     */
+    struct Slot {
+        bool ready = false;
+        Epoch epoch;
+    };
+
+    /** @brief The FreeRTOS task function. */
+    static void signerTask(void* pvParameters);
+
+    /** @brief Signs the missing epochs of the next RING_SIZE counter values. */
+    void fill();
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[Presigner]";
+
+    /// @brief The unique ID of this beacon.
+    const uint32_t _beaconId;
+
+    /// @brief A reference to the cryptographic service.
+    const CryptoService& _cryptoService;
+
+    /// @brief A reference to the beacon counter.
+    const BeaconCounter& _counterRef;
+
+    /// @brief The signing task.
+    TaskHandle_t _task = nullptr;
+
+    /// @brief Protects the ring.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The presigned epochs.
+    Slot _ring[RING_SIZE];
+};
+
+#endif  // BROADCAST_PRESIGNER_H
@@ -2,10 +2,10 @@
 #ifndef ICHARACTERISTIC_H
 #define ICHARACTERISTIC_H
 
-#include <BLEService.h>
-
 #include <string>
 
+#include "../stack/ible_stack.h"
+
 /**
  * @interface ICharacteristic
  * @brief An interface for a wrapper around a BLE characteristic.
@@ -17,17 +17,17 @@ public:
     virtual ~ICharacteristic() = default;
 
     /**
-     * @brief Creates and configures the underlying BLE characteristic within a given service.
-     * @param service The BLE service to which this characteristic will be added.
+     * @brief Creates and configures the underlying BLE characteristic in the stack primary service.
+     * @param stack The BLE stack in which the characteristic will be created.
      * @return True on success, false on failure.
      */
-    virtual bool configure(BLEService& service) = 0;
+    virtual bool configure(IBleStack& stack) = 0;
 
     /**
-     * @brief Gets a pointer to the raw `BLECharacteristic` object from the BLE library.
-     * @return A pointer to the underlying characteristic object.
+     * @brief Gets a pointer to the backend characteristic handle owned by the BLE stack.
+     * @return A pointer to the underlying characteristic, or `nullptr` if not configured.
      */
-    virtual BLECharacteristic* getRawCharacteristic() = 0;
+    virtual IBleCharacteristic* getRawCharacteristic() = 0;
 
     /**
      * @brief Gets the name or description of the characteristic.
@@ -37,9 +37,9 @@ public:
 
     /**
      * @brief Gets the UUID of the characteristic.
-     * @return A const reference to the `BLEUUID` object.
+     * @return A const reference to the UUID string.
      */
-    virtual const BLEUUID& getUUID() const = 0;
+    virtual const std::string& getUUID() const = 0;
 };
 
-#endif  // ICHARACTERISTIC_H
\ No newline at end of file
+#endif  // ICHARACTERISTIC_H
@@ -2,11 +2,6 @@
 #ifndef INDICATE_CHARACTERISTIC_H
 #define INDICATE_CHARACTERISTIC_H
 
-#include <BLE2902.h>  // For CCCD
-#include <BLECharacteristic.h>
-#include <BLEService.h>
-#include <BLEUUID.h>
-
 #include <string>
 
 #include "icharacteristic.h"
@@ -15,8 +10,8 @@
  * @class IndicateCharacteristic
  * @brief Implementation of ICharacteristic for a characteristic with INDICATE properties.
  *
- * This class encapsulates the creation of a characteristic that can send data to a client. It
- * automatically adds the CCCD.
+ * This class encapsulates the creation of a characteristic that can send data to a client. The
+ * stack backend automatically adds the CCCD.
  */
 class IndicateCharacteristic : public ICharacteristic {
 public:
@@ -28,17 +23,17 @@ public:
     IndicateCharacteristic(const char* uuid, const std::string& description);
 
     // See ICharacteristic for documentation of overridden methods.
-    bool configure(BLEService& service) override;
-    BLECharacteristic* getRawCharacteristic() override;
+    bool configure(IBleStack& stack) override;
+    IBleCharacteristic* getRawCharacteristic() override;
     std::string getName() const override;
-    const BLEUUID& getUUID() const override;
+    const std::string& getUUID() const override;
 
     /**
      * @brief Sets the value of the characteristic in the local buffer.
      * @param data Pointer to the data buffer.
      * @param len The length of the data.
      */
-    void setValue(uint8_t* data, size_t len);
+    void setValue(const uint8_t* data, size_t len);
 
     /**
      * @brief Sends an indication of the current value to a connected client.
@@ -47,13 +42,13 @@ public:
 
 private:
     /// @brief The UUID of this characteristic.
-    BLEUUID _uuid;
+    std::string _uuid;
 
-    /// @brief A pointer to the underlying librar characteristic object.
-    BLECharacteristic* _pCharacteristic = nullptr;
+    /// @brief A pointer to the underlying stack characteristic object.
+    IBleCharacteristic* _pCharacteristic = nullptr;
 
     /// @brief The human-readable description of this characteristic.
     std::string _userDescription;
 };
 
-#endif  // INDICATE_CHARACTERISTIC_H
\ No newline at end of file
+#endif  // INDICATE_CHARACTERISTIC_H
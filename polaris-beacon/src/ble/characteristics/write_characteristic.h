@@ -1,12 +1,7 @@
 #ifndef WRITE_CHARACTERISTIC_H
 #define WRITE_CHARACTERISTIC_H
 
-#include <BLECharacteristic.h>
-#include <BLEService.h>
-#include <BLEUUID.h>
-
 #include <functional>  // For std::function
-#include <memory>      // For std::unique_ptr
 #include <string>
 
 #include "icharacteristic.h"
@@ -20,7 +15,7 @@ public:
     /**
      * @brief A function type for the callback executed when a client writes to this characteristic.
      */
-    using WriteCallback = std::function<void(const uint8_t* data, size_t len)>;
+    using WriteCallback = IBleStack::WriteCallback;
 
     /**
      * @brief Constructs a WriteCharacteristic.
@@ -32,40 +27,24 @@ public:
                         const std::string& description);
 
     // See ICharacteristic for documentation of overridden methods.
-    bool configure(BLEService& service) override;
-    BLECharacteristic* getRawCharacteristic() override;
+    bool configure(IBleStack& stack) override;
+    IBleCharacteristic* getRawCharacteristic() override;
     std::string getName() const override;
-    const BLEUUID& getUUID() const override;
+    const std::string& getUUID() const override;
 
 private:
-    /**
-     * @class CharacteristicWriteHandler
-     * @brief An inner class that bridges the BLE library C-style callbacks to the `std::function`
-     * used by this class.
-     */
-    class CharacteristicWriteHandler : public BLECharacteristicCallbacks {
-    public:
-        explicit CharacteristicWriteHandler(WriteCallback onWriteAction);
-        void onWrite(BLECharacteristic* pChar) override;
-
-    private:
-        WriteCallback _onWriteAction;
-    };
-
     /// @brief The UUID of this characteristic.
-    BLEUUID _uuid;
+    std::string _uuid;
 
-    /// @brief The modern C++ callback function to be executed on write events.
+    /// @brief The callback function to be executed on write events. The stack backend bridges its
+    /// own library callbacks to it.
     WriteCallback _onWriteAction;
 
-    /// @brief A unique pointer to the inner class that handles the raw BLE library callback.
-    std::unique_ptr<CharacteristicWriteHandler> _bleCallbackHandler;
-
-    /// @brief A pointer to the underlying library characteristic object.
-    BLECharacteristic* _pCharacteristic = nullptr;
+    /// @brief A pointer to the underlying stack characteristic object.
+    IBleCharacteristic* _pCharacteristic = nullptr;
 
     /// @brief The human-readable description of this characteristic.
     std::string _userDescription;
 };
 
-#endif  // WRITE_CHARACTERISTIC_H
\ No newline at end of file
+#endif  // WRITE_CHARACTERISTIC_H
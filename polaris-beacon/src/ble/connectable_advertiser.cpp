@@ -1,73 +1,93 @@
 #include "connectable_advertiser.h"
 
-#include <BLEDevice.h>
 #include <HardwareSerial.h>
 
+#include "adv_data_builder.h"
 #include "ble_manager.h"
 
-ConnectableAdvertiser::ConnectableAdvertiser(BLEMultiAdvertising& advertiser)
-    : _advertiserRef(advertiser) {
+namespace {
+uint8_t queueDepthBucket(size_t pendingCount) {
+    if (pendingCount == 0)
+        return 0;
+    if (pendingCount <= 2)
+        return 1;
+    if (pendingCount <= 8)
+        return 2;
+    return 3;
 }
 
-void ConnectableAdvertiser::begin() {
-    updateAdvertisementData();
+uint8_t tokenLoadLevel(size_t pending, size_t capacity) {
+    if (pending == 0)
+        return 0;
+    if (pending >= capacity)
+        return 3;
+    if (pending * 2 >= capacity)
+        return 2;
+    return 1;
 }
+}  // namespace
 
-void ConnectableAdvertiser::setHasDataPending(bool hasData) {
-    bool isCurrentlySet = (_statusByte & STATUS_FLAG_DATA_PENDING) != 0;
-    bool stateChanged = (hasData != isCurrentlySet);
-
-    if (stateChanged) {
-        if (hasData) {
-            _statusByte |= STATUS_FLAG_DATA_PENDING;
-        } else {
-            _statusByte &= ~STATUS_FLAG_DATA_PENDING;
-        }
-        Serial.printf("[ConnAdv] Data pending flag changed to: %d. Updating advertisement.\n",
-                      hasData);
-        updateAdvertisementData();
-    }
+ConnectableAdvertiser::ConnectableAdvertiser(AdvertisingUpdateService& updater)
+    : _updater(updater) {
 }
 
-void ConnectableAdvertiser::updateAdvertisementData() {
-    BLEAdvertisementData advData;
+void ConnectableAdvertiser::begin(uint8_t features) {
+    AdvDataBuilder advData;
 
     // Set the Flags
-    advData.setFlags(ESP_BLE_ADV_FLAG_GEN_DISC | ESP_BLE_ADV_FLAG_BREDR_NOT_SPT);
+    advData.addFlags(AdvDataBuilder::FLAG_GENERAL_DISCOVERABLE |
+                     AdvDataBuilder::FLAG_BREDR_NOT_SUPPORTED);
 
-    // Construct the Manufacturer Data payload
-    // New size: 2 bytes (Manuf ID) + 4 bytes (Beacon ID) + 1 byte (Status) = 7 bytes
-    uint8_t manufDataPayload[7];
-    uint16_t manufId = MANUFACTURER_ID;
+    // Construct the Manufacturer Data payload (the builder prepends the Manuf ID)
+    // Size: 2 bytes (Manuf ID) + 4 bytes (Beacon ID) + 1 byte (Status) + 1 byte (Features) = 8
+    // bytes. With the flags and the 128-bit service UUID, this fills the 31 bytes exactly.
+    uint8_t manufDataPayload[6];
     uint32_t beaconId = BEACON_ID;
 
-    // Copy Manuf ID
-    memcpy(manufDataPayload, &manufId, sizeof(manufId));
     // Copy Beacon ID
-    memcpy(manufDataPayload + sizeof(manufId), &beaconId, sizeof(beaconId));
-    // Copy dynamic Status Byte
-    memcpy(manufDataPayload + sizeof(manufId) + sizeof(beaconId), &_statusByte,
-           sizeof(_statusByte));
+    memcpy(manufDataPayload, &beaconId, sizeof(beaconId));
+    // Initial Status Byte and the Features Byte
+    manufDataPayload[sizeof(beaconId)] = 0x00;
+    manufDataPayload[sizeof(beaconId) + 1] = features;
 
-    advData.setManufacturerData(
-        std::string(reinterpret_cast<const char*>(manufDataPayload), sizeof(manufDataPayload)));
+    // The status byte follows the AD header [len][type], the Manuf ID and the Beacon ID.
+    _statusOffset = advData.size() + 2 + sizeof(MANUFACTURER_ID) + sizeof(beaconId);
 
-    // Set the Complete Service UUID
-    advData.setCompleteServices(BLEUUID(BleManager::POL_SERVICE));
+    // Set the Manufacturer Data and the Complete Service UUID
+    bool fits =
+        advData.addManufacturerData(MANUFACTURER_ID, manufDataPayload, sizeof(manufDataPayload)) &&
+        advData.addCompleteUuid128(BleManager::POL_SERVICE);
 
-    // Get the final payload and set it
-    std::string advPayload = advData.getPayload();
+    if (!fits) {
+        Serial.printf("%s WARNING: Constructed advertisement payload too long (max 31).\n", TAG);
+    }
 
-    if (advPayload.length() > ESP_BLE_ADV_DATA_LEN_MAX) {
-        Serial.printf(
-            "[ConnAdv] WARNING: Constructed advertisement payload too long (%zu bytes, max 31).\n",
-            advPayload.length());
+    _slot = _updater.registerTemplate(LEGACY_TOKEN_ADV_INSTANCE,
+                                      AdvertisingUpdateService::Target::Advertising,
+                                      advData.data(), advData.size(), MIN_UPDATE_INTERVAL_MS);
+    if (_slot == AdvertisingUpdateService::INVALID_HANDLE) {
+        Serial.printf("%s Failed to register the legacy advertising template.\n", TAG);
     }
+}
 
-    if (!_advertiserRef.setAdvertisingData(LEGACY_TOKEN_ADV_INSTANCE, advPayload.length(),
-                                           reinterpret_cast<const uint8_t*>(advPayload.data()))) {
-        Serial.println("[ConnAdv] Failed to set legacy advertising data.");
-    } else {
-        Serial.println("[ConnAdv] Legacy advertising data updated successfully.");
+void ConnectableAdvertiser::setOutgoingQueueDepth(size_t pendingCount) {
+    uint8_t bits = (uint8_t)(queueDepthBucket(pendingCount) << STATUS_QUEUE_DEPTH_SHIFT);
+    if (pendingCount > 0) {
+        bits |= STATUS_FLAG_DATA_PENDING;
     }
-}
\ No newline at end of file
+
+    // The data pending flag drives the phones pull logic, so it is never delayed.
+    _updater.patchBits(_slot, _statusOffset, STATUS_FLAG_DATA_PENDING, bits, true);
+    _updater.patchBits(_slot, _statusOffset, STATUS_QUEUE_DEPTH_MASK, bits);
+}
+
+void ConnectableAdvertiser::setTokenLoad(size_t pending, size_t capacity) {
+    uint8_t bits = (uint8_t)(tokenLoadLevel(pending, capacity) << STATUS_TOKEN_LOAD_SHIFT);
+    _updater.patchBits(_slot, _statusOffset, STATUS_TOKEN_LOAD_MASK, bits);
+}
+
+void ConnectableAdvertiser::setShedLevel(uint8_t level) {
+    uint8_t bits = (uint8_t)((level & 0x03) << STATUS_SHED_LEVEL_SHIFT);
+    // Phones must stop pulling at once when the pull requests are refused.
+    _updater.patchBits(_slot, _statusOffset, STATUS_SHED_LEVEL_MASK, bits, true);
+}
@@ -1,57 +1,99 @@
 #ifndef CONNECTABLE_ADVERTISER_H
 #define CONNECTABLE_ADVERTISER_H
 
-#include <BLEAdvertising.h>
-
+#include "advertising_update_service.h"
 #include "protocol/pol_constants.h"
 
-class BLEMultiAdvertising;
-
 /**
  * @class ConnectableAdvertiser
  * @brief Manages the dynamic payload of the legacy BLE advertisement.
  *
- * This class is responsible for updating the manufacturer data field of the legacy advertisement to
- * signal if the beacon has data pending for a client.
+ * This class is responsible for updating the manufacturer data field of the legacy advertisement
+ * with the beacon status hints, so that phones can choose a beacon before connecting:
+ *
+ * Manufacturer data: [Manuf ID (2)][Beacon ID (4)][Status (1)][Features (1)]
+ *
+ * Status byte:
+ * - bit 0: data pending for a client (outgoing queue not empty).
+ * - bits 1-2: outgoing queue depth bucket (0: empty, 1: 1-2, 2: 3-8, 3: more than 8).
+ * - bits 3-4: token service load (0: idle, 1: light, 2: busy, 3: saturated).
+ * - bits 5-6: load shedding level (0: normal, 1: elevated, 2: high, 3: critical, pull requests
+ *   refused).
+ * - bit 7: reserved, zero.
+ *
+ * The features byte is a combination of the BEACON_FEATURE_* bits, those of the firmware that
+ * are available at runtime.
+ *
+ * The payload is registered once as a template in the AdvertisingUpdateService, and the setters
+ * only patch the status byte, so they can be called from any task. Data pending changes are
+ * published immediately, other hint changes at most once per MIN_UPDATE_INTERVAL_MS.
  */
 class ConnectableAdvertiser {
 public:
     /**
      * @brief Constructs the ConnectableAdvertiser.
-     * @param advertiser A reference to the main BLEMultiAdvertising instance.
+     * @param updater The service applying the advertising payload changes.
      */
-    explicit ConnectableAdvertiser(BLEMultiAdvertising& advertiser);
+    explicit ConnectableAdvertiser(AdvertisingUpdateService& updater);
 
     /**
-     * @brief Sets the initial advertising payload.
+     * @brief Registers the advertising payload template.
      *
      * This should be called after the advertising parameters have been configured
      * in the BleManager.
+     * @param features The features byte, from BleManager::getFeatures.
      */
-    void begin();
+    void begin(uint8_t features);
 
     /**
-     * @brief Sets the "data pending" flag in the advertisement payload.
-     *
-     * It updates the advertisement data only if the new state is different from the current state.
-     * @param hasData True to raise the flag, false to lower it.
+     * @brief Updates the outgoing queue hints (data pending flag and depth bucket).
+     * @param pendingCount The number of messages waiting in the outgoing queue.
      */
-    void setHasDataPending(bool hasData);
+    void setOutgoingQueueDepth(size_t pendingCount);
 
-private:
     /**
-     * @brief Reconstructs the entire advertisement data payload and sends it to the BLE stack.
+     * @brief Updates the token service load hint.
+     * @param pending The number of token requests waiting to be processed.
+     * @param capacity The capacity of the token request queue.
      */
-    void updateAdvertisementData();
+    void setTokenLoad(size_t pending, size_t capacity);
 
-    /// @brief A reference to the ESP32 multi-advertising controller.
-    BLEMultiAdvertising& _advertiserRef;
-
-    /// @brief The status byte included in the manufacturer data.
-    uint8_t _statusByte = 0x00;
+    /**
+     * @brief Updates the load shedding level hint.
+     * @param level The level, 0 (normal) to 3 (critical).
+     */
+    void setShedLevel(uint8_t level);
 
     /// @brief Bitmask for the "data pending" flag within the status byte.
     static constexpr uint8_t STATUS_FLAG_DATA_PENDING = 0b00000001;
+
+    /// @brief Bitmask and shift of the outgoing queue depth bucket within the status byte.
+    static constexpr uint8_t STATUS_QUEUE_DEPTH_MASK = 0b00000110;
+    static constexpr uint8_t STATUS_QUEUE_DEPTH_SHIFT = 1;
+
+    /// @brief Bitmask and shift of the token service load level within the status byte.
+    static constexpr uint8_t STATUS_TOKEN_LOAD_MASK = 0b00011000;
+    static constexpr uint8_t STATUS_TOKEN_LOAD_SHIFT = 3;
+
+    /// @brief Bitmask and shift of the load shedding level within the status byte.
+    static constexpr uint8_t STATUS_SHED_LEVEL_MASK = 0b01100000;
+    static constexpr uint8_t STATUS_SHED_LEVEL_SHIFT = 5;
+
+    /// @brief The minimum time between two advertisement updates caused by hint changes.
+    static constexpr uint32_t MIN_UPDATE_INTERVAL_MS = 2000;
+
+private:
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[ConnAdv]";
+
+    /// @brief The service applying the advertising payload changes.
+    AdvertisingUpdateService& _updater;
+
+    /// @brief The template slot of the legacy advertisement.
+    AdvertisingUpdateService::Handle _slot = AdvertisingUpdateService::INVALID_HANDLE;
+
+    /// @brief The offset of the status byte in the advertising payload.
+    size_t _statusOffset = 0;
 };
 
-#endif  // CONNECTABLE_ADVERTISER_H
\ No newline at end of file
+#endif  // CONNECTABLE_ADVERTISER_H
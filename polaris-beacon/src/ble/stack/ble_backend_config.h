@@ -0,0 +1,24 @@
+#ifndef BLE_BACKEND_CONFIG_H
+#define BLE_BACKEND_CONFIG_H
+
+// Compile-time selection of the BLE host stack backend. Exactly one of the POLARIS_BLE_BACKEND_*
+// macros below is set to 1:
+//  - `-DPOLARIS_BLE_NIMBLE` selects the NimBLE backend (requires the NimBLE-Arduino library).
+//  - `-DPOLARIS_BLE_FAKE` selects the in-memory fake backend. It is also the default when not
+//    building for Arduino (host builds).
+//  - Otherwise, the Arduino Bluedroid backend is used.
+#if defined(POLARIS_BLE_NIMBLE)
+#define POLARIS_BLE_BACKEND_NIMBLE 1
+#define POLARIS_BLE_BACKEND_FAKE 0
+#define POLARIS_BLE_BACKEND_BLUEDROID 0
+#elif defined(POLARIS_BLE_FAKE) || !defined(ARDUINO)
+#define POLARIS_BLE_BACKEND_NIMBLE 0
+#define POLARIS_BLE_BACKEND_FAKE 1
+#define POLARIS_BLE_BACKEND_BLUEDROID 0
+#else
+#define POLARIS_BLE_BACKEND_NIMBLE 0
+#define POLARIS_BLE_BACKEND_FAKE 0
+#define POLARIS_BLE_BACKEND_BLUEDROID 1
+#endif
+
+#endif  // BLE_BACKEND_CONFIG_H
@@ -0,0 +1,21 @@
+#include "ble_stack_factory.h"
+
+#include "ble_backend_config.h"
+
+#if POLARIS_BLE_BACKEND_NIMBLE
+#include "nimble_ble_stack.h"
+#elif POLARIS_BLE_BACKEND_FAKE
+#include "fake_ble_stack.h"
+#else
+#include "bluedroid_ble_stack.h"
+#endif
+
+std::unique_ptr<IBleStack> createBleStack() {
+#if POLARIS_BLE_BACKEND_NIMBLE
+    return std::unique_ptr<IBleStack>(new NimBleStack());
+#elif POLARIS_BLE_BACKEND_FAKE
+    return std::unique_ptr<IBleStack>(new FakeBleStack());
+#else
+    return std::unique_ptr<IBleStack>(new BluedroidBleStack());
+#endif
+}
@@ -0,0 +1,16 @@
+#ifndef BLE_STACK_FACTORY_H
+#define BLE_STACK_FACTORY_H
+
+#include <memory>
+
+#include "ible_stack.h"
+
+/**
+ * @brief Creates the BLE host stack backend selected at compile time.
+ *
+ * See `ble_backend_config.h` for the build flags controlling the selection.
+ * @return A unique pointer to the new, uninitialized stack.
+ */
+std::unique_ptr<IBleStack> createBleStack();
+
+#endif  // BLE_STACK_FACTORY_H
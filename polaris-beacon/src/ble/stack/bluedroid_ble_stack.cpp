@@ -0,0 +1,289 @@
+#include "bluedroid_ble_stack.h"
+
+#if POLARIS_BLE_BACKEND_BLUEDROID
+
+#include <BLE2902.h>  // For standard descriptors like CCCD
+#include <BLEDevice.h>
+#include <BLEUUID.h>
+#include <HardwareSerial.h>
+
+namespace {
+esp_ble_gap_phy_t toBluedroidPhy(BlePhy phy) {
+    switch (phy) {
+        case BlePhy::Phy2M:
+            return ESP_BLE_GAP_PHY_2M;
+        case BlePhy::Coded:
+            return ESP_BLE_GAP_PHY_CODED;
+        case BlePhy::Phy1M:
+        default:
+            return ESP_BLE_GAP_PHY_1M;
+    }
+}
+}  // namespace
+
+// ========== CHARACTERISTIC ==========
+BluedroidBleStack::Characteristic::Characteristic(BLECharacteristic* characteristic,
+                                                  WriteCallback onWrite)
+    : _characteristic(characteristic), _onWrite(onWrite) {
+}
+
+void BluedroidBleStack::Characteristic::setValue(const uint8_t* data, size_t len) {
+    _characteristic->setValue(const_cast<uint8_t*>(data), len);
+}
+
+void BluedroidBleStack::Characteristic::indicate() {
+    _characteristic->indicate();
+}
+
+BLECharacteristic* BluedroidBleStack::Characteristic::getRaw() const {
+    return _characteristic;
+}
+
+void BluedroidBleStack::Characteristic::onWrite(BLECharacteristic* pChar) {
+    if (!pChar)
+        return;
+    std::string value = pChar->getValue();
+    if (_onWrite && !value.empty()) {
+        _onWrite(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    }
+}
+
+// ========== SERVER CALLBACKS ==========
+BluedroidBleStack::ServerCallbacks::ServerCallbacks(IBleServerListener* listener)
+    : _listener(listener) {
+}
+
+void BluedroidBleStack::ServerCallbacks::onConnect(BLEServer* _) {
+    if (_listener) {
+        _listener->onConnect();
+    }
+}
+
+void BluedroidBleStack::ServerCallbacks::onDisconnect(BLEServer* _) {
+    if (_listener) {
+        _listener->onDisconnect();
+    }
+}
+
+void BluedroidBleStack::ServerCallbacks::onMtuChanged(BLEServer* _,
+                                                      esp_ble_gatts_cb_param_t* param) {
+    if (_listener) {
+        _listener->onMtuChanged(param->mtu.mtu);
+    }
+}
+
+// ========== MULTI ADVERTISER ==========
+BluedroidBleStack::MultiAdvertiser::MultiAdvertiser() : _advertising(MAX_ADV_INSTANCES) {
+}
+
+bool BluedroidBleStack::MultiAdvertiser::setAdvertisingParams(uint8_t instance,
+                                                              const BleAdvParams& params) {
+    uint16_t type;
+    if (params.legacy) {
+        type = params.connectable ? ESP_BLE_GAP_SET_EXT_ADV_PROP_LEGACY_IND
+                                  : ESP_BLE_GAP_SET_EXT_ADV_PROP_LEGACY_NONCONN;
+    } else if (params.connectable) {
+        type = ESP_BLE_GAP_SET_EXT_ADV_PROP_CONNECTABLE;
+    } else if (params.scannable) {
+        type = ESP_BLE_GAP_SET_EXT_ADV_PROP_SCANNABLE;
+    } else {
+        type = ESP_BLE_GAP_SET_EXT_ADV_PROP_NONCONN_NONSCANNABLE_UNDIRECTED;
+    }
+
+    esp_ble_gap_ext_adv_params_t espParams = {
+        .type = type,
+        .interval_min = params.intervalMin,
+        .interval_max = params.intervalMax,
+        .channel_map = ADV_CHNL_ALL,
+        .own_addr_type = BLE_ADDR_TYPE_PUBLIC,               // Same address as the device
+        .filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,  // Allows scan & connection
+        .tx_power = EXT_ADV_TX_PWR_NO_PREFERENCE,            // No preference for tx power
+        .primary_phy = toBluedroidPhy(params.primaryPhy),
+        .secondary_phy = toBluedroidPhy(params.secondaryPhy),
+        .sid = params.sid,
+        .scan_req_notif = false,
+    };
+
+    if (!_advertising.setAdvertisingParams(instance, &espParams)) {
+        return false;
+    }
+    _advertising.setDuration(instance, 0, 0);  // Advertise indefinitely
+    return true;
+}
+
+bool BluedroidBleStack::MultiAdvertiser::setAdvertisingData(uint8_t instance, const uint8_t* data,
+                                                            size_t len) {
+    return _advertising.setAdvertisingData(instance, len, data);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::setScanResponseData(uint8_t instance,
+                                                             const uint8_t* data, size_t len) {
+    return _advertising.setScanRspData(instance, len, data);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::start(uint8_t instance) {
+    return _advertising.start(1, instance);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::stop(uint8_t instance) {
+    return _advertising.stop(1, &instance);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::setPeriodicAdvertisingParams(uint8_t instance,
+                                                                      uint16_t intervalMin,
+                                                                      uint16_t intervalMax) {
+    esp_ble_gap_periodic_adv_params_t periodicParams = {
+        .interval_min = intervalMin,
+        .interval_max = intervalMax,
+        .properties = 0,  // Do not include the TX power
+    };
+    return _advertising.setPeriodicAdvertisingParams(instance, &periodicParams);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::setPeriodicAdvertisingData(uint8_t instance,
+                                                                    const uint8_t* data,
+                                                                    size_t len) {
+    return _advertising.setPeriodicAdvertisingData(instance, len, data);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::startPeriodicAdvertising(uint8_t instance) {
+    return _advertising.startPeriodicAdvertising(instance);
+}
+
+bool BluedroidBleStack::MultiAdvertiser::stopPeriodicAdvertising(uint8_t instance) {
+    // BLEMultiAdvertising has no wrapper for this one.
+    return esp_ble_gap_periodic_adv_stop(instance) == ESP_OK;
+}
+
+// ========== STACK ==========
+BluedroidBleStack::BluedroidBleStack()
+    : _multiAdvertiser(std::unique_ptr<MultiAdvertiser>(new MultiAdvertiser())) {
+}
+
+BluedroidBleStack::~BluedroidBleStack() {
+    deinit();
+}
+
+bool BluedroidBleStack::init(uint16_t mtu) {
+    BLEDevice::init("");
+    BLEDevice::setMTU(mtu);
+    return BLEDevice::getInitialized();
+}
+
+void BluedroidBleStack::deinit() {
+    if (BLEDevice::getInitialized()) {
+        BLEDevice::deinit(true);
+    }
+    _characteristics.clear();
+    _pService = nullptr;
+    _pServer = nullptr;
+}
+
+bool BluedroidBleStack::isInitialized() const {
+    return BLEDevice::getInitialized();
+}
+
+bool BluedroidBleStack::createServer(IBleServerListener* listener) {
+    _pServer = BLEDevice::createServer();
+    if (!_pServer) {
+        return false;
+    }
+
+    _serverCallbacks = std::unique_ptr<ServerCallbacks>(new ServerCallbacks(listener));
+    _pServer->setCallbacks(_serverCallbacks.get());
+    return true;
+}
+
+bool BluedroidBleStack::createService(const char* uuid, uint16_t numHandles) {
+    if (!_pServer) {
+        return false;
+    }
+    _pService = _pServer->createService(BLEUUID(uuid), numHandles, 0);
+    return _pService != nullptr;
+}
+
+IBleCharacteristic* BluedroidBleStack::createWriteCharacteristic(const char* uuid,
+                                                                 WriteCallback onWrite,
+                                                                 const std::string& description) {
+    Characteristic* handle =
+        createCharacteristic(uuid, BLECharacteristic::PROPERTY_WRITE, onWrite);
+    if (!handle) {
+        return nullptr;
+    }
+
+    BLECharacteristic* pChar = handle->getRaw();
+    pChar->setAccessPermissions(ESP_GATT_PERM_WRITE);
+    pChar->setCallbacks(handle);
+    addUserDescription(pChar, description);
+    return handle;
+}
+
+IBleCharacteristic* BluedroidBleStack::createIndicateCharacteristic(
+    const char* uuid, const std::string& description) {
+    Characteristic* handle =
+        createCharacteristic(uuid, BLECharacteristic::PROPERTY_INDICATE, nullptr);
+    if (!handle) {
+        return nullptr;
+    }
+
+    BLECharacteristic* pChar = handle->getRaw();
+    pChar->setAccessPermissions(ESP_GATT_PERM_READ);
+
+    BLE2902* cccd = new BLE2902();
+    if (!cccd) {
+        Serial.printf("%s Failed to allocate BLE2902 (CCCD)!\n", TAG);
+        return nullptr;
+    }
+    cccd->setAccessPermissions(ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE);
+    pChar->addDescriptor(cccd);
+
+    addUserDescription(pChar, description);
+    return handle;
+}
+
+BluedroidBleStack::Characteristic* BluedroidBleStack::createCharacteristic(
+    const char* uuid, uint32_t properties, WriteCallback onWrite) {
+    if (!_pService) {
+        Serial.printf("%s No service to add characteristic %s to.\n", TAG, uuid);
+        return nullptr;
+    }
+
+    BLECharacteristic* pChar = _pService->createCharacteristic(BLEUUID(uuid), properties);
+    if (!pChar) {
+        Serial.printf("%s Failed to create characteristic with UUID: %s\n", TAG, uuid);
+        return nullptr;
+    }
+
+    _characteristics.push_back(
+        std::unique_ptr<Characteristic>(new Characteristic(pChar, onWrite)));
+    return _characteristics.back().get();
+}
+
+void BluedroidBleStack::addUserDescription(BLECharacteristic* characteristic,
+                                           const std::string& description) {
+    if (description.empty()) {
+        return;
+    }
+    BLEDescriptor* desc = new BLEDescriptor(BLEUUID((uint16_t)0x2901));
+    if (desc) {
+        desc->setValue(description);
+        desc->setAccessPermissions(ESP_GATT_PERM_READ);
+        characteristic->addDescriptor(desc);
+    } else {
+        Serial.printf("%s Failed to allocate User Description descriptor!\n", TAG);
+    }
+}
+
+bool BluedroidBleStack::startService() {
+    if (!_pService) {
+        return false;
+    }
+    _pService->start();
+    return true;
+}
+
+IBleMultiAdvertiser* BluedroidBleStack::getMultiAdvertiser() {
+    return _multiAdvertiser.get();
+}
+
+#endif  // POLARIS_BLE_BACKEND_BLUEDROID
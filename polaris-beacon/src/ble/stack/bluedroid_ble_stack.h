@@ -0,0 +1,139 @@
+#ifndef BLUEDROID_BLE_STACK_H
+#define BLUEDROID_BLE_STACK_H
+
+#include "ble_backend_config.h"
+
+#if POLARIS_BLE_BACKEND_BLUEDROID
+
+#include <BLEAdvertising.h>
+#include <BLECharacteristic.h>
+#include <BLEServer.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ible_stack.h"
+
+/**
+ * @class BluedroidBleStack
+ * @brief IBleStack implementation on top of the Arduino Bluedroid BLE library.
+ *
+ * This is the original backend of the beacon. It is heavier than NimBLE in RAM and boot time,
+ * but it ships with the Arduino core and needs no extra library.
+ */
+class BluedroidBleStack : public IBleStack {
+public:
+    /**
+     * @brief Constructs the stack. The host stack itself is only started by `init`.
+     */
+    BluedroidBleStack();
+    ~BluedroidBleStack() override;
+
+    // See IBleStack for documentation of overridden methods.
+    bool init(uint16_t mtu) override;
+    void deinit() override;
+    bool isInitialized() const override;
+    bool createServer(IBleServerListener* listener) override;
+    bool createService(const char* uuid, uint16_t numHandles) override;
+    IBleCharacteristic* createWriteCharacteristic(const char* uuid, WriteCallback onWrite,
+                                                  const std::string& description) override;
+    IBleCharacteristic* createIndicateCharacteristic(const char* uuid,
+                                                     const std::string& description) override;
+    bool startService() override;
+    IBleMultiAdvertiser* getMultiAdvertiser() override;
+
+    /// @brief The number of advertising instances reserved in the Bluedroid controller.
+    static constexpr uint8_t MAX_ADV_INSTANCES = 2;
+
+private:
+    BluedroidBleStack(const BluedroidBleStack&) = delete;
+    BluedroidBleStack& operator=(const BluedroidBleStack&) = delete;
+
+    /**
+     * @class Characteristic
+     * @brief Adapts a `BLECharacteristic` to IBleCharacteristic and bridges its write callback.
+     */
+    class Characteristic : public IBleCharacteristic, public BLECharacteristicCallbacks {
+    public:
+        Characteristic(BLECharacteristic* characteristic, WriteCallback onWrite);
+        void setValue(const uint8_t* data, size_t len) override;
+        void indicate() override;
+        void onWrite(BLECharacteristic* pChar) override;
+
+        /** @brief Gets the underlying library characteristic. */
+        BLECharacteristic* getRaw() const;
+
+    private:
+        BLECharacteristic* _characteristic;
+        WriteCallback _onWrite;
+    };
+
+    /**
+     * @class ServerCallbacks
+     * @brief Forwards the Bluedroid server events to an IBleServerListener.
+     */
+    class ServerCallbacks : public BLEServerCallbacks {
+    public:
+        explicit ServerCallbacks(IBleServerListener* listener);
+        void onConnect(BLEServer* pServer) override;
+        void onDisconnect(BLEServer* pServer) override;
+        void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) override;
+
+    private:
+        IBleServerListener* _listener;
+    };
+
+    /**
+     * @class MultiAdvertiser
+     * @brief Adapts `BLEMultiAdvertising` to IBleMultiAdvertiser.
+     */
+    class MultiAdvertiser : public IBleMultiAdvertiser {
+    public:
+        MultiAdvertiser();
+        bool setAdvertisingParams(uint8_t instance, const BleAdvParams& params) override;
+        bool setAdvertisingData(uint8_t instance, const uint8_t* data, size_t len) override;
+        bool setScanResponseData(uint8_t instance, const uint8_t* data, size_t len) override;
+        bool start(uint8_t instance) override;
+        bool stop(uint8_t instance) override;
+        bool setPeriodicAdvertisingParams(uint8_t instance, uint16_t intervalMin,
+                                          uint16_t intervalMax) override;
+        bool setPeriodicAdvertisingData(uint8_t instance, const uint8_t* data,
+                                        size_t len) override;
+        bool startPeriodicAdvertising(uint8_t instance) override;
+        bool stopPeriodicAdvertising(uint8_t instance) override;
+
+    private:
+        BLEMultiAdvertising _advertising;
+    };
+
+    /** @brief Adds the User Description (0x2901) descriptor to a characteristic. */
+    static void addUserDescription(BLECharacteristic* characteristic,
+                                   const std::string& description);
+
+    /** @brief Creates a characteristic in the current service and wraps it. */
+    Characteristic* createCharacteristic(const char* uuid, uint32_t properties,
+                                         WriteCallback onWrite);
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[Bluedroid]";
+
+    /// @brief A pointer to the main BLE server instance, owned by the library.
+    BLEServer* _pServer = nullptr;
+
+    /// @brief The primary service, owned by the library.
+    BLEService* _pService = nullptr;
+
+    /// @brief The adapter forwarding server events to the listener.
+    std::unique_ptr<ServerCallbacks> _serverCallbacks;
+
+    /// @brief The multi-advertising controller.
+    std::unique_ptr<MultiAdvertiser> _multiAdvertiser;
+
+    /// @brief The characteristic adapters created in the primary service.
+    std::vector<std::unique_ptr<Characteristic>> _characteristics;
+};
+
+#endif  // POLARIS_BLE_BACKEND_BLUEDROID
+
+#endif  // BLUEDROID_BLE_STACK_H
@@ -0,0 +1,205 @@
+#include "fake_ble_stack.h"
+
+#if POLARIS_BLE_BACKEND_FAKE
+
+// ========== CHARACTERISTIC ==========
+FakeBleStack::Characteristic::Characteristic(WriteCallback onWrite) : onWrite(onWrite) {
+}
+
+void FakeBleStack::Characteristic::setValue(const uint8_t* data, size_t len) {
+    value.assign(data, data + len);
+}
+
+void FakeBleStack::Characteristic::indicate() {
+    indications.push_back(value);
+}
+
+// ========== MULTI ADVERTISER ==========
+bool FakeBleStack::MultiAdvertiser::setAdvertisingParams(uint8_t instance,
+                                                         const BleAdvParams& params) {
+    if (instance >= MAX_ADV_INSTANCES) {
+        return false;
+    }
+    instances[instance].params = params;
+    instances[instance].hasParams = true;
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::setAdvertisingData(uint8_t instance, const uint8_t* data,
+                                                       size_t len) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasParams) {
+        return false;
+    }
+    instances[instance].advData.assign(data, data + len);
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::setScanResponseData(uint8_t instance, const uint8_t* data,
+                                                        size_t len) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasParams) {
+        return false;
+    }
+    instances[instance].scanRspData.assign(data, data + len);
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::start(uint8_t instance) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasParams) {
+        return false;
+    }
+    instances[instance].active = true;
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::stop(uint8_t instance) {
+    if (instance >= MAX_ADV_INSTANCES) {
+        return false;
+    }
+    instances[instance].active = false;
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::setPeriodicAdvertisingParams(uint8_t instance,
+                                                                 uint16_t intervalMin,
+                                                                 uint16_t intervalMax) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasParams) {
+        return false;
+    }
+    const BleAdvParams& params = instances[instance].params;
+    if (params.legacy || params.connectable || params.scannable) {
+        return false;
+    }
+    instances[instance].periodicIntervalMin = intervalMin;
+    instances[instance].periodicIntervalMax = intervalMax;
+    instances[instance].hasPeriodicParams = true;
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::setPeriodicAdvertisingData(uint8_t instance,
+                                                               const uint8_t* data, size_t len) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasPeriodicParams) {
+        return false;
+    }
+    instances[instance].periodicData.assign(data, data + len);
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::startPeriodicAdvertising(uint8_t instance) {
+    if (instance >= MAX_ADV_INSTANCES || !instances[instance].hasPeriodicParams) {
+        return false;
+    }
+    instances[instance].periodicActive = true;
+    return true;
+}
+
+bool FakeBleStack::MultiAdvertiser::stopPeriodicAdvertising(uint8_t instance) {
+    if (instance >= MAX_ADV_INSTANCES) {
+        return false;
+    }
+    instances[instance].periodicActive = false;
+    return true;
+}
+
+// ========== STACK ==========
+FakeBleStack::FakeBleStack() = default;
+
+bool FakeBleStack::init(uint16_t _) {
+    _initialized = true;
+    return true;
+}
+
+void FakeBleStack::deinit() {
+    _initialized = false;
+    _serviceCreated = false;
+    _serviceStarted = false;
+    _listener = nullptr;
+    _characteristics.clear();
+    for (auto& instance : _multiAdvertiser.instances) {
+        instance = AdvInstance();
+    }
+}
+
+bool FakeBleStack::isInitialized() const {
+    return _initialized;
+}
+
+bool FakeBleStack::createServer(IBleServerListener* listener) {
+    if (!_initialized) {
+        return false;
+    }
+    _listener = listener;
+    return true;
+}
+
+bool FakeBleStack::createService(const char* _, uint16_t __) {
+    _serviceCreated = _initialized;
+    return _serviceCreated;
+}
+
+IBleCharacteristic* FakeBleStack::createWriteCharacteristic(const char* uuid,
+                                                            WriteCallback onWrite,
+                                                            const std::string& _) {
+    if (!_serviceCreated) {
+        return nullptr;
+    }
+    auto& slot = _characteristics[uuid];
+    slot = std::unique_ptr<Characteristic>(new Characteristic(onWrite));
+    return slot.get();
+}
+
+IBleCharacteristic* FakeBleStack::createIndicateCharacteristic(const char* uuid,
+                                                               const std::string& _) {
+    return createWriteCharacteristic(uuid, nullptr, _);
+}
+
+bool FakeBleStack::startService() {
+    _serviceStarted = _serviceCreated;
+    return _serviceStarted;
+}
+
+IBleMultiAdvertiser* FakeBleStack::getMultiAdvertiser() {
+    return &_multiAdvertiser;
+}
+
+// ========== SIMULATION ==========
+void FakeBleStack::simulateConnect() {
+    if (_listener) {
+        _listener->onConnect();
+    }
+}
+
+void FakeBleStack::simulateDisconnect() {
+    if (_listener) {
+        _listener->onDisconnect();
+    }
+}
+
+void FakeBleStack::simulateMtuChange(uint16_t mtu) {
+    if (_listener) {
+        _listener->onMtuChanged(mtu);
+    }
+}
+
+bool FakeBleStack::simulateWrite(const std::string& uuid, const uint8_t* data, size_t len) {
+    Characteristic* characteristic = getCharacteristic(uuid);
+    if (!characteristic || !characteristic->onWrite) {
+        return false;
+    }
+    characteristic->onWrite(data, len);
+    return true;
+}
+
+FakeBleStack::Characteristic* FakeBleStack::getCharacteristic(const std::string& uuid) {
+    auto it = _characteristics.find(uuid);
+    return it != _characteristics.end() ? it->second.get() : nullptr;
+}
+
+const FakeBleStack::AdvInstance& FakeBleStack::getAdvInstance(uint8_t instance) const {
+    return _multiAdvertiser.instances[instance < MAX_ADV_INSTANCES ? instance : 0];
+}
+
+bool FakeBleStack::isServiceStarted() const {
+    return _serviceStarted;
+}
+
+#endif  // POLARIS_BLE_BACKEND_FAKE
@@ -0,0 +1,135 @@
+#ifndef FAKE_BLE_STACK_H
+#define FAKE_BLE_STACK_H
+
+#include "ble_backend_config.h"
+
+#if POLARIS_BLE_BACKEND_FAKE
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ible_stack.h"
+
+/**
+ * @class FakeBleStack
+ * @brief In-memory IBleStack implementation without any radio.
+ *
+ * Used for host builds. It records everything the firmware pushes to the stack (advertising data,
+ * characteristic values, indications) and lets a test harness inject client events.
+ */
+class FakeBleStack : public IBleStack {
+public:
+    /**
+     * @class Characteristic
+     * @brief A recorded characteristic.
+     */
+    class Characteristic : public IBleCharacteristic {
+    public:
+        explicit Characteristic(WriteCallback onWrite);
+        void setValue(const uint8_t* data, size_t len) override;
+        void indicate() override;
+
+        /// @brief The current local value.
+        std::vector<uint8_t> value;
+
+        /// @brief Every value sent as an indication, in order.
+        std::vector<std::vector<uint8_t>> indications;
+
+        /// @brief The callback to execute on a client write, if any.
+        WriteCallback onWrite;
+    };
+
+    /**
+     * @struct AdvInstance
+     * @brief The recorded state of an advertising instance.
+     */
+    struct AdvInstance {
+        BleAdvParams params = {};
+        bool hasParams = false;
+        std::vector<uint8_t> advData;
+        std::vector<uint8_t> scanRspData;
+        bool active = false;
+        uint16_t periodicIntervalMin = 0;
+        uint16_t periodicIntervalMax = 0;
+        bool hasPeriodicParams = false;
+        std::vector<uint8_t> periodicData;
+        bool periodicActive = false;
+    };
+
+    FakeBleStack();
+
+    // See IBleStack for documentation of overridden methods.
+    bool init(uint16_t mtu) override;
+    void deinit() override;
+    bool isInitialized() const override;
+    bool createServer(IBleServerListener* listener) override;
+    bool createService(const char* uuid, uint16_t numHandles) override;
+    IBleCharacteristic* createWriteCharacteristic(const char* uuid, WriteCallback onWrite,
+                                                  const std::string& description) override;
+    IBleCharacteristic* createIndicateCharacteristic(const char* uuid,
+                                                     const std::string& description) override;
+    bool startService() override;
+    IBleMultiAdvertiser* getMultiAdvertiser() override;
+
+    /** @brief Simulates a client connection. */
+    void simulateConnect();
+
+    /** @brief Simulates a client disconnection. */
+    void simulateDisconnect();
+
+    /** @brief Simulates an MTU negotiation. */
+    void simulateMtuChange(uint16_t mtu);
+
+    /**
+     * @brief Simulates a client write to a characteristic.
+     * @return False if the characteristic does not exist or is not writable.
+     */
+    bool simulateWrite(const std::string& uuid, const uint8_t* data, size_t len);
+
+    /** @brief Gets a recorded characteristic by UUID, or `nullptr`. */
+    Characteristic* getCharacteristic(const std::string& uuid);
+
+    /** @brief Gets the recorded state of an advertising instance. */
+    const AdvInstance& getAdvInstance(uint8_t instance) const;
+
+    /** @brief True once `startService` has been called. */
+    bool isServiceStarted() const;
+
+    /// @brief The number of advertising instances recorded by this backend.
+    static constexpr uint8_t MAX_ADV_INSTANCES = 2;
+
+private:
+    /**
+     * @class MultiAdvertiser
+     * @brief Records the advertising instances.
+     */
+    class MultiAdvertiser : public IBleMultiAdvertiser {
+    public:
+        bool setAdvertisingParams(uint8_t instance, const BleAdvParams& params) override;
+        bool setAdvertisingData(uint8_t instance, const uint8_t* data, size_t len) override;
+        bool setScanResponseData(uint8_t instance, const uint8_t* data, size_t len) override;
+        bool start(uint8_t instance) override;
+        bool stop(uint8_t instance) override;
+        bool setPeriodicAdvertisingParams(uint8_t instance, uint16_t intervalMin,
+                                          uint16_t intervalMax) override;
+        bool setPeriodicAdvertisingData(uint8_t instance, const uint8_t* data,
+                                        size_t len) override;
+        bool startPeriodicAdvertising(uint8_t instance) override;
+        bool stopPeriodicAdvertising(uint8_t instance) override;
+
+        AdvInstance instances[MAX_ADV_INSTANCES];
+    };
+
+    bool _initialized = false;
+    bool _serviceCreated = false;
+    bool _serviceStarted = false;
+    IBleServerListener* _listener = nullptr;
+    MultiAdvertiser _multiAdvertiser;
+    std::map<std::string, std::unique_ptr<Characteristic>> _characteristics;
+};
+
+#endif  // POLARIS_BLE_BACKEND_FAKE
+
+#endif  // FAKE_BLE_STACK_H
@@ -0,0 +1,258 @@
+#ifndef IBLE_STACK_H
+#define IBLE_STACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+
+/**
+ * @enum BlePhy
+ * @brief The physical layers an advertising set can use.
+ */
+enum class BlePhy : uint8_t {
+    Phy1M,  ///< 1 Mb/s, the default LE PHY.
+    Phy2M,  ///< 2 Mb/s, higher throughput, shorter range.
+    Coded   ///< LE Coded (125/500 kb/s), long range. Extended advertising only.
+};
+
+/**
+ * @struct BleAdvParams
+ * @brief Backend-neutral parameters of a single advertising instance.
+ */
+struct BleAdvParams {
+    /// @brief True for a legacy (BLE 4.x) advertisement, false for an extended one.
+    bool legacy;
+
+    /// @brief True if centrals are allowed to connect through this instance.
+    bool connectable;
+
+    /// @brief True if the instance answers scan requests with its scan response data.
+    bool scannable;
+
+    /// @brief The minimum advertising interval, in units of 0.625 ms.
+    uint32_t intervalMin;
+
+    /// @brief The maximum advertising interval, in units of 0.625 ms.
+    uint32_t intervalMax;
+
+    /// @brief The PHY used on the primary advertising channels.
+    BlePhy primaryPhy;
+
+    /// @brief The PHY used on the secondary channels (extended advertising only).
+    BlePhy secondaryPhy;
+
+    /// @brief The advertising set ID (SID) of this instance.
+    uint8_t sid;
+};
+
+/**
+ * @interface IBleCharacteristic
+ * @brief A backend-neutral handle to a GATT characteristic owned by the BLE stack.
+ */
+class IBleCharacteristic {
+public:
+    virtual ~IBleCharacteristic() = default;
+
+    /**
+     * @brief Sets the local value of the characteristic.
+     * @param data Pointer to the new value.
+     * @param len The length of the new value.
+     */
+    virtual void setValue(const uint8_t* data, size_t len) = 0;
+
+    /**
+     * @brief Sends the current value to the subscribed clients as an indication.
+     */
+    virtual void indicate() = 0;
+};
+
+/**
+ * @interface IBleServerListener
+ * @brief Receives the GATT server connection events from the BLE stack.
+ */
+class IBleServerListener {
+public:
+    virtual ~IBleServerListener() = default;
+
+    /** @brief Called when a client connects. */
+    virtual void onConnect() = 0;
+
+    /** @brief Called when a client disconnects. */
+    virtual void onDisconnect() = 0;
+
+    /** @brief Called when the ATT MTU of a connection has been negotiated. */
+    virtual void onMtuChanged(uint16_t mtu) = 0;
+};
+
+/**
+ * @interface IBleMultiAdvertiser
+ * @brief Controls several independent advertising instances (BLE 5 advertising sets).
+ */
+class IBleMultiAdvertiser {
+public:
+    virtual ~IBleMultiAdvertiser() = default;
+
+    /**
+     * @brief Configures the parameters of an advertising instance.
+     * @param instance The advertising instance ID.
+     * @param params The parameters to apply.
+     * @return True on success, false otherwise.
+     */
+    virtual bool setAdvertisingParams(uint8_t instance, const BleAdvParams& params) = 0;
+
+    /**
+     * @brief Sets the raw advertising data (AD structures) of an instance.
+     * @param instance The advertising instance ID.
+     * @param data Pointer to the raw AD structures.
+     * @param len The length of the data.
+     * @return True on success, false otherwise.
+     */
+    virtual bool setAdvertisingData(uint8_t instance, const uint8_t* data, size_t len) = 0;
+
+    /**
+     * @brief Sets the raw scan response data (AD structures) of an instance.
+     * @param instance The advertising instance ID.
+     * @param data Pointer to the raw AD structures.
+     * @param len The length of the data.
+     * @return True on success, false otherwise.
+     */
+    virtual bool setScanResponseData(uint8_t instance, const uint8_t* data, size_t len) = 0;
+
+    /**
+     * @brief Starts advertising an instance indefinitely.
+     * @param instance The advertising instance ID.
+     * @return True on success, false otherwise.
+     */
+    virtual bool start(uint8_t instance) = 0;
+
+    /**
+     * @brief Stops advertising an instance.
+     * @param instance The advertising instance ID.
+     * @return True on success, false otherwise.
+     */
+    virtual bool stop(uint8_t instance) = 0;
+
+    /**
+     * @brief Configures a periodic advertising train on an extended instance.
+     *
+     * The instance must be extended, non-connectable and non-scannable, and its parameters must
+     * already be set. Once both are running, the controller adds the sync info to the extended
+     * advertisement so scanners can synchronize to the train.
+     * @param instance The advertising instance ID.
+     * @param intervalMin The minimum periodic interval, in units of 1.25 ms.
+     * @param intervalMax The maximum periodic interval, in units of 1.25 ms.
+     * @return True on success, false otherwise (including if the backend has no support).
+     */
+    virtual bool setPeriodicAdvertisingParams(uint8_t instance, uint16_t intervalMin,
+                                              uint16_t intervalMax) = 0;
+
+    /**
+     * @brief Sets the raw data (AD structures) carried by the periodic train of an instance.
+     * @param instance The advertising instance ID.
+     * @param data Pointer to the raw AD structures.
+     * @param len The length of the data.
+     * @return True on success, false otherwise.
+     */
+    virtual bool setPeriodicAdvertisingData(uint8_t instance, const uint8_t* data,
+                                            size_t len) = 0;
+
+    /**
+     * @brief Starts the periodic train of an instance.
+     * @param instance The advertising instance ID.
+     * @return True on success, false otherwise.
+     */
+    virtual bool startPeriodicAdvertising(uint8_t instance) = 0;
+
+    /**
+     * @brief Stops the periodic train of an instance.
+     * @param instance The advertising instance ID.
+     * @return True on success, false otherwise.
+     */
+    virtual bool stopPeriodicAdvertising(uint8_t instance) = 0;
+};
+
+/**
+ * @interface IBleStack
+ * @brief A thin abstraction over the BLE host stack (GATT server and advertising).
+ *
+ * The rest of the firmware only talks to the BLE stack through this interface, so the
+ * host stack implementation (Bluedroid, NimBLE, or an in-memory fake for host tests) can be
+ * selected at compile time. The stack exposes a single primary service, which is all the
+ * beacon needs.
+ */
+class IBleStack {
+public:
+    /**
+     * @brief A function type for the callback executed when a client writes a characteristic.
+     */
+    using WriteCallback = std::function<void(const uint8_t* data, size_t len)>;
+
+    virtual ~IBleStack() = default;
+
+    /**
+     * @brief Initializes the host stack and requests the given ATT MTU.
+     * @param mtu The preferred ATT MTU for connections.
+     * @return True on success, false otherwise.
+     */
+    virtual bool init(uint16_t mtu) = 0;
+
+    /**
+     * @brief Shuts down the host stack and releases its resources.
+     */
+    virtual void deinit() = 0;
+
+    /**
+     * @brief Checks whether the host stack is currently initialized.
+     */
+    virtual bool isInitialized() const = 0;
+
+    /**
+     * @brief Creates the GATT server.
+     * @param listener The listener notified of connection events. Must outlive the stack.
+     * @return True on success, false otherwise.
+     */
+    virtual bool createServer(IBleServerListener* listener) = 0;
+
+    /**
+     * @brief Creates the primary service that will hold all the characteristics.
+     * @param uuid The 128-bit UUID of the service, as a string.
+     * @param numHandles The number of attribute handles to reserve for the service.
+     * @return True on success, false otherwise.
+     */
+    virtual bool createService(const char* uuid, uint16_t numHandles) = 0;
+
+    /**
+     * @brief Creates a characteristic with the WRITE property in the primary service.
+     * @param uuid The 128-bit UUID of the characteristic, as a string.
+     * @param onWrite The callback executed when a client writes to the characteristic.
+     * @param description A human-readable description (User Description descriptor).
+     * @return A handle to the characteristic, owned by the stack, or `nullptr` on failure.
+     */
+    virtual IBleCharacteristic* createWriteCharacteristic(const char* uuid, WriteCallback onWrite,
+                                                          const std::string& description) = 0;
+
+    /**
+     * @brief Creates a characteristic with the INDICATE property (and its CCCD).
+     * @param uuid The 128-bit UUID of the characteristic, as a string.
+     * @param description A human-readable description (User Description descriptor).
+     * @return A handle to the characteristic, owned by the stack, or `nullptr` on failure.
+     */
+    virtual IBleCharacteristic* createIndicateCharacteristic(const char* uuid,
+                                                             const std::string& description) = 0;
+
+    /**
+     * @brief Starts the primary service, making it visible to clients.
+     * @return True on success, false otherwise.
+     */
+    virtual bool startService() = 0;
+
+    /**
+     * @brief Gets the multi-advertising controller of the stack.
+     * @return A pointer to the controller, or `nullptr` if the stack does not provide one.
+     */
+    virtual IBleMultiAdvertiser* getMultiAdvertiser() = 0;
+};
+
+#endif  // IBLE_STACK_H
@@ -0,0 +1,308 @@
+#include "nimble_ble_stack.h"
+
+#if POLARIS_BLE_BACKEND_NIMBLE
+
+#include <HardwareSerial.h>
+
+#if defined(CONFIG_NIMBLE_CPP_IDF)
+#include "host/ble_gap.h"
+#else
+#include "nimble/nimble/host/include/host/ble_gap.h"
+#endif
+
+namespace {
+uint8_t toNimBlePhy(BlePhy phy) {
+    switch (phy) {
+        case BlePhy::Phy2M:
+            return BLE_HCI_LE_PHY_2M;
+        case BlePhy::Coded:
+            return BLE_HCI_LE_PHY_CODED;
+        case BlePhy::Phy1M:
+        default:
+            return BLE_HCI_LE_PHY_1M;
+    }
+}
+
+// Copies raw AD structures into an mbuf. The host takes ownership of the mbuf in all cases.
+struct os_mbuf* toMbuf(const uint8_t* data, size_t len) {
+    struct os_mbuf* buf = os_msys_get_pkthdr(len, 0);
+    if (!buf) {
+        return nullptr;
+    }
+    if (os_mbuf_append(buf, data, len) != 0) {
+        os_mbuf_free_chain(buf);
+        return nullptr;
+    }
+    return buf;
+}
+}  // namespace
+
+// ========== CHARACTERISTIC ==========
+NimBleStack::Characteristic::Characteristic(NimBLECharacteristic* characteristic,
+                                            WriteCallback onWrite)
+    : _characteristic(characteristic), _onWrite(onWrite) {
+}
+
+void NimBleStack::Characteristic::setValue(const uint8_t* data, size_t len) {
+    _characteristic->setValue(data, len);
+}
+
+void NimBleStack::Characteristic::indicate() {
+    _characteristic->indicate();
+}
+
+void NimBleStack::Characteristic::onWrite(NimBLECharacteristic* pChar, NimBLEConnInfo& _) {
+    if (!pChar)
+        return;
+    NimBLEAttValue value = pChar->getValue();
+    if (_onWrite && value.size() > 0) {
+        _onWrite(value.data(), value.size());
+    }
+}
+
+// ========== SERVER CALLBACKS ==========
+NimBleStack::ServerCallbacks::ServerCallbacks(IBleServerListener* listener) : _listener(listener) {
+}
+
+void NimBleStack::ServerCallbacks::onConnect(NimBLEServer* _, NimBLEConnInfo& __) {
+    if (_listener) {
+        _listener->onConnect();
+    }
+}
+
+void NimBleStack::ServerCallbacks::onDisconnect(NimBLEServer* _, NimBLEConnInfo& __, int ___) {
+    if (_listener) {
+        _listener->onDisconnect();
+    }
+}
+
+void NimBleStack::ServerCallbacks::onMTUChange(uint16_t mtu, NimBLEConnInfo& _) {
+    if (_listener) {
+        _listener->onMtuChanged(mtu);
+    }
+}
+
+// ========== MULTI ADVERTISER ==========
+bool NimBleStack::MultiAdvertiser::setAdvertisingParams(uint8_t instance,
+                                                        const BleAdvParams& params) {
+    if (instance >= MAX_ADV_INSTANCES) {
+        return false;
+    }
+
+    auto adv = std::unique_ptr<NimBLEExtAdvertisement>(new NimBLEExtAdvertisement(
+        toNimBlePhy(params.primaryPhy), toNimBlePhy(params.secondaryPhy)));
+    adv->setLegacyAdvertising(params.legacy);
+    adv->setConnectable(params.connectable);
+    adv->setScannable(params.scannable);
+    adv->setMinInterval(params.intervalMin);
+    adv->setMaxInterval(params.intervalMax);
+
+    _pending[instance] = std::move(adv);
+    _configured[instance] = false;
+    return true;
+}
+
+bool NimBleStack::MultiAdvertiser::setAdvertisingData(uint8_t instance, const uint8_t* data,
+                                                      size_t len) {
+    if (instance >= MAX_ADV_INSTANCES) {
+        return false;
+    }
+
+    if (!_configured[instance]) {
+        if (!_pending[instance]) {
+            Serial.printf("%s Instance %u has no parameters.\n", TAG, instance);
+            return false;
+        }
+        _pending[instance]->setData(data, len);
+        if (!NimBLEDevice::getAdvertising()->setInstanceData(instance, *_pending[instance])) {
+            return false;
+        }
+        _pending[instance].reset();
+        _configured[instance] = true;
+        return true;
+    }
+
+    struct os_mbuf* buf = toMbuf(data, len);
+    return buf && ble_gap_ext_adv_set_data(instance, buf) == 0;
+}
+
+bool NimBleStack::MultiAdvertiser::setScanResponseData(uint8_t instance, const uint8_t* data,
+                                                       size_t len) {
+    if (instance >= MAX_ADV_INSTANCES || !_configured[instance]) {
+        Serial.printf("%s Scan response set before advertising data (instance %u).\n", TAG,
+                      instance);
+        return false;
+    }
+    struct os_mbuf* buf = toMbuf(data, len);
+    return buf && ble_gap_ext_adv_rsp_set_data(instance, buf) == 0;
+}
+
+bool NimBleStack::MultiAdvertiser::start(uint8_t instance) {
+    return NimBLEDevice::getAdvertising()->start(instance);
+}
+
+bool NimBleStack::MultiAdvertiser::stop(uint8_t instance) {
+    return NimBLEDevice::getAdvertising()->stop(instance);
+}
+
+#if defined(CONFIG_BT_NIMBLE_ENABLE_PERIODIC_ADV) && CONFIG_BT_NIMBLE_ENABLE_PERIODIC_ADV
+bool NimBleStack::MultiAdvertiser::setPeriodicAdvertisingParams(uint8_t instance,
+                                                                uint16_t intervalMin,
+                                                                uint16_t intervalMax) {
+    // The extended instance must exist in the host before a train can be attached to it.
+    if (instance >= MAX_ADV_INSTANCES || !_configured[instance]) {
+        Serial.printf("%s Periodic params set before advertising data (instance %u).\n", TAG,
+                      instance);
+        return false;
+    }
+    struct ble_gap_periodic_adv_params params = {};
+    params.include_tx_power = 0;
+    params.itvl_min = intervalMin;
+    params.itvl_max = intervalMax;
+    return ble_gap_periodic_adv_configure(instance, &params) == 0;
+}
+
+bool NimBleStack::MultiAdvertiser::setPeriodicAdvertisingData(uint8_t instance,
+                                                              const uint8_t* data, size_t len) {
+    struct os_mbuf* buf = toMbuf(data, len);
+    return buf && ble_gap_periodic_adv_set_data(instance, buf) == 0;
+}
+
+bool NimBleStack::MultiAdvertiser::startPeriodicAdvertising(uint8_t instance) {
+    return ble_gap_periodic_adv_start(instance) == 0;
+}
+
+bool NimBleStack::MultiAdvertiser::stopPeriodicAdvertising(uint8_t instance) {
+    return ble_gap_periodic_adv_stop(instance) == 0;
+}
+#else
+// Periodic advertising is not compiled into the NimBLE host.
+bool NimBleStack::MultiAdvertiser::setPeriodicAdvertisingParams(uint8_t, uint16_t, uint16_t) {
+    return false;
+}
+
+bool NimBleStack::MultiAdvertiser::setPeriodicAdvertisingData(uint8_t, const uint8_t*, size_t) {
+    return false;
+}
+
+bool NimBleStack::MultiAdvertiser::startPeriodicAdvertising(uint8_t) {
+    return false;
+}
+
+bool NimBleStack::MultiAdvertiser::stopPeriodicAdvertising(uint8_t) {
+    return false;
+}
+#endif
+
+// ========== STACK ==========
+NimBleStack::NimBleStack()
+    : _multiAdvertiser(std::unique_ptr<MultiAdvertiser>(new MultiAdvertiser())) {
+}
+
+NimBleStack::~NimBleStack() {
+    deinit();
+}
+
+bool NimBleStack::init(uint16_t mtu) {
+    if (!NimBLEDevice::init("")) {
+        return false;
+    }
+    NimBLEDevice::setMTU(mtu);
+    return true;
+}
+
+void NimBleStack::deinit() {
+    if (NimBLEDevice::isInitialized()) {
+        NimBLEDevice::deinit(true);
+    }
+    _characteristics.clear();
+    _pService = nullptr;
+    _pServer = nullptr;
+}
+
+bool NimBleStack::isInitialized() const {
+    return NimBLEDevice::isInitialized();
+}
+
+bool NimBleStack::createServer(IBleServerListener* listener) {
+    _pServer = NimBLEDevice::createServer();
+    if (!_pServer) {
+        return false;
+    }
+
+    // The BleManager restarts the connectable instance itself on disconnect.
+    _pServer->advertiseOnDisconnect(false);
+
+    _serverCallbacks = std::unique_ptr<ServerCallbacks>(new ServerCallbacks(listener));
+    _pServer->setCallbacks(_serverCallbacks.get(), false);
+    return true;
+}
+
+bool NimBleStack::createService(const char* uuid, uint16_t _) {
+    // NimBLE computes the attribute handles itself.
+    if (!_pServer) {
+        return false;
+    }
+    _pService = _pServer->createService(uuid);
+    return _pService != nullptr;
+}
+
+IBleCharacteristic* NimBleStack::createWriteCharacteristic(const char* uuid, WriteCallback onWrite,
+                                                           const std::string& description) {
+    if (!_pService) {
+        Serial.printf("%s No service to add characteristic %s to.\n", TAG, uuid);
+        return nullptr;
+    }
+
+    NimBLECharacteristic* pChar = _pService->createCharacteristic(uuid, NIMBLE_PROPERTY::WRITE);
+    if (!pChar) {
+        Serial.printf("%s Failed to create characteristic with UUID: %s\n", TAG, uuid);
+        return nullptr;
+    }
+
+    _characteristics.push_back(
+        std::unique_ptr<Characteristic>(new Characteristic(pChar, onWrite)));
+    pChar->setCallbacks(_characteristics.back().get());
+
+    if (!description.empty()) {
+        pChar->createDescriptor("2901", NIMBLE_PROPERTY::READ)->setValue(description);
+    }
+    return _characteristics.back().get();
+}
+
+IBleCharacteristic* NimBleStack::createIndicateCharacteristic(const char* uuid,
+                                                              const std::string& description) {
+    if (!_pService) {
+        Serial.printf("%s No service to add characteristic %s to.\n", TAG, uuid);
+        return nullptr;
+    }
+
+    // NimBLE adds the CCCD automatically for characteristics with the INDICATE property.
+    NimBLECharacteristic* pChar =
+        _pService->createCharacteristic(uuid, NIMBLE_PROPERTY::READ | NIMBLE_PROPERTY::INDICATE);
+    if (!pChar) {
+        Serial.printf("%s Failed to create characteristic with UUID: %s\n", TAG, uuid);
+        return nullptr;
+    }
+
+    if (!description.empty()) {
+        pChar->createDescriptor("2901", NIMBLE_PROPERTY::READ)->setValue(description);
+    }
+
+    _characteristics.push_back(
+        std::unique_ptr<Characteristic>(new Characteristic(pChar, nullptr)));
+    return _characteristics.back().get();
+}
+
+bool NimBleStack::startService() {
+    if (!_pService) {
+        return false;
+    }
+    return _pService->start() && _pServer->start();
+}
+
+IBleMultiAdvertiser* NimBleStack::getMultiAdvertiser() {
+    return _multiAdvertiser.get();
+}
+
+#endif  // POLARIS_BLE_BACKEND_NIMBLE
@@ -2,6 +2,10 @@
 #include <Preferences.h>
 #include <sodium.h>
 
+#include <atomic>
+#include <string>
+
+#include "ble/advertising_update_service.h"
 #include "ble/ble_manager.h"
 #include "ble/broadcast_advertiser.h"
 #include "ble/connectable_advertiser.h"
@@ -10,13 +14,23 @@
 #include "protocol/handlers/encrypted_message_handler.h"
 #include "protocol/handlers/outgoing_message_service.h"
 #include "protocol/handlers/token_message_handler.h"
+#include "utils/aead_sequence.h"
 #include "utils/beacon_counter.h"
+#include "utils/crypto/crypto_backend_factory.h"
+#include "utils/crypto/crypto_benchmark.h"
 #include "utils/crypto_service.h"
+#include "utils/crypto_worker_pool.h"
 #include "utils/display_controller.h"
+#include "utils/issuance_log.h"
 #include "utils/key_manager.h"
+#include "utils/latency_tracker.h"
 #include "utils/led_controller.h"
+#include "utils/load_shedder.h"
+#include "utils/rate_limiter.h"
+#include "utils/revocation_filter.h"
 #include "utils/system_event_notifier.h"
 #include "utils/system_monitor.h"
+#include "utils/visitor_sketch.h"
 
 // These objects are declared globally to ensure their lifecycle persists for
 // the entire duration of the program.
@@ -24,21 +38,34 @@ const char* TAG = "[MAIN]";
 BleManager ble;
 Preferences prefs;
 BeaconCounter counter;
-KeyManager keyManager;
-CryptoService cryptoService(keyManager);
+std::unique_ptr<ICryptoBackend> cryptoBackend = createCryptoBackend();
+KeyManager keyManager(*cryptoBackend);
+AeadSequence aeadSequence;
+CryptoService cryptoService(*cryptoBackend, keyManager, aeadSequence);
 LedController ledController;
 DisplayController displayController;
 SystemMonitor systemMonitor;
 SystemEventNotifier eventNotifier;
 OutgoingMessageService outgoingMessageService;
+AdvertisingUpdateService advUpdateService;
+RateLimiter tokenRateLimiter;
+CryptoWorkerPool cryptoWorkers;
+LatencyTracker tokenLatency;
+IssuanceLog issuanceLog;
+VisitorSketch visitorSketch;
+RevocationFilter revocationFilter;
+LoadShedder loadShedder;
 CommandFactory commandFactory(ledController, displayController, systemMonitor,
-                              outgoingMessageService, eventNotifier);
+                              outgoingMessageService, eventNotifier, revocationFilter);
 std::unique_ptr<BroadcastAdvertiser> beaconExtAdvertiser;
 std::unique_ptr<ConnectableAdvertiser> connectableAdvertiser;
 std::vector<std::unique_ptr<FragmentationTransport>> g_transports;
 std::vector<std::unique_ptr<IMessageHandler>> g_handlers;
 FragmentationTransport* encryptedTransportPtr = nullptr;
 
+// The token logs skipped while the display updates are shed, summed up once resumed.
+std::atomic<uint32_t> deferredTokenLogs(0);
+
 void setup() {
     Serial.begin(115200);
     delay(5000);  // Gives the developper time to connect the serial monitor
@@ -53,6 +80,11 @@ void setup() {
     EventListener uiFeedbackListener = [&](SystemEventType event) {
         switch (event) {
             case SystemEventType::PoLTokenGenerated:
+                // A redraw takes the token processor task for a while, it is skipped under load.
+                if (loadShedder.defersUi()) {
+                    deferredTokenLogs++;
+                    break;
+                }
                 displayController.addLog("> Token created");
                 break;
             case SystemEventType::ServerCmd_NoOp:
@@ -78,6 +110,14 @@ void setup() {
         Serial.printf("%s CRITICAL: Libsodium initialization failed! Restarting...\n", TAG);
         ESP.restart();
     }
+    Serial.printf("%s Crypto backend: %s.\n", TAG, cryptoBackend->name());
+#ifdef POLARIS_CRYPTO_BENCHMARK
+    CryptoBenchmark cryptoBenchmark(*cryptoBackend);
+    if (!cryptoBenchmark.run()) {
+        Serial.printf("%s Crypto benchmark: an operation failed.\n", TAG);
+    }
+    cryptoBenchmark.print();
+#endif
 
     // Init the non-volatile storage (NVS)
     if (!prefs.begin(NVS_NAMESPACE, false)) {
@@ -92,34 +132,68 @@ void setup() {
         Serial.printf("%s CRITICAL: Failed to initialize Key manager, rebooting...\n", TAG);
         ESP.restart();
     }
+    aeadSequence.begin(&prefs);  // After the key manager, which clears it for a new key pair
+    revocationFilter.begin(&prefs);
 
     Serial.printf("%s Starting GATT Server & Multi-Advertising...\n", TAG);
+    // The connection callbacks go through the advertising owner task, started below.
+    ble.setAdvertisingUpdateService(&advUpdateService);
     ble.begin(BLE_DEVICE_NAME);
 
-    BLEMultiAdvertising* multiAdv = ble.getMultiAdvertiser();
+    IBleMultiAdvertiser* multiAdv = ble.getMultiAdvertiser();
     if (!multiAdv) {
         Serial.printf("%s CRITICAL: Failed to get MultiAdvertiser! Restarting...\n", TAG);
         ESP.restart();
     }
 
+    // Start the task owning the advertising payload updates.
+    if (!advUpdateService.begin(*multiAdv)) {
+        Serial.printf("%s CRITICAL: Failed to start the advertising updates! Restarting...\n", TAG);
+        ESP.restart();
+    }
+
     // Create the advertiser for the connectable (legacy) advertisement.
     connectableAdvertiser =
-        std::unique_ptr<ConnectableAdvertiser>(new ConnectableAdvertiser(*multiAdv));
-    connectableAdvertiser->begin();
+        std::unique_ptr<ConnectableAdvertiser>(new ConnectableAdvertiser(advUpdateService));
+    connectableAdvertiser->begin(ble.getFeatures());
 
     // Initialize the outgoing message service. It needs a callback to notify the
     // connectable advertiser when its queue state changes.
-    outgoingMessageService.begin(&cryptoService, &prefs, [&](bool hasData) {
-        connectableAdvertiser->setHasDataPending(hasData);
+    outgoingMessageService.begin(&cryptoService, &prefs, [&](size_t pendingCount) {
+        connectableAdvertiser->setOutgoingQueueDepth(pendingCount);
+    });
+
+    // The token journal and the visitor sketches are uploaded through the outgoing messages.
+    issuanceLog.begin(&prefs, &outgoingMessageService);
+    visitorSketch.begin(&outgoingMessageService);
+
+    // Shed the display, LED, background uploads and pull requests as the load rises, and publish
+    // the level so that phones retry later.
+    loadShedder.begin([&](LoadShedder::Level previous, LoadShedder::Level level) {
+        ledController.setPaused(level >= LoadShedder::Level::Elevated);
+        connectableAdvertiser->setShedLevel(static_cast<uint8_t>(level));
+    });
+    ble.setLoadShedder(&loadShedder);
+
+    // Publish the token service load in the connectable advertisement.
+    ble.setTokenLoadCallback([&](size_t pending, size_t capacity) {
+        connectableAdvertiser->setTokenLoad(pending, capacity);
     });
 
     // Create the advertiser for the non-connectable (extended) broadcast.
     beaconExtAdvertiser = std::unique_ptr<BroadcastAdvertiser>(
-        new BroadcastAdvertiser(BEACON_ID, cryptoService, counter, *multiAdv));
+        new BroadcastAdvertiser(BEACON_ID, cryptoService, counter, advUpdateService,
+                                ble.isPeriodicAdvertisingEnabled()));
     beaconExtAdvertiser->begin();
 
+    // Start the workers issuing the tokens on both cores. Without them, tokens are issued by the
+    // processor task alone.
+    if (!cryptoWorkers.begin()) {
+        Serial.printf("%s Failed to start the crypto workers, issuing on one core.\n", TAG);
+    }
+
     // Get the raw BLE characteristic that will be used for sending data.
-    auto tokenIndicateChar = ble.getCharacteristicByUUID(BLEUUID(BleManager::TOKEN_INDICATE));
+    auto tokenIndicateChar = ble.getCharacteristicByUUID(BleManager::TOKEN_INDICATE);
 
     // Create the Transport Layer for this channel.
     auto tokenTransport = std::unique_ptr<FragmentationTransport>(new FragmentationTransport(
@@ -128,15 +202,20 @@ void setup() {
         [&](IMessageTransport& transport) -> std::unique_ptr<IMessageHandler> {
             // Inside the lambda, create the TokenMessageHandler for this channel.
             return std::unique_ptr<TokenMessageHandler>(
-                new TokenMessageHandler(cryptoService, counter, transport, eventNotifier));
+                new TokenMessageHandler(cryptoService, counter, transport, eventNotifier,
+                                        tokenRateLimiter, cryptoWorkers, tokenLatency,
+                                        issuanceLog, visitorSketch, revocationFilter));
         }));
 
     ble.setTokenRequestProcessor(tokenTransport.get());
+    ble.setTokenRateLimiter(&tokenRateLimiter);
+    ble.setTokenLatencyTracker(&tokenLatency);
+    systemMonitor.setTokenLatencyTracker(&tokenLatency);
     ble.registerTransportForMtuUpdates(tokenTransport.get());
     g_transports.push_back(std::move(tokenTransport));
 
     // Setup for all encrypted communication.
-    auto encIndicateChar = ble.getCharacteristicByUUID(BLEUUID(BleManager::ENCRYPTED_INDICATE));
+    auto encIndicateChar = ble.getCharacteristicByUUID(BleManager::ENCRYPTED_INDICATE);
     auto encryptedTransport = std::unique_ptr<FragmentationTransport>(new FragmentationTransport(
         encIndicateChar, [&](IMessageTransport& transport) -> std::unique_ptr<IMessageHandler> {
             return std::unique_ptr<EncryptedMessageHandler>(
@@ -160,5 +239,24 @@ void setup() {
 }
 
 void loop() {
+    loadShedder.update(millis(), outgoingMessageService.pendingCount(), ESP.getFreeHeap());
+
+    // Seal the token journal blocks and the visitor sketches, and hand them to the data mules.
+    // Both keep their data while deferred, the journal blocks being still written to the NVS.
+    if (!loadShedder.defersBackgroundMessages()) {
+        issuanceLog.upload(millis());
+        visitorSketch.upload(counter.getValue());
+    } else {
+        issuanceLog.flush(millis());
+    }
+
+    uint32_t deferredLogs = deferredTokenLogs.exchange(0);
+    if (deferredLogs > 0) {
+        if (loadShedder.defersUi()) {
+            deferredTokenLogs += deferredLogs;
+        } else {
+            displayController.addLog("> " + std::to_string(deferredLogs) + " tokens created");
+        }
+    }
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "add_revocations_command.h"
+
+#include <HardwareSerial.h>
+#include <sodium.h>
+#include <string.h>
+
+AddRevocationsCommand::AddRevocationsCommand(RevocationFilter& filter, const JsonObject& params)
+    : _filter(filter) {
+    if (params.isNull()) {
+        Serial.println("[Command] AddRevocations created with no parameters.");
+        return;
+    }
+
+    _baseVersion = params["base"] | 0u;
+    _version = params["v"] | 0u;
+    _valid = _version > _baseVersion;
+
+    for (JsonVariant id : params["ids"].as<JsonArray>()) {
+        _phoneIds.push_back(id.as<uint64_t>());
+    }
+
+    for (JsonVariant pk : params["pks"].as<JsonArray>()) {
+        const char* encoded = pk.as<const char*>();
+        PhoneKey key;
+        size_t len = 0;
+        if (!encoded ||
+            sodium_base642bin(key.bytes, sizeof(key.bytes), encoded, strlen(encoded), nullptr,
+                              &len, nullptr, sodium_base64_VARIANT_ORIGINAL) != 0 ||
+            len != sizeof(key.bytes)) {
+            _valid = false;
+            break;
+        }
+        _phoneKeys.push_back(key);
+    }
+
+    Serial.printf("[Command] AddRevocations parsed params: Base=%u, Version=%u, Ids=%zu, "
+                  "Keys=%zu, Valid=%d\n",
+                  _baseVersion, _version, _phoneIds.size(), _phoneKeys.size(), _valid);
+}
+
+CommandResult AddRevocationsCommand::execute() {
+    Serial.println("[Command] Executing ADD_REVOCATIONS.");
+    CommandResult result;
+    result.success = _valid && _filter.beginDelta(_baseVersion);
+    if (!result.success) {
+        return result;
+    }
+
+    for (uint64_t phoneId : _phoneIds) {
+        _filter.addPhoneId(phoneId);
+    }
+    for (const PhoneKey& key : _phoneKeys) {
+        _filter.addPhoneKey(key.bytes);
+    }
+    _filter.commitDelta(_version);
+
+    const uint8_t* version = reinterpret_cast<const uint8_t*>(&_version);
+    result.responsePayload.assign(version, version + sizeof(_version));
+    return result;
+}
@@ -0,0 +1,62 @@
+#ifndef ADD_REVOCATIONS_COMMAND_H
+#define ADD_REVOCATIONS_COMMAND_H
+
+#include <ArduinoJson.h>
+
+#include <vector>
+
+#include "icommand.h"
+#include "utils/revocation_filter.h"
+
+/**
+ * @class AddRevocationsCommand
+ * @brief A command adding revoked phones to the revocation filter (a delta).
+ *
+ * Parameters: {"base": version the delta applies to, "v": new version, "ids": [phone IDs],
+ * "pks": [base64 Ed25519 public keys]}. A delta for another version than the current one fails,
+ * and the server sends a full filter instead. The ACK payload is the new filter version (4 bytes,
+ * little-endian).
+ */
+class AddRevocationsCommand : public ICommand {
+public:
+    /**
+     * @brief Constructs the AddRevocationsCommand.
+     * @param filter Reference to the revocation filter.
+     * @param params A JsonObject containing the `base`, `v`, `ids` and `pks` parameters.
+     */
+    AddRevocationsCommand(RevocationFilter& filter, const JsonObject& params);
+
+    /**
+     * @brief Executes the command, adding the items to the filter and persisting it.
+     */
+    CommandResult execute() override;
+
+private:
+    /**
+     * @struct PhoneKey
+     * @brief A revoked Ed25519 public key.
+     */
+    struct PhoneKey {
+        uint8_t bytes[Ed25519_PK_SIZE];
+    };
+
+    /// @brief Reference to the revocation filter.
+    RevocationFilter& _filter;
+
+    /// @brief True if the parameters were decoded.
+    bool _valid = false;
+
+    /// @brief The version the delta applies to.
+    uint32_t _baseVersion = 0;
+
+    /// @brief The version of the updated filter.
+    uint32_t _version = 0;
+
+    /// @brief The revoked phone IDs.
+    std::vector<uint64_t> _phoneIds;
+
+    /// @brief The revoked public keys.
+    std::vector<PhoneKey> _phoneKeys;
+};
+
+#endif  // ADD_REVOCATIONS_COMMAND_H
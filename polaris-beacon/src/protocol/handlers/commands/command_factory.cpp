@@ -1,5 +1,6 @@
 #include "command_factory.h"
 
+#include "add_revocations_command.h"
 #include "blink_led_command.h"
 #include "clear_display_command.h"
 #include "display_text_command.h"
@@ -8,17 +9,19 @@
 #include "request_status_command.h"
 #include "rotate_key_finish_command.h"
 #include "rotate_key_init_command.h"
+#include "set_revocation_filter_command.h"
 #include "stop_blink_command.h"
 
 CommandFactory::CommandFactory(LedController& ledController, DisplayController& displayController,
                                SystemMonitor& systemMonitor,
                                OutgoingMessageService& outgoingMessageService,
-                               SystemEventNotifier& notifier)
+                               SystemEventNotifier& notifier, RevocationFilter& revocations)
     : _ledController(ledController),
       _displayController(displayController),
       _systemMonitor(systemMonitor),
       _outgoingMessageService(outgoingMessageService),
-      _notifier(notifier) {
+      _notifier(notifier),
+      _revocations(revocations) {
 }
 
 std::unique_ptr<ICommand> CommandFactory::createCommand(OperationType opType,
@@ -47,7 +50,7 @@ std::unique_ptr<ICommand> CommandFactory::createCommand(OperationType opType,
 
         case OperationType::RequestBeaconStatus:
             return std::unique_ptr<RequestStatusCommand>(
-                new RequestStatusCommand(_systemMonitor, _outgoingMessageService));
+                new RequestStatusCommand(_systemMonitor, _outgoingMessageService, params));
 
         case OperationType::RotateKeyInit:
             return std::unique_ptr<RotateKeyInitCommand>(
@@ -57,6 +60,14 @@ std::unique_ptr<ICommand> CommandFactory::createCommand(OperationType opType,
             return std::unique_ptr<RotateKeyFinishCommand>(
                 new RotateKeyFinishCommand(keyManager, _notifier));
 
+        case OperationType::SetRevocationFilter:
+            return std::unique_ptr<SetRevocationFilterCommand>(
+                new SetRevocationFilterCommand(_revocations, params));
+
+        case OperationType::AddRevocations:
+            return std::unique_ptr<AddRevocationsCommand>(
+                new AddRevocationsCommand(_revocations, params));
+
         default:
             // For unknown commands, return a null pointer.
             // The caller is responsible for handling this.
@@ -10,6 +10,7 @@
 #include "protocol/handlers/outgoing_message_service.h"
 #include "utils/display_controller.h"
 #include "utils/led_controller.h"
+#include "utils/revocation_filter.h"
 #include "utils/system_monitor.h"
 
 // Forward declarations
@@ -28,10 +29,11 @@ public:
      * @param displayController Reference to the OLED display controller.
      * @param systemMonitor Reference to the system status monitoring utility.
      * @param outgoingMessageService Reference to the service for queuing outgoing messages.
+     * @param revocations Reference to the filter of the revoked phones.
      */
     CommandFactory(LedController& ledController, DisplayController& displayController,
                    SystemMonitor& systemMonitor, OutgoingMessageService& outgoingMessageService,
-                   SystemEventNotifier& notifier);
+                   SystemEventNotifier& notifier, RevocationFilter& revocations);
 
     /**
      * @brief Creates a command object.
@@ -57,5 +59,8 @@ private:
 
     /// @brief Reference to the system notifier.
     SystemEventNotifier& _notifier;
+
+    /// @brief Reference to the filter of the revoked phones.
+    RevocationFilter& _revocations;
 };
 #endif  // COMMAND_FACTORY
\ No newline at end of file
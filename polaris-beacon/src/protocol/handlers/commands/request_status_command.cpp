@@ -4,8 +4,11 @@
 #include <HardwareSerial.h>
 
 RequestStatusCommand::RequestStatusCommand(SystemMonitor& systemMonitor,
-                                           OutgoingMessageService& outgoingMessageService)
+                                           OutgoingMessageService& outgoingMessageService,
+                                           const JsonObject& params)
     : _systemMonitor(systemMonitor), _outgoingMessageService(outgoingMessageService) {
+    // The histograms are only reset on request, so that two reports in a row lose nothing.
+    _resetLatency = params["reset_latency"] | false;
 }
 
 CommandResult RequestStatusCommand::execute() {
@@ -16,7 +19,7 @@ CommandResult RequestStatusCommand::execute() {
     JsonObject statusPayload = doc.to<JsonObject>();
 
     // Use the SystemMonitor to populate the JSON object.
-    _systemMonitor.getStatus(statusPayload);
+    _systemMonitor.getStatus(statusPayload, _resetLatency);
 
     // Queue the new message for sending back to the server.
     _outgoingMessageService.queueMessage(OperationType::BeaconStatus, statusPayload);
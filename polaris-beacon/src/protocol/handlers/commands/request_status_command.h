@@ -11,7 +11,8 @@
  *
  * This command is triggered by a request from the server. Its execution results
  * in a new `BeaconStatus` message being created and queued for delivery back
- * to the server.
+ * to the server. With `{"reset_latency": true}`, the token latency histograms are reset once
+ * reported (the status says so under "token_latency.reset").
  */
 class RequestStatusCommand : public ICommand {
 public:
@@ -19,9 +20,10 @@ public:
      * @brief Constructs the RequestStatusCommand.
      * @param systemMonitor Reference to the utility for gathering system metrics.
      * @param outgoingMessageService Reference to the service for queuing the response message.
+     * @param params The command parameters.
      */
     RequestStatusCommand(SystemMonitor& systemMonitor,
-                         OutgoingMessageService& outgoingMessageService);
+                         OutgoingMessageService& outgoingMessageService, const JsonObject& params);
 
     /**
      * @brief Executes the command, gathering status and queuing the response.
@@ -34,6 +36,9 @@ private:
 
     /// @brief Reference to the outgoing message queuing service.
     OutgoingMessageService& _outgoingMessageService;
+
+    /// @brief True to reset the token latency histograms once reported.
+    bool _resetLatency;
 };
 
 #endif  // REQUEST_STATUS_COMMAND_H
\ No newline at end of file
@@ -10,9 +10,12 @@ CommandResult RotateKeyInitCommand::execute() {
     Serial.println("[Command] Executing ROTATE_KEY_INIT.");
     _notifier.notify(SystemEventType::ServerCmd_RotateKeyInit);
 
-    _keyManager.prepareNewX25519KeyPair();
-    const uint8_t* newPk = _keyManager.getNewX25519Pk();
     CommandResult result;
+    if (!_keyManager.prepareNewX25519KeyPair()) {
+        result.success = false;
+        return result;
+    }
+    const uint8_t* newPk = _keyManager.getNewX25519Pk();
     result.success = true;
     result.responsePayload.assign(newPk, newPk + X25519_PK_SIZE);
     return result;
@@ -0,0 +1,39 @@
+#include "set_revocation_filter_command.h"
+
+#include <HardwareSerial.h>
+#include <sodium.h>
+#include <string.h>
+
+SetRevocationFilterCommand::SetRevocationFilterCommand(RevocationFilter& filter,
+                                                       const JsonObject& params)
+    : _filter(filter) {
+    if (params.isNull()) {
+        Serial.println("[Command] SetRevocationFilter created with no parameters.");
+        return;
+    }
+
+    _version = params["v"] | 0u;
+    unsigned hashes = params["k"] | 0u;
+    const char* encoded = params["f"].as<const char*>();
+
+    size_t len = 0;
+    _valid = hashes <= RevocationFilter::MAX_HASHES && encoded &&
+             sodium_base642bin(_bits, sizeof(_bits), encoded, strlen(encoded), nullptr, &len,
+                               nullptr, sodium_base64_VARIANT_ORIGINAL) == 0 &&
+             len == RevocationFilter::FILTER_BYTES;
+    _hashes = (uint8_t)hashes;
+
+    Serial.printf("[Command] SetRevocationFilter parsed params: Version=%u, Hashes=%u, Valid=%d\n",
+                  _version, hashes, _valid);
+}
+
+CommandResult SetRevocationFilterCommand::execute() {
+    Serial.println("[Command] Executing SET_REVOCATION_FILTER.");
+    CommandResult result;
+    result.success = _valid && _filter.replace(_version, _hashes, _bits);
+    if (result.success) {
+        const uint8_t* version = reinterpret_cast<const uint8_t*>(&_version);
+        result.responsePayload.assign(version, version + sizeof(_version));
+    }
+    return result;
+}
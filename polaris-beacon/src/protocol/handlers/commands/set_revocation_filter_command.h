@@ -0,0 +1,47 @@
+#ifndef SET_REVOCATION_FILTER_COMMAND_H
+#define SET_REVOCATION_FILTER_COMMAND_H
+
+#include <ArduinoJson.h>
+
+#include "icommand.h"
+#include "utils/revocation_filter.h"
+
+/**
+ * @class SetRevocationFilterCommand
+ * @brief A command replacing the revocation filter of the beacon.
+ *
+ * Parameters: {"v": version, "k": hash count, "f": base64 filter bits}. The ACK payload is the new
+ * filter version (4 bytes, little-endian).
+ */
+class SetRevocationFilterCommand : public ICommand {
+public:
+    /**
+     * @brief Constructs the SetRevocationFilterCommand.
+     * @param filter Reference to the revocation filter.
+     * @param params A JsonObject containing the `v`, `k` and `f` parameters.
+     */
+    SetRevocationFilterCommand(RevocationFilter& filter, const JsonObject& params);
+
+    /**
+     * @brief Executes the command, replacing and persisting the filter.
+     */
+    CommandResult execute() override;
+
+private:
+    /// @brief Reference to the revocation filter.
+    RevocationFilter& _filter;
+
+    /// @brief True if the parameters were decoded.
+    bool _valid = false;
+
+    /// @brief The version of the new filter.
+    uint32_t _version = 0;
+
+    /// @brief The number of hash functions of the new filter.
+    uint8_t _hashes = 0;
+
+    /// @brief The bits of the new filter.
+    uint8_t _bits[RevocationFilter::FILTER_BYTES] = {};
+};
+
+#endif  // SET_REVOCATION_FILTER_COMMAND_H
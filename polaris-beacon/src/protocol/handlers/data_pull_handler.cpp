@@ -7,6 +7,12 @@ DataPullHandler::DataPullHandler(OutgoingMessageService& service, FragmentationT
 }
 
 void DataPullHandler::process(const uint8_t* requestData, size_t len) {
+    if (len == 1 && requestData[0] == PULL_TRIGGER_REFUSED) {
+        Serial.printf("%s: Pull request refused under load, answering busy.\n", TAG);
+        _transport.sendMessage(&PULL_RESPONSE_BUSY, sizeof(PULL_RESPONSE_BUSY));
+        return;
+    }
+
     Serial.printf("%s: Processing pull request.\n", TAG);
     if (_service.hasPendingMessages()) {
         std::vector<uint8_t> message = _service.getNextMessageForSending();
@@ -12,6 +12,7 @@
  * This handler is triggered when a client writes to the `PULL_DATA_WRITE`
  * characteristic. Its responsibility is to check the `OutgoingMessageService`
  * for a pending message and, if one exists, send it over the provided transport layer.
+ * A request refused under load is answered with PULL_RESPONSE_BUSY instead.
  */
 class DataPullHandler : public IMessageHandler {
 public:
@@ -25,9 +26,9 @@ public:
     /**
      * @brief Processes the pull request trigger.
      *
-     * The content of the request does not matter; the call itself is the trigger.
-     * @param requestData Not used.
-     * @param len Not used.
+     * @param requestData The trigger from the BLE manager, PULL_TRIGGER_ACCEPTED or
+     * PULL_TRIGGER_REFUSED.
+     * @param len The length of the trigger (1).
      */
     void process(const uint8_t* requestData, size_t len) override;
 
@@ -63,38 +63,32 @@ void EncryptedMessageHandler::process(const uint8_t* data, size_t len) {
         return;
     }
 
+    // The key is selected by the epoch of the header, an unknown epoch costs no decryption.
     InnerPlaintext innerPtReceived;
-    bool decryptionSuccess = false;
     if (!receivedMsg.unseal(innerPtReceived)) {
-        Serial.printf("%s Unseal failed. Trying with pending key...\n", TAG);
-
-        // Derive a temp shared key with the pending key
-        uint8_t tempAeadKey[SHARED_KEY_SIZE];
-        if (_keyManager.deriveAEADSharedKeyWithPendingKey(tempAeadKey)) {
-            // Try to unseal with the temp shared key
-            if (receivedMsg.unseal(innerPtReceived, tempAeadKey)) {
-                // Success, it's the end of the key rotation
-                Serial.printf("%s Alternate decryption successful!\n", TAG);
-
-                // The type MUST be RotateKeyFinish
-                if (static_cast<OperationType>(innerPtReceived.opType) !=
-                    OperationType::RotateKeyFinish) {
-                    Serial.printf("%s SECURITY ALERT: Decrypted with pending key, but opType is "
-                                  "not RotateKeyFinish!\n",
-                                  TAG);
-                    // Do nothing, drop the message
-                    return;
-                }
-
-                // The message is valid, we can activate the pending key
-                if (!_keyManager.activateNewX25519KeyPair()) {
-                    Serial.printf("%s CRITICAL: Failed to activate new key pair after successful "
-                                  "alternate decryption.\n",
-                                  TAG);
-                    return;
-                }
-                decryptionSuccess = true;
-            }
+        Serial.printf("%s Unseal failed (key epoch %u). Dropping.\n", TAG, receivedMsg.keyEpoch);
+        return;
+    }
+
+    if (_keyManager.isPendingEpoch(receivedMsg.keyEpoch)) {
+        // Decrypted with the pending key, it's the end of the key rotation
+        Serial.printf("%s Message sealed with the pending key.\n", TAG);
+
+        // The type MUST be RotateKeyFinish
+        if (static_cast<OperationType>(innerPtReceived.opType) != OperationType::RotateKeyFinish) {
+            Serial.printf("%s SECURITY ALERT: Decrypted with pending key, but opType is "
+                          "not RotateKeyFinish!\n",
+                          TAG);
+            // Do nothing, drop the message
+            return;
+        }
+
+        // The message is valid, we can activate the pending key
+        if (!_keyManager.activateNewX25519KeyPair()) {
+            Serial.printf("%s CRITICAL: Failed to activate new key pair after successful "
+                          "alternate decryption.\n",
+                          TAG);
+            return;
         }
     }
 
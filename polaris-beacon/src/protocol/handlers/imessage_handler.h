@@ -19,6 +19,14 @@ public:
      * @param len The length of the message in the buffer.
      */
     virtual void process(const uint8_t* requestData, size_t len) = 0;
+
+    /**
+     * @brief Called once all the messages pending in the queue were handed to `process`.
+     *
+     * Handlers that batch their work complete it here. The default does nothing.
+     */
+    virtual void flush() {
+    }
 };
 
 #endif  // IMESSAGE_HANDLER_H
\ No newline at end of file
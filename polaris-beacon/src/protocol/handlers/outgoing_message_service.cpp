@@ -3,6 +3,7 @@
 #include <HardwareSerial.h>
 
 OutgoingMessageService::OutgoingMessageService() {
+    _mutex = xSemaphoreCreateMutex();
 }
 
 void OutgoingMessageService::begin(CryptoService* cryptoService, Preferences* prefs,
@@ -13,6 +14,10 @@ void OutgoingMessageService::begin(CryptoService* cryptoService, Preferences* pr
     loadNextMsgId();
 }
 
+void OutgoingMessageService::addAckListener(AckCallback listener) {
+    _ackListeners.push_back(listener);
+}
+
 void OutgoingMessageService::loadNextMsgId() {
     _nextMsgId = _prefs->getUInt("out_msg_id_ctr", 1);
     Serial.printf("%s Loaded next outgoing message ID: %u\n", TAG, _nextMsgId);
@@ -24,12 +29,9 @@ void OutgoingMessageService::saveNextMsgId() {
     }
 }
 
-void OutgoingMessageService::queueMessage(OperationType opType, const JsonObject& params) {
-    bool wasEmpty = _messageQueue.empty();
-
+bool OutgoingMessageService::queueMessage(OperationType opType, const JsonObject& params,
+                                          uint32_t* msgIdOut) {
     OutgoingMessage msg;
-    msg.plaintext.msgId = _nextMsgId++;
-    saveNextMsgId();
     msg.plaintext.msgType = MSG_TYPE_REQ;
     msg.plaintext.opType = static_cast<uint8_t>(opType);
     msg.plaintext.beaconCnt = 0;
@@ -41,9 +43,7 @@ void OutgoingMessageService::queueMessage(OperationType opType, const JsonObject
         if (len > sizeof(msg.plaintext.payload)) {
             Serial.printf("%s ERROR: Payload for opType %u is too large.\n", TAG,
                           msg.plaintext.opType);
-            _nextMsgId--;  // Roll back ID on failure
-            saveNextMsgId();
-            return;
+            return false;
         }
         memcpy(msg.plaintext.payload, payloadStr.c_str(), len);
         msg.plaintext.actualPayloadLength = len;
@@ -51,26 +51,60 @@ void OutgoingMessageService::queueMessage(OperationType opType, const JsonObject
         msg.plaintext.actualPayloadLength = 0;
     }
 
-    _messageQueue.push(msg);
-    Serial.printf("%s Queued message with ID %u, opType %u. Queue size: %zu\n", TAG,
-                  msg.plaintext.msgId, msg.plaintext.opType, _messageQueue.size());
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    msg.plaintext.msgId = _nextMsgId++;
+    saveNextMsgId();
+    _messageQueue.push_back(msg);
+    size_t pending = _messageQueue.size();
+    if (_onQueueStateChange) {
+        _onQueueStateChange(pending);
+    }
+    xSemaphoreGive(_mutex);
 
-    if (wasEmpty && _onQueueStateChange) {
-        _onQueueStateChange(true);
+    Serial.printf("%s Queued message with ID %u, opType %u. Queue size: %zu\n", TAG,
+                  msg.plaintext.msgId, msg.plaintext.opType, pending);
+    if (msgIdOut) {
+        *msgIdOut = msg.plaintext.msgId;
     }
+    return true;
 }
 
 bool OutgoingMessageService::hasPendingMessages() const {
-    return !_messageQueue.empty();
+    return pendingCount() > 0;
+}
+
+size_t OutgoingMessageService::pendingCount() const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    size_t pending = _messageQueue.size();
+    xSemaphoreGive(_mutex);
+    return pending;
+}
+
+bool OutgoingMessageService::isQueued(uint32_t msgId) const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool queued = false;
+    for (const OutgoingMessage& msg : _messageQueue) {
+        if (msg.plaintext.msgId == msgId) {
+            queued = true;
+            break;
+        }
+    }
+    xSemaphoreGive(_mutex);
+    return queued;
 }
 
 std::vector<uint8_t> OutgoingMessageService::getNextMessageForSending() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     if (_messageQueue.empty()) {
+        xSemaphoreGive(_mutex);
         return {};
     }
-
     OutgoingMessage msg = _messageQueue.front();
-    _messageQueue.pop();
+    _messageQueue.pop_front();
+    if (_onQueueStateChange) {
+        _onQueueStateChange(_messageQueue.size());
+    }
+    xSemaphoreGive(_mutex);
 
     EncryptedMessage encryptedMsg(*_cryptoService);
     if (!encryptedMsg.seal(msg.plaintext, BEACON_ID)) {
@@ -78,26 +112,32 @@ std::vector<uint8_t> OutgoingMessageService::getNextMessageForSending() {
         return {};
     }
 
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     _pendingAckMessages[msg.plaintext.msgId] = msg;
+    xSemaphoreGive(_mutex);
     Serial.printf("%s Encrypted and moved message ID %u to pending ACK list.\n", TAG,
                   msg.plaintext.msgId);
 
-    if (_messageQueue.empty() && _onQueueStateChange) {
-        _onQueueStateChange(false);
-    }
-
     std::vector<uint8_t> buffer(encryptedMsg.packedSize());
     encryptedMsg.toBytes(buffer.data(), buffer.size());
     return buffer;
 }
 
 void OutgoingMessageService::handleAck(uint32_t msgId) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     auto it = _pendingAckMessages.find(msgId);
-    if (it != _pendingAckMessages.end()) {
+    bool found = it != _pendingAckMessages.end();
+    if (found) {
         _pendingAckMessages.erase(it);
-        Serial.printf("%s Received ACK for message ID %u. Removed from pending list.\n", TAG,
-                      msgId);
-    } else {
+    }
+    xSemaphoreGive(_mutex);
+
+    if (!found) {
         Serial.printf("%s Received stray ACK for unknown message ID %u.\n", TAG, msgId);
+        return;
+    }
+    Serial.printf("%s Received ACK for message ID %u. Removed from pending list.\n", TAG, msgId);
+    for (const AckCallback& listener : _ackListeners) {
+        listener(msgId);
     }
 }
\ No newline at end of file
@@ -2,10 +2,12 @@
 #define OUTGOING_MESSAGE_SERVICE_H
 
 #include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #include <functional>
+#include <deque>
 #include <map>
-#include <queue>
 #include <vector>
 
 #include "protocol/messages/encrypted_message.h"
@@ -14,14 +16,26 @@
 /**
  * @class OutgoingMessageService
  * @brief Manages a queue of beacon messages to be sent to the server.
+ *
+ * Messages are queued by the main loop and the command handlers, pulled by the data pull task
+ * and acknowledged by the encrypted processor task: the queue, the pending-ACK list and the
+ * message ID counter are guarded by a mutex. The queue state callback is called with it held, so
+ * that the counts arrive in order (it must not call back into this service), the ACK listeners
+ * without it.
  */
 class OutgoingMessageService {
 public:
     /**
      * @brief A function pointer type for the queue state change callback.
-     * @param hasData True if the queue now has data, false if it has become empty.
+     * @param pendingCount The number of messages now waiting in the queue (0 if it became empty).
      */
-    using QueueStateChangeCallback = std::function<void(bool hasData)>;
+    using QueueStateChangeCallback = std::function<void(size_t pendingCount)>;
+
+    /**
+     * @brief A function called when the server acknowledged a message.
+     * @param msgId The ID of the acknowledged message, from `queueMessage`.
+     */
+    using AckCallback = std::function<void(uint32_t msgId)>;
 
     /**
      * @brief Constructs the OutgoingMessageService.
@@ -32,18 +46,21 @@ public:
      * @brief Initializes the service with its dependencies.
      * @param cryptoService Pointer to the service for sealing messages.
      * @param prefs Pointer to the NVS storage for persisting message IDs.
-     * @param callback Function to call when the queue transitions between empty and not-empty.
+     * @param callback Function to call each time the number of queued messages changes.
      */
     void begin(CryptoService* cryptoService, Preferences* prefs, QueueStateChangeCallback callback);
 
     /**
      * @brief Adds a new message to the queue.
      *
-     * If the queue was previously empty, this will trigger the state change callback.
+     * This triggers the state change callback with the new queue size.
      * @param opType The operation type of the message to be sent.
      * @param params A JsonObject containing the payload for the message.
+     * @param msgIdOut If set, receives the ID of the queued message.
+     * @return False if the payload is too large.
      */
-    void queueMessage(OperationType opType, const JsonObject& params);
+    bool queueMessage(OperationType opType, const JsonObject& params,
+                      uint32_t* msgIdOut = nullptr);
 
     /**
      * @brief Checks if there are any messages in the outgoing queue.
@@ -51,6 +68,17 @@ public:
      */
     bool hasPendingMessages() const;
 
+    /**
+     * @brief Returns the number of messages waiting in the outgoing queue.
+     */
+    size_t pendingCount() const;
+
+    /**
+     * @brief Checks whether a message is still waiting in the outgoing queue (not pulled yet).
+     * @param msgId The ID of the message, from `queueMessage`.
+     */
+    bool isQueued(uint32_t msgId) const;
+
     /**
      * @brief Retrieves the next message from the queue for sending.
      * @return A vector of bytes containing the encrypted message ready for transport.
@@ -61,11 +89,18 @@ public:
     /**
      * @brief Processes an ACK from the server for a previously sent message.
      *
-     * This removes the corresponding message from the pending-ACK list.
+     * This removes the corresponding message from the pending-ACK list and notifies the ACK
+     * listeners.
      * @param msgId The message ID of the beacon original message that is being acknowledged.
      */
     void handleAck(uint32_t msgId);
 
+    /**
+     * @brief Registers a function called for each acknowledged message. Must be called during
+     * setup.
+     */
+    void addAckListener(AckCallback listener);
+
 private:
     /// @brief A tag used for logging from this class
     static constexpr const char* TAG = "[OutgoingSvc]";
@@ -87,8 +122,14 @@ private:
     /// @brief Callback function to notify listeners of queue state changes.
     QueueStateChangeCallback _onQueueStateChange;
 
+    /// @brief The functions notified of the acknowledged messages.
+    std::vector<AckCallback> _ackListeners;
+
+    /// @brief Guards the queue, the pending-ACK list and the message ID counter.
+    SemaphoreHandle_t _mutex = nullptr;
+
     /// @brief A FIFO queue of messages waiting to be sent.
-    std::queue<OutgoingMessage> _messageQueue;
+    std::deque<OutgoingMessage> _messageQueue;
 
     /// @brief A map of messages that have been sent and are now awaiting an ACK from the server.
     std::map<uint32_t, OutgoingMessage> _pendingAckMessages;
@@ -99,7 +140,7 @@ private:
     /** @brief Loads the outgoing message ID counter from NVS. */
     void loadNextMsgId();
 
-    /** @brief Saves the outgoing message ID counter to NVS. */
+    /** @brief Saves the outgoing message ID counter to NVS. Called with the mutex held. */
     void saveNextMsgId();
 };
 #endif  // OUTGOING_MESSAGE_SERVICE_H
\ No newline at end of file
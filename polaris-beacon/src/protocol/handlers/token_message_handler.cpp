@@ -1,58 +1,550 @@
 #include "token_message_handler.h"
 
+#include <Arduino.h>
 #include <HardwareSerial.h>
+#include <sodium.h>
 
+#include "../../utils/merkle_tree.h"
 #include "../messages/pol_request.h"
 #include "../messages/pol_response.h"
+#include "../messages/pol_session.h"
 
 TokenMessageHandler::TokenMessageHandler(const CryptoService& cryptoService,
                                          const BeaconCounter& counter, IMessageTransport& transport,
-                                         const SystemEventNotifier& notifier)
-    : _cryptoService(cryptoService), _counter(counter), _transport(transport), _notifier(notifier) {
+                                         const SystemEventNotifier& notifier,
+                                         RateLimiter& rateLimiter, CryptoWorkerPool& workers,
+                                         LatencyTracker& latency, IssuanceLog& issuanceLog,
+                                         VisitorSketch& visitors, RevocationFilter& revocations)
+    : _cryptoService(cryptoService),
+      _counter(counter),
+      _transport(transport),
+      _notifier(notifier),
+      _rateLimiter(rateLimiter),
+      _workers(workers),
+      _latency(latency),
+      _issuanceLog(issuanceLog),
+      _visitors(visitors),
+      _revocations(revocations) {
 }
 
 void TokenMessageHandler::process(const uint8_t* data, size_t len) {
-    uint8_t buffer[PoLResponse::packedSize()];
+    if (len > 0 && data[0] == POL_FRAME_PIPELINE) {
+        processPipeline(data, len);
+        return;
+    }
 
-    if (len != PoLRequest::packedSize()) {
-        Serial.printf("[Processor] Invalid length. Got %zu, expected %zu\n", len,
-                      PoLRequest::packedSize());
+    stageRequest(data, len);
+    if (_batchSize == MAX_BATCH) {
+        flush();
+    }
+}
+
+void TokenMessageHandler::processPipeline(const uint8_t* data, size_t len) {
+    size_t count = parsePipeline(data, len);
+    if (count == 0) {
+        Serial.printf("%s Malformed pipelined frame of %zu bytes\n", TAG, len);
+        PendingRequest& pending = stageRequest(nullptr, 0);
+        stageError(pending, PoLErrorCode::InvalidLength);
+        if (_batchSize == MAX_BATCH) {
+            flush();
+        }
         return;
     }
 
-    PoLRequest req;
-    if (!req.fromBytes(data, len)) {
-        Serial.println("[Processor] Invalid format");
+    // The answers of a frame are coalesced, so its requests must belong to the same batch.
+    if (_batchSize + count > MAX_BATCH) {
+        flush();
+    }
+
+    if (++_frameSeq == 0) {
+        _frameSeq = 1;
+    }
+
+    size_t offset = POL_FRAME_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        uint8_t requestId = data[offset];
+        size_t entryLen = data[offset + 1];
+        offset += POL_FRAME_HEADER_SIZE;
+
+        // A nested frame is not a valid request, it is rejected by the flags check.
+        PendingRequest& pending = stageRequest(data + offset, entryLen);
+        pending.frame = _frameSeq;
+        pending.requestId = requestId;
+        offset += entryLen;
+    }
+    Serial.printf("%s Pipelined frame of %zu request(s)\n", TAG, count);
+
+    if (_batchSize == MAX_BATCH) {
+        flush();
+    }
+}
+
+size_t TokenMessageHandler::parsePipeline(const uint8_t* data, size_t len) {
+    if (len < POL_FRAME_HEADER_SIZE) {
+        return 0;
+    }
+    size_t count = data[1];
+    if (count == 0 || count > MAX_PIPELINE_REQUESTS) {
+        return 0;
+    }
+
+    size_t offset = POL_FRAME_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i) {
+        if (offset + POL_FRAME_HEADER_SIZE > len) {
+            return 0;
+        }
+        offset += POL_FRAME_HEADER_SIZE + data[offset + 1];
+    }
+    return offset == len ? count : 0;
+}
+
+TokenMessageHandler::PendingRequest& TokenMessageHandler::stageRequest(const uint8_t* data,
+                                                                       size_t len) {
+    // One snapshot for the whole batch: every token, replay entry and cached response of the batch
+    // belongs to the same epoch, even if the counter ticks before the flush.
+    if (_batchSize == 0) {
+        _batchCounter = _counter.getValue();
+    }
+
+    // Every request takes a slot, so that the answers leave in arrival order.
+    PendingRequest& pending = _batch[_batchSize++];
+    pending.answered = false;
+    pending.issued = false;
+    pending.frame = 0;
+    pending.retryOf = NO_RETRY;
+    pending.answerLen = 0;
+    pending.writeUs = _latency.lastWriteUs();
+    pending.dequeueUs = _latency.lastDequeueUs();
+
+    if (answerFromCache(pending, data, len)) {
+        // A retry must be checked first, the replay filter would reject it.
+    } else if (len > 0 && data[0] == POL_REQ_FLAG_SESSION_MAC) {
+        // Session requests only cost a MAC, they are answered at once.
+        answerSessionRequest(pending, data, len);
+    } else if ((pending.retryOf = findRetry(data, len)) != NO_RETRY) {
+        // The retry of a request of this batch gets the same answer.
+        pending.answered = true;
+    } else {
+        uint32_t retryAfterMs = 0;
+        PoLErrorCode error = precheck(data, len, pending.req, retryAfterMs);
+        if (error != PoLErrorCode::None) {
+            stageError(pending, error, retryAfterMs);
+        } else {
+            memcpy(pending.raw, data, len);
+        }
+    }
+    pending.readyUs = micros();
+    return pending;
+}
+
+void TokenMessageHandler::flush() {
+    if (_batchSize == 0) {
+        return;
+    }
+
+    uint64_t counter = _batchCounter;
+
+    const PoLRequest* reqs[MAX_BATCH];
+    PendingRequest* toVerify[MAX_BATCH];
+    size_t verifyCount = 0;
+    for (size_t i = 0; i < _batchSize; ++i) {
+        if (!_batch[i].answered) {
+            toVerify[verifyCount] = &_batch[i];
+            reqs[verifyCount] = &_batch[i].req;
+            verifyCount++;
+        }
+    }
+
+    bool valid[MAX_BATCH];
+    if (verifyCount > 0) {
+        Serial.printf("%s Verifying %zu signature(s)\n", TAG, verifyCount);
+        _cryptoService.verifyDistinctPoLRequestSignatures(reqs, verifyCount, valid, &_workers);
+    }
+    uint32_t verifiedUs = micros();
+
+    // The responses are signed together once the whole batch is prepared: the individual
+    // signatures and the Merkle root signature are spread over the workers.
+    PoLResponse responses[MAX_BATCH];
+    SignJob job;
+    job.crypto = &_cryptoService;
+    PendingRequest* signedRequests[MAX_BATCH];
+    PendingRequest* merkleRequests[MAX_BATCH];
+    PoLResponse* merkleResponses[MAX_BATCH];
+    size_t merkleCount = 0;
 
-        // Send a blank response signifying an error
-        _transport.sendMessage(buffer, sizeof(buffer));
+    for (size_t v = 0; v < verifyCount; ++v) {
+        PendingRequest& pending = *toVerify[v];
+        if (!valid[v]) {
+            Serial.println("[Processor] Invalid signature");
+            stageError(pending, PoLErrorCode::InvalidSignature);
+            continue;
+        }
+        if (!prepareResponse(pending, counter, responses[v])) {
+            continue;
+        }
+
+        if (responses[v].flags & POL_RESP_FLAG_MERKLE) {
+            merkleRequests[merkleCount] = &pending;
+            merkleResponses[merkleCount] = &responses[v];
+            merkleCount++;
+            continue;
+        }
+
+        // The signature includes context from the original request
+        signedRequests[job.count] = &pending;
+        job.requests[job.count] = &pending.req;
+        job.responses[job.count] = &responses[v];
+        job.count++;
+    }
+
+    uint8_t root[MERKLE_HASH_SIZE];
+    if (merkleCount > 0 && buildMerkleBatch(merkleRequests, merkleResponses, merkleCount, root)) {
+        job.merkleRoot = root;
+    }
+
+    _workers.run(runSignJob, &job, job.count + (job.merkleRoot ? 1 : 0));
+    uint32_t signedUs = micros();
+    for (size_t v = 0; v < verifyCount; ++v) {
+        toVerify[v]->verifiedUs = verifiedUs;
+        toVerify[v]->readyUs = signedUs;
     }
 
-    Serial.println("[processor] Verifiying signatures");
-    if (!_cryptoService.verifyPoLRequestSignature(req)) {
-        Serial.println("[Processor] Invalid signature");
+    // A request whose response could not be signed gets an error, so the phone retries at once
+    // instead of waiting for a timeout.
+    for (size_t i = 0; i < job.count; ++i) {
+        if (job.signedOk[i]) {
+            stageToken(*signedRequests[i], *job.responses[i]);
+        } else {
+            stageError(*signedRequests[i], PoLErrorCode::SigningFailed);
+        }
+    }
+    if (job.merkleRoot && job.merkleOk) {
+        for (size_t i = 0; i < merkleCount; ++i) {
+            memcpy(merkleResponses[i]->beaconSig, job.merkleSig, SIG_SIZE);
+            stageToken(*merkleRequests[i], *merkleResponses[i]);
+        }
+        Serial.printf("%s Signed %zu response(s) with one Merkle root\n", TAG, merkleCount);
+    } else if (merkleCount > 0) {
+        Serial.printf("%s Failed to sign the Merkle batch\n", TAG);
+        for (size_t i = 0; i < merkleCount; ++i) {
+            stageError(*merkleRequests[i], PoLErrorCode::SigningFailed);
+        }
+    }
 
-        // Send a blank response signifying an error
-        _transport.sendMessage(buffer, sizeof(buffer));
+    // The requests of a pipelined frame occupy consecutive slots.
+    for (size_t i = 0; i < _batchSize;) {
+        if (_batch[i].frame == 0) {
+            sendAnswer(_batch[i++]);
+            continue;
+        }
+        size_t count = 1;
+        while (i + count < _batchSize && _batch[i + count].frame == _batch[i].frame) {
+            count++;
+        }
+        sendFrame(i, count);
+        i += count;
+    }
+    _batchSize = 0;
+}
+
+bool TokenMessageHandler::prepareResponse(PendingRequest& pending, uint64_t counter,
+                                          PoLResponse& resp) {
+    const PoLRequest& req = pending.req;
+
+    uint32_t retryAfterMs = 0;
+    PoLErrorCode error = checkHistory(req.phoneId, req.nonce, counter, retryAfterMs);
+    if (error != PoLErrorCode::None) {
+        stageError(pending, error, retryAfterMs);
+        return false;
     }
 
     Serial.println("[Processor] Valid request signature");
 
-    PoLResponse resp;
-    resp.flags = 0x00;
+    // The response echoes the request options, the server checks the token with the same flags.
+    resp.flags = req.flags;
     resp.beaconId = BEACON_ID;
-    resp.counter = _counter.getValue();
+    resp.counter = counter;
     memcpy(resp.nonce, req.nonce, PROTOCOL_NONCE_SIZE);  // Echo the nonce
 
-    // Sign the response, including context from the original request
-    _cryptoService.signPoLResponse(resp, req);
-    resp.toBytes(buffer);
+    // Only verified requests are remembered, so that forged ones cannot block a phone. The request
+    // is scoped to the epoch of the token it gets.
+    rememberRequest(req.phoneId, req.nonce, resp.counter, millis());
+
+    if (req.flags & POL_REQ_FLAG_SESSION) {
+        openSession(req, resp.counter);
+    }
+    return true;
+}
+
+bool TokenMessageHandler::buildMerkleBatch(const PendingRequest* const requests[],
+                                           PoLResponse* const responses[], size_t count,
+                                           uint8_t root[MERKLE_HASH_SIZE]) {
+    uint8_t leaves[MAX_BATCH][MERKLE_HASH_SIZE];
+    uint8_t signedData[PoLResponse::SIGNED_SIZE];
+    for (size_t i = 0; i < count; ++i) {
+        responses[i]->getSignedData(signedData, requests[i]->req);
+        MerkleTree::hashLeaf(leaves[i], signedData, sizeof(signedData));
+    }
+
+    MerkleProof proofs[MAX_BATCH];
+    if (!MerkleTree::build(leaves, count, root, proofs)) {
+        return false;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        responses[i]->proof = proofs[i];
+    }
+    return true;
+}
+
+void TokenMessageHandler::runSignJob(void* context, size_t index) {
+    SignJob& job = *static_cast<SignJob*>(context);
+    if (index < job.count) {
+        job.signedOk[index] = job.crypto->signPoLResponse(*job.responses[index],
+                                                          *job.requests[index]);
+    } else {
+        job.merkleOk = job.crypto->signMerkleRoot(job.merkleSig, job.merkleRoot);
+    }
+}
+
+void TokenMessageHandler::stageToken(PendingRequest& pending, const PoLResponse& resp) {
+    pending.answerLen = resp.getPackedLength();
+    pending.issued = true;
+    resp.toBytes(pending.answer);
+    _responseCache.store(pending.raw, sizeof(pending.raw), resp.counter, pending.answer,
+                         pending.answerLen);
+    _issuanceLog.record(pending.req.phoneId, resp.nonce, resp.counter);
+    _visitors.record(pending.req.phoneId, resp.counter);
+}
+
+const TokenMessageHandler::PendingRequest& TokenMessageHandler::answerOf(
+    const PendingRequest& pending) const {
+    return pending.retryOf != NO_RETRY ? _batch[pending.retryOf] : pending;
+}
+
+void TokenMessageHandler::sendAnswer(const PendingRequest& pending) {
+    const PendingRequest& source = answerOf(pending);
+    if (source.answerLen == 0) {
+        return;
+    }
 
     // Delegate sending the full message to the transport layer
-    if (!_transport.sendMessage(buffer, sizeof(buffer))) {
+    if (!_transport.sendMessage(source.answer, source.answerLen)) {
         Serial.println("[Processor] Failed to send response via transport layer.");
+        return;
+    }
+    recordSent(pending, micros());
+}
+
+void TokenMessageHandler::sendFrame(size_t first, size_t count) {
+    // [0x08][count] then, for each request, [request ID][length][answer]. An entry without answer
+    // keeps its place with a zero length.
+    size_t offset = 0;
+    _frameBuffer[offset++] = POL_FRAME_PIPELINE;
+    _frameBuffer[offset++] = (uint8_t)count;
+    for (size_t i = first; i < first + count; ++i) {
+        const PendingRequest& source = answerOf(_batch[i]);
+        _frameBuffer[offset++] = _batch[i].requestId;
+        _frameBuffer[offset++] = (uint8_t)source.answerLen;
+        memcpy(_frameBuffer + offset, source.answer, source.answerLen);
+        offset += source.answerLen;
     }
 
+    if (!_transport.sendMessage(_frameBuffer, offset)) {
+        Serial.println("[Processor] Failed to send response frame via transport layer.");
+        return;
+    }
+
+    uint32_t sentUs = micros();
+    for (size_t i = first; i < first + count; ++i) {
+        recordSent(_batch[i], sentUs);
+    }
+}
+
+void TokenMessageHandler::recordSent(const PendingRequest& pending, uint32_t sentUs) {
+    if (!pending.issued) {
+        return;
+    }
+
+    // Session tokens skip the verification and signing stages.
+    _latency.record(LatencyTracker::Stage::Queue, pending.writeUs, pending.dequeueUs);
+    if (!pending.answered) {
+        _latency.record(LatencyTracker::Stage::Verify, pending.dequeueUs, pending.verifiedUs);
+        _latency.record(LatencyTracker::Stage::Sign, pending.verifiedUs, pending.readyUs);
+    }
+    _latency.record(LatencyTracker::Stage::Send, pending.readyUs, sentUs);
+    _latency.record(LatencyTracker::Stage::Total, pending.writeUs, sentUs);
+
     Serial.println("[Processor] Response dispatched to transport layer.");
     _notifier.notify(SystemEventType::PoLTokenGenerated);
-}
\ No newline at end of file
+}
+
+void TokenMessageHandler::openSession(const PoLRequest& req, uint64_t counter) {
+    uint8_t key[SESSION_KEY_SIZE];
+    if (!_cryptoService.deriveSessionKey(key, req.phonePk, req.nonce, counter)) {
+        Serial.printf("%s Failed to open a session for phone %llu\n", TAG, req.phoneId);
+        return;
+    }
+    _sessions.open(req.phoneId, key, millis());
+    sodium_memzero(key, sizeof(key));
+    Serial.printf("%s Session opened for phone %llu\n", TAG, req.phoneId);
+}
+
+void TokenMessageHandler::answerSessionRequest(PendingRequest& pending, const uint8_t* data,
+                                               size_t len) {
+    PoLSessionRequest req;
+    if (len != PoLSessionRequest::packedSize() || !req.fromBytes(data, len)) {
+        Serial.printf("%s Invalid session request length %zu\n", TAG, len);
+        stageError(pending, PoLErrorCode::InvalidLength);
+        return;
+    }
+
+    if (req.beaconId != BEACON_ID) {
+        Serial.printf("%s Session request for beacon %u rejected\n", TAG, req.beaconId);
+        stageError(pending, PoLErrorCode::WrongBeacon);
+        return;
+    }
+
+    if (_revocations.isRevoked(req.phoneId, nullptr)) {
+        Serial.printf("%s Phone %llu revoked\n", TAG, req.phoneId);
+        stageError(pending, PoLErrorCode::Revoked);
+        return;
+    }
+
+    uint32_t now = millis();
+    const uint8_t* key = _sessions.find(req.phoneId, now);
+    if (!key) {
+        Serial.printf("%s No session for phone %llu\n", TAG, req.phoneId);
+        stageError(pending, PoLErrorCode::UnknownSession);
+        return;
+    }
+
+    uint8_t macData[PoLSessionRequest::MAC_DATA_SIZE];
+    req.getMacData(macData);
+    if (!_cryptoService.verifySessionMac(req.mac, macData, sizeof(macData), key)) {
+        Serial.printf("%s Invalid session MAC from phone %llu\n", TAG, req.phoneId);
+        stageError(pending, PoLErrorCode::InvalidSignature);
+        return;
+    }
+
+    uint64_t counter = _batchCounter;
+    uint32_t retryAfterMs = 0;
+    PoLErrorCode error = checkHistory(req.phoneId, req.nonce, counter, retryAfterMs);
+    if (error != PoLErrorCode::None) {
+        stageError(pending, error, retryAfterMs);
+        return;
+    }
+
+    PoLSessionToken token;
+    token.flags = POL_RESP_FLAG_SESSION_MAC;
+    token.beaconId = BEACON_ID;
+    token.counter = counter;
+    memcpy(token.nonce, req.nonce, PROTOCOL_NONCE_SIZE);
+    rememberRequest(req.phoneId, req.nonce, token.counter, now);
+
+    uint8_t tokenData[PoLSessionToken::MAC_DATA_SIZE];
+    token.getMacData(tokenData, req.phoneId);
+    _cryptoService.computeSessionMac(token.mac, tokenData, sizeof(tokenData), key);
+
+    token.toBytes(pending.answer);
+    pending.answerLen = PoLSessionToken::packedSize();
+    pending.answered = true;
+    pending.issued = true;
+    _responseCache.store(data, len, token.counter, pending.answer, pending.answerLen);
+    _issuanceLog.record(req.phoneId, token.nonce, token.counter);
+    _visitors.record(req.phoneId, token.counter);
+    Serial.printf("%s Session token issued to phone %llu\n", TAG, req.phoneId);
+}
+
+PoLErrorCode TokenMessageHandler::precheck(const uint8_t* data, size_t len, PoLRequest& req,
+                                           uint32_t& retryAfterMs) const {
+    if (len != PoLRequest::packedSize() || !req.fromBytes(data, len)) {
+        Serial.printf("%s Invalid length. Got %zu, expected %zu\n", TAG, len,
+                      PoLRequest::packedSize());
+        return PoLErrorCode::InvalidLength;
+    }
+
+    if (req.beaconId != BEACON_ID) {
+        Serial.printf("%s Request for beacon %u rejected\n", TAG, req.beaconId);
+        return PoLErrorCode::WrongBeacon;
+    }
+
+    if ((req.flags & ~POL_REQ_SUPPORTED_FLAGS) != 0) {
+        Serial.printf("%s Unsupported flags 0x%02X\n", TAG, req.flags);
+        return PoLErrorCode::UnsupportedFlags;
+    }
+
+    if (_revocations.isRevoked(req.phoneId, req.phonePk)) {
+        Serial.printf("%s Phone %llu revoked\n", TAG, req.phoneId);
+        return PoLErrorCode::Revoked;
+    }
+
+    return checkHistory(req.phoneId, req.nonce, _batchCounter, retryAfterMs);
+}
+
+PoLErrorCode TokenMessageHandler::checkHistory(uint64_t phoneId,
+                                               const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                                               uint64_t epoch, uint32_t& retryAfterMs) const {
+    if (isReplay(phoneId, nonce, epoch)) {
+        Serial.printf("%s Replayed nonce from phone %llu\n", TAG, phoneId);
+        return PoLErrorCode::Replay;
+    }
+
+    if (!_rateLimiter.allows(phoneId, millis(), &retryAfterMs)) {
+        Serial.printf("%s Phone %llu rate limited, retry in %u ms\n", TAG, phoneId,
+                      retryAfterMs);
+        return PoLErrorCode::RateLimited;
+    }
+
+    return PoLErrorCode::None;
+}
+
+bool TokenMessageHandler::answerFromCache(PendingRequest& pending, const uint8_t* data,
+                                          size_t len) {
+    if (len != PoLRequest::packedSize() && len != PoLSessionRequest::packedSize()) {
+        return false;
+    }
+
+    if (!_responseCache.lookup(data, len, _batchCounter, pending.answer, pending.answerLen)) {
+        return false;
+    }
+
+    Serial.printf("%s Retried request, answering with the cached response\n", TAG);
+    pending.answered = true;
+    return true;
+}
+
+size_t TokenMessageHandler::findRetry(const uint8_t* data, size_t len) const {
+    if (len != PoLRequest::packedSize()) {
+        return NO_RETRY;
+    }
+
+    // Only the requests waiting for verification: the others have no raw copy.
+    for (size_t i = 0; i + 1 < _batchSize; ++i) {
+        if (!_batch[i].answered && memcmp(_batch[i].raw, data, len) == 0) {
+            return i;
+        }
+    }
+    return NO_RETRY;
+}
+
+bool TokenMessageHandler::isReplay(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                                   uint64_t epoch) const {
+    return _replayCache.contains(phoneId, nonce, epoch);
+}
+
+void TokenMessageHandler::rememberRequest(uint64_t phoneId,
+                                          const uint8_t nonce[PROTOCOL_NONCE_SIZE], uint64_t epoch,
+                                          uint32_t now) {
+    _replayCache.insert(phoneId, nonce, epoch);
+
+    _rateLimiter.consume(phoneId, now);
+}
+
+void TokenMessageHandler::stageError(PendingRequest& pending, PoLErrorCode code,
+                                     uint32_t retryAfterMs) {
+    PoLResponse::errorToBytes(code, pending.answer, retryAfterMs);
+    pending.answerLen = PoLResponse::errorPackedSize();
+    pending.answered = true;
+    pending.issued = false;
+}
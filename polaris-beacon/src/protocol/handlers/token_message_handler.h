@@ -3,6 +3,18 @@
 
 #include "../../utils/beacon_counter.h"
 #include "../../utils/crypto_service.h"
+#include "../../utils/crypto_worker_pool.h"
+#include "../../utils/issuance_log.h"
+#include "../../utils/latency_tracker.h"
+#include "../../utils/rate_limiter.h"
+#include "../../utils/replay_cache.h"
+#include "../../utils/response_cache.h"
+#include "../../utils/revocation_filter.h"
+#include "../../utils/session_table.h"
+#include "../../utils/visitor_sketch.h"
+#include "../messages/pol_request.h"
+#include "../messages/pol_response.h"
+#include "../messages/pol_session.h"
 #include "../pol_constants.h"
 #include "imessage_handler.h"
 #include "protocol/transport/imessage_transport.h"
@@ -14,6 +26,42 @@
  *
  * This handler is responsible for processing an incoming PoLRequest, verifying its signature, and
  * constructing a signed PoLResponse containing the beacon current counter value.
+ *
+ * The Ed25519 verification dominates the cost of a request, so it only runs once the cheap checks
+ * passed, in this order: length, beacon ID, flags, revocation filter, replay filter, per-phone rate
+ * check. Any failure short-circuits with a compact error response (see
+ * `PoLResponse::errorToBytes`).
+ *
+ * An exact retry of a request answered during the current counter epoch (signed or session
+ * request) is answered with the cached response, before any of these checks.
+ *
+ * Requests passing the cheap checks are batched: the processor task hands over every request
+ * pending in its queue, then calls `flush`, which verifies the distinct signatures of the batch
+ * and issues the tokens. The responses to the requests carrying POL_REQ_FLAG_MERKLE are signed
+ * together: the beacon signs the root of a Merkle tree of their signed data, and each phone gets
+ * the root signature plus the authentication path of its response.
+ *
+ * A signed request carrying POL_REQ_FLAG_SESSION also opens a session: both sides derive a session
+ * key from the exchange (see `CryptoService::deriveSessionKey`). Until it expires, the phone can
+ * send a PoLSessionRequest authenticated with a MAC under that key, and gets a PoLSessionToken
+ * authenticated the same way, without any curve operation. Session requests go through the same
+ * replay and rate checks but skip the batch verification.
+ *
+ * The curve operations of a batch (request verifications, response and Merkle root signatures) run
+ * on the crypto worker pool, one worker per core. Every request takes a slot of the batch, in
+ * arrival order, including those answered without verification (errors, cached responses, session
+ * tokens), and `flush` sends the answers in slot order: the phone sees its answers in the order of
+ * its requests. The counter is read once per batch, when its first request is staged, so that the
+ * tokens (signed or session), the replay checks and entries and the cached responses of a batch all
+ * belong to the same epoch.
+ *
+ * A phone can also pipeline up to MAX_BATCH requests in one write, as a POL_FRAME_PIPELINE frame
+ * tagging each request with a request ID. The requests of a frame take consecutive slots of the
+ * same batch, and their answers are coalesced into a single response frame, matched by ID. A
+ * malformed frame is answered with a single InvalidLength error.
+ *
+ * The latency of every issued token is recorded per stage in the LatencyTracker, the token itself
+ * in the IssuanceLog, and its phone in the VisitorSketch.
  */
 class TokenMessageHandler : public IMessageHandler {
 public:
@@ -22,9 +70,19 @@ public:
      * @param cryptoService Reference to the cryptographic service for signing/verification.
      * @param counter Reference to the beacon counter.
      * @param transport Reference to the transport layer for sending the response.
+     * @param notifier Reference to the system event notifier.
+     * @param rateLimiter Reference to the per-phone rate limiter, shared with the queue admission.
+     * @param workers Reference to the worker pool running the curve operations.
+     * @param latency Reference to the tracker of the token latency.
+     * @param issuanceLog Reference to the journal of the issued tokens.
+     * @param visitors Reference to the sketches of the distinct phones served.
+     * @param revocations Reference to the filter of the phones revoked by the server.
      */
     TokenMessageHandler(const CryptoService& cryptoService, const BeaconCounter& counter,
-                        IMessageTransport& transport, const SystemEventNotifier& notifier);
+                        IMessageTransport& transport, const SystemEventNotifier& notifier,
+                        RateLimiter& rateLimiter, CryptoWorkerPool& workers,
+                        LatencyTracker& latency, IssuanceLog& issuanceLog,
+                        VisitorSketch& visitors, RevocationFilter& revocations);
 
     /**
      * @brief Processes a complete, reassembled PoL token request.
@@ -33,7 +91,213 @@ public:
      */
     void process(const uint8_t* requestData, size_t len) override;
 
+    /**
+     * @brief Verifies the batched requests and sends the answers, in arrival order.
+     */
+    void flush() override;
+
+    /// @brief The maximum number of requests in a pipelined frame.
+    static constexpr size_t MAX_PIPELINE_REQUESTS = 4;
+
 private:
+    /// @brief The maximum number of requests verified together (the token queue depth).
+    static constexpr size_t MAX_BATCH = 4;
+    static_assert(MAX_BATCH <= MERKLE_MAX_LEAVES, "A batch must fit in a Merkle tree");
+    static_assert(MAX_BATCH <= CryptoService::MAX_BATCH_SIZE, "A batch must be verifiable at once");
+    static_assert(PoLSessionToken::packedSize() <= PoLResponse::MAX_PACKED_SIZE,
+                  "A session token must fit in an answer slot");
+    static_assert(MAX_PIPELINE_REQUESTS <= MAX_BATCH, "A pipelined frame must fit in a batch");
+    static_assert(PoLResponse::MAX_PACKED_SIZE <= UINT8_MAX,
+                  "An answer length must fit in a frame entry");
+
+    /// @brief The maximum size of a pipelined response frame.
+    static constexpr size_t MAX_FRAME_SIZE =
+        POL_FRAME_HEADER_SIZE +
+        MAX_PIPELINE_REQUESTS * (POL_FRAME_HEADER_SIZE + PoLResponse::MAX_PACKED_SIZE);
+
+    /// @brief The value of `PendingRequest::retryOf` for a request without earlier copy.
+    static constexpr size_t NO_RETRY = MAX_BATCH;
+
+    /**
+     * @struct PendingRequest
+     * @brief A request of the batch and its answer.
+     */
+    struct PendingRequest {
+        PoLRequest req;
+
+        /// @brief The serialized request, the key of the response cache.
+        uint8_t raw[PoLRequest::packedSize()];
+
+        /// @brief True if the request was answered without verification.
+        bool answered = false;
+
+        /// @brief True if the answer is a new token.
+        bool issued = false;
+
+        /// @brief The pipelined frame of the request, 0 if it came alone.
+        uint8_t frame = 0;
+
+        /// @brief The request ID of the request in its frame.
+        uint8_t requestId = 0;
+
+        /// @brief The index of an earlier identical request of the batch, or NO_RETRY.
+        size_t retryOf = NO_RETRY;
+
+        /// @brief The answer, empty if the request gets none.
+        uint8_t answer[PoLResponse::MAX_PACKED_SIZE];
+        size_t answerLen = 0;
+
+        /// @brief The timestamps (micros) of the request, see LatencyTracker.
+        uint32_t writeUs = 0;
+        uint32_t dequeueUs = 0;
+        uint32_t verifiedUs = 0;
+        uint32_t readyUs = 0;
+    };
+
+    /**
+     * @struct SignJob
+     * @brief The signatures of a batch, computed by the worker pool.
+     *
+     * The items are the individual responses, then the Merkle root if `merkleRoot` is set.
+     */
+    struct SignJob {
+        const CryptoService* crypto = nullptr;
+        const PoLRequest* requests[MAX_BATCH] = {};
+        PoLResponse* responses[MAX_BATCH] = {};
+        bool signedOk[MAX_BATCH] = {};
+        size_t count = 0;
+
+        const uint8_t* merkleRoot = nullptr;
+        uint8_t merkleSig[SIG_SIZE] = {};
+        bool merkleOk = false;
+    };
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[Processor]";
+
+    /**
+     * @brief Takes a slot of the batch for a request and answers it if no verification is needed.
+     * @param data The raw request.
+     * @param len The length of the request.
+     * @return The slot of the request.
+     */
+    PendingRequest& stageRequest(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Stages the requests of a pipelined frame in consecutive slots.
+     * @param data The raw frame.
+     * @param len The length of the frame.
+     */
+    void processPipeline(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Checks the layout of a pipelined frame.
+     * @return The number of requests of the frame, 0 if it is malformed.
+     */
+    static size_t parsePipeline(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Runs the cheap checks on a request, in order, and parses it.
+     * @param data The raw request.
+     * @param len The length of the request.
+     * @param req The parsed request, valid if the checks passed.
+     * @param retryAfterMs Receives the time until the phone gets a new token, if rate limited.
+     * @return PoLErrorCode::None if the request can be verified, the reason of the rejection
+     * otherwise.
+     */
+    PoLErrorCode precheck(const uint8_t* data, size_t len, PoLRequest& req,
+                          uint32_t& retryAfterMs) const;
+
+    /**
+     * @brief Runs the checks depending on the previously answered requests (replay, rate).
+     * @param epoch The counter value the request would be answered with.
+     * @return PoLErrorCode::None if the request can be answered, the reason of the rejection
+     * otherwise.
+     */
+    PoLErrorCode checkHistory(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                              uint64_t epoch, uint32_t& retryAfterMs) const;
+
+    /**
+     * @brief Fills the unsigned response to a verified request, and records the request.
+     *
+     * The history checks run again, as an earlier request of the batch may have answered the same
+     * nonce or used the last token of the phone.
+     * @param pending The request. Receives the error answer if the checks fail.
+     * @param counter The counter snapshot of the batch.
+     * @param resp The response to fill.
+     * @return False if the request was answered with an error.
+     */
+    bool prepareResponse(PendingRequest& pending, uint64_t counter, PoLResponse& resp);
+
+    /**
+     * @brief Builds the Merkle tree of some responses and attaches the proofs.
+     * @param requests The requests, `count` entries.
+     * @param responses The responses, `count` entries.
+     * @param count The number of responses.
+     * @param root Receives the root to sign.
+     * @return False if the tree could not be built.
+     */
+    bool buildMerkleBatch(const PendingRequest* const requests[], PoLResponse* const responses[],
+                          size_t count, uint8_t root[MERKLE_HASH_SIZE]);
+
+    /** @brief Computes a signature of a SignJob, see `CryptoWorkerPool::Job`. */
+    static void runSignJob(void* context, size_t index);
+
+    /** @brief Stores a signed token response as the answer of a request, and caches it. */
+    void stageToken(PendingRequest& pending, const PoLResponse& resp);
+
+    /**
+     * @brief Derives and stores the session key of a verified request with POL_REQ_FLAG_SESSION.
+     */
+    void openSession(const PoLRequest& req, uint64_t counter);
+
+    /**
+     * @brief Checks a PoLSessionRequest and answers it with a PoLSessionToken or an error.
+     * @param pending The slot receiving the answer.
+     * @param data The raw request.
+     * @param len The length of the request.
+     */
+    void answerSessionRequest(PendingRequest& pending, const uint8_t* data, size_t len);
+
+    /** @brief Checks whether the nonce of the phone was already answered in the epoch. */
+    bool isReplay(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                  uint64_t epoch) const;
+
+    /**
+     * @brief Answers an exact retry of a signed or session request with the cached response.
+     * @return True if the request was answered.
+     */
+    bool answerFromCache(PendingRequest& pending, const uint8_t* data, size_t len);
+
+    /**
+     * @brief Finds an earlier identical request waiting in the batch.
+     * @return Its index, or NO_RETRY.
+     */
+    size_t findRetry(const uint8_t* data, size_t len) const;
+
+    /** @brief Records an answered request in the replay cache and the rate limiter. */
+    void rememberRequest(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE], uint64_t epoch,
+                         uint32_t now);
+
+    /** @brief Stores a compact error response as the answer of a request. */
+    void stageError(PendingRequest& pending, PoLErrorCode code, uint32_t retryAfterMs = 0);
+
+    /** @brief Returns the slot holding the answer of a request (itself, or its earlier copy). */
+    const PendingRequest& answerOf(const PendingRequest& pending) const;
+
+    /** @brief Sends the answer of a request, if any. */
+    void sendAnswer(const PendingRequest& pending);
+
+    /**
+     * @brief Sends the answers of the requests of a pipelined frame as a single response frame.
+     * @param first The index of the first slot of the frame.
+     * @param count The number of slots of the frame.
+     */
+    void sendFrame(size_t first, size_t count);
+
+    /** @brief Records the latency of a sent answer and notifies a new token. */
+    void recordSent(const PendingRequest& pending, uint32_t sentUs);
+
     /// @brief A reference to the cryptographic service.
     const CryptoService& _cryptoService;
 
@@ -45,6 +309,48 @@ private:
 
     /// @brief Notifier used to trigger actions
     const SystemEventNotifier& _notifier;
+
+    /// @brief The per-phone token buckets.
+    RateLimiter& _rateLimiter;
+
+    /// @brief The workers running the curve operations.
+    CryptoWorkerPool& _workers;
+
+    /// @brief The tracker of the token latency.
+    LatencyTracker& _latency;
+
+    /// @brief The journal of the issued tokens.
+    IssuanceLog& _issuanceLog;
+
+    /// @brief The sketches of the distinct phones served.
+    VisitorSketch& _visitors;
+
+    /// @brief The filter of the phones revoked by the server.
+    RevocationFilter& _revocations;
+
+    /// @brief The requests answered during the current counter epoch.
+    ReplayCache _replayCache;
+
+    /// @brief The last signed responses.
+    ResponseCache _responseCache;
+
+    /// @brief The open sessions.
+    SessionTable _sessions;
+
+    /// @brief The requests of the batch, in arrival order.
+    PendingRequest _batch[MAX_BATCH];
+
+    /// @brief The number of requests in `_batch`.
+    size_t _batchSize = 0;
+
+    /// @brief The counter snapshot of the batch, read when its first request is staged.
+    uint64_t _batchCounter = 0;
+
+    /// @brief The identifier of the last pipelined frame, never 0.
+    uint8_t _frameSeq = 0;
+
+    /// @brief The buffer of the pipelined response frames.
+    uint8_t _frameBuffer[MAX_FRAME_SIZE];
 };
 
 #endif  // TOKEN_HANDLER_H
\ No newline at end of file
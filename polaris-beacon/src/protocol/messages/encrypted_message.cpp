@@ -1,7 +1,6 @@
 #include "encrypted_message.h"
 
 #include <HardwareSerial.h>
-#include <sodium.h>
 #include <string.h>
 
 #include <vector>
@@ -59,17 +58,24 @@ bool InnerPlaintext::deserialize(const uint8_t* buffer, size_t len) {
 // --- EncryptedMessage Implementation ---
 EncryptedMessage::EncryptedMessage(const CryptoService& cryptoService)
     : _cryptoService(cryptoService), ciphertextWithTagLen(0) {
-    memset(nonce, 0, sizeof(nonce));
+    counter = 0;
     memset(ciphertextWithTag, 0, sizeof(ciphertextWithTag));
     beaconIdAd = 0;
+    keyEpoch = 0;
+    suite = POL_AEAD_SUITE_CHACHA20_POLY1305;
+    senderSuites = 0;
 }
 
 bool EncryptedMessage::seal(const InnerPlaintext& innerPt, uint32_t senderBeaconIdAd) {
     this->beaconIdAd = senderBeaconIdAd;
+    this->suite = _cryptoService.selectAeadSuite();
+    this->senderSuites = _cryptoService.getAeadSuites();
 
-    // Generate a unique 12-byte nonce for this message
-    // IMPORTANT: This nonce MUST be unique for each message encrypted with the same key.
-    randombytes_buf(this->nonce, POL_AEAD_NONCE_SIZE);
+    // The nonce is built from the counter, unique for each message sealed with the same subkey.
+    if (!_cryptoService.nextAeadCounter(this->keyEpoch, this->counter)) {
+        Serial.println("[EncMsg] Seal: No message counter available.");
+        return false;
+    }
 
     // Serialize InnerPlaintext
     std::vector<uint8_t> innerPlaintextBuffer(MAX_INNER_PLAINTEXT_SIZE);
@@ -79,14 +85,15 @@ bool EncryptedMessage::seal(const InnerPlaintext& innerPt, uint32_t senderBeacon
         return false;
     }
 
-    // Prepare Associated Data (beaconId)
-    uint8_t adBuffer[sizeof(uint32_t)];
-    memcpy(adBuffer, &this->beaconIdAd, sizeof(this->beaconIdAd));
+    // Prepare Associated Data (beaconId, keyEpoch, suite)
+    uint8_t adBuffer[AD_SIZE];
+    writeAssociatedData(adBuffer);
 
     // Encrypt
     if (!_cryptoService.encryptAEAD(this->ciphertextWithTag, this->ciphertextWithTagLen,
                                     innerPlaintextBuffer.data(), innerPlaintextLen, adBuffer,
-                                    sizeof(adBuffer), this->nonce)) {
+                                    sizeof(adBuffer), this->counter, this->keyEpoch,
+                                    this->suite)) {
         Serial.println("[EncMsg] Seal: AEAD encryption failed.");
         return false;
     }
@@ -94,13 +101,20 @@ bool EncryptedMessage::seal(const InnerPlaintext& innerPt, uint32_t senderBeacon
     return true;
 }
 
-bool EncryptedMessage::unseal(InnerPlaintext& innerPtOut, const uint8_t* overrideKey) {
-    // Assumes beaconIdAd, nonce, ciphertextWithTag, and ciphertextWithTagLen
+bool EncryptedMessage::unseal(InnerPlaintext& innerPtOut) {
+    // Assumes beaconIdAd, keyEpoch, counter, ciphertextWithTag, and ciphertextWithTagLen
     // have been populated by fromBytes()
 
+    // A replay costs no decryption
+    if (!_cryptoService.isFreshAeadCounter(this->keyEpoch, this->counter)) {
+        Serial.printf("[EncMsg] Unseal: Counter %u of epoch %u already received.\n", this->counter,
+                      this->keyEpoch);
+        return false;
+    }
+
     // Prepare Associated Data
-    uint8_t adBuffer[sizeof(uint32_t)];
-    memcpy(adBuffer, &this->beaconIdAd, sizeof(this->beaconIdAd));
+    uint8_t adBuffer[AD_SIZE];
+    writeAssociatedData(adBuffer);
 
     // Decrypt
     std::vector<uint8_t> decryptedInnerPlaintextBuffer(MAX_INNER_PLAINTEXT_SIZE);
@@ -109,11 +123,21 @@ bool EncryptedMessage::unseal(InnerPlaintext& innerPtOut, const uint8_t* overrid
     if (!_cryptoService.decryptAEAD(decryptedInnerPlaintextBuffer.data(),
                                     decryptedInnerPlaintextLen, this->ciphertextWithTag,
                                     this->ciphertextWithTagLen, adBuffer, sizeof(adBuffer),
-                                    this->nonce, overrideKey)) {
+                                    this->counter, this->keyEpoch, this->suite)) {
         Serial.println("[EncMsg] Unseal: AEAD decryption failed (bad tag or data).");
         return false;
     }
 
+    // Only an authenticated counter moves the replay window
+    if (!_cryptoService.markAeadCounter(this->keyEpoch, this->counter)) {
+        Serial.printf("[EncMsg] Unseal: Counter %u of epoch %u replayed.\n", this->counter,
+                      this->keyEpoch);
+        return false;
+    }
+
+    // Authenticated: the server can open the suites it announced
+    _cryptoService.setServerAeadSuites(this->senderSuites);
+
     // Deserialize InnerPlaintext
     if (!innerPtOut.deserialize(decryptedInnerPlaintextBuffer.data(), decryptedInnerPlaintextLen)) {
         Serial.println("[EncMsg] Unseal: Failed to deserialize inner plaintext.");
@@ -123,7 +147,7 @@ bool EncryptedMessage::unseal(InnerPlaintext& innerPtOut, const uint8_t* overrid
 }
 
 size_t EncryptedMessage::packedSize() const {
-    return sizeof(beaconIdAd) + POL_AEAD_NONCE_SIZE + ciphertextWithTagLen;
+    return AD_SIZE + POL_AEAD_COUNTER_SIZE + ciphertextWithTagLen;
 }
 
 size_t EncryptedMessage::toBytes(uint8_t* buffer, size_t bufferMaxLen) const {
@@ -132,25 +156,28 @@ size_t EncryptedMessage::toBytes(uint8_t* buffer, size_t bufferMaxLen) const {
         return 0;  // Not enough space
 
     size_t offset = 0;
-    memcpy(buffer + offset, &beaconIdAd, sizeof(beaconIdAd));
-    offset += sizeof(beaconIdAd);
-    memcpy(buffer + offset, nonce, POL_AEAD_NONCE_SIZE);
-    offset += POL_AEAD_NONCE_SIZE;
+    writeAssociatedData(buffer);
+    offset += AD_SIZE;
+    memcpy(buffer + offset, &counter, POL_AEAD_COUNTER_SIZE);
+    offset += POL_AEAD_COUNTER_SIZE;
     memcpy(buffer + offset, ciphertextWithTag, ciphertextWithTagLen);
     offset += ciphertextWithTagLen;
     return offset;
 }
 
 bool EncryptedMessage::fromBytes(const uint8_t* data, size_t len) {
-    size_t minHeaderLen = sizeof(beaconIdAd) + POL_AEAD_NONCE_SIZE;
+    size_t minHeaderLen = AD_SIZE + POL_AEAD_COUNTER_SIZE;
     if (len < minHeaderLen)
         return false;
 
     size_t offset = 0;
     memcpy(&beaconIdAd, data + offset, sizeof(beaconIdAd));
     offset += sizeof(beaconIdAd);
-    memcpy(nonce, data + offset, POL_AEAD_NONCE_SIZE);
-    offset += POL_AEAD_NONCE_SIZE;
+    keyEpoch = data[offset++];
+    suite = data[offset] & POL_AEAD_SUITE_ID_MASK;
+    senderSuites = data[offset++] & ~POL_AEAD_SUITE_ID_MASK;
+    memcpy(&counter, data + offset, POL_AEAD_COUNTER_SIZE);
+    offset += POL_AEAD_COUNTER_SIZE;
 
     this->ciphertextWithTagLen = len - offset;
     if (this->ciphertextWithTagLen > MAX_CIPHERTEXT_WITH_TAG_SIZE)
@@ -158,4 +185,10 @@ bool EncryptedMessage::fromBytes(const uint8_t* data, size_t len) {
 
     memcpy(ciphertextWithTag, data + offset, this->ciphertextWithTagLen);
     return true;
-}
\ No newline at end of file
+}
+
+void EncryptedMessage::writeAssociatedData(uint8_t out[AD_SIZE]) const {
+    memcpy(out, &beaconIdAd, sizeof(beaconIdAd));
+    out[sizeof(beaconIdAd)] = keyEpoch;
+    out[sizeof(beaconIdAd) + 1] = suite | senderSuites;
+}
@@ -54,14 +54,33 @@ struct __attribute__((packed)) InnerPlaintext {
  * This class encapsulates the logic for sealing (encrypting) an `InnerPlaintext`
  * into a transmittable format and unsealing (decrypting) a received buffer back
  * into an `InnerPlaintext`.
+ *
+ * Wire format: [beacon ID (4)][key epoch (1)][suite (1)][counter (4)][ciphertext + tag]. The
+ * beacon ID, the key epoch and the suite byte are the associated data. The 12-byte AEAD nonce is
+ * not sent: both sides build it from the direction and the counter (see
+ * CryptoService::encryptAEAD).
+ *
+ * Cipher suite negotiation: the low nibble of the suite byte is the suite of the message
+ * (POL_AEAD_SUITE_*), the high nibble the suites its sender can open. Each side seals with
+ * AES-256-GCM once an authenticated message of the other announced it, and with
+ * ChaCha20-Poly1305 otherwise. Being authenticated, the announcement cannot be downgraded.
  */
 class EncryptedMessage {
 public:
     /// @brief The beacon ID, sent as unencrypted Associated Data.
     uint32_t beaconIdAd;
 
-    /// @brief A 12-byte nonce, unique per message, sent in the clear.
-    uint8_t nonce[POL_AEAD_NONCE_SIZE];
+    /// @brief The epoch of the AEAD key, sent as unencrypted Associated Data after the beacon ID.
+    uint8_t keyEpoch;
+
+    /// @brief The cipher suite of the message (POL_AEAD_SUITE_*), low nibble of the suite byte.
+    uint8_t suite;
+
+    /// @brief The suites the sender can open, high nibble of the suite byte.
+    uint8_t senderSuites;
+
+    /// @brief The message counter of the direction and epoch, sent in the clear.
+    uint32_t counter;
 
     /// @brief Buffer containing the ciphertext and authentication tag.
     uint8_t ciphertextWithTag[MAX_CIPHERTEXT_WITH_TAG_SIZE];
@@ -77,6 +96,9 @@ public:
 
     /**
      * @brief Encrypts an InnerPlaintext struct and populates the EncryptedMessage fields.
+     *
+     * Takes the next send counter of the active key epoch, and the suite negotiated with the
+     * server.
      * @param innerPt The plaintext data to seal.
      * @param senderBeaconIdAd The ID of the beacon to include as Associated Data.
      * @return True on successful encryption.
@@ -85,11 +107,15 @@ public:
 
     /**
      * @brief Decrypts the messag ciphertext and populates a given InnerPlaintext struct.
+     *
+     * The key is the one of `keyEpoch`, a message of an epoch no longer live fails at once. A
+     * counter already received, or too old for the replay window, or a suite this beacon cannot
+     * open, fails before decrypting. Once authenticated, the suites announced by the server are
+     * recorded.
      * @param innerPtOut The InnerPlaintext struct to populate with decrypted data.
-     * @param Optionnal. Overrides the key stored in the KeyManager to unseal
      * @return True on successful decryption and authentication.
      */
-    bool unseal(InnerPlaintext& innerPtOut, const uint8_t* overrideKey = nullptr);
+    bool unseal(InnerPlaintext& innerPtOut);
 
     /**
      * @brief Serializes the entire message (header + ciphertext) to a buffer for transmission.
@@ -114,6 +140,12 @@ public:
     size_t packedSize() const;
 
 private:
+    /// @brief The size of the associated data (and of the header before the counter).
+    static constexpr size_t AD_SIZE = sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint8_t);
+
+    /** @brief Writes the associated data: [beacon ID (4)][key epoch (1)][suite (1)]. */
+    void writeAssociatedData(uint8_t out[AD_SIZE]) const;
+
     /// @brief A reference to the cryptographic service provider.
     const CryptoService& _cryptoService;
 };
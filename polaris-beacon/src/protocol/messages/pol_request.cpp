@@ -6,6 +6,14 @@ size_t PoLRequest::getSignedSize() const {
     return SIGNED_SIZE;
 }
 
+bool PoLRequest::peekPhoneId(const uint8_t* data, size_t len, uint64_t& phoneId) {
+    // The phone ID follows the flags byte.
+    if (len < sizeof(uint8_t) + sizeof(phoneId))
+        return false;
+    memcpy(&phoneId, data + sizeof(uint8_t), sizeof(phoneId));
+    return true;
+}
+
 bool PoLRequest::fromBytes(const uint8_t* data, size_t len) {
     if (len < PoLRequest::packedSize())
         return false;
@@ -61,6 +61,15 @@ public:
 
     size_t getSignedSize() const;
 
+    /**
+     * @brief Reads the phone ID of a serialized request without parsing the rest.
+     * @param data The buffer containing the beginning of a serialized request.
+     * @param len The length of the buffer.
+     * @param phoneId Receives the phone ID.
+     * @return False if the buffer is too short.
+     */
+    static bool peekPhoneId(const uint8_t* data, size_t len, uint64_t& phoneId);
+
     /**
      * @brief Copies the signable data (all fields except `phoneSig`) into a buffer.
      * @param out The output buffer for the signable data.
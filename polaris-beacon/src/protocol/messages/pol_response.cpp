@@ -23,6 +23,20 @@ bool PoLResponse::fromBytes(const uint8_t* data, size_t len) {
     offset += PROTOCOL_NONCE_SIZE;
 
     memcpy(beaconSig, data + offset, SIG_SIZE);
+    offset += SIG_SIZE;
+
+    proof = MerkleProof();
+    if (flags & POL_RESP_FLAG_MERKLE) {
+        if (len < offset + 2)
+            return false;
+        proof.leafIndex = data[offset++];
+        proof.leafCount = data[offset++];
+        size_t pathLen = (len - offset) / MERKLE_HASH_SIZE;
+        if (pathLen > MERKLE_MAX_DEPTH)
+            return false;
+        proof.pathLen = (uint8_t)pathLen;
+        memcpy(proof.path, data + offset, pathLen * MERKLE_HASH_SIZE);
+    }
     return true;
 }
 
@@ -40,6 +54,20 @@ void PoLResponse::toBytes(uint8_t* out) const {
     offset += PROTOCOL_NONCE_SIZE;
 
     memcpy(out + offset, beaconSig, SIG_SIZE);
+    offset += SIG_SIZE;
+
+    if (flags & POL_RESP_FLAG_MERKLE) {
+        out[offset++] = proof.leafIndex;
+        out[offset++] = proof.leafCount;
+        memcpy(out + offset, proof.path, proof.pathLen * MERKLE_HASH_SIZE);
+    }
+}
+
+size_t PoLResponse::getPackedLength() const {
+    if (flags & POL_RESP_FLAG_MERKLE) {
+        return packedSize() + 2 + proof.pathLen * MERKLE_HASH_SIZE;
+    }
+    return packedSize();
 }
 
 void PoLResponse::getSignedData(uint8_t* out, const PoLRequest& originalReq) const {
@@ -62,3 +90,11 @@ void PoLResponse::getSignedData(uint8_t* out, const PoLRequest& originalReq) con
     memcpy(out + offset, originalReq.phoneSig, SIG_SIZE);
     offset += SIG_SIZE;
 }
+
+void PoLResponse::errorToBytes(PoLErrorCode code, uint8_t* out, uint32_t retryAfterMs) {
+    uint32_t retryAfterS = (retryAfterMs + 999) / 1000;
+
+    out[0] = POL_RESP_FLAG_ERROR;
+    out[1] = static_cast<uint8_t>(code);
+    out[2] = static_cast<uint8_t>(retryAfterS > UINT8_MAX ? UINT8_MAX : retryAfterS);
+}
@@ -4,6 +4,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "../../utils/merkle_tree.h"
 #include "../pol_constants.h"
 #include "pol_request.h"
 
@@ -12,10 +13,14 @@
  * @brief Represents an unencrypted PoL response from the beacon.
  *
  * This struct defines the fixed-size binary layout for a PoL token response.
+ *
+ * With POL_RESP_FLAG_MERKLE, `beaconSig` signs the root of a Merkle tree whose leaves are the
+ * signed data of the responses of a batch, and the fixed layout is followed by the proof:
+ * [leaf index (1)][leaf count (1)][path (32 per level)].
  */
 class PoLResponse {
 public:
-    /// @brief Bit flags for message options. Currently unused.
+    /// @brief Bit flags for message options (POL_RESP_FLAG_*).
     uint8_t flags;
 
     /// @brief The ID of this beacon.
@@ -30,6 +35,9 @@ public:
     /// @brief The beacon Ed25519 signature over the response and parts of the original request.
     uint8_t beaconSig[SIG_SIZE];
 
+    /// @brief The authentication path of this response, with POL_RESP_FLAG_MERKLE only.
+    MerkleProof proof;
+
     /**
      * @brief Parses a PoLResponse from a raw byte buffer.
      * @param data The buffer containing the serialized response.
@@ -40,10 +48,33 @@ public:
 
     /**
      * @brief Serializes the PoLResponse object into a raw byte buffer.
-     * @param out The output buffer to write the serialized data into.
+     * @param out The output buffer to write the serialized data into, `getPackedLength()` bytes.
      */
     void toBytes(uint8_t* out) const;
 
+    /**
+     * @brief The size in bytes of this serialized response, proof included.
+     */
+    size_t getPackedLength() const;
+
+    /**
+     * @brief Serializes a compact error response: the error flag, the error code and the delay
+     * after which the phone may retry.
+     * @param code The reason of the rejection.
+     * @param out The output buffer, at least `errorPackedSize()` bytes.
+     * @param retryAfterMs The delay before retrying, rounded up to seconds (0 if not applicable).
+     */
+    static void errorToBytes(PoLErrorCode code, uint8_t* out, uint32_t retryAfterMs = 0);
+
+    /**
+     * @brief The size in bytes of a compact error response.
+     */
+    static constexpr size_t errorPackedSize() {
+        return sizeof(uint8_t)     // flags
+               + sizeof(uint8_t)   // error code
+               + sizeof(uint8_t);  // retry after, in seconds
+    }
+
     /**
      * @brief The total size in bytes of the portion of the message that is signed.
      *
@@ -68,6 +99,18 @@ public:
                + SIG_SIZE;            // response beacon signature
     }
 
+    /**
+     * @brief The maximum size in bytes of a serialized response, with the longest Merkle proof.
+     */
+    static constexpr size_t MAX_PACKED_SIZE = sizeof(uint8_t)        // flags
+                                              + sizeof(uint32_t)     // beacon id
+                                              + sizeof(uint64_t)     // beacon counter
+                                              + PROTOCOL_NONCE_SIZE  // echo nonce
+                                              + SIG_SIZE             // root signature
+                                              + sizeof(uint8_t)      // leaf index
+                                              + sizeof(uint8_t)      // leaf count
+                                              + MERKLE_MAX_DEPTH * MERKLE_HASH_SIZE;  // path
+
     size_t getSignedSize() const;
 
     /**
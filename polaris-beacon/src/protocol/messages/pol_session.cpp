@@ -0,0 +1,68 @@
+#include "pol_session.h"
+
+#include <string.h>
+
+bool PoLSessionRequest::fromBytes(const uint8_t* data, size_t len) {
+    if (len < packedSize())
+        return false;
+
+    size_t offset = 0;
+
+    flags = data[offset++];
+    memcpy(&phoneId, data + offset, sizeof(phoneId));
+    offset += sizeof(phoneId);
+
+    memcpy(&beaconId, data + offset, sizeof(beaconId));
+    offset += sizeof(beaconId);
+
+    memcpy(nonce, data + offset, PROTOCOL_NONCE_SIZE);
+    offset += PROTOCOL_NONCE_SIZE;
+
+    memcpy(mac, data + offset, SESSION_MAC_SIZE);
+    return true;
+}
+
+void PoLSessionRequest::getMacData(uint8_t* out) const {
+    size_t offset = 0;
+
+    out[offset++] = flags;
+    memcpy(out + offset, &phoneId, sizeof(phoneId));
+    offset += sizeof(phoneId);
+
+    memcpy(out + offset, &beaconId, sizeof(beaconId));
+    offset += sizeof(beaconId);
+
+    memcpy(out + offset, nonce, PROTOCOL_NONCE_SIZE);
+}
+
+void PoLSessionToken::toBytes(uint8_t* out) const {
+    size_t offset = 0;
+
+    out[offset++] = flags;
+    memcpy(out + offset, &beaconId, sizeof(beaconId));
+    offset += sizeof(beaconId);
+
+    memcpy(out + offset, &counter, sizeof(counter));
+    offset += sizeof(counter);
+
+    memcpy(out + offset, nonce, PROTOCOL_NONCE_SIZE);
+    offset += PROTOCOL_NONCE_SIZE;
+
+    memcpy(out + offset, mac, SESSION_MAC_SIZE);
+}
+
+void PoLSessionToken::getMacData(uint8_t* out, uint64_t phoneId) const {
+    size_t offset = 0;
+
+    out[offset++] = flags;
+    memcpy(out + offset, &beaconId, sizeof(beaconId));
+    offset += sizeof(beaconId);
+
+    memcpy(out + offset, &counter, sizeof(counter));
+    offset += sizeof(counter);
+
+    memcpy(out + offset, nonce, PROTOCOL_NONCE_SIZE);
+    offset += PROTOCOL_NONCE_SIZE;
+
+    memcpy(out + offset, &phoneId, sizeof(phoneId));
+}
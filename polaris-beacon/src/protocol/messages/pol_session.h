@@ -0,0 +1,118 @@
+#ifndef POL_SESSION_H
+#define POL_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../pol_constants.h"
+
+/**
+ * @class PoLSessionRequest
+ * @brief A PoL request from a phone with an open session, authenticated with the session key.
+ *
+ * Layout: [flags (1)][phone ID (8)][beacon ID (4)][nonce (16)][MAC (32)]. The flags are exactly
+ * POL_REQ_FLAG_SESSION_MAC, which tells it apart from a PoLRequest. The MAC covers the fields
+ * preceding it.
+ */
+class PoLSessionRequest {
+public:
+    /// @brief Bit flags, POL_REQ_FLAG_SESSION_MAC.
+    uint8_t flags;
+
+    /// @brief The ID of the phone that opened the session.
+    uint64_t phoneId;
+
+    /// @brief The ID of the beacon this request is intended for.
+    uint32_t beaconId;
+
+    /// @brief A random nonce to prevent replay attacks.
+    uint8_t nonce[PROTOCOL_NONCE_SIZE];
+
+    /// @brief The MAC of the preceding fields, under the session key.
+    uint8_t mac[SESSION_MAC_SIZE];
+
+    /**
+     * @brief Parses a request from a raw byte buffer.
+     * @param data The buffer containing the serialized request.
+     * @param len The length of the buffer.
+     * @return True if parsing was successful, false if length is incorrect.
+     */
+    bool fromBytes(const uint8_t* data, size_t len);
+
+    /**
+     * @brief The size in bytes of the portion of the message covered by the MAC.
+     */
+    static constexpr size_t MAC_DATA_SIZE =
+        sizeof(uint8_t) + sizeof(uint64_t) + sizeof(uint32_t) + PROTOCOL_NONCE_SIZE;
+
+    /**
+     * @brief The total size in bytes of the serialized message.
+     */
+    static constexpr size_t packedSize() {
+        return MAC_DATA_SIZE + SESSION_MAC_SIZE;
+    }
+
+    /**
+     * @brief Copies the authenticated data (all fields except `mac`) into a buffer.
+     * @param out The output buffer, MAC_DATA_SIZE bytes.
+     */
+    void getMacData(uint8_t* out) const;
+};
+
+/**
+ * @class PoLSessionToken
+ * @brief The beacon answer to a PoLSessionRequest, authenticated with the session key.
+ *
+ * Layout: [flags (1)][beacon ID (4)][counter (8)][nonce (16)][MAC (32)]. The MAC covers the
+ * fields preceding it followed by the phone ID of the request, so that the token is bound to the
+ * session of the phone.
+ */
+class PoLSessionToken {
+public:
+    /// @brief Bit flags, POL_RESP_FLAG_SESSION_MAC.
+    uint8_t flags;
+
+    /// @brief The ID of this beacon.
+    uint32_t beaconId;
+
+    /// @brief The beacon current monotonic counter value.
+    uint64_t counter;
+
+    /// @brief The nonce echoed back from the request.
+    uint8_t nonce[PROTOCOL_NONCE_SIZE];
+
+    /// @brief The MAC of the token, under the session key.
+    uint8_t mac[SESSION_MAC_SIZE];
+
+    /**
+     * @brief Serializes the token into a raw byte buffer.
+     * @param out The output buffer, `packedSize()` bytes.
+     */
+    void toBytes(uint8_t* out) const;
+
+    /**
+     * @brief The size in bytes of the authenticated data.
+     */
+    static constexpr size_t MAC_DATA_SIZE = sizeof(uint8_t)        // flags
+                                            + sizeof(uint32_t)     // beacon id
+                                            + sizeof(uint64_t)     // beacon counter
+                                            + PROTOCOL_NONCE_SIZE  // echo nonce
+                                            + sizeof(uint64_t);    // request phoneId
+
+    /**
+     * @brief The total size in bytes of the serialized message.
+     */
+    static constexpr size_t packedSize() {
+        return sizeof(uint8_t) + sizeof(uint32_t) + sizeof(uint64_t) + PROTOCOL_NONCE_SIZE +
+               SESSION_MAC_SIZE;
+    }
+
+    /**
+     * @brief Copies the authenticated data into a buffer.
+     * @param out The output buffer, MAC_DATA_SIZE bytes.
+     * @param phoneId The phone ID of the request.
+     */
+    void getMacData(uint8_t* out, uint64_t phoneId) const;
+};
+
+#endif  // POL_SESSION_H
@@ -11,6 +11,100 @@ constexpr const char* BLE_DEVICE_NAME = "PoL Beacon";
 /// @brief A placeholder manufacturer ID used in BLE advertisements.
 constexpr uint16_t MANUFACTURER_ID = 0xFFFF;
 
+// Feature bits advertised in the connectable advertisement, so that phones can pick a beacon
+// supporting what they need before connecting.
+constexpr uint8_t BEACON_FEATURE_SIGNED_BROADCAST = 0x01;
+constexpr uint8_t BEACON_FEATURE_ENCRYPTED_CHANNEL = 0x02;
+constexpr uint8_t BEACON_FEATURE_DATA_PULL = 0x04;
+constexpr uint8_t BEACON_FEATURE_PERIODIC_BROADCAST = 0x08;
+constexpr uint8_t BEACON_FEATURE_MERKLE_TOKENS = 0x10;
+constexpr uint8_t BEACON_FEATURE_SESSIONS = 0x20;
+constexpr uint8_t BEACON_FEATURE_PIPELINE = 0x40;
+constexpr uint8_t BEACON_FEATURE_TESLA_BROADCAST = 0x80;
+
+/// @brief The features supported by this firmware. The advertised byte is computed at runtime
+/// from it, see BleManager::getFeatures.
+constexpr uint8_t BEACON_FEATURES =
+    BEACON_FEATURE_SIGNED_BROADCAST | BEACON_FEATURE_ENCRYPTED_CHANNEL | BEACON_FEATURE_DATA_PULL |
+    BEACON_FEATURE_PERIODIC_BROADCAST | BEACON_FEATURE_MERKLE_TOKENS | BEACON_FEATURE_SESSIONS |
+    BEACON_FEATURE_PIPELINE | BEACON_FEATURE_TESLA_BROADCAST;
+
+/// @brief PoLRequest flag: the phone accepts a Merkle-batched response.
+constexpr uint8_t POL_REQ_FLAG_MERKLE = 0x01;
+
+/// @brief PoLRequest flag: the phone opens a session (see PoLSessionRequest) with this request.
+constexpr uint8_t POL_REQ_FLAG_SESSION = 0x02;
+
+/// @brief The PoLRequest flags understood by this firmware. Requests with other bits are rejected.
+constexpr uint8_t POL_REQ_SUPPORTED_FLAGS = POL_REQ_FLAG_MERKLE | POL_REQ_FLAG_SESSION;
+
+/**
+ * @brief Flag of the first byte of a PoLSessionRequest, authenticated with a session key instead
+ * of a signature. Never set in a PoLRequest.
+ */
+constexpr uint8_t POL_REQ_FLAG_SESSION_MAC = 0x04;
+
+/**
+ * @brief First byte of a pipelined frame, carrying several token requests tagged with an ID:
+ * [0x08][count] then, for each request, [request ID][length][request]. The answers come back in
+ * a single frame with the same layout. Never set in a PoLRequest.
+ */
+constexpr uint8_t POL_FRAME_PIPELINE = 0x08;
+
+/// @brief The size of the header of a pipelined frame, and of the header of each of its entries.
+constexpr size_t POL_FRAME_HEADER_SIZE = 2;
+
+/**
+ * @brief PoLResponse flag: the signature covers the root of a Merkle tree of responses, and the
+ * response carries the authentication path of its leaf. A response echoes the flags of its
+ * request, so the flags of the token are the same in the request and the response.
+ */
+constexpr uint8_t POL_RESP_FLAG_MERKLE = 0x01;
+
+/// @brief PoLSessionToken flag: the token is authenticated with the session key.
+constexpr uint8_t POL_RESP_FLAG_SESSION_MAC = 0x04;
+
+/// @brief PoLResponse flag marking a compact error response ([flags][error code][retry after]).
+constexpr uint8_t POL_RESP_FLAG_ERROR = 0x80;
+
+/// @brief Size of a Merkle tree node (BLAKE2b-256).
+constexpr size_t MERKLE_HASH_SIZE = 32;
+
+/// @brief The maximum number of responses signed together.
+constexpr size_t MERKLE_MAX_LEAVES = 8;
+
+/// @brief The maximum length of a Merkle authentication path (log2 of MERKLE_MAX_LEAVES).
+constexpr size_t MERKLE_MAX_DEPTH = 3;
+
+/// @brief Size of a session key (crypto_auth_KEYBYTES).
+constexpr size_t SESSION_KEY_SIZE = 32;
+
+/// @brief Size of a session MAC, HMAC-SHA-512-256 (crypto_auth_BYTES).
+constexpr size_t SESSION_MAC_SIZE = 32;
+
+/// @brief Size of a key of the broadcast hash chain (BLAKE2b-128).
+constexpr size_t TESLA_KEY_SIZE = 16;
+
+/// @brief Size of the broadcast interval tag (keyed BLAKE2b-128).
+constexpr size_t TESLA_TAG_SIZE = 16;
+
+/**
+ * @enum PoLErrorCode
+ * @brief The reason a PoL token request was rejected, sent in the compact error response.
+ */
+enum class PoLErrorCode : uint8_t {
+    None = 0x00,              ///< The request was accepted.
+    InvalidLength = 0x01,     ///< The request does not have the PoLRequest size.
+    WrongBeacon = 0x02,       ///< The request is intended for another beacon.
+    UnsupportedFlags = 0x03,  ///< The request uses flags this firmware does not support.
+    Replay = 0x04,            ///< The nonce was already answered.
+    RateLimited = 0x05,       ///< The phone sent too many requests, it should retry later.
+    InvalidSignature = 0x06,  ///< The phone signature (or session MAC) is invalid.
+    UnknownSession = 0x07,    ///< No open session for the phone, it must send a signed request.
+    Revoked = 0x08,           ///< The phone or its key was revoked by the server.
+    SigningFailed = 0x09      ///< The beacon failed to sign the token, retry with a new nonce.
+};
+
 /// @brief Size of the random nonce in bytes for PoL requests
 constexpr size_t PROTOCOL_NONCE_SIZE = 16;
 
@@ -32,12 +126,45 @@ constexpr size_t X25519_SK_SIZE = 32;
 /// @brief Size of the shared secret derived from an X25519 key exchange.
 constexpr size_t SHARED_KEY_SIZE = 32;
 
-/// @brief Size of the nonce for ChaCha20-Poly1305 AEAD (IETF standard).
+/// @brief Size of the AEAD nonce, for both suites (IETF ChaCha20-Poly1305 and AES-256-GCM).
 constexpr size_t POL_AEAD_NONCE_SIZE = 12;
 
-/// @brief Size of the authentication tag for ChaCha20-Poly1305 AEAD.
+/// @brief Size of the AEAD authentication tag, for both suites.
 constexpr size_t POL_AEAD_TAG_SIZE = 16;
 
+/// @brief Size of the message counter sent in the clear, from which the AEAD nonce is built.
+constexpr size_t POL_AEAD_COUNTER_SIZE = 4;
+
+/// @brief The context of the AEAD subkeys derivation (crypto_kdf, 8 characters).
+constexpr const char* POL_AEAD_KDF_CONTEXT = "PolAEAD_";
+
+/// @brief The KDF subkey IDs of the two directions, also the first byte of their nonces.
+constexpr uint8_t POL_AEAD_BEACON_TO_SERVER = 0x01;
+constexpr uint8_t POL_AEAD_SERVER_TO_BEACON = 0x02;
+
+/// @brief The AEAD cipher suites, sent in the low nibble of the suite byte of an encrypted message.
+constexpr uint8_t POL_AEAD_SUITE_CHACHA20_POLY1305 = 0x00;
+constexpr uint8_t POL_AEAD_SUITE_AES256_GCM = 0x01;
+constexpr size_t POL_AEAD_SUITE_COUNT = 2;
+
+/// @brief The suite byte: the suite of the message in the low nibble, and in the high nibble the
+/// suites the sender can open (bit 4 + suite). ChaCha20-Poly1305 is always supported.
+constexpr uint8_t POL_AEAD_SUITE_ID_MASK = 0x0F;
+constexpr uint8_t POL_AEAD_SUITES_SHIFT = 4;
+
+/// @brief The KDF subkey ID of a direction is direction + suite * stride: ChaCha20-Poly1305 keeps
+/// 1 and 2, AES-256-GCM uses 3 and 4, so a key is never shared by the two algorithms.
+constexpr uint8_t POL_AEAD_SUITE_SUBKEY_STRIDE = 2;
+
+/// @brief The data pull triggers passed by the BLE manager to the pull handler: the request was
+/// accepted, or refused under load.
+constexpr uint8_t PULL_TRIGGER_ACCEPTED = 1;
+constexpr uint8_t PULL_TRIGGER_REFUSED = 0;
+
+/// @brief The answer to a data pull refused under load: a single byte, shorter than any sealed
+/// message, so that the phone retries later instead of waiting for a message.
+constexpr uint8_t PULL_RESPONSE_BUSY = 0x00;
+
 /// @brief The maximum size of the inner plaintext structure for encrypted messages.
 constexpr size_t MAX_INNER_PLAINTEXT_SIZE = 544;  // Arbitrary value
 
@@ -49,10 +176,15 @@ constexpr size_t MAX_BLE_PAYLOAD_SIZE = MAX_INNER_PLAINTEXT_SIZE + 40;
 constexpr const char* NVS_NAMESPACE = "polaris-beacon";
 constexpr const char* NVS_Ed25519_SK_NAME = "bcn_Ed25519_sk";
 constexpr const char* NVS_Ed25519_PK_NAME = "bcn_Ed25519_pk";
+// The X25519 entries of the previous firmware versions, moved to NVS_X25519_PAIR_NAME at boot.
 constexpr const char* NVS_X25519_SK_NAME = "bcn_x25519_sk";
 constexpr const char* NVS_X25519_PK_NAME = "bcn_x25519_pk";
+constexpr const char* NVS_X25519_EPOCH_NAME = "bcn_x25519_ep";
+constexpr const char* NVS_X25519_PAIR_NAME = "bcn_x25519_kp";
 constexpr const char* NVS_SERVER_X25519_PK_NAME = "srv_x25519_pk";
 constexpr const char* NVS_ENC_MSG_ID_COUNTER = "enc_msg_id_ctr";
+constexpr const char* NVS_AEAD_TX_NAME = "aead_tx";
+constexpr const char* NVS_AEAD_RX_NAME = "aead_rx";
 
 /// @brief Message type for a request.
 constexpr uint8_t MSG_TYPE_REQ = 0x01;
@@ -88,8 +220,12 @@ enum class OperationType : uint8_t {
     RequestBeaconStatus = 0x06,  ///< Command from server requesting beacon status.
     RotateKeyInit = 0x10,        ///< Command from server requesting key rotation.
     RotateKeyFinish = 0x11,      ///< Command from server acknowledging end of rotation.
+    SetRevocationFilter = 0x12,  ///< Command from server replacing the revocation filter.
+    AddRevocations = 0x13,       ///< Command from server adding revoked phones to the filter.
 
     BeaconStatus = 0x80,  ///< A message from beacon containing its status.
+    IssuanceLog = 0x81,   ///< A message from beacon containing a block of its token journal.
+    VisitorSketch = 0x82,  ///< A message from beacon containing the distinct phones of a window.
     Unknown = 0xFF        ///< Represents an unknown or invalid operation type.
 };
 
@@ -5,7 +5,7 @@
 
 #include "fragmentation_header.h"
 
-FragmentationTransport::FragmentationTransport(BLECharacteristic* indicateChar,
+FragmentationTransport::FragmentationTransport(IBleCharacteristic* indicateChar,
                                                HandlerFactory factory)
     : _indicateChar(indicateChar) {
     _reassemblyBuffer.reserve(512);  // Pre-allocate some memory
@@ -109,6 +109,12 @@ void FragmentationTransport::process(const uint8_t* chunkData, size_t len) {
     }
 }
 
+void FragmentationTransport::flush() {
+    if (_wrappedHandler) {
+        _wrappedHandler->flush();
+    }
+}
+
 // --- OUTGOING DATA LOGIC ---
 bool FragmentationTransport::sendMessage(const uint8_t* fullMessageData, size_t len) {
     if (!_indicateChar) {
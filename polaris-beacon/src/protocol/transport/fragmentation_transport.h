@@ -2,12 +2,11 @@
 #ifndef FRAGMENTATION_TRANSPORT_H
 #define FRAGMENTATION_TRANSPORT_H
 
-#include <BLECharacteristic.h>
-
 #include <functional>
 #include <memory>
 #include <vector>
 
+#include "ble/stack/ible_stack.h"
 #include "imessage_transport.h"
 #include "protocol/handlers/imessage_handler.h"
 
@@ -33,7 +32,7 @@ public:
      * @param indicateChar The BLE characteristic used for sending outgoing (indicated) data.
      * @param factory A factory function that creates the message handler.
      */
-    FragmentationTransport(BLECharacteristic* indicateChar, HandlerFactory factory);
+    FragmentationTransport(IBleCharacteristic* indicateChar, HandlerFactory factory);
 
     /**
      * @brief Processes an incoming raw data chunk from the BLE stack.
@@ -45,6 +44,11 @@ public:
      */
     void process(const uint8_t* chunkData, size_t len) override;
 
+    /**
+     * @brief Forwards the end of a batch to the wrapped handler.
+     */
+    void flush() override;
+
     /**
      * @brief Sends a full message by fragmenting it and sending it via indications.
      * @param fullMessageData Pointer to the complete message to be sent.
@@ -86,7 +90,7 @@ private:
     std::unique_ptr<IMessageHandler> _wrappedHandler;
 
     /// @brief The BLE characteristic for sending outgoing data.
-    BLECharacteristic* _indicateChar;
+    IBleCharacteristic* _indicateChar;
 
     /// @brief The current state of the reassembly process.
     ReassemblyState _reassemblyState = ReassemblyState::IDLE;
@@ -0,0 +1,141 @@
+#include "aead_sequence.h"
+
+#include <HardwareSerial.h>
+#include <string.h>
+
+#include "protocol/pol_constants.h"
+
+AeadSequence::AeadSequence() {
+    _mutex = xSemaphoreCreateMutex();
+}
+
+void AeadSequence::begin(Preferences* prefs) {
+    _prefs = prefs;
+
+    // The counters reserved before the reboot are skipped, they may have been used.
+    SendState stored;
+    if (_prefs->getBytes(NVS_AEAD_TX_NAME, &stored, sizeof(stored)) == sizeof(stored)) {
+        _send = stored;
+        _send.next = stored.reservedUntil;
+    }
+    if (_prefs->getBytes(NVS_AEAD_RX_NAME, _windows, sizeof(_windows)) != sizeof(_windows)) {
+        memset(_windows, 0, sizeof(_windows));
+    }
+    Serial.printf("%s Epoch %u, next send counter %u.\n", TAG, _send.epoch, _send.next);
+}
+
+bool AeadSequence::nextSendCounter(uint8_t epoch, uint32_t& counterOut) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    SendState previous = _send;
+    if (_send.epoch != epoch) {
+        if ((int8_t)(epoch - _send.epoch) < 0 && _send.next > 0) {
+            // Starting the older epoch again at 0 would reuse its nonces
+            uint8_t sendEpoch = _send.epoch;
+            xSemaphoreGive(_mutex);
+            Serial.printf("%s Epoch %u is older than the send epoch %u.\n", TAG, epoch, sendEpoch);
+            return false;
+        }
+        // New subkeys, new counter space
+        _send.epoch = epoch;
+        _send.next = 0;
+        _send.reservedUntil = 0;
+    }
+    if (_send.next == UINT32_MAX) {
+        xSemaphoreGive(_mutex);
+        Serial.printf("%s Send counters of epoch %u exhausted, rotate the key.\n", TAG, epoch);
+        return false;
+    }
+    counterOut = _send.next++;
+    bool reserve = counterOut >= _send.reservedUntil;
+    if (reserve) {
+        _send.reservedUntil = counterOut > UINT32_MAX - SEND_RESERVE ? UINT32_MAX
+                                                                     : counterOut + SEND_RESERVE;
+    }
+    bool reserved = !reserve || _prefs->putBytes(NVS_AEAD_TX_NAME, &_send, sizeof(_send)) ==
+                                    sizeof(_send);
+    if (!reserved) {
+        // The counter was not handed out, the block is reserved again by the next call.
+        _send = previous;
+    }
+    xSemaphoreGive(_mutex);
+
+    if (!reserved) {
+        Serial.printf("%s Failed to reserve the send counters from %u.\n", TAG, counterOut);
+    }
+    return reserved;
+}
+
+bool AeadSequence::isFresh(uint8_t epoch, uint32_t counter) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    const Window* window = findWindowLocked(epoch);
+    bool fresh = window == nullptr || isFreshIn(*window, counter);
+    xSemaphoreGive(_mutex);
+    return fresh;
+}
+
+bool AeadSequence::markReceived(uint8_t epoch, uint32_t counter) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    Window& window = windowLocked(epoch);
+    if (!isFreshIn(window, counter)) {
+        xSemaphoreGive(_mutex);
+        return false;
+    }
+    if (counter >= window.top) {
+        uint32_t shift = counter - window.top + 1;
+        window.bits = shift >= WINDOW_BITS ? 0 : window.bits << shift;
+        window.bits |= 1;
+        window.top = counter + 1;
+    } else {
+        window.bits |= 1ULL << (window.top - 1 - counter);
+    }
+    bool stored =
+        _prefs->putBytes(NVS_AEAD_RX_NAME, _windows, sizeof(_windows)) == sizeof(_windows);
+    xSemaphoreGive(_mutex);
+
+    if (!stored) {
+        Serial.printf("%s Failed to store the receive windows.\n", TAG);
+    }
+    return true;
+}
+
+AeadSequence::Window* AeadSequence::findWindowLocked(uint8_t epoch) {
+    for (Window& window : _windows) {
+        if (window.used && window.epoch == epoch) {
+            return &window;
+        }
+    }
+    return nullptr;
+}
+
+AeadSequence::Window& AeadSequence::windowLocked(uint8_t epoch) {
+    Window* found = findWindowLocked(epoch);
+    if (found) {
+        return *found;
+    }
+
+    // Windows are only created for authenticated epochs, the newest ones: the window of the
+    // epoch furthest behind is no longer live.
+    Window* replaced = &_windows[0];
+    for (Window& window : _windows) {
+        if (!window.used) {
+            replaced = &window;
+            break;
+        }
+        if ((uint8_t)(epoch - window.epoch) > (uint8_t)(epoch - replaced->epoch)) {
+            replaced = &window;
+        }
+    }
+    replaced->used = 1;
+    replaced->epoch = epoch;
+    replaced->top = 0;
+    replaced->bits = 0;
+    return *replaced;
+}
+
+bool AeadSequence::isFreshIn(const Window& window, uint32_t counter) {
+    if (counter >= window.top) {
+        return true;
+    }
+    uint32_t age = window.top - 1 - counter;
+    return age < WINDOW_BITS && (window.bits & (1ULL << age)) == 0;
+}
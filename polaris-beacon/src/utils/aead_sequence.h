@@ -0,0 +1,131 @@
+#ifndef AEAD_SEQUENCE_H
+#define AEAD_SEQUENCE_H
+
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class AeadSequence
+ * @brief The message counters of the encrypted channel with the server, from which the AEAD
+ * nonces are built.
+ *
+ * Each direction has its own subkey per key epoch (see KeyManager), so a counter only has to be
+ * unique per direction and epoch: the beacon counts its sealed messages from 0 at each new epoch,
+ * and the server does the same for its own.
+ *
+ * Send side: the counter is persisted by blocks of SEND_RESERVE. A block is reserved in NVS before
+ * its first counter is used, so a reboot skips the rest of the block but never reuses a counter.
+ * The send epoch only moves forward: a counter asked for an older epoch (by a task that read the
+ * epoch before a rotation) is refused, as the counters of that epoch cannot be started again.
+ *
+ * Receive side: a sliding window of WINDOW_BITS counters per epoch (the highest counter received,
+ * and a bitmap of the ones before it) detects the replays without storing the counters, while
+ * accepting the messages relayed out of order by different phones. The windows are persisted
+ * after each accepted message (the server messages are rare).
+ *
+ * Seal and unseal run on the BLE and main loop tasks. The state is guarded by a mutex, held
+ * across the NVS writes: no counter of a block is handed out before the block is stored, and the
+ * windows are stored in the order they were updated.
+ */
+class AeadSequence {
+public:
+    /**
+     * @brief Constructs the AeadSequence.
+     */
+    AeadSequence();
+
+    /// @brief The number of send counters reserved by each NVS write.
+    static constexpr uint32_t SEND_RESERVE = 32;
+
+    /// @brief The number of counters below the highest one still accepted once.
+    static constexpr uint32_t WINDOW_BITS = 64;
+
+    /// @brief The number of epochs with a receive window: active, pending and 2 retired.
+    static constexpr size_t WINDOWS = 4;
+
+    /**
+     * @brief Loads the counters from the NVS.
+     * @param prefs The NVS storage, after the KeyManager cleared the counters of a new key pair.
+     */
+    void begin(Preferences* prefs);
+
+    /**
+     * @brief Takes the counter of the next sealed message.
+     * @param epoch The epoch of the sealing key. A new epoch starts again at 0.
+     * @param counterOut Receives the counter.
+     * @return False if the epoch is older than the one of the last counter, if the counter space
+     * of the epoch is exhausted (the key must be rotated) or if the reservation could not be
+     * stored. A failed reservation is undone, so that the next
+     * calls fail as well until a reservation is stored.
+     */
+    bool nextSendCounter(uint8_t epoch, uint32_t& counterOut);
+
+    /**
+     * @brief Checks, before decrypting, whether a counter was not received yet.
+     * @return False for a replay, or a counter too old for the window.
+     */
+    bool isFresh(uint8_t epoch, uint32_t counter);
+
+    /**
+     * @brief Records the counter of an authenticated message.
+     * @return False if the counter was recorded meanwhile (a concurrent replay), the message must
+     * then be dropped.
+     */
+    bool markReceived(uint8_t epoch, uint32_t counter);
+
+private:
+    /**
+     * @struct SendState
+     * @brief The send counter of an epoch, as stored in the NVS.
+     */
+    struct __attribute__((packed)) SendState {
+        uint8_t epoch;
+        uint32_t next;
+        uint32_t reservedUntil;
+    };
+
+    /**
+     * @struct Window
+     * @brief The receive window of an epoch, as stored in the NVS.
+     */
+    struct __attribute__((packed)) Window {
+        uint8_t used;
+        uint8_t epoch;
+        /// @brief The highest counter received + 1, 0 before the first message.
+        uint32_t top;
+        /// @brief Bit i is set if the counter top - 1 - i was received.
+        uint64_t bits;
+    };
+
+    /** @brief Returns the window of an epoch, or nullptr. Called with the mutex held. */
+    Window* findWindowLocked(uint8_t epoch);
+
+    /**
+     * @brief Returns the window of an epoch, replacing the one of the oldest epoch if needed.
+     * Called with the mutex held.
+     */
+    Window& windowLocked(uint8_t epoch);
+
+    /** @brief Checks a counter against a window. */
+    static bool isFreshIn(const Window& window, uint32_t counter);
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[AeadSeq]";
+
+    /// @brief Handle to the NVS storage.
+    Preferences* _prefs = nullptr;
+
+    /// @brief Protects the counters and the windows, and serializes their NVS writes.
+    SemaphoreHandle_t _mutex = nullptr;
+
+    /// @brief The send counter.
+    SendState _send = {};
+
+    /// @brief The receive windows.
+    Window _windows[WINDOWS] = {};
+};
+
+#endif  // AEAD_SEQUENCE_H
@@ -0,0 +1,27 @@
+#ifndef CRYPTO_BACKEND_CONFIG_H
+#define CRYPTO_BACKEND_CONFIG_H
+
+// Compile-time selection of the crypto backend. Exactly one of the POLARIS_CRYPTO_BACKEND_*
+// macros below is set to 1:
+//  - `-DPOLARIS_CRYPTO_HW` selects the ESP32-S3 backend, which routes SHA-512 (session MACs) and
+//    AES-256-GCM to the hardware accelerators through mbedTLS.
+//  - `-DPOLARIS_CRYPTO_HOST` selects the host backend (libsodium with a seedable deterministic
+//    random generator). It is also the default when not building for Arduino. No host build
+//    environment exists yet (platformio.ini only has ESP32 targets): like the fake BLE stack, the
+//    backend is there for the Linux test builds to come, and is not built by any target today.
+//  - Otherwise, the plain libsodium backend is used.
+#if defined(POLARIS_CRYPTO_HW)
+#define POLARIS_CRYPTO_BACKEND_HW 1
+#define POLARIS_CRYPTO_BACKEND_HOST 0
+#define POLARIS_CRYPTO_BACKEND_SODIUM 0
+#elif defined(POLARIS_CRYPTO_HOST) || !defined(ARDUINO)
+#define POLARIS_CRYPTO_BACKEND_HW 0
+#define POLARIS_CRYPTO_BACKEND_HOST 1
+#define POLARIS_CRYPTO_BACKEND_SODIUM 0
+#else
+#define POLARIS_CRYPTO_BACKEND_HW 0
+#define POLARIS_CRYPTO_BACKEND_HOST 0
+#define POLARIS_CRYPTO_BACKEND_SODIUM 1
+#endif
+
+#endif  // CRYPTO_BACKEND_CONFIG_H
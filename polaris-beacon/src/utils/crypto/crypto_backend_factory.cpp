@@ -0,0 +1,21 @@
+#include "crypto_backend_factory.h"
+
+#include "crypto_backend_config.h"
+
+#if POLARIS_CRYPTO_BACKEND_HW
+#include "esp32_hw_crypto_backend.h"
+#elif POLARIS_CRYPTO_BACKEND_HOST
+#include "host_crypto_backend.h"
+#else
+#include "sodium_crypto_backend.h"
+#endif
+
+std::unique_ptr<ICryptoBackend> createCryptoBackend() {
+#if POLARIS_CRYPTO_BACKEND_HW
+    return std::unique_ptr<ICryptoBackend>(new Esp32HwCryptoBackend());
+#elif POLARIS_CRYPTO_BACKEND_HOST
+    return std::unique_ptr<ICryptoBackend>(new HostCryptoBackend());
+#else
+    return std::unique_ptr<ICryptoBackend>(new SodiumCryptoBackend());
+#endif
+}
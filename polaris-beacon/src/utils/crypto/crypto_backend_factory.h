@@ -0,0 +1,16 @@
+#ifndef CRYPTO_BACKEND_FACTORY_H
+#define CRYPTO_BACKEND_FACTORY_H
+
+#include <memory>
+
+#include "icrypto_backend.h"
+
+/**
+ * @brief Creates the crypto backend selected at compile time.
+ *
+ * See `crypto_backend_config.h` for the build flags controlling the selection.
+ * @return A unique pointer to the new backend. libsodium must be initialized before it is used.
+ */
+std::unique_ptr<ICryptoBackend> createCryptoBackend();
+
+#endif  // CRYPTO_BACKEND_FACTORY_H
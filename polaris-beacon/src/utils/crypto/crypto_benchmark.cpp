@@ -0,0 +1,137 @@
+#include "crypto_benchmark.h"
+
+#include <HardwareSerial.h>
+#include <string.h>
+
+CryptoBenchmark::CryptoBenchmark(const ICryptoBackend& backend, uint32_t iterations)
+    : _backend(backend), _iterations(iterations == 0 ? 1 : iterations) {
+}
+
+template <typename F>
+bool CryptoBenchmark::measure(Op op, F operation) {
+    bool ok = true;
+    uint32_t start = _backend.cycleCount();
+    for (uint32_t i = 0; i < _iterations; ++i) {
+        ok = operation() && ok;
+    }
+    // Unsigned difference, correct across one wrap of the counter
+    uint32_t elapsed = _backend.cycleCount() - start;
+    _cycles[op] = ok ? elapsed / _iterations : 0;
+    return ok;
+}
+
+bool CryptoBenchmark::run() {
+    uint8_t message[MESSAGE_SIZE];
+    uint8_t key[SHARED_KEY_SIZE];
+    uint8_t digest[SHA512_SIZE];
+    uint8_t edPk[Ed25519_PK_SIZE];
+    uint8_t edSk[Ed25519_SK_SIZE];
+    uint8_t sig[SIG_SIZE];
+    uint8_t xSk[X25519_SK_SIZE];
+    uint8_t xPk[X25519_PK_SIZE];
+    uint8_t shared[SHARED_KEY_SIZE];
+    uint8_t nonce[POL_AEAD_NONCE_SIZE] = {};
+    uint8_t aeadMessage[AEAD_MESSAGE_SIZE];
+    uint8_t ct[AEAD_MESSAGE_SIZE + POL_AEAD_TAG_SIZE];
+    uint8_t pt[AEAD_MESSAGE_SIZE];
+    size_t ctLen = 0;
+    size_t ptLen = 0;
+
+    _backend.randomBytes(message, sizeof(message));
+    _backend.randomBytes(aeadMessage, sizeof(aeadMessage));
+    _backend.randomBytes(key, sizeof(key));
+    _backend.randomBytes(xSk, sizeof(xSk));
+    if (!_backend.generateEd25519KeyPair(edPk, edSk) || !_backend.x25519Base(xPk, xSk)) {
+        Serial.printf("%s Error: benchmark keys generation failed.\n", TAG);
+        return false;
+    }
+    const ICryptoBackend& b = _backend;
+
+    bool ok = true;
+    ok = measure(SHA512, [&]() -> bool {
+             b.sha512(digest, message, sizeof(message));
+             return true;
+         }) && ok;
+    ok = measure(HMAC, [&]() -> bool {
+             b.hmacSha512256(digest, message, sizeof(message), key);
+             return true;
+         }) && ok;
+    ok = measure(BLAKE2B, [&]() -> bool {
+             b.hash(digest, SHARED_KEY_SIZE, message, sizeof(message), key, sizeof(key));
+             return true;
+         }) && ok;
+    ok = measure(KDF, [&]() -> bool {
+             b.deriveKey(digest, SHARED_KEY_SIZE, POL_AEAD_BEACON_TO_SERVER, POL_AEAD_KDF_CONTEXT,
+                         key);
+             return true;
+         }) && ok;
+    ok = measure(SIGN, [&]() { return b.signEd25519(sig, message, sizeof(message), edSk); }) && ok;
+    ok = measure(VERIFY, [&]() { return b.verifyEd25519(sig, message, sizeof(message), edPk); }) &&
+         ok;
+    ok = measure(X25519, [&]() { return b.x25519(shared, xSk, xPk); }) && ok;
+    ok = measure(CHACHA_ENCRYPT, [&]() {
+             return b.aeadEncrypt(ct, ctLen, aeadMessage, sizeof(aeadMessage), nullptr, 0, nonce,
+                                  key);
+         }) && ok;
+    ok = measure(CHACHA_DECRYPT, [&]() {
+             return b.aeadDecrypt(pt, ptLen, ct, ctLen, nullptr, 0, nonce, key);
+         }) && ok;
+    if (b.hasAesGcm()) {
+        ok = measure(GCM_ENCRYPT, [&]() {
+                 return b.aesGcmEncrypt(ct, ctLen, aeadMessage, sizeof(aeadMessage), nullptr, 0,
+                                        nonce, key);
+             }) && ok;
+        ok = measure(GCM_DECRYPT, [&]() {
+                 return b.aesGcmDecrypt(pt, ptLen, ct, ctLen, nullptr, 0, nonce, key);
+             }) && ok;
+    } else {
+        _cycles[GCM_ENCRYPT] = 0;
+        _cycles[GCM_DECRYPT] = 0;
+    }
+
+    memset(edSk, 0, sizeof(edSk));
+    memset(xSk, 0, sizeof(xSk));
+    return ok;
+}
+
+uint32_t CryptoBenchmark::cyclesPerOp(Op op) const {
+    return op < OP_COUNT ? _cycles[op] : 0;
+}
+
+const char* CryptoBenchmark::opName(Op op) {
+    switch (op) {
+        case SHA512:
+            return "sha512";
+        case HMAC:
+            return "hmac-sha512-256";
+        case BLAKE2B:
+            return "blake2b";
+        case KDF:
+            return "kdf";
+        case SIGN:
+            return "ed25519-sign";
+        case VERIFY:
+            return "ed25519-verify";
+        case X25519:
+            return "x25519";
+        case CHACHA_ENCRYPT:
+            return "chacha20-encrypt";
+        case CHACHA_DECRYPT:
+            return "chacha20-decrypt";
+        case GCM_ENCRYPT:
+            return "aes-gcm-encrypt";
+        case GCM_DECRYPT:
+            return "aes-gcm-decrypt";
+        default:
+            return "?";
+    }
+}
+
+void CryptoBenchmark::print() const {
+    Serial.printf("%s Backend %s, %u iterations, %u-byte messages (AEAD: %u bytes):\n", TAG,
+                  _backend.name(), _iterations, (unsigned)MESSAGE_SIZE,
+                  (unsigned)AEAD_MESSAGE_SIZE);
+    for (uint8_t op = 0; op < OP_COUNT; ++op) {
+        Serial.printf("%s   %-16s %10u cycles/op\n", TAG, opName((Op)op), _cycles[op]);
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef CRYPTO_BENCHMARK_H
+#define CRYPTO_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "icrypto_backend.h"
+
+/**
+ * @class CryptoBenchmark
+ * @brief Measures the cost of each operation of a crypto backend, in cycles per operation.
+ *
+ * The operations run on throwaway keys and on messages of the sizes the beacon actually
+ * processes, so the figures compare the backends on the real workload. The two AEAD suites run
+ * on the largest inner plaintext of an encrypted message (MAX_INNER_PLAINTEXT_SIZE), the cost
+ * that decides which suite to negotiate. AES-256-GCM is reported as 0 when the backend does not
+ * offer it. The counts
+ * come from `ICryptoBackend::cycleCount` (CPU cycles on the ESP32, nanoseconds on the host).
+ *
+ * Built with `-DPOLARIS_CRYPTO_BENCHMARK`, the firmware runs it once at boot.
+ */
+class CryptoBenchmark {
+public:
+    /// @brief The measured operations.
+    enum Op : uint8_t {
+        SHA512,
+        HMAC,
+        BLAKE2B,
+        KDF,
+        SIGN,
+        VERIFY,
+        X25519,
+        CHACHA_ENCRYPT,
+        CHACHA_DECRYPT,
+        GCM_ENCRYPT,
+        GCM_DECRYPT,
+        OP_COUNT
+    };
+
+    /// @brief The message length hashed, MACed and signed.
+    static constexpr size_t MESSAGE_SIZE = 128;
+
+    /// @brief The message length encrypted.
+    static constexpr size_t AEAD_MESSAGE_SIZE = MAX_INNER_PLAINTEXT_SIZE;
+
+    /**
+     * @brief Creates a benchmark.
+     * @param backend The backend to measure.
+     * @param iterations The number of runs of each operation, averaged.
+     */
+    explicit CryptoBenchmark(const ICryptoBackend& backend, uint32_t iterations = 32);
+
+    /**
+     * @brief Runs every operation.
+     * @return False if an operation failed, its result is then 0.
+     */
+    bool run();
+
+    /** @brief Gets the average cycles per operation of the last run. */
+    uint32_t cyclesPerOp(Op op) const;
+
+    /** @brief Gets the name of an operation. */
+    static const char* opName(Op op);
+
+    /** @brief Prints the results of the last run on the serial port. */
+    void print() const;
+
+private:
+    /** @brief Runs one operation `_iterations` times and stores its average. */
+    template <typename F>
+    bool measure(Op op, F operation);
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[CryptoBench]";
+
+    /// @brief The measured backend.
+    const ICryptoBackend& _backend;
+
+    /// @brief The number of runs of each operation.
+    uint32_t _iterations;
+
+    /// @brief The average cycles per operation, indexed by Op.
+    uint32_t _cycles[OP_COUNT] = {};
+};
+
+#endif  // CRYPTO_BENCHMARK_H
@@ -0,0 +1,82 @@
+#include "esp32_hw_crypto_backend.h"
+
+#if POLARIS_CRYPTO_BACKEND_HW
+
+#include <mbedtls/gcm.h>
+#include <mbedtls/md.h>
+#include <sodium.h>
+
+const char* Esp32HwCryptoBackend::name() const {
+    return "esp32-hw";
+}
+
+void Esp32HwCryptoBackend::sha512(uint8_t out[SHA512_SIZE], const uint8_t* in, size_t len) const {
+    if (mbedtls_md(mbedtls_md_info_from_type(MBEDTLS_MD_SHA512), in, len, out) != 0) {
+        SodiumCryptoBackend::sha512(out, in, len);
+    }
+}
+
+void Esp32HwCryptoBackend::hmacSha512256(uint8_t out[HMAC_SHA512_256_SIZE], const uint8_t* in,
+                                         size_t len,
+                                         const uint8_t key[HMAC_SHA512_256_SIZE]) const {
+    // HMAC-SHA-512-256 is HMAC-SHA-512 truncated to 32 bytes, as crypto_auth
+    uint8_t full[SHA512_SIZE];
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA512), key, HMAC_SHA512_256_SIZE,
+                        in, len, full) != 0) {
+        SodiumCryptoBackend::hmacSha512256(out, in, len, key);
+        return;
+    }
+    memcpy(out, full, HMAC_SHA512_256_SIZE);
+    sodium_memzero(full, sizeof(full));
+}
+
+bool Esp32HwCryptoBackend::verifyHmacSha512256(const uint8_t tag[HMAC_SHA512_256_SIZE],
+                                               const uint8_t* in, size_t len,
+                                               const uint8_t key[HMAC_SHA512_256_SIZE]) const {
+    uint8_t expected[HMAC_SHA512_256_SIZE];
+    hmacSha512256(expected, in, len, key);
+    bool ok = sodium_memcmp(expected, tag, sizeof(expected)) == 0;
+    sodium_memzero(expected, sizeof(expected));
+    return ok;
+}
+
+bool Esp32HwCryptoBackend::hasAesGcm() const {
+    return true;
+}
+
+bool Esp32HwCryptoBackend::aesGcmEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt,
+                                         size_t ptLen, const uint8_t* ad, size_t adLen,
+                                         const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                         const uint8_t key[SHARED_KEY_SIZE]) const {
+    mbedtls_gcm_context ctx;
+    mbedtls_gcm_init(&ctx);
+    bool ok = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, SHARED_KEY_SIZE * 8) == 0 &&
+              mbedtls_gcm_crypt_and_tag(&ctx, MBEDTLS_GCM_ENCRYPT, ptLen, nonce,
+                                        POL_AEAD_NONCE_SIZE, ad, adLen, pt, ctOut,
+                                        POL_AEAD_TAG_SIZE, ctOut + ptLen) == 0;
+    mbedtls_gcm_free(&ctx);
+    ctLenOut = ok ? ptLen + POL_AEAD_TAG_SIZE : 0;
+    return ok;
+}
+
+bool Esp32HwCryptoBackend::aesGcmDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct,
+                                         size_t ctLen, const uint8_t* ad, size_t adLen,
+                                         const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                         const uint8_t key[SHARED_KEY_SIZE]) const {
+    ptLenOut = 0;
+    if (ctLen < POL_AEAD_TAG_SIZE) {
+        return false;
+    }
+    size_t ptLen = ctLen - POL_AEAD_TAG_SIZE;
+    mbedtls_gcm_context ctx;
+    mbedtls_gcm_init(&ctx);
+    // Checks the tag in constant time, and clears the output if it does not match
+    bool ok = mbedtls_gcm_setkey(&ctx, MBEDTLS_CIPHER_ID_AES, key, SHARED_KEY_SIZE * 8) == 0 &&
+              mbedtls_gcm_auth_decrypt(&ctx, ptLen, nonce, POL_AEAD_NONCE_SIZE, ad, adLen,
+                                       ct + ptLen, POL_AEAD_TAG_SIZE, ct, ptOut) == 0;
+    mbedtls_gcm_free(&ctx);
+    ptLenOut = ok ? ptLen : 0;
+    return ok;
+}
+
+#endif  // POLARIS_CRYPTO_BACKEND_HW
@@ -0,0 +1,45 @@
+#ifndef ESP32_HW_CRYPTO_BACKEND_H
+#define ESP32_HW_CRYPTO_BACKEND_H
+
+#include "crypto_backend_config.h"
+
+#if POLARIS_CRYPTO_BACKEND_HW
+
+#include "sodium_crypto_backend.h"
+
+/**
+ * @class Esp32HwCryptoBackend
+ * @brief ICryptoBackend implementation routing SHA-512 and AES to the ESP32-S3 accelerators.
+ *
+ * `sha512` and the HMAC-SHA-512-256 of the session tokens call the mbedTLS message digest API,
+ * which the Arduino core builds on the hardware accelerator. The Ed25519 signature and
+ * verification stay on libsodium: the libsodium component of ESP-IDF already routes its internal
+ * SHA-512 to mbedTLS (CONFIG_LIBSODIUM_USE_MBEDTLS_SHA, on by default), so they hash on the
+ * accelerator too.
+ *
+ * AES-256-GCM runs on the AES accelerator through the mbedTLS GCM API, so the encrypted channel
+ * can negotiate it with the server.
+ *
+ * Everything else (BLAKE2b, X25519, ChaCha20-Poly1305) has no accelerator and is inherited. The
+ * benchmark tells what the accelerator actually buys per operation.
+ */
+class Esp32HwCryptoBackend : public SodiumCryptoBackend {
+public:
+    const char* name() const override;
+    void sha512(uint8_t out[SHA512_SIZE], const uint8_t* in, size_t len) const override;
+    void hmacSha512256(uint8_t out[HMAC_SHA512_256_SIZE], const uint8_t* in, size_t len,
+                       const uint8_t key[HMAC_SHA512_256_SIZE]) const override;
+    bool verifyHmacSha512256(const uint8_t tag[HMAC_SHA512_256_SIZE], const uint8_t* in,
+                             size_t len, const uint8_t key[HMAC_SHA512_256_SIZE]) const override;
+    bool hasAesGcm() const override;
+    bool aesGcmEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt, size_t ptLen,
+                       const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                       const uint8_t key[SHARED_KEY_SIZE]) const override;
+    bool aesGcmDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct, size_t ctLen,
+                       const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                       const uint8_t key[SHARED_KEY_SIZE]) const override;
+};
+
+#endif  // POLARIS_CRYPTO_BACKEND_HW
+
+#endif  // ESP32_HW_CRYPTO_BACKEND_H
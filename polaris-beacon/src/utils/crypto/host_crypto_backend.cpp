@@ -0,0 +1,26 @@
+#include "host_crypto_backend.h"
+
+#if POLARIS_CRYPTO_BACKEND_HOST
+
+#include <sodium.h>
+#include <string.h>
+
+HostCryptoBackend::HostCryptoBackend() {
+    memset(_seed, 0, sizeof(_seed));
+}
+
+void HostCryptoBackend::seed(const uint8_t seed[SEED_SIZE]) {
+    memcpy(_seed, seed, sizeof(_seed));
+}
+
+const char* HostCryptoBackend::name() const {
+    return "host";
+}
+
+void HostCryptoBackend::randomBytes(uint8_t* out, size_t len) const {
+    randombytes_buf_deterministic(out, len, _seed);
+    // Next seed: the hash of the current one, so two calls never return the same bytes
+    crypto_generichash(_seed, sizeof(_seed), _seed, sizeof(_seed), nullptr, 0);
+}
+
+#endif  // POLARIS_CRYPTO_BACKEND_HOST
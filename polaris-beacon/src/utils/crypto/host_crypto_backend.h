@@ -0,0 +1,43 @@
+#ifndef HOST_CRYPTO_BACKEND_H
+#define HOST_CRYPTO_BACKEND_H
+
+#include "crypto_backend_config.h"
+
+#if POLARIS_CRYPTO_BACKEND_HOST
+
+#include "sodium_crypto_backend.h"
+
+/**
+ * @class HostCryptoBackend
+ * @brief ICryptoBackend implementation for the Linux builds of the beacon code.
+ *
+ * libsodium, like on the beacon, but the random bytes come from a seedable deterministic
+ * generator, so that the keys, nonces and signatures of a run can be reproduced. The cycle count
+ * is in nanoseconds.
+ *
+ * The generator state is not guarded: a host build drives the backend from a single thread.
+ * It must never be used to generate real keys. No target builds it yet, see
+ * `crypto_backend_config.h`.
+ */
+class HostCryptoBackend : public SodiumCryptoBackend {
+public:
+    /// @brief Size of the generator seed.
+    static constexpr size_t SEED_SIZE = 32;
+
+    /** @brief Creates a backend seeded with zeros. */
+    HostCryptoBackend();
+
+    /** @brief Restarts the random sequence from a seed. */
+    void seed(const uint8_t seed[SEED_SIZE]);
+
+    const char* name() const override;
+    void randomBytes(uint8_t* out, size_t len) const override;
+
+private:
+    /// @brief The generator state, advanced by each call to randomBytes.
+    mutable uint8_t _seed[SEED_SIZE];
+};
+
+#endif  // POLARIS_CRYPTO_BACKEND_HOST
+
+#endif  // HOST_CRYPTO_BACKEND_H
@@ -0,0 +1,156 @@
+#ifndef ICRYPTO_BACKEND_H
+#define ICRYPTO_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol/pol_constants.h"
+
+/// @brief Size of a SHA-512 digest.
+constexpr size_t SHA512_SIZE = 64;
+
+/// @brief Size of an HMAC-SHA-512-256 tag and key.
+constexpr size_t HMAC_SHA512_256_SIZE = 32;
+
+/**
+ * @interface ICryptoBackend
+ * @brief The cryptographic primitives used by the CryptoService and the KeyManager.
+ *
+ * Every backend produces the same bytes for the same inputs (same algorithms, same encodings as
+ * libsodium), so that the peers never see which one a beacon was built with. Only the speed and
+ * the source of random bytes differ. AES-256-GCM is the exception: a backend only offers it when
+ * it can run it efficiently (see `hasAesGcm`), and the encrypted channel then negotiates it. The
+ * backend is selected at compile time, see `crypto_backend_config.h`.
+ *
+ * All the methods are const and may be called from several tasks at once.
+ */
+class ICryptoBackend {
+public:
+    virtual ~ICryptoBackend() = default;
+
+    /** @brief Returns the name of the backend, for the logs and the benchmark. */
+    virtual const char* name() const = 0;
+
+    /**
+     * @brief Returns a free-running cycle counter, used by the benchmark.
+     *
+     * CPU cycles on the ESP32 (wraps in about 18 s at 240 MHz), nanoseconds on the host.
+     */
+    virtual uint32_t cycleCount() const = 0;
+
+    // ---------- Random ----------
+
+    /** @brief Fills a buffer with random bytes. */
+    virtual void randomBytes(uint8_t* out, size_t len) const = 0;
+
+    // ---------- Hashing ----------
+
+    /**
+     * @brief Computes a BLAKE2b hash (crypto_generichash).
+     * @param out Receives the hash.
+     * @param outLen The hash length (16 to 64).
+     * @param in The message.
+     * @param inLen The message length.
+     * @param key The key, or nullptr for an unkeyed hash.
+     * @param keyLen The key length (0, or 16 to 64).
+     */
+    virtual void hash(uint8_t* out, size_t outLen, const uint8_t* in, size_t inLen,
+                      const uint8_t* key, size_t keyLen) const = 0;
+
+    /** @brief Computes the SHA-512 digest of a message. */
+    virtual void sha512(uint8_t out[SHA512_SIZE], const uint8_t* in, size_t len) const = 0;
+
+    /** @brief Computes an HMAC-SHA-512-256 tag (crypto_auth). */
+    virtual void hmacSha512256(uint8_t out[HMAC_SHA512_256_SIZE], const uint8_t* in, size_t len,
+                               const uint8_t key[HMAC_SHA512_256_SIZE]) const = 0;
+
+    /** @brief Verifies an HMAC-SHA-512-256 tag, in constant time. */
+    virtual bool verifyHmacSha512256(const uint8_t tag[HMAC_SHA512_256_SIZE], const uint8_t* in,
+                                     size_t len,
+                                     const uint8_t key[HMAC_SHA512_256_SIZE]) const = 0;
+
+    /**
+     * @brief Derives a subkey from a master key (crypto_kdf, BLAKE2b).
+     * @param context An 8-character context.
+     */
+    virtual void deriveKey(uint8_t* subkeyOut, size_t subkeyLen, uint64_t subkeyId,
+                           const char* context, const uint8_t masterKey[SHARED_KEY_SIZE]) const = 0;
+
+    // ---------- Signing ----------
+
+    /** @brief Generates an Ed25519 key pair (64-byte secret key: seed || public key). */
+    virtual bool generateEd25519KeyPair(uint8_t pkOut[Ed25519_PK_SIZE],
+                                        uint8_t skOut[Ed25519_SK_SIZE]) const = 0;
+
+    /** @brief Computes a deterministic Ed25519 detached signature. */
+    virtual bool signEd25519(uint8_t sigOut[SIG_SIZE], const uint8_t* msg, size_t len,
+                             const uint8_t sk[Ed25519_SK_SIZE]) const = 0;
+
+    /** @brief Verifies an Ed25519 detached signature. */
+    virtual bool verifyEd25519(const uint8_t sig[SIG_SIZE], const uint8_t* msg, size_t len,
+                               const uint8_t pk[Ed25519_PK_SIZE]) const = 0;
+
+    /** @brief Converts an Ed25519 public key to an X25519 public key. */
+    virtual bool ed25519PkToX25519(uint8_t x25519PkOut[X25519_PK_SIZE],
+                                   const uint8_t ed25519Pk[Ed25519_PK_SIZE]) const = 0;
+
+    /** @brief Converts an Ed25519 secret key to an X25519 secret key. */
+    virtual bool ed25519SkToX25519(uint8_t x25519SkOut[X25519_SK_SIZE],
+                                   const uint8_t ed25519Sk[Ed25519_SK_SIZE]) const = 0;
+
+    // ---------- X25519 ----------
+
+    /** @brief Computes the X25519 public key of a secret key. */
+    virtual bool x25519Base(uint8_t pkOut[X25519_PK_SIZE],
+                            const uint8_t sk[X25519_SK_SIZE]) const = 0;
+
+    /**
+     * @brief Computes an X25519 shared secret.
+     * @return False for a low-order public key.
+     */
+    virtual bool x25519(uint8_t sharedOut[SHARED_KEY_SIZE], const uint8_t sk[X25519_SK_SIZE],
+                        const uint8_t pk[X25519_PK_SIZE]) const = 0;
+
+    // ---------- AEAD ----------
+
+    /**
+     * @brief Encrypts with ChaCha20-Poly1305 (IETF).
+     * @param ctOut Receives the ciphertext followed by the tag (ptLen + POL_AEAD_TAG_SIZE bytes).
+     */
+    virtual bool aeadEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt, size_t ptLen,
+                             const uint8_t* ad, size_t adLen,
+                             const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                             const uint8_t key[SHARED_KEY_SIZE]) const = 0;
+
+    /**
+     * @brief Decrypts and verifies a ChaCha20-Poly1305 (IETF) ciphertext.
+     * @return False if the tag does not match.
+     */
+    virtual bool aeadDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct, size_t ctLen,
+                             const uint8_t* ad, size_t adLen,
+                             const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                             const uint8_t key[SHARED_KEY_SIZE]) const = 0;
+
+    /** @brief Checks whether `aesGcmEncrypt` and `aesGcmDecrypt` are available. */
+    virtual bool hasAesGcm() const = 0;
+
+    /**
+     * @brief Encrypts with AES-256-GCM, same layout as `aeadEncrypt` (ciphertext then tag).
+     * @return False if AES-256-GCM is not available.
+     */
+    virtual bool aesGcmEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt, size_t ptLen,
+                               const uint8_t* ad, size_t adLen,
+                               const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                               const uint8_t key[SHARED_KEY_SIZE]) const = 0;
+
+    /**
+     * @brief Decrypts and verifies an AES-256-GCM ciphertext.
+     * @return False if the tag does not match or if AES-256-GCM is not available.
+     */
+    virtual bool aesGcmDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct, size_t ctLen,
+                               const uint8_t* ad, size_t adLen,
+                               const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                               const uint8_t key[SHARED_KEY_SIZE]) const = 0;
+};
+
+#endif  // ICRYPTO_BACKEND_H
@@ -0,0 +1,150 @@
+#include "sodium_crypto_backend.h"
+
+#include <sodium.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#endif
+
+const char* SodiumCryptoBackend::name() const {
+    return "libsodium";
+}
+
+uint32_t SodiumCryptoBackend::cycleCount() const {
+#if defined(ARDUINO)
+    return ESP.getCycleCount();
+#else
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+void SodiumCryptoBackend::randomBytes(uint8_t* out, size_t len) const {
+    randombytes_buf(out, len);
+}
+
+void SodiumCryptoBackend::hash(uint8_t* out, size_t outLen, const uint8_t* in, size_t inLen,
+                               const uint8_t* key, size_t keyLen) const {
+    crypto_generichash(out, outLen, in, inLen, key, keyLen);
+}
+
+void SodiumCryptoBackend::sha512(uint8_t out[SHA512_SIZE], const uint8_t* in, size_t len) const {
+    crypto_hash_sha512(out, in, len);
+}
+
+void SodiumCryptoBackend::hmacSha512256(uint8_t out[HMAC_SHA512_256_SIZE], const uint8_t* in,
+                                        size_t len, const uint8_t key[HMAC_SHA512_256_SIZE]) const {
+    crypto_auth(out, in, len, key);
+}
+
+bool SodiumCryptoBackend::verifyHmacSha512256(const uint8_t tag[HMAC_SHA512_256_SIZE],
+                                              const uint8_t* in, size_t len,
+                                              const uint8_t key[HMAC_SHA512_256_SIZE]) const {
+    return crypto_auth_verify(tag, in, len, key) == 0;
+}
+
+void SodiumCryptoBackend::deriveKey(uint8_t* subkeyOut, size_t subkeyLen, uint64_t subkeyId,
+                                    const char* context,
+                                    const uint8_t masterKey[SHARED_KEY_SIZE]) const {
+    crypto_kdf_derive_from_key(subkeyOut, subkeyLen, subkeyId, context, masterKey);
+}
+
+bool SodiumCryptoBackend::generateEd25519KeyPair(uint8_t pkOut[Ed25519_PK_SIZE],
+                                                 uint8_t skOut[Ed25519_SK_SIZE]) const {
+    // Same as crypto_sign_ed25519_keypair, but the seed comes from randomBytes()
+    uint8_t seed[crypto_sign_ed25519_SEEDBYTES];
+    randomBytes(seed, sizeof(seed));
+    bool ok = crypto_sign_ed25519_seed_keypair(pkOut, skOut, seed) == 0;
+    sodium_memzero(seed, sizeof(seed));
+    return ok;
+}
+
+bool SodiumCryptoBackend::signEd25519(uint8_t sigOut[SIG_SIZE], const uint8_t* msg, size_t len,
+                                      const uint8_t sk[Ed25519_SK_SIZE]) const {
+    return crypto_sign_ed25519_detached(sigOut, nullptr, msg, len, sk) == 0;
+}
+
+bool SodiumCryptoBackend::verifyEd25519(const uint8_t sig[SIG_SIZE], const uint8_t* msg,
+                                        size_t len, const uint8_t pk[Ed25519_PK_SIZE]) const {
+    return crypto_sign_ed25519_verify_detached(sig, msg, len, pk) == 0;
+}
+
+bool SodiumCryptoBackend::ed25519PkToX25519(uint8_t x25519PkOut[X25519_PK_SIZE],
+                                            const uint8_t ed25519Pk[Ed25519_PK_SIZE]) const {
+    return crypto_sign_ed25519_pk_to_curve25519(x25519PkOut, ed25519Pk) == 0;
+}
+
+bool SodiumCryptoBackend::ed25519SkToX25519(uint8_t x25519SkOut[X25519_SK_SIZE],
+                                            const uint8_t ed25519Sk[Ed25519_SK_SIZE]) const {
+    return crypto_sign_ed25519_sk_to_curve25519(x25519SkOut, ed25519Sk) == 0;
+}
+
+bool SodiumCryptoBackend::x25519Base(uint8_t pkOut[X25519_PK_SIZE],
+                                     const uint8_t sk[X25519_SK_SIZE]) const {
+    return crypto_scalarmult_curve25519_base(pkOut, sk) == 0;
+}
+
+bool SodiumCryptoBackend::x25519(uint8_t sharedOut[SHARED_KEY_SIZE],
+                                 const uint8_t sk[X25519_SK_SIZE],
+                                 const uint8_t pk[X25519_PK_SIZE]) const {
+    return crypto_scalarmult_curve25519(sharedOut, sk, pk) == 0;
+}
+
+bool SodiumCryptoBackend::aeadEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt,
+                                      size_t ptLen, const uint8_t* ad, size_t adLen,
+                                      const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                      const uint8_t key[SHARED_KEY_SIZE]) const {
+    unsigned long long ctLen = 0;
+    int res = crypto_aead_chacha20poly1305_ietf_encrypt(ctOut, &ctLen, pt, ptLen, ad, adLen,
+                                                        nullptr, nonce, key);
+    ctLenOut = res == 0 ? (size_t)ctLen : 0;
+    return res == 0;
+}
+
+bool SodiumCryptoBackend::aeadDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct,
+                                      size_t ctLen, const uint8_t* ad, size_t adLen,
+                                      const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                      const uint8_t key[SHARED_KEY_SIZE]) const {
+    unsigned long long ptLen = 0;
+    int res = crypto_aead_chacha20poly1305_ietf_decrypt(ptOut, &ptLen, nullptr, ct, ctLen, ad,
+                                                        adLen, nonce, key);
+    ptLenOut = res == 0 ? (size_t)ptLen : 0;
+    return res == 0;
+}
+
+bool SodiumCryptoBackend::hasAesGcm() const {
+    return crypto_aead_aes256gcm_is_available() == 1;
+}
+
+bool SodiumCryptoBackend::aesGcmEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt,
+                                        size_t ptLen, const uint8_t* ad, size_t adLen,
+                                        const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                        const uint8_t key[SHARED_KEY_SIZE]) const {
+    ctLenOut = 0;
+    if (!hasAesGcm()) {
+        return false;
+    }
+    unsigned long long ctLen = 0;
+    int res = crypto_aead_aes256gcm_encrypt(ctOut, &ctLen, pt, ptLen, ad, adLen, nullptr, nonce,
+                                            key);
+    ctLenOut = res == 0 ? (size_t)ctLen : 0;
+    return res == 0;
+}
+
+bool SodiumCryptoBackend::aesGcmDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct,
+                                        size_t ctLen, const uint8_t* ad, size_t adLen,
+                                        const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                                        const uint8_t key[SHARED_KEY_SIZE]) const {
+    ptLenOut = 0;
+    if (!hasAesGcm()) {
+        return false;
+    }
+    unsigned long long ptLen = 0;
+    int res = crypto_aead_aes256gcm_decrypt(ptOut, &ptLen, nullptr, ct, ctLen, ad, adLen, nonce,
+                                            key);
+    ptLenOut = res == 0 ? (size_t)ptLen : 0;
+    return res == 0;
+}
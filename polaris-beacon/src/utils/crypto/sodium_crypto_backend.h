@@ -0,0 +1,59 @@
+#ifndef SODIUM_CRYPTO_BACKEND_H
+#define SODIUM_CRYPTO_BACKEND_H
+
+#include "icrypto_backend.h"
+
+/**
+ * @class SodiumCryptoBackend
+ * @brief ICryptoBackend implementation on libsodium only, in software.
+ *
+ * The default backend. It is also the base of the other backends, which only override the
+ * operations they do differently.
+ *
+ * libsodium only implements AES-256-GCM with the AES instructions of x86 and ARMv8 CPUs, so it
+ * is unavailable on the ESP32 (the channel stays on ChaCha20-Poly1305) and usually available on
+ * a host.
+ */
+class SodiumCryptoBackend : public ICryptoBackend {
+public:
+    const char* name() const override;
+    uint32_t cycleCount() const override;
+    void randomBytes(uint8_t* out, size_t len) const override;
+    void hash(uint8_t* out, size_t outLen, const uint8_t* in, size_t inLen, const uint8_t* key,
+              size_t keyLen) const override;
+    void sha512(uint8_t out[SHA512_SIZE], const uint8_t* in, size_t len) const override;
+    void hmacSha512256(uint8_t out[HMAC_SHA512_256_SIZE], const uint8_t* in, size_t len,
+                       const uint8_t key[HMAC_SHA512_256_SIZE]) const override;
+    bool verifyHmacSha512256(const uint8_t tag[HMAC_SHA512_256_SIZE], const uint8_t* in,
+                             size_t len, const uint8_t key[HMAC_SHA512_256_SIZE]) const override;
+    void deriveKey(uint8_t* subkeyOut, size_t subkeyLen, uint64_t subkeyId, const char* context,
+                   const uint8_t masterKey[SHARED_KEY_SIZE]) const override;
+    bool generateEd25519KeyPair(uint8_t pkOut[Ed25519_PK_SIZE],
+                                uint8_t skOut[Ed25519_SK_SIZE]) const override;
+    bool signEd25519(uint8_t sigOut[SIG_SIZE], const uint8_t* msg, size_t len,
+                     const uint8_t sk[Ed25519_SK_SIZE]) const override;
+    bool verifyEd25519(const uint8_t sig[SIG_SIZE], const uint8_t* msg, size_t len,
+                       const uint8_t pk[Ed25519_PK_SIZE]) const override;
+    bool ed25519PkToX25519(uint8_t x25519PkOut[X25519_PK_SIZE],
+                           const uint8_t ed25519Pk[Ed25519_PK_SIZE]) const override;
+    bool ed25519SkToX25519(uint8_t x25519SkOut[X25519_SK_SIZE],
+                           const uint8_t ed25519Sk[Ed25519_SK_SIZE]) const override;
+    bool x25519Base(uint8_t pkOut[X25519_PK_SIZE], const uint8_t sk[X25519_SK_SIZE]) const override;
+    bool x25519(uint8_t sharedOut[SHARED_KEY_SIZE], const uint8_t sk[X25519_SK_SIZE],
+                const uint8_t pk[X25519_PK_SIZE]) const override;
+    bool aeadEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt, size_t ptLen,
+                     const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                     const uint8_t key[SHARED_KEY_SIZE]) const override;
+    bool aeadDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct, size_t ctLen,
+                     const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                     const uint8_t key[SHARED_KEY_SIZE]) const override;
+    bool hasAesGcm() const override;
+    bool aesGcmEncrypt(uint8_t* ctOut, size_t& ctLenOut, const uint8_t* pt, size_t ptLen,
+                       const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                       const uint8_t key[SHARED_KEY_SIZE]) const override;
+    bool aesGcmDecrypt(uint8_t* ptOut, size_t& ptLenOut, const uint8_t* ct, size_t ctLen,
+                       const uint8_t* ad, size_t adLen, const uint8_t nonce[POL_AEAD_NONCE_SIZE],
+                       const uint8_t key[SHARED_KEY_SIZE]) const override;
+};
+
+#endif  // SODIUM_CRYPTO_BACKEND_H
@@ -4,7 +4,12 @@
 #include <sodium.h>
 #include <string.h>
 
-CryptoService::CryptoService(const KeyManager& keyManager) : _keyManager(keyManager) {
+CryptoService::CryptoService(const ICryptoBackend& backend, const KeyManager& keyManager,
+                             AeadSequence& sequence)
+    : _backend(backend),
+      _sequence(sequence),
+      _keyManager(keyManager),
+      _serverAeadSuites(1 << (POL_AEAD_SUITES_SHIFT + POL_AEAD_SUITE_CHACHA20_POLY1305)) {
 }
 
 bool CryptoService::verifyPoLRequestSignature(const PoLRequest& req) const {
@@ -16,8 +21,77 @@ bool CryptoService::verifyPoLRequestSignature(const PoLRequest& req) const {
     uint8_t signedData[PoLRequest::SIGNED_SIZE];
     req.getSignedData(signedData);
 
-    return crypto_sign_ed25519_verify_detached(req.phoneSig, signedData, PoLRequest::SIGNED_SIZE,
-                                               req.phonePk) == 0;
+    return _backend.verifyEd25519(req.phoneSig, signedData, PoLRequest::SIGNED_SIZE, req.phonePk);
+}
+
+namespace {
+/// @brief The distinct signatures of a batch, verified by the worker pool.
+struct VerifyJob {
+    const CryptoService* crypto;
+    const PoLRequest* const* reqs;
+    bool* validOut;
+    size_t unique[CryptoService::MAX_BATCH_SIZE];
+};
+
+void runVerifyJob(void* context, size_t index) {
+    VerifyJob& job = *static_cast<VerifyJob*>(context);
+    size_t i = job.unique[index];
+    job.validOut[i] = job.crypto->verifyPoLRequestSignature(*job.reqs[i]);
+}
+}  // namespace
+
+bool CryptoService::verifyDistinctPoLRequestSignatures(const PoLRequest* const reqs[],
+                                                       size_t count, bool validOut[],
+                                                       CryptoWorkerPool* pool) const {
+    // libsodium exposes neither a batch verification nor a multi-scalar multiplication, and
+    // building the batch equation on its encoded point API costs more than verifying each
+    // signature. The set is therefore checked signature by signature, skipping duplicates.
+    if (count > MAX_BATCH_SIZE) {
+        Serial.printf("%s Error: batch of %zu requests too large.\n", TAG, count);
+        return false;
+    }
+
+    size_t duplicateOf[MAX_BATCH_SIZE];
+    VerifyJob job = {this, reqs, validOut, {}};
+    size_t uniqueCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        duplicateOf[i] = i;
+        for (size_t j = 0; j < i; ++j) {
+            if (duplicateOf[j] == j &&
+                memcmp(reqs[j]->phoneSig, reqs[i]->phoneSig, SIG_SIZE) == 0 &&
+                memcmp(reqs[j]->phonePk, reqs[i]->phonePk, Ed25519_PK_SIZE) == 0) {
+                duplicateOf[i] = j;
+                break;
+            }
+        }
+        if (duplicateOf[i] == i) {
+            job.unique[uniqueCount++] = i;
+        }
+    }
+
+    // The distinct signatures are independent, they can be verified on both cores.
+    if (pool) {
+        pool->run(runVerifyJob, &job, uniqueCount);
+    } else {
+        for (size_t u = 0; u < uniqueCount; ++u) {
+            runVerifyJob(&job, u);
+        }
+    }
+
+    bool allValid = true;
+    for (size_t i = 0; i < count; ++i) {
+        size_t first = duplicateOf[i];
+        if (first != i) {
+            // Same key and signature: valid only if the signed fields are identical too.
+            uint8_t a[PoLRequest::SIGNED_SIZE];
+            uint8_t b[PoLRequest::SIGNED_SIZE];
+            reqs[first]->getSignedData(a);
+            reqs[i]->getSignedData(b);
+            validOut[i] = validOut[first] && memcmp(a, b, sizeof(a)) == 0;
+        }
+        allValid = allValid && validOut[i];
+    }
+    return allValid;
 }
 
 bool CryptoService::signPoLResponse(PoLResponse& resp, const PoLRequest& originalReq) const {
@@ -31,10 +105,8 @@ bool CryptoService::signPoLResponse(PoLResponse& resp, const PoLRequest& origina
         bufferToSign[PoLResponse::SIGNED_SIZE];  // Buffer for the data that will actually be signed
     resp.getSignedData(bufferToSign,
                        originalReq);  // Pass originalReq to construct the full signed data
-    unsigned long long signatureLengthOut;
 
-    if (crypto_sign_ed25519_detached(resp.beaconSig, &signatureLengthOut, bufferToSign,
-                                     PoLResponse::SIGNED_SIZE, beaconSk) != 0) {
+    if (!_backend.signEd25519(resp.beaconSig, bufferToSign, PoLResponse::SIGNED_SIZE, beaconSk)) {
         Serial.printf("%s Error: signing PoLResponse failed.\n", TAG);
         memset(resp.beaconSig, 0, SIG_SIZE);
         return false;
@@ -42,6 +114,28 @@ bool CryptoService::signPoLResponse(PoLResponse& resp, const PoLRequest& origina
     return true;
 }
 
+bool CryptoService::signMerkleRoot(uint8_t signatureOut[SIG_SIZE],
+                                   const uint8_t root[MERKLE_HASH_SIZE]) const {
+    static constexpr char CONTEXT[] = "polaris-merkle";
+
+    const uint8_t* beaconSk = _keyManager.getEd25519Sk();
+    if (!beaconSk) {
+        Serial.printf("%s Error: Beacon Ed25519 SK not available for signing Merkle root.\n", TAG);
+        return false;
+    }
+
+    uint8_t signedData[sizeof(CONTEXT) - 1 + MERKLE_HASH_SIZE];
+    memcpy(signedData, CONTEXT, sizeof(CONTEXT) - 1);
+    memcpy(signedData + sizeof(CONTEXT) - 1, root, MERKLE_HASH_SIZE);
+
+    if (!_backend.signEd25519(signatureOut, signedData, sizeof(signedData), beaconSk)) {
+        Serial.printf("%s Error: signing Merkle root failed.\n", TAG);
+        memset(signatureOut, 0, SIG_SIZE);
+        return false;
+    }
+    return true;
+}
+
 bool CryptoService::signBeaconBroadcast(uint8_t signatureOut[SIG_SIZE], uint32_t beaconId,
                                         uint64_t counter) const {
     const uint8_t* beaconSk = _keyManager.getEd25519Sk();
@@ -57,9 +151,7 @@ bool CryptoService::signBeaconBroadcast(uint8_t signatureOut[SIG_SIZE], uint32_t
     offset += sizeof(beaconId);
     memcpy(signedDataBuffer + offset, &counter, sizeof(counter));
 
-    unsigned long long signatureLengthOut;
-    if (crypto_sign_ed25519_detached(signatureOut, &signatureLengthOut, signedDataBuffer,
-                                     signedDataLen, beaconSk) != 0) {
+    if (!_backend.signEd25519(signatureOut, signedDataBuffer, signedDataLen, beaconSk)) {
         Serial.printf("%s Error: signing beacon broadcast failed.\n", TAG);
         memset(signatureOut, 0, SIG_SIZE);
         return false;
@@ -67,55 +159,198 @@ bool CryptoService::signBeaconBroadcast(uint8_t signatureOut[SIG_SIZE], uint32_t
     return true;
 }
 
+bool CryptoService::signChainAnchor(uint8_t signatureOut[SIG_SIZE], uint32_t beaconId,
+                                    uint64_t counter, const uint8_t anchor[TESLA_KEY_SIZE]) const {
+    static constexpr char CONTEXT[] = "polaris-tesla";
+
+    const uint8_t* beaconSk = _keyManager.getEd25519Sk();
+    if (!beaconSk) {
+        Serial.printf("%s Error: Beacon Ed25519 SK not available for chain anchor signing.\n", TAG);
+        return false;
+    }
+
+    uint8_t signedData[sizeof(CONTEXT) - 1 + sizeof(beaconId) + sizeof(counter) + TESLA_KEY_SIZE];
+    size_t offset = 0;
+    memcpy(signedData + offset, CONTEXT, sizeof(CONTEXT) - 1);
+    offset += sizeof(CONTEXT) - 1;
+    memcpy(signedData + offset, &beaconId, sizeof(beaconId));
+    offset += sizeof(beaconId);
+    memcpy(signedData + offset, &counter, sizeof(counter));
+    offset += sizeof(counter);
+    memcpy(signedData + offset, anchor, TESLA_KEY_SIZE);
+
+    if (!_backend.signEd25519(signatureOut, signedData, sizeof(signedData), beaconSk)) {
+        Serial.printf("%s Error: signing chain anchor failed.\n", TAG);
+        memset(signatureOut, 0, SIG_SIZE);
+        return false;
+    }
+    return true;
+}
+
+bool CryptoService::deriveSessionKey(uint8_t keyOut[SESSION_KEY_SIZE],
+                                     const uint8_t phonePk[Ed25519_PK_SIZE],
+                                     const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                                     uint64_t counter) const {
+    static constexpr char CONTEXT[] = "polaris-session";
+
+    const uint8_t* beaconSk = _keyManager.getEd25519Sk();
+    const uint8_t* beaconPk = _keyManager.getEd25519Pk();
+    if (!beaconSk || !beaconPk) {
+        Serial.printf("%s Error: Beacon Ed25519 keys not available for the session key.\n", TAG);
+        return false;
+    }
+
+    uint8_t beaconCurveSk[X25519_SK_SIZE];
+    uint8_t phoneCurvePk[X25519_PK_SIZE];
+    uint8_t shared[SHARED_KEY_SIZE];
+    bool ok = _backend.ed25519SkToX25519(beaconCurveSk, beaconSk) &&
+              _backend.ed25519PkToX25519(phoneCurvePk, phonePk) &&
+              _backend.x25519(shared, beaconCurveSk, phoneCurvePk);
+
+    if (ok) {
+        // One-shot hash of the concatenation, the same bytes as the streaming hash of the fields
+        uint8_t input[sizeof(CONTEXT) - 1 + 2 * Ed25519_PK_SIZE + PROTOCOL_NONCE_SIZE +
+                      sizeof(counter)];
+        size_t offset = 0;
+        memcpy(input + offset, CONTEXT, sizeof(CONTEXT) - 1);
+        offset += sizeof(CONTEXT) - 1;
+        memcpy(input + offset, phonePk, Ed25519_PK_SIZE);
+        offset += Ed25519_PK_SIZE;
+        memcpy(input + offset, beaconPk, Ed25519_PK_SIZE);
+        offset += Ed25519_PK_SIZE;
+        memcpy(input + offset, nonce, PROTOCOL_NONCE_SIZE);
+        offset += PROTOCOL_NONCE_SIZE;
+        memcpy(input + offset, &counter, sizeof(counter));
+        _backend.hash(keyOut, SESSION_KEY_SIZE, input, sizeof(input), shared, sizeof(shared));
+    } else {
+        Serial.printf("%s Error: session key exchange failed.\n", TAG);
+    }
+
+    sodium_memzero(beaconCurveSk, sizeof(beaconCurveSk));
+    sodium_memzero(shared, sizeof(shared));
+    return ok;
+}
+
+void CryptoService::computeSessionMac(uint8_t macOut[SESSION_MAC_SIZE], const uint8_t* data,
+                                      size_t len, const uint8_t key[SESSION_KEY_SIZE]) const {
+    _backend.hmacSha512256(macOut, data, len, key);
+}
+
+bool CryptoService::verifySessionMac(const uint8_t mac[SESSION_MAC_SIZE], const uint8_t* data,
+                                     size_t len, const uint8_t key[SESSION_KEY_SIZE]) const {
+    return _backend.verifyHmacSha512256(mac, data, len, key);
+}
+
+uint8_t CryptoService::getAeadSuites() const {
+    uint8_t suites = 1 << (POL_AEAD_SUITES_SHIFT + POL_AEAD_SUITE_CHACHA20_POLY1305);
+    if (_backend.hasAesGcm()) {
+        suites |= 1 << (POL_AEAD_SUITES_SHIFT + POL_AEAD_SUITE_AES256_GCM);
+    }
+    return suites;
+}
+
+uint8_t CryptoService::selectAeadSuite() const {
+    uint8_t common = getAeadSuites() & _serverAeadSuites.load();
+    return (common & (1 << (POL_AEAD_SUITES_SHIFT + POL_AEAD_SUITE_AES256_GCM)))
+               ? POL_AEAD_SUITE_AES256_GCM
+               : POL_AEAD_SUITE_CHACHA20_POLY1305;
+}
+
+void CryptoService::setServerAeadSuites(uint8_t suites) const {
+    _serverAeadSuites.store(suites & ~POL_AEAD_SUITE_ID_MASK);
+}
+
+bool CryptoService::nextAeadCounter(uint8_t& keyEpochOut, uint32_t& counterOut) const {
+    keyEpochOut = _keyManager.getKeyEpoch();
+    if (_sequence.nextSendCounter(keyEpochOut, counterOut)) {
+        return true;
+    }
+    // Refused for an epoch rotated meanwhile, the active one is taken instead
+    uint8_t activeEpoch = _keyManager.getKeyEpoch();
+    if (activeEpoch == keyEpochOut) {
+        return false;
+    }
+    keyEpochOut = activeEpoch;
+    return _sequence.nextSendCounter(keyEpochOut, counterOut);
+}
+
+bool CryptoService::isFreshAeadCounter(uint8_t keyEpoch, uint32_t counter) const {
+    return _sequence.isFresh(keyEpoch, counter);
+}
+
+bool CryptoService::markAeadCounter(uint8_t keyEpoch, uint32_t counter) const {
+    return _sequence.markReceived(keyEpoch, counter);
+}
+
+void CryptoService::buildAeadNonce(uint8_t nonceOut[POL_AEAD_NONCE_SIZE], uint8_t direction,
+                                   uint32_t counter) {
+    memset(nonceOut, 0, POL_AEAD_NONCE_SIZE);
+    nonceOut[0] = direction;
+    memcpy(nonceOut + 4, &counter, sizeof(counter));
+}
+
 bool CryptoService::encryptAEAD(uint8_t ciphertextAndTagOut[], size_t& actualCiphertextLenOut,
                                 const uint8_t plaintext[], size_t plaintextLen,
                                 const uint8_t associatedData[], size_t associatedDataLen,
-                                const uint8_t publicNonce[POL_AEAD_NONCE_SIZE]) const {
-    const uint8_t* sharedKeyWithServer = _keyManager.getAeadKey();
-    if (!sharedKeyWithServer) {
+                                uint32_t counter, uint8_t keyEpoch, uint8_t suite) const {
+    KeyManager::AeadKeys keys;
+    if (suite >= POL_AEAD_SUITE_COUNT || !_keyManager.getAeadKeysForEpoch(keyEpoch, keys)) {
         Serial.printf("%s Error: Shared AEAD key not available for encryption.\n", TAG);
         actualCiphertextLenOut = 0;
         return false;
     }
 
-    unsigned long long cyphertextLength;
-    if (crypto_aead_chacha20poly1305_ietf_encrypt(ciphertextAndTagOut, &cyphertextLength, plaintext,
-                                                  (unsigned long long)plaintextLen, associatedData,
-                                                  (unsigned long long)associatedDataLen, NULL,
-                                                  publicNonce, sharedKeyWithServer) != 0) {
+    uint8_t publicNonce[POL_AEAD_NONCE_SIZE];
+    buildAeadNonce(publicNonce, POL_AEAD_BEACON_TO_SERVER, counter);
+
+    bool ok = suite == POL_AEAD_SUITE_AES256_GCM
+                  ? _backend.aesGcmEncrypt(ciphertextAndTagOut, actualCiphertextLenOut, plaintext,
+                                           plaintextLen, associatedData, associatedDataLen,
+                                           publicNonce, keys.seal[suite])
+                  : _backend.aeadEncrypt(ciphertextAndTagOut, actualCiphertextLenOut, plaintext,
+                                         plaintextLen, associatedData, associatedDataLen,
+                                         publicNonce, keys.seal[suite]);
+    sodium_memzero(&keys, sizeof(keys));
+    if (!ok) {
         Serial.printf("%s Error: AEAD encryption failed.\n", TAG);
         actualCiphertextLenOut = 0;
         return false;
     }
-    actualCiphertextLenOut = static_cast<size_t>(cyphertextLength);
     return true;
 }
 
 bool CryptoService::decryptAEAD(uint8_t plaintextOut[], size_t& actualPlaintextLenOut,
                                 const uint8_t ciphertextAndTag[], size_t ciphertextAndTagLen,
                                 const uint8_t associatedData[], size_t associatedDataLen,
-                                const uint8_t publicNonce[POL_AEAD_NONCE_SIZE],
-                                const uint8_t* overrideKey) const {
-    const uint8_t* keyToUse = overrideKey;
-    if (keyToUse == nullptr) {
-        keyToUse = _keyManager.getAeadKey();
+                                uint32_t counter, uint8_t keyEpoch, uint8_t suite) const {
+    if (suite >= POL_AEAD_SUITE_COUNT ||
+        !(getAeadSuites() & (1 << (POL_AEAD_SUITES_SHIFT + suite)))) {
+        Serial.printf("%s Error: Unsupported AEAD suite %u.\n", TAG, suite);
+        actualPlaintextLenOut = 0;
+        return false;
     }
-
-    if (!keyToUse) {
-        Serial.printf("%s Error: Shared AEAD key not available for decryption.\n", TAG);
+    KeyManager::AeadKeys keys;
+    if (!_keyManager.getAeadKeysForEpoch(keyEpoch, keys)) {
+        Serial.printf("%s Error: No live AEAD key for epoch %u.\n", TAG, keyEpoch);
         actualPlaintextLenOut = 0;
         return false;
     }
 
-    unsigned long long plaintextLength;
-    if (crypto_aead_chacha20poly1305_ietf_decrypt(
-            plaintextOut, &plaintextLength, NULL, ciphertextAndTag,
-            (unsigned long long)ciphertextAndTagLen, associatedData,
-            (unsigned long long)associatedDataLen, publicNonce, keyToUse) != 0) {
+    uint8_t publicNonce[POL_AEAD_NONCE_SIZE];
+    buildAeadNonce(publicNonce, POL_AEAD_SERVER_TO_BEACON, counter);
+
+    bool ok = suite == POL_AEAD_SUITE_AES256_GCM
+                  ? _backend.aesGcmDecrypt(plaintextOut, actualPlaintextLenOut, ciphertextAndTag,
+                                           ciphertextAndTagLen, associatedData, associatedDataLen,
+                                           publicNonce, keys.open[suite])
+                  : _backend.aeadDecrypt(plaintextOut, actualPlaintextLenOut, ciphertextAndTag,
+                                         ciphertextAndTagLen, associatedData, associatedDataLen,
+                                         publicNonce, keys.open[suite]);
+    sodium_memzero(&keys, sizeof(keys));
+    if (!ok) {
         Serial.printf("%s Error: AEAD decryption failed (tag mismatch or bad data).\n", TAG);
         actualPlaintextLenOut = 0;
         return false;
     }
-    actualPlaintextLenOut = static_cast<size_t>(plaintextLength);
     return true;
 }
\ No newline at end of file
@@ -3,26 +3,39 @@
 
 #include <stdint.h>
 
+#include <atomic>
+
 #include "protocol/messages/pol_request.h"
 #include "protocol/messages/pol_response.h"
 #include "protocol/pol_constants.h"
+#include "utils/aead_sequence.h"
+#include "utils/crypto/icrypto_backend.h"
+#include "utils/crypto_worker_pool.h"
 #include "utils/key_manager.h"
 
 /**
  * @class CryptoService
  * @brief Provides a high-level interface for all cryptographic operations.
  *
- * This class acts as a facade for the libsodium library, handling signatures and
- * authenticated encryption/decryption (AEAD).
- * It relies on a KeyManager instance to provide the necessary cryptographic keys.
+ * This class acts as a facade for the crypto backend selected at compile time (libsodium, or
+ * the ESP32-S3 hardware accelerators), handling signatures and authenticated
+ * encryption/decryption (AEAD).
+ * It relies on a KeyManager instance to provide the necessary cryptographic keys, and on an
+ * AeadSequence for the message counters from which the AEAD nonces are built.
  */
 class CryptoService {
 public:
+    /// @brief The maximum number of requests verified by `verifyDistinctPoLRequestSignatures`.
+    static constexpr size_t MAX_BATCH_SIZE = MERKLE_MAX_LEAVES;
+
     /**
      * @brief Constructs the CryptoService.
+     * @param backend The cryptographic primitives.
      * @param keyManager A reference to an initialized KeyManager instance.
+     * @param sequence The message counters of the encrypted channel with the server.
      */
-    CryptoService(const KeyManager& keyManager);
+    CryptoService(const ICryptoBackend& backend, const KeyManager& keyManager,
+                  AeadSequence& sequence);
 
     /**
      * @brief Verifies the Ed25519 signature of a Proof-of-Location request.
@@ -31,6 +44,22 @@ public:
      */
     bool verifyPoLRequestSignature(const PoLRequest& req) const;
 
+    /**
+     * @brief Verifies the Ed25519 signatures of a set of Proof-of-Location requests, one by one.
+     *
+     * This is not a batch verification (a single equation for all the signatures): each distinct
+     * signature is verified on its own, so a failure is always pinpointed. Requests identical to a
+     * previous one of the set (e.g. retries) are only verified once.
+     * @param reqs The requests to verify.
+     * @param count The number of requests.
+     * @param validOut Receives, for each request, whether its signature is valid.
+     * @param pool If set, the distinct signatures are verified in parallel on its workers.
+     * @return True if all the signatures are valid.
+     */
+    bool verifyDistinctPoLRequestSignatures(const PoLRequest* const reqs[], size_t count,
+                                            bool validOut[],
+                                            CryptoWorkerPool* pool = nullptr) const;
+
     /**
      * @brief Signs a Proof-of-Location response using the beaco Ed25519 private key.
      * @param resp The PoLResponse object to be signed. The signature is written into its
@@ -40,6 +69,16 @@ public:
      */
     bool signPoLResponse(PoLResponse& resp, const PoLRequest& originalReq) const;
 
+    /**
+     * @brief Signs the root of a Merkle tree of PoL responses (see POL_RESP_FLAG_MERKLE).
+     *
+     * The signed data is "polaris-merkle" followed by the root.
+     * @param signatureOut Buffer where the resulting 64-byte Ed25519 signature will be written.
+     * @param root The root of the tree.
+     * @return True if signing was successful, false otherwise.
+     */
+    bool signMerkleRoot(uint8_t signatureOut[SIG_SIZE], const uint8_t root[MERKLE_HASH_SIZE]) const;
+
     /**
      * @brief Signs the beacon broadcast data (ID and counter) for extended advertising.
      * @param signatureOut Buffer where the resulting 64-byte Ed25519 signature will be written.
@@ -51,9 +90,96 @@ public:
                              uint64_t counter) const;
 
     /**
-     * @brief Encrypts and authenticates a plaintext message using ChaCha20-Poly1305.
+     * @brief Signs the anchor of the broadcast hash chain of a counter epoch (see TeslaChain).
      *
-     * This function uses the pre-derived shared key with the server for encryption.
+     * The signed data is "polaris-tesla" followed by the beacon ID, the counter and the anchor.
+     * @param signatureOut Buffer where the resulting 64-byte Ed25519 signature will be written.
+     * @param beaconId The beacon ID to be included in the signature.
+     * @param counter The counter value of the epoch.
+     * @param anchor The first key of the chain.
+     * @return True if signing was successful, false otherwise.
+     */
+    bool signChainAnchor(uint8_t signatureOut[SIG_SIZE], uint32_t beaconId, uint64_t counter,
+                         const uint8_t anchor[TESLA_KEY_SIZE]) const;
+
+    /**
+     * @brief Derives the session key of a phone, after a signed request opening a session.
+     *
+     * The Ed25519 keys of the beacon and of the phone are converted to X25519, and the shared
+     * secret keys a BLAKE2b hash of the context, both public keys, the request nonce and the
+     * counter of the response. The phone derives the same key from its side of the exchange.
+     * @param keyOut Receives the session key.
+     * @param phonePk The Ed25519 public key of the phone, from the verified request.
+     * @param nonce The nonce of the request.
+     * @param counter The counter of the response.
+     * @return False if a key is unavailable or invalid.
+     */
+    bool deriveSessionKey(uint8_t keyOut[SESSION_KEY_SIZE], const uint8_t phonePk[Ed25519_PK_SIZE],
+                          const uint8_t nonce[PROTOCOL_NONCE_SIZE], uint64_t counter) const;
+
+    /**
+     * @brief Computes the session MAC (HMAC-SHA-512-256) of a message.
+     * @param macOut Receives the MAC.
+     * @param data The message.
+     * @param len The length of the message.
+     * @param key The session key.
+     */
+    void computeSessionMac(uint8_t macOut[SESSION_MAC_SIZE], const uint8_t* data, size_t len,
+                           const uint8_t key[SESSION_KEY_SIZE]) const;
+
+    /**
+     * @brief Verifies a session MAC, in constant time.
+     * @return True if the MAC is valid.
+     */
+    bool verifySessionMac(const uint8_t mac[SESSION_MAC_SIZE], const uint8_t* data, size_t len,
+                          const uint8_t key[SESSION_KEY_SIZE]) const;
+
+    /**
+     * @brief Gets the cipher suites this beacon can open, as the high nibble of the suite byte.
+     *
+     * ChaCha20-Poly1305 always, AES-256-GCM when the crypto backend offers it.
+     */
+    uint8_t getAeadSuites() const;
+
+    /**
+     * @brief Chooses the suite of the next sealed message: AES-256-GCM if both this beacon and the
+     * server support it, ChaCha20-Poly1305 otherwise (and until the server announced its suites).
+     */
+    uint8_t selectAeadSuite() const;
+
+    /**
+     * @brief Records the suites announced by an authenticated server message.
+     * @param suites The high nibble of its suite byte.
+     */
+    void setServerAeadSuites(uint8_t suites) const;
+
+    /**
+     * @brief Takes the epoch of the active AEAD key and the counter of the next message sealed
+     * with it.
+     *
+     * If a rotation activates a new key meanwhile, the counter of the previous epoch is refused
+     * (see AeadSequence) and the epoch is read again.
+     * @param keyEpochOut Receives the epoch, to be sent with the sealed message.
+     * @param counterOut Receives the counter.
+     * @return False if no counter is available, the message must not be sealed.
+     */
+    bool nextAeadCounter(uint8_t& keyEpochOut, uint32_t& counterOut) const;
+
+    /** @brief Checks, before decrypting, that a server message counter was not received yet. */
+    bool isFreshAeadCounter(uint8_t keyEpoch, uint32_t counter) const;
+
+    /**
+     * @brief Records the counter of an authenticated server message.
+     * @return False if it was recorded meanwhile, the message is a replay.
+     */
+    bool markAeadCounter(uint8_t keyEpoch, uint32_t counter) const;
+
+    /**
+     * @brief Encrypts and authenticates a plaintext message using ChaCha20-Poly1305 or
+     * AES-256-GCM.
+     *
+     * This function uses the beacon-to-server subkey of the given epoch and suite, and the nonce
+     * [POL_AEAD_BEACON_TO_SERVER (1)][0 (3)][counter (4, LE)][0 (4)].
      *
      * @param ciphertextAndTagOut Buffer to store the resulting ciphertext and authentication tag.
      * @param actualCiphertextLenOut Reference to store the actual length of the output.
@@ -61,18 +187,23 @@ public:
      * @param plaintextLen The length of the plaintext data.
      * @param associatedData Additional data to be authenticated but not encrypted.
      * @param associatedDataLen The length of the associated data.
-     * @param publicNonce A unique nonce for this specific encryption operation.
+     * @param counter The message counter, from `nextAeadCounter`.
+     * @param keyEpoch The epoch of the key, from `nextAeadCounter`.
+     * @param suite The cipher suite, from `selectAeadSuite`.
      * @return True if encryption was successful, false otherwise.
      */
     bool encryptAEAD(uint8_t ciphertextAndTagOut[], size_t& actualCiphertextLenOut,
                      const uint8_t plaintext[], size_t plaintextLen, const uint8_t associatedData[],
-                     size_t associatedDataLen,
-                     const uint8_t publicNonce[POL_AEAD_NONCE_SIZE]) const;
+                     size_t associatedDataLen, uint32_t counter, uint8_t keyEpoch,
+                     uint8_t suite) const;
 
     /**
-     * @brief Decrypts and verifies an authenticated ciphertext message using ChaCha20-Poly1305.
+     * @brief Decrypts and verifies an authenticated ciphertext message using ChaCha20-Poly1305 or
+     * AES-256-GCM.
      *
-     * This function uses the pre-derived shared key with the server for decryption.
+     * The server-to-beacon subkey is selected directly by its epoch, among the live keys of the
+     * KeyManager (active, pending and recently retired), so a message is decrypted once at most.
+     * The nonce is built from the counter like in `encryptAEAD`, with POL_AEAD_SERVER_TO_BEACON.
      * It will only succeed if the authentication tag is valid for the key, nonce,
      * associated data, and ciphertext.
      *
@@ -82,19 +213,35 @@ public:
      * @param ciphertextAndTagLen The length of the encrypted data and tag.
      * @param associatedData Additional data. Must match the data used during encryption.
      * @param associatedDataLen The length of the associated data.
-     * @param publicNonce The public nonce used during the encryption operation.
+     * @param counter The message counter from the message header.
+     * @param keyEpoch The key epoch from the message header.
+     * @param suite The cipher suite from the message header. A suite this beacon cannot open
+     * fails without decrypting.
      * @return True if decryption and verification were successful, false otherwise.
      */
     bool decryptAEAD(uint8_t plaintextOut[], size_t& actualPlaintextLenOut,
                      const uint8_t ciphertextAndTag[], size_t ciphertextAndTagLen,
-                     const uint8_t associatedData[], size_t associatedDataLen,
-                     const uint8_t publicNonce[POL_AEAD_NONCE_SIZE],
-                     const uint8_t* overrideKey = nullptr) const;
+                     const uint8_t associatedData[], size_t associatedDataLen, uint32_t counter,
+                     uint8_t keyEpoch, uint8_t suite) const;
 
 private:
+    /** @brief Builds the AEAD nonce of a direction and a message counter. */
+    static void buildAeadNonce(uint8_t nonceOut[POL_AEAD_NONCE_SIZE], uint8_t direction,
+                               uint32_t counter);
+
+    /// @brief The cryptographic primitives.
+    const ICryptoBackend& _backend;
+
+    /// @brief The message counters, mutable state outside of this facade.
+    AeadSequence& _sequence;
+
     /// @brief A reference to the key manager that provides all cryptographic keys.
     const KeyManager& _keyManager;
 
+    /// @brief The suites announced by the last authenticated server message (RAM only, the
+    /// first message after a boot is sealed with ChaCha20-Poly1305).
+    mutable std::atomic<uint8_t> _serverAeadSuites;
+
     /// @brief A tag used for logging from this class.
     static constexpr const char* TAG = "[Crypto]";
 };
@@ -0,0 +1,92 @@
+#include "crypto_worker_pool.h"
+
+#include <HardwareSerial.h>
+
+bool CryptoWorkerPool::begin() {
+    static const char* const NAMES[NUM_WORKERS] = {"Crypto0", "Crypto1"};
+
+    for (size_t i = 0; i < NUM_WORKERS; ++i) {
+        // Same priority as the token processor task, which waits while the workers run.
+        BaseType_t res = xTaskCreatePinnedToCore(workerTask, NAMES[i], WORKER_STACK_SIZE, this, 1,
+                                                 &_workers[i], (BaseType_t)i);
+        if (res != pdPASS) {
+            Serial.printf("%s CRITICAL: Failed to create worker %zu!\n", TAG, i);
+            _workers[i] = nullptr;
+            return false;
+        }
+    }
+    _started = true;
+    return true;
+}
+
+void CryptoWorkerPool::run(Job job, void* context, size_t count) {
+    if (count == 0) {
+        return;
+    }
+
+    // A single item gains nothing from a worker.
+    if (!_started || count == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            job(context, i);
+        }
+        return;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    _caller = xTaskGetCurrentTaskHandle();
+    _job = job;
+    _context = context;
+    _count = count;
+    _next = 0;
+    _done = 0;
+    taskEXIT_CRITICAL(&_lock);
+
+    for (TaskHandle_t worker : _workers) {
+        xTaskNotifyGive(worker);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
+void CryptoWorkerPool::workerTask(void* pvParameters) {
+    static_cast<CryptoWorkerPool*>(pvParameters)->work();
+}
+
+void CryptoWorkerPool::work() {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        // A late wake-up may find the batch done, or join the next one: claims are always checked
+        // against the current batch.
+        Job job;
+        void* context;
+        size_t index;
+        while (claim(job, context, index)) {
+            job(context, index);
+            complete();
+        }
+    }
+}
+
+bool CryptoWorkerPool::claim(Job& job, void*& context, size_t& index) {
+    bool claimed = false;
+    taskENTER_CRITICAL(&_lock);
+    if (_next < _count) {
+        job = _job;
+        context = _context;
+        index = _next++;
+        claimed = true;
+    }
+    taskEXIT_CRITICAL(&_lock);
+    return claimed;
+}
+
+void CryptoWorkerPool::complete() {
+    taskENTER_CRITICAL(&_lock);
+    bool last = ++_done == _count;
+    TaskHandle_t caller = _caller;
+    taskEXIT_CRITICAL(&_lock);
+
+    if (last) {
+        xTaskNotifyGive(caller);
+    }
+}
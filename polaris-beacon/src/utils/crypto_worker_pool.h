@@ -0,0 +1,91 @@
+#ifndef CRYPTO_WORKER_POOL_H
+#define CRYPTO_WORKER_POOL_H
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class CryptoWorkerPool
+ * @brief Runs the independent crypto operations of a batch on both cores.
+ *
+ * The pool owns one worker task pinned on each core. `run` hands the items of a batch to the
+ * workers, which claim them one at a time, and blocks the calling task until every item is done.
+ * Each item must be independent of the others: the workers only share the claim counter.
+ *
+ * The pool does not decide any order: the caller keeps its results in item order and sends them
+ * itself once `run` returns, so the order of the answers does not depend on which core was faster.
+ *
+ * `run` must be called by a single task at a time (the token processor task). Before `begin`, or
+ * if the workers could not be created, the items run inline in the calling task.
+ */
+class CryptoWorkerPool {
+public:
+    /// @brief The number of workers, one per core.
+    static constexpr size_t NUM_WORKERS = 2;
+
+    /// @brief The stack of a worker. Ed25519 operations need a few KB.
+    static constexpr uint32_t WORKER_STACK_SIZE = 6144;
+
+    /// @brief A batch item: processes the item `index`, with the context given to `run`.
+    using Job = void (*)(void* context, size_t index);
+
+    /**
+     * @brief Creates the worker tasks.
+     * @return True if every worker was created.
+     */
+    bool begin();
+
+    /**
+     * @brief Runs `job` on the items 0 to `count - 1` and waits for all of them.
+     * @param job The function processing an item.
+     * @param context The context passed to `job`.
+     * @param count The number of items.
+     */
+    void run(Job job, void* context, size_t count);
+
+private:
+    /** @brief The FreeRTOS task function of a worker. */
+    static void workerTask(void* pvParameters);
+
+    /** @brief The worker main loop. */
+    void work();
+
+    /**
+     * @brief Claims the next item of the current batch.
+     * @return False if every item was claimed.
+     */
+    bool claim(Job& job, void*& context, size_t& index);
+
+    /** @brief Records a finished item and wakes the caller after the last one. */
+    void complete();
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[CryptoPool]";
+
+    /// @brief The worker tasks.
+    TaskHandle_t _workers[NUM_WORKERS] = {};
+
+    /// @brief True once every worker runs.
+    bool _started = false;
+
+    /// @brief Protects the batch state below.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The task waiting in `run`.
+    TaskHandle_t _caller = nullptr;
+
+    /// @brief The current batch.
+    Job _job = nullptr;
+    void* _context = nullptr;
+    size_t _count = 0;
+
+    /// @brief The next item to claim.
+    size_t _next = 0;
+
+    /// @brief The number of finished items.
+    size_t _done = 0;
+};
+
+#endif  // CRYPTO_WORKER_POOL_H
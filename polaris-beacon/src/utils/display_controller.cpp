@@ -5,6 +5,7 @@
 
 DisplayController::DisplayController()
     : _display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET_PIN) {
+    _mutex = xSemaphoreCreateMutex();
 }
 
 bool DisplayController::begin() {
@@ -33,14 +34,17 @@ bool DisplayController::begin() {
 void DisplayController::clear() {
     if (!_isInitialized)
         return;
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     _logBuffer.clear();
     _display.clearDisplay();
     _display.display();
+    xSemaphoreGive(_mutex);
 }
 
 void DisplayController::showCenteredMessage(const std::string& message, uint8_t size) {
     if (!_isInitialized) return;
 
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     _logBuffer.clear();
     _display.clearDisplay();
     _display.setTextSize(size);
@@ -56,11 +60,13 @@ void DisplayController::showCenteredMessage(const std::string& message, uint8_t
     
     _display.println(message.c_str());
     _display.display();
+    xSemaphoreGive(_mutex);
 }
 
 void DisplayController::addLog(const std::string& logMessage) {
     if (!_isInitialized) return;
 
+    xSemaphoreTake(_mutex, portMAX_DELAY);
     // Adds the new message to the buffer
     _logBuffer.push_back(logMessage);
 
@@ -70,6 +76,7 @@ void DisplayController::addLog(const std::string& logMessage) {
     }
 
     redrawLog();
+    xSemaphoreGive(_mutex);
 }
 
 void DisplayController::redrawLog() {
@@ -3,6 +3,8 @@
 
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <vector>
 #include <string>
 
@@ -13,6 +15,9 @@
  * This class provides a simplified interface for displaying text
  * on the OLED screen. It abstracts the details of the I2C
  * communication and the Adafruit_GFX library calls.
+ *
+ * The logs are added by the main loop and by the tasks notifying system events, so the
+ * drawing methods are serialized by a mutex.
  */
 class DisplayController {
 public:
@@ -55,7 +60,7 @@ public:
 private:
 
     /**
-     * @brief Redraws the entire log with updated data
+     * @brief Redraws the entire log with updated data. Called with the mutex held.
      */
     void redrawLog();
 
@@ -77,6 +82,9 @@ private:
     /// @brief The underlying display driver object from the Adafruit library.
     Adafruit_SSD1306 _display;
 
+    /// @brief Guards the display buffer and the log buffer.
+    SemaphoreHandle_t _mutex = nullptr;
+
     /// @brief A flag to indicate if the display has been successfully initialized.
     bool _isInitialized = false;
 
@@ -0,0 +1,292 @@
+#include "issuance_log.h"
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <HardwareSerial.h>
+#include <sodium.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+size_t writeVarint(uint8_t* out, uint64_t value) {
+    size_t len = 0;
+    do {
+        uint8_t byte = value & 0x7F;
+        value >>= 7;
+        out[len++] = value ? (byte | 0x80) : byte;
+    } while (value);
+    return len;
+}
+}  // namespace
+
+void IssuanceLog::begin(Preferences* prefs, OutgoingMessageService* outgoing) {
+    _prefs = prefs;
+    _outgoing = outgoing;
+    _head = _prefs->getUInt(NVS_HEAD_KEY, 0);
+    _tail = _prefs->getUInt(NVS_TAIL_KEY, 0);
+    _stored = _head;
+    _next = _tail;
+    _outgoing->addAckListener([this](uint32_t msgId) { handleAck(msgId); });
+    Serial.printf("%s %u block(s) waiting for upload.\n", TAG, _head - _tail);
+}
+
+void IssuanceLog::record(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                         uint64_t counter) {
+    uint8_t phoneHash[crypto_generichash_BYTES_MIN];
+    crypto_generichash(phoneHash, sizeof(phoneHash), reinterpret_cast<const uint8_t*>(&phoneId),
+                       sizeof(phoneId), nullptr, 0);
+
+    taskENTER_CRITICAL(&_lock);
+    // A full block, or a counter going back (reset), starts a new block.
+    if (_open.count > 0 &&
+        (_open.len + MAX_ENTRY_SIZE > BLOCK_DATA_SIZE || counter < _open.lastCounter)) {
+        sealLocked();
+    }
+    if (_open.count == 0) {
+        _open.firstCounter = counter;
+        _open.lastCounter = counter;
+        _openedMs = millis();
+    }
+
+    uint8_t* entry = _open.data + _open.len;
+    size_t len = writeVarint(entry, counter - _open.lastCounter);
+    memcpy(entry + len, phoneHash, PHONE_HASH_SIZE);
+    len += PHONE_HASH_SIZE;
+    memcpy(entry + len, nonce, NONCE_PREFIX_SIZE);
+    len += NONCE_PREFIX_SIZE;
+
+    _open.len += len;
+    _open.count++;
+    _open.lastCounter = counter;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void IssuanceLog::flush(uint32_t now) {
+    if (!_prefs) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    if (_open.count > 0 && now - _openedMs >= SEAL_INTERVAL_MS) {
+        sealLocked();
+    }
+    uint32_t dropped = _dropped;
+    _dropped = 0;
+    taskEXIT_CRITICAL(&_lock);
+    if (dropped > 0) {
+        Serial.printf("%s %u sealed block(s) dropped before being stored.\n", TAG, dropped);
+    }
+
+    Block block;
+    while (true) {
+        taskENTER_CRITICAL(&_lock);
+        if (_sealedCount == 0) {
+            taskEXIT_CRITICAL(&_lock);
+            return;
+        }
+        block = _sealed[0];
+        _sealedCount--;
+        memmove(&_sealed[0], &_sealed[1], _sealedCount * sizeof(Block));
+        taskEXIT_CRITICAL(&_lock);
+
+        store(block);
+    }
+}
+
+void IssuanceLog::upload(uint32_t now) {
+    if (!_prefs || !_outgoing) {
+        return;
+    }
+    flush(now);
+
+    while (_outgoing->pendingCount() < MAX_QUEUED_MESSAGES) {
+        // A block refused by the queue or without ACK is queued again first, then the next stored
+        // block.
+        taskENTER_CRITICAL(&_lock);
+        InFlight* slot = nullptr;
+        for (InFlight& entry : _inFlight) {
+            if (entry.used && !entry.done &&
+                (entry.msgId == 0 || now - entry.queuedMs >= ACK_TIMEOUT_MS)) {
+                slot = &entry;
+                break;
+            }
+        }
+        if (!slot && _next != _stored) {
+            for (InFlight& entry : _inFlight) {
+                if (!entry.used) {
+                    // Reserved before queuing, so that the tail cannot move past it meanwhile.
+                    entry = {true, false, _next++, 0, now};
+                    slot = &entry;
+                    break;
+                }
+            }
+        }
+        uint32_t seq = slot ? slot->seq : 0;
+        uint32_t previousMsgId = slot ? slot->msgId : 0;
+        taskEXIT_CRITICAL(&_lock);
+        if (!slot) {
+            break;
+        }
+
+        // A copy still waiting in the outgoing queue has not reached a data mule yet, the block
+        // waits for another timeout instead of being queued twice.
+        if (previousMsgId != 0 && _outgoing->isQueued(previousMsgId)) {
+            taskENTER_CRITICAL(&_lock);
+            InFlight* entry = findInFlightLocked(seq);
+            if (entry && !entry->done) {
+                entry->queuedMs = now;
+            }
+            taskEXIT_CRITICAL(&_lock);
+            continue;
+        }
+
+        uint32_t msgId = 0;
+        QueueResult result = queue(seq, msgId);
+
+        taskENTER_CRITICAL(&_lock);
+        // The entry is gone if the ring overwrote the block meanwhile.
+        InFlight* entry = findInFlightLocked(seq);
+        if (entry && !entry->done) {
+            // A refused block keeps its entry (msgId 0) and is queued again by the next upload.
+            entry->done = result == QueueResult::Missing;
+            entry->msgId = result == QueueResult::Queued ? msgId : 0;
+            entry->queuedMs = now;
+        }
+        advanceTailLocked();
+        taskEXIT_CRITICAL(&_lock);
+        if (result == QueueResult::Refused) {
+            break;
+        }
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    bool persist = _tailDirty;
+    uint32_t tail = _tail;
+    _tailDirty = false;
+    taskEXIT_CRITICAL(&_lock);
+    if (persist) {
+        _prefs->putUInt(NVS_TAIL_KEY, tail);
+    }
+}
+
+void IssuanceLog::sealLocked() {
+    if (_open.count == 0) {
+        return;
+    }
+
+    _open.seq = _head++;
+    // The oldest block is overwritten by this one.
+    if (_head - _tail > RING_BLOCKS) {
+        _tail = _head - RING_BLOCKS;
+        _tailDirty = true;
+        advanceTailLocked();
+    }
+
+    // Without a flush since the previous seals, the oldest waiting block is dropped.
+    if (_sealedCount == SEALED_BLOCKS) {
+        _sealedCount--;
+        memmove(&_sealed[0], &_sealed[1], _sealedCount * sizeof(Block));
+        _dropped++;
+    }
+    _sealed[_sealedCount++] = _open;
+    _open.count = 0;
+    _open.len = 0;
+}
+
+void IssuanceLog::store(const Block& block) {
+    // A block failing is lost: its slot holds another sequence number, and it is skipped.
+    char key[16];
+    slotKey(key, sizeof(key), block.seq);
+    bool ok = _prefs->putBytes(key, &block, sizeof(block)) == sizeof(block);
+
+    taskENTER_CRITICAL(&_lock);
+    _stored = block.seq + 1;
+    taskEXIT_CRITICAL(&_lock);
+
+    if (!ok) {
+        Serial.printf("%s Failed to store block %u.\n", TAG, block.seq);
+        return;
+    }
+    _prefs->putUInt(NVS_HEAD_KEY, block.seq + 1);
+    Serial.printf("%s Block %u sealed (%u entries, %u bytes).\n", TAG, block.seq, block.count,
+                  block.len);
+}
+
+IssuanceLog::QueueResult IssuanceLog::queue(uint32_t seq, uint32_t& msgIdOut) {
+    // A slot overwritten meanwhile, or lost by a reboot before its write, holds another sequence
+    // number: it is skipped.
+    char key[16];
+    slotKey(key, sizeof(key), seq);
+    Block block;
+    if (_prefs->getBytes(key, &block, sizeof(block)) != sizeof(block) || block.seq != seq) {
+        Serial.printf("%s Block %u missing, skipped.\n", TAG, seq);
+        return QueueResult::Missing;
+    }
+
+    char encoded[sodium_base64_ENCODED_LEN(BLOCK_DATA_SIZE, sodium_base64_VARIANT_ORIGINAL)];
+    sodium_bin2base64(encoded, sizeof(encoded), block.data, block.len,
+                      sodium_base64_VARIANT_ORIGINAL);
+
+    JsonDocument doc;
+    JsonObject payload = doc.to<JsonObject>();
+    payload["seq"] = block.seq;
+    payload["c0"] = block.firstCounter;
+    payload["n"] = block.count;
+    payload["d"] = encoded;
+
+    if (!_outgoing->queueMessage(OperationType::IssuanceLog, payload, &msgIdOut)) {
+        Serial.printf("%s Failed to queue block %u, retried later.\n", TAG, block.seq);
+        return QueueResult::Refused;
+    }
+    Serial.printf("%s Block %u queued for upload.\n", TAG, block.seq);
+    return QueueResult::Queued;
+}
+
+void IssuanceLog::handleAck(uint32_t msgId) {
+    taskENTER_CRITICAL(&_lock);
+    for (InFlight& entry : _inFlight) {
+        if (entry.used && !entry.done && entry.msgId == msgId) {
+            entry.done = true;
+            break;
+        }
+    }
+    advanceTailLocked();
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void IssuanceLog::advanceTailLocked() {
+    // The blocks behind the tail were overwritten in the ring, their ACK no longer matters.
+    for (InFlight& entry : _inFlight) {
+        if (entry.used && (int32_t)(entry.seq - _tail) < 0) {
+            entry.used = false;
+        }
+    }
+    if ((int32_t)(_next - _tail) < 0) {
+        _next = _tail;
+    }
+
+    while (_tail != _next) {
+        InFlight* entry = findInFlightLocked(_tail);
+        if (entry && !entry->done) {
+            break;
+        }
+        if (entry) {
+            entry->used = false;
+        }
+        _tail++;
+        _tailDirty = true;
+    }
+}
+
+IssuanceLog::InFlight* IssuanceLog::findInFlightLocked(uint32_t seq) {
+    for (InFlight& entry : _inFlight) {
+        if (entry.used && entry.seq == seq) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void IssuanceLog::slotKey(char* out, size_t len, uint32_t seq) {
+    snprintf(out, len, "ilog_%u", (unsigned)(seq % RING_BLOCKS));
+}
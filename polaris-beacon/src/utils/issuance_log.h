@@ -0,0 +1,227 @@
+#ifndef ISSUANCE_LOG_H
+#define ISSUANCE_LOG_H
+
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol/handlers/outgoing_message_service.h"
+#include "protocol/pol_constants.h"
+
+/**
+ * @class IssuanceLog
+ * @brief A compact journal of the issued tokens, uploaded to the server through the data mules.
+ *
+ * Each issued token (signed or session) adds an entry to the open block:
+ *
+ * Entry: [counter delta (LEB128 varint)][phone hash (3)][nonce prefix (3)]
+ *
+ * The counter delta is relative to the previous entry of the block (the first entry has a zero
+ * delta from the block first counter), so a burst within one counter epoch costs 7 bytes per
+ * token. The phone hash is the truncated BLAKE2b-128 of the phone ID (8 bytes, little-endian): the
+ * server matches it against its registered phones, and the nonce prefix against the uploaded
+ * tokens.
+ *
+ * A block is sealed when it is full, or SEAL_INTERVAL_MS after its first entry. `record` runs on
+ * the token issuance path and never touches the NVS: sealed blocks wait in RAM (SEALED_BLOCKS at
+ * most, the oldest being dropped) until `flush` writes them to a ring of RING_BLOCKS NVS blobs, the
+ * oldest being overwritten when the ring is full. Only the open block and the blocks waiting in
+ * RAM are lost by a reboot.
+ *
+ * The ring holds about 780 entries (16 blocks of about 48). A larger journal does not fit the NVS
+ * partition of the default partition table (20 KB, shared with the keys and counters).
+ *
+ * `upload` queues the stored blocks in order into the OutgoingMessageService, at most
+ * MAX_QUEUED_MESSAGES pending at a time and MAX_IN_FLIGHT waiting for their ACK, as IssuanceLog
+ * messages:
+ *
+ * {"seq": block number, "c0": first counter, "n": entries, "d": base64 entries}
+ *
+ * The outgoing queue is RAM only, so a block leaves the ring (the persisted tail moves past it)
+ * only once the server acknowledged it. A block not acknowledged after ACK_TIMEOUT_MS, or before
+ * a reboot, is queued again with the same sequence number, unless its previous message is still
+ * waiting in the outgoing queue. A block the queue refused is queued again by the next `upload`;
+ * only a block missing from the ring is skipped.
+ *
+ * `record` is called by the token processor task, the ACKs arrive on the encrypted processor task,
+ * `flush` and `upload` are called by the main loop. The blocks in RAM and the ring indices are
+ * guarded by a critical section; the NVS accesses happen outside of it, in the main loop.
+ */
+class IssuanceLog {
+public:
+    /// @brief The size of the entries of a block, sized so that a block fills a message payload.
+    static constexpr size_t BLOCK_DATA_SIZE = 342;
+
+    /// @brief The number of blocks kept in NVS.
+    static constexpr uint32_t RING_BLOCKS = 16;
+
+    /// @brief The maximum age of the open block before it is sealed.
+    static constexpr uint32_t SEAL_INTERVAL_MS = 10 * 60 * 1000;
+
+    /// @brief The outgoing queue occupancy above which no block is uploaded.
+    static constexpr size_t MAX_QUEUED_MESSAGES = 4;
+
+    /// @brief The maximum number of uploaded blocks waiting for their ACK.
+    static constexpr size_t MAX_IN_FLIGHT = 4;
+
+    /// @brief The time after which a block without ACK is queued again.
+    static constexpr uint32_t ACK_TIMEOUT_MS = 30 * 60 * 1000;
+
+    /// @brief The maximum number of sealed blocks waiting in RAM for `flush`.
+    static constexpr size_t SEALED_BLOCKS = 2;
+
+    /// @brief The sizes of the truncated fields of an entry.
+    static constexpr size_t PHONE_HASH_SIZE = 3;
+    static constexpr size_t NONCE_PREFIX_SIZE = 3;
+
+    /**
+     * @brief Loads the ring indices from NVS and listens to the ACKs of the outgoing messages.
+     * @param prefs The opened NVS namespace.
+     * @param outgoing The service the blocks are uploaded through.
+     */
+    void begin(Preferences* prefs, OutgoingMessageService* outgoing);
+
+    /**
+     * @brief Adds an issued token to the journal, in RAM.
+     * @param phoneId The phone the token was issued to.
+     * @param nonce The nonce of the request.
+     * @param counter The counter value of the token.
+     */
+    void record(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE], uint64_t counter);
+
+    /**
+     * @brief Seals the open block if it is old enough, and writes the sealed blocks to the NVS.
+     *
+     * Called by `upload`, and alone while the uploads are deferred.
+     * @param now The current time (millis).
+     */
+    void flush(uint32_t now);
+
+    /**
+     * @brief Flushes, then queues the stored blocks for upload and persists the acknowledged ones.
+     * @param now The current time (millis).
+     */
+    void upload(uint32_t now);
+
+private:
+    /// @brief The largest entry: a 64-bit varint and the truncated fields.
+    static constexpr size_t MAX_ENTRY_SIZE = 10 + PHONE_HASH_SIZE + NONCE_PREFIX_SIZE;
+
+    /**
+     * @struct Block
+     * @brief A block of entries, as stored in NVS.
+     */
+    struct Block {
+        uint32_t seq;
+        uint64_t firstCounter;
+        uint64_t lastCounter;
+        uint16_t count;
+        uint16_t len;
+        uint8_t data[BLOCK_DATA_SIZE];
+    };
+
+    /**
+     * @struct InFlight
+     * @brief An uploaded block waiting for its ACK.
+     */
+    struct InFlight {
+        bool used;
+        /// @brief True once acknowledged, or if the block is missing from the ring (skipped).
+        bool done;
+        uint32_t seq;
+        /// @brief The ID of the outgoing message, 0 until it is queued (or if it was refused).
+        uint32_t msgId;
+        uint32_t queuedMs;
+    };
+
+    /**
+     * @enum QueueResult
+     * @brief The outcome of queuing a stored block.
+     */
+    enum class QueueResult { Queued, Missing, Refused };
+
+    /**
+     * @brief Closes the open block and moves it to the blocks waiting in RAM. Must be called
+     * within the critical section.
+     */
+    void sealLocked();
+
+    /** @brief Writes a sealed block to its ring slot and persists the ring head. */
+    void store(const Block& block);
+
+    /**
+     * @brief Loads a stored block and queues it as an IssuanceLog message.
+     * @param seq The sequence number of the block.
+     * @param msgIdOut Receives the ID of the outgoing message.
+     * @return Missing if the block was overwritten or lost, Refused if the outgoing queue did not
+     * take the message.
+     */
+    QueueResult queue(uint32_t seq, uint32_t& msgIdOut);
+
+    /** @brief Marks the block of an acknowledged message as done. */
+    void handleAck(uint32_t msgId);
+
+    /**
+     * @brief Moves the tail past the done blocks, and forgets the blocks overwritten in the ring.
+     * Must be called within the critical section.
+     */
+    void advanceTailLocked();
+
+    /** @brief Returns the in-flight entry of a block, or nullptr. Called with the lock held. */
+    InFlight* findInFlightLocked(uint32_t seq);
+
+    /** @brief Builds the NVS key of a ring slot. */
+    static void slotKey(char* out, size_t len, uint32_t seq);
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[IssuanceLog]";
+
+    /// @brief NVS keys of the ring indices.
+    static constexpr const char* NVS_HEAD_KEY = "ilog_head";
+    static constexpr const char* NVS_TAIL_KEY = "ilog_tail";
+
+    /// @brief The NVS storage.
+    Preferences* _prefs = nullptr;
+
+    /// @brief The service the blocks are uploaded through.
+    OutgoingMessageService* _outgoing = nullptr;
+
+    /// @brief Protects the blocks in RAM, the ring indices and the in-flight blocks.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The block receiving the entries.
+    Block _open = {};
+
+    /// @brief The time (millis) of the first entry of the open block.
+    uint32_t _openedMs = 0;
+
+    /// @brief The sealed blocks waiting for `flush`, oldest first.
+    Block _sealed[SEALED_BLOCKS];
+
+    /// @brief The number of blocks in `_sealed`.
+    size_t _sealedCount = 0;
+
+    /// @brief The number of sealed blocks dropped because `_sealed` was full, since the last flush.
+    uint32_t _dropped = 0;
+
+    /// @brief The sequence number of the next sealed block.
+    uint32_t _head = 0;
+
+    /// @brief The sequence number following the last block written to the NVS (or lost).
+    uint32_t _stored = 0;
+
+    /// @brief The sequence number of the next block to upload.
+    uint32_t _next = 0;
+
+    /// @brief The sequence number of the oldest block not acknowledged yet.
+    uint32_t _tail = 0;
+
+    /// @brief True if the tail moved since it was last persisted.
+    bool _tailDirty = false;
+
+    /// @brief The uploaded blocks waiting for their ACK.
+    InFlight _inFlight[MAX_IN_FLIGHT] = {};
+};
+
+#endif  // ISSUANCE_LOG_H
@@ -6,7 +6,10 @@
 
 #include "protocol/pol_constants.h"
 
-KeyManager::KeyManager(const uint8_t (&serverX25519Pk)[X25519_PK_SIZE]) {
+KeyManager::KeyManager(const ICryptoBackend& backend,
+                       const uint8_t (&serverX25519Pk)[X25519_PK_SIZE])
+    : _backend(backend) {
+    _mutex = xSemaphoreCreateMutex();
     memcpy(_serverX25519Pk, serverX25519Pk, X25519_PK_SIZE);
 }
 
@@ -36,7 +39,7 @@ bool KeyManager::begin(Preferences& prefs) {
     Serial.printf("%s Server X25519 Public Key: ", TAG);
     printKey(X25519_PK_SIZE, _serverX25519Pk);
 
-    if (!deriveAEADSharedKey(_aeadKey, _x25519Sk, _serverX25519Pk)) {
+    if (!deriveAEADSharedKey(_aeadKeys, _x25519Sk, _serverX25519Pk)) {
         Serial.printf("%s CRITICAL: Failed to derive shared AEAD key with server!\n", TAG);
         return false;
     }
@@ -90,11 +93,8 @@ bool KeyManager::manageEd25519KeyPair(uint8_t pk_out[Ed25519_PK_SIZE],
 
 bool KeyManager::manageX25519KeyPair(uint8_t pk_out[X25519_PK_SIZE],
                                      uint8_t sk_out[X25519_SK_SIZE]) {
-    bool pk_loaded = loadKey(NVS_X25519_PK_NAME, pk_out, X25519_PK_SIZE);
-    bool sk_loaded = loadKey(NVS_X25519_SK_NAME, sk_out, X25519_SK_SIZE);
-
-    if (pk_loaded && sk_loaded) {
-        Serial.printf("%s X25519 PK and SK loaded from NVS.\n", TAG);
+    if (loadX25519KeyPair(pk_out, sk_out, _keyEpoch)) {
+        Serial.printf("%s X25519 PK and SK loaded from NVS (key epoch %u).\n", TAG, _keyEpoch);
         return true;
     }
 
@@ -102,10 +102,50 @@ bool KeyManager::manageX25519KeyPair(uint8_t pk_out[X25519_PK_SIZE],
                   TAG);
     generateX25519KeyPair(pk_out, sk_out);
 
-    bool pk_stored = storeKey(NVS_X25519_PK_NAME, pk_out, X25519_PK_SIZE);
-    bool sk_stored = storeKey(NVS_X25519_SK_NAME, sk_out, X25519_SK_SIZE);
+    // A new key pair starts a new epoch sequence, the server must be provisioned again anyway.
+    // The message counters of the previous pair start again as well.
+    _keyEpoch = 0;
+    _prefs.remove(NVS_AEAD_TX_NAME);
+    _prefs.remove(NVS_AEAD_RX_NAME);
+
+    return storeX25519KeyPair(pk_out, sk_out, _keyEpoch);
+}
+
+bool KeyManager::storeX25519KeyPair(const uint8_t pk[X25519_PK_SIZE],
+                                    const uint8_t sk[X25519_SK_SIZE], uint8_t epoch) {
+    uint8_t blob[X25519_SK_SIZE + X25519_PK_SIZE + 1];
+    memcpy(blob, sk, X25519_SK_SIZE);
+    memcpy(blob + X25519_SK_SIZE, pk, X25519_PK_SIZE);
+    blob[X25519_SK_SIZE + X25519_PK_SIZE] = epoch;
+    bool stored = storeKey(NVS_X25519_PAIR_NAME, blob, sizeof(blob));
+    sodium_memzero(blob, sizeof(blob));
+    return stored;
+}
+
+bool KeyManager::loadX25519KeyPair(uint8_t pk_out[X25519_PK_SIZE], uint8_t sk_out[X25519_SK_SIZE],
+                                   uint8_t& epochOut) {
+    uint8_t blob[X25519_SK_SIZE + X25519_PK_SIZE + 1];
+    if (loadKey(NVS_X25519_PAIR_NAME, blob, sizeof(blob))) {
+        memcpy(sk_out, blob, X25519_SK_SIZE);
+        memcpy(pk_out, blob + X25519_SK_SIZE, X25519_PK_SIZE);
+        epochOut = blob[X25519_SK_SIZE + X25519_PK_SIZE];
+        sodium_memzero(blob, sizeof(blob));
+        return true;
+    }
 
-    return pk_stored && sk_stored;
+    if (!loadKey(NVS_X25519_PK_NAME, pk_out, X25519_PK_SIZE) ||
+        !loadKey(NVS_X25519_SK_NAME, sk_out, X25519_SK_SIZE)) {
+        return false;
+    }
+    epochOut = _prefs.getUChar(NVS_X25519_EPOCH_NAME, 0);
+    if (!storeX25519KeyPair(pk_out, sk_out, epochOut)) {
+        return true;  // Still usable, moved at the next boot
+    }
+    _prefs.remove(NVS_X25519_PK_NAME);
+    _prefs.remove(NVS_X25519_SK_NAME);
+    _prefs.remove(NVS_X25519_EPOCH_NAME);
+    Serial.printf("%s X25519 key pair moved to a single NVS entry.\n", TAG);
+    return true;
 }
 
 bool KeyManager::manageServerX25519PublicKey(uint8_t pk_out[X25519_PK_SIZE],
@@ -130,7 +170,7 @@ bool KeyManager::manageServerX25519PublicKey(uint8_t pk_out[X25519_PK_SIZE],
 
 void KeyManager::generateEd25519KeyPair(uint8_t publicKeyOut[Ed25519_PK_SIZE],
                                         uint8_t secretKeyOut[Ed25519_SK_SIZE]) {
-    if (crypto_sign_ed25519_keypair(publicKeyOut, secretKeyOut) != 0) {
+    if (!_backend.generateEd25519KeyPair(publicKeyOut, secretKeyOut)) {
         Serial.println("[Crypto] Error: Ed25519 keypair generation failed.");
         memset(publicKeyOut, 0, Ed25519_PK_SIZE);
         memset(secretKeyOut, 0, Ed25519_SK_SIZE);
@@ -140,64 +180,138 @@ void KeyManager::generateEd25519KeyPair(uint8_t publicKeyOut[Ed25519_PK_SIZE],
 void KeyManager::generateX25519KeyPair(uint8_t publicKeyOut[X25519_PK_SIZE],
                                        uint8_t secretKeyOut[X25519_SK_SIZE]) {
     // Generate 32 random bytes for the secret key
-    randombytes_buf(secretKeyOut, X25519_SK_SIZE);
+    _backend.randomBytes(secretKeyOut, X25519_SK_SIZE);
     // Derive the public key from the secret key
-    if (crypto_scalarmult_curve25519_base(publicKeyOut, secretKeyOut) != 0) {
+    if (!_backend.x25519Base(publicKeyOut, secretKeyOut)) {
         Serial.println("[Crypto] Error: X25519 public key derivation failed.");
         memset(publicKeyOut, 0, X25519_PK_SIZE);
         // The secret_key_out is still random, which is fine for an X25519 sk.
     }
 }
 
-bool KeyManager::deriveAEADSharedKey(uint8_t sharedKeyOut[SHARED_KEY_SIZE],
+bool KeyManager::deriveAEADSharedKey(AeadKeys& keysOut,
                                      const uint8_t X25519SecretKey[X25519_SK_SIZE],
                                      const uint8_t serverX25519PublicKey[X25519_PK_SIZE]) {
-    if (crypto_scalarmult_curve25519(sharedKeyOut, X25519SecretKey, serverX25519PublicKey) != 0) {
+    uint8_t sharedSecret[SHARED_KEY_SIZE];
+    if (!_backend.x25519(sharedSecret, X25519SecretKey, serverX25519PublicKey)) {
         Serial.println("[Crypto] Error: X25519 key agreement failed (possibly low-order key).");
-        memset(sharedKeyOut, 0, SHARED_KEY_SIZE);
+        sodium_memzero(&keysOut, sizeof(keysOut));
         return false;
     }
+
+    // One subkey per direction and suite, the same derivation as the server.
+    for (uint8_t suite = 0; suite < POL_AEAD_SUITE_COUNT; ++suite) {
+        uint64_t offset = suite * POL_AEAD_SUITE_SUBKEY_STRIDE;
+        _backend.deriveKey(keysOut.seal[suite], SHARED_KEY_SIZE,
+                           POL_AEAD_BEACON_TO_SERVER + offset, POL_AEAD_KDF_CONTEXT, sharedSecret);
+        _backend.deriveKey(keysOut.open[suite], SHARED_KEY_SIZE,
+                           POL_AEAD_SERVER_TO_BEACON + offset, POL_AEAD_KDF_CONTEXT, sharedSecret);
+    }
+    sodium_memzero(sharedSecret, sizeof(sharedSecret));
     return true;
 }
 
-bool KeyManager::deriveAEADSharedKeyWithPendingKey(uint8_t sharedKeyOut[SHARED_KEY_SIZE]) const {
-    if (crypto_scalarmult_curve25519(sharedKeyOut, _new_x25519Sk, _serverX25519Pk) != 0) {
-        Serial.printf("%s Error: Failed to derive temporary AEAD key with pending secret key.\n",
-                      TAG);
-        memset(sharedKeyOut, 0, SHARED_KEY_SIZE);
-        return false;
+uint8_t KeyManager::getKeyEpoch() const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    uint8_t epoch = _keyEpoch;
+    xSemaphoreGive(_mutex);
+    return epoch;
+}
+
+bool KeyManager::getAeadKeysForEpoch(uint8_t epoch, AeadKeys& keysOut) const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    const AeadKeys* keys = findAeadKeysLocked(epoch);
+    if (keys) {
+        keysOut = *keys;
     }
-    return true;
+    xSemaphoreGive(_mutex);
+    return keys != nullptr;
 }
 
-void KeyManager::prepareNewX25519KeyPair() {
+const KeyManager::AeadKeys* KeyManager::findAeadKeysLocked(uint8_t epoch) const {
+    if (epoch == _keyEpoch) {
+        return &_aeadKeys;
+    }
+    if (isPendingEpochLocked(epoch)) {
+        return &_pendingAeadKeys;
+    }
+    for (const RetiredKey& retired : _retired) {
+        if (retired.used && retired.epoch == epoch) {
+            return &retired.keys;
+        }
+    }
+    return nullptr;
+}
+
+bool KeyManager::isPendingEpoch(uint8_t epoch) const {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    bool pending = isPendingEpochLocked(epoch);
+    xSemaphoreGive(_mutex);
+    return pending;
+}
+
+bool KeyManager::isPendingEpochLocked(uint8_t epoch) const {
+    return _rotationPending && epoch == (uint8_t)(_keyEpoch + 1);
+}
+
+bool KeyManager::prepareNewX25519KeyPair() {
     Serial.printf("%s Preparing new X25519 key pair...\n", TAG);
     generateX25519KeyPair(_new_x25519Pk, _new_x25519Sk);
+
+    // The pending AEAD subkeys are derived once here, and not for each message failing to decrypt.
+    AeadKeys pendingKeys;
+    bool derived = deriveAEADSharedKey(pendingKeys, _new_x25519Sk, _serverX25519Pk);
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    _pendingAeadKeys = pendingKeys;
+    _rotationPending = derived;
+    xSemaphoreGive(_mutex);
+    sodium_memzero(&pendingKeys, sizeof(pendingKeys));
+    if (!derived) {
+        Serial.printf("%s Error: Failed to derive the AEAD subkeys of the pending key pair.\n",
+                      TAG);
+        return false;
+    }
     Serial.printf("%s New X25519 Public Key (pending): ", TAG);
     printKey(X25519_PK_SIZE, _new_x25519Pk);
+    return true;
 }
 
 bool KeyManager::activateNewX25519KeyPair() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (!_rotationPending) {
+        xSemaphoreGive(_mutex);
+        Serial.printf("%s No pending key pair to activate.\n", TAG);
+        return false;
+    }
+
     Serial.printf("%s Activating new X25519 key pair...\n", TAG);
-    // Copy the new keys on the active ones
+    // Store the new keys with their epoch first, the active ones are kept if the write fails.
+    uint8_t newEpoch = _keyEpoch + 1;
+    if (!storeX25519KeyPair(_new_x25519Pk, _new_x25519Sk, newEpoch)) {
+        xSemaphoreGive(_mutex);
+        return false;
+    }
     memcpy(_x25519Pk, _new_x25519Pk, X25519_PK_SIZE);
     memcpy(_x25519Sk, _new_x25519Sk, X25519_SK_SIZE);
 
-    // Store the now active new keys in the NVS
-    bool pk_stored = storeKey(NVS_X25519_PK_NAME, _x25519Pk, X25519_PK_SIZE);
-    bool sk_stored = storeKey(NVS_X25519_SK_NAME, _x25519Sk, X25519_SK_SIZE);
-
-    if (pk_stored && sk_stored) {
-        // Derive AEAD shared key with the new private key
-        if (deriveAEADSharedKey(_aeadKey, _x25519Sk, _serverX25519Pk)) {
-            Serial.printf("%s New key pair activated and AEAD key re-derived.\n", TAG);
-            return true;
-        } else {
-            Serial.printf("%s CRITICAL: Failed to re-derive AEAD key after key rotation!\n", TAG);
-            return false;
-        }
-    }
-    return false;
+    // Retire the previous AEAD subkeys, the messages sealed before the rotation still use them.
+    // The subkeys and their epoch are swapped under the mutex, so that no task seals with the new
+    // subkeys under the previous epoch.
+    RetiredKey& retired = _retired[_nextRetired];
+    _nextRetired = (_nextRetired + 1) % RETIRED_KEYS;
+    retired.used = true;
+    retired.epoch = _keyEpoch;
+    retired.keys = _aeadKeys;
+
+    // The AEAD subkeys of the new pair were derived by the preparation.
+    _aeadKeys = _pendingAeadKeys;
+    sodium_memzero(&_pendingAeadKeys, sizeof(_pendingAeadKeys));
+    sodium_memzero(_new_x25519Sk, X25519_SK_SIZE);
+    _rotationPending = false;
+    _keyEpoch = newEpoch;
+    xSemaphoreGive(_mutex);
+    Serial.printf("%s New key pair activated, key epoch %u.\n", TAG, newEpoch);
+    return true;
 }
 
 const uint8_t* KeyManager::getNewX25519Pk() const {
@@ -229,7 +343,3 @@ const uint8_t* KeyManager::getX25519Sk() const {
 const uint8_t* KeyManager::getServerX25519Pk() const {
     return _serverX25519Pk;
 }
-
-const uint8_t* KeyManager::getAeadKey() const {
-    return _aeadKey;
-}
\ No newline at end of file
@@ -2,10 +2,13 @@
 #define KEY_STORAGE_H
 
 #include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 #include <stddef.h>
 #include <stdint.h>
 
 #include "protocol/pol_constants.h"
+#include "utils/crypto/icrypto_backend.h"
 
 /// @brief The hardcoded default public key for the server key exchange (X25519).
 static constexpr const uint8_t HARDCODED_SERVER_X25519_PK[X25519_PK_SIZE] = {
@@ -19,16 +22,41 @@ static constexpr const uint8_t HARDCODED_SERVER_X25519_PK[X25519_PK_SIZE] = {
  * This class is responsible for loading the beacon Ed25519 (signing) and
  * X25519 (encryption) key pairs from NVS. If the keys are not found or are
  * invalid, it generates new ones and persists them. It also manages the
- * server public key and derives the shared secret (AEAD key) required for
- * encrypted communication.
+ * server public key and derives the shared secret required for encrypted
+ * communication.
+ *
+ * The X25519 shared secret is not used as an AEAD key: it is the master key of a KDF
+ * (crypto_kdf, BLAKE2b) deriving one subkey per direction, so that the beacon and the server
+ * never encrypt with the same key and their message counters can both start at 0. Each cipher
+ * suite has its own pair of subkeys.
+ *
+ * The AEAD subkeys and their epoch are read by the tasks sealing and opening the messages while a
+ * rotation swaps them: they are guarded by a mutex, and handed out as copies.
  */
 class KeyManager {
 public:
+    /**
+     * @struct AeadKeys
+     * @brief The directional AEAD subkeys derived from the shared secret of a key pair, one pair
+     * per cipher suite (indexed by POL_AEAD_SUITE_*).
+     */
+    struct AeadKeys {
+        /// @brief Seals the messages of the beacon (subkey POL_AEAD_BEACON_TO_SERVER + suite
+        /// stride).
+        uint8_t seal[POL_AEAD_SUITE_COUNT][SHARED_KEY_SIZE];
+
+        /// @brief Opens the messages of the server (subkey POL_AEAD_SERVER_TO_BEACON + suite
+        /// stride).
+        uint8_t open[POL_AEAD_SUITE_COUNT][SHARED_KEY_SIZE];
+    };
+
     /**
      * @brief Constructs the KeyManager.
+     * @param backend The cryptographic primitives generating and deriving the keys.
      * @param serverX25519Pk The default server public key to use if one isn't found in NVS.
      */
-    KeyManager(const uint8_t (&serverX25519Pk)[X25519_PK_SIZE] = HARDCODED_SERVER_X25519_PK);
+    KeyManager(const ICryptoBackend& backend,
+               const uint8_t (&serverX25519Pk)[X25519_PK_SIZE] = HARDCODED_SERVER_X25519_PK);
 
     /**
      * @brief Initializes the KeyManager and all cryptographic keys.
@@ -52,34 +80,88 @@ public:
     /** @brief Gets the serverX25519 public key. */
     const uint8_t* getServerX25519Pk() const;
 
-    /** @brief Gets the derived shared secret for AEAD operations. */
-    const uint8_t* getAeadKey() const;
+    /**
+     * @brief Gets the epoch of the active AEAD key, sent in the header of each encrypted message.
+     *
+     * The epoch starts at 0 with a new key pair and is incremented (modulo 256) by each rotation.
+     */
+    uint8_t getKeyEpoch() const;
 
     /**
-     * @brief Derives a shared AEAD key using the pending (new) X25519 private key.
+     * @brief Gets the AEAD subkeys of an epoch: the active ones, the pending ones (active epoch +
+     * 1), or the ones of the RETIRED_KEYS last active key pairs.
      *
-     * This is used to test-decrypt a RotateKeyFinish command without activating the new key yet.
-     * @param sharedKeyOut Buffer where the derived temporary shared key will be written.
-     * @return True on success, false on failure.
+     * The pending subkeys are derived once by `prepareNewX25519KeyPair`, so selecting them costs
+     * no scalar multiplication.
+     * @param epoch The epoch of the subkeys.
+     * @param keysOut Receives a copy of the subkeys, to be wiped by the caller.
+     * @return False if the epoch is not live.
      */
-    bool deriveAEADSharedKeyWithPendingKey(uint8_t sharedKeyOut[SHARED_KEY_SIZE]) const;
+    bool getAeadKeysForEpoch(uint8_t epoch, AeadKeys& keysOut) const;
 
-    /** @brief Prepares a new X25519 keypair and temporarily store it. */
-    void prepareNewX25519KeyPair();
+    /** @brief Checks whether an epoch is the one of the pending key. */
+    bool isPendingEpoch(uint8_t epoch) const;
 
-    /** @brief Activates the new prepared X25519 keypair and saves it in the NVS. */
+    /**
+     * @brief Prepares a new X25519 keypair, derives its AEAD subkeys and temporarily store them.
+     * @return False if the AEAD subkeys derivation failed, no rotation is then pending.
+     */
+    bool prepareNewX25519KeyPair();
+
+    /**
+     * @brief Activates the new prepared X25519 keypair and saves it in the NVS with its epoch.
+     *
+     * The pair and its epoch are written at once before they are activated, so that a failed
+     * write keeps the previous pair active.
+     * The previous AEAD subkeys are retired, and still accepted for the messages sealed before
+     * the rotation (kept in RAM only).
+     * @return False if no rotation is pending or if the keys could not be stored.
+     */
     bool activateNewX25519KeyPair();
 
     /** @brief Gets the temporary prepared X25519 keypair. */
     const uint8_t* getNewX25519Pk() const;
 
+    /// @brief The number of retired AEAD subkey pairs still accepted for decryption.
+    static constexpr size_t RETIRED_KEYS = 2;
+
 private:
+    /**
+     * @struct RetiredKey
+     * @brief AEAD subkeys replaced by a rotation, with their epoch.
+     */
+    struct RetiredKey {
+        bool used = false;
+        uint8_t epoch = 0;
+        AeadKeys keys;
+    };
+
+    /** @brief Returns the AEAD subkeys of an epoch, or nullptr. Called with the mutex held. */
+    const AeadKeys* findAeadKeysLocked(uint8_t epoch) const;
+
+    /** @brief Checks whether an epoch is the one of the pending key. Called with the mutex held. */
+    bool isPendingEpochLocked(uint8_t epoch) const;
+
     /** @brief Loads or generates and stores the Ed25519 key pair. */
     bool manageEd25519KeyPair(uint8_t pk_out[Ed25519_PK_SIZE], uint8_t sk_out[Ed25519_SK_SIZE]);
 
     /** @brief Loads or generates and stores the X25519 key pair. */
     bool manageX25519KeyPair(uint8_t pk_out[X25519_PK_SIZE], uint8_t sk_out[X25519_SK_SIZE]);
 
+    /**
+     * @brief Stores an X25519 key pair with its epoch in a single NVS blob
+     * [sk (32)][pk (32)][epoch (1)], so that a reset never leaves a key with the epoch of another.
+     */
+    bool storeX25519KeyPair(const uint8_t pk[X25519_PK_SIZE], const uint8_t sk[X25519_SK_SIZE],
+                            uint8_t epoch);
+
+    /**
+     * @brief Loads the X25519 key pair and its epoch. The separate entries of the previous
+     * firmware versions are moved to the single blob.
+     */
+    bool loadX25519KeyPair(uint8_t pk_out[X25519_PK_SIZE], uint8_t sk_out[X25519_SK_SIZE],
+                           uint8_t& epochOut);
+
     /** @brief Loads or uses the hardcoded default for the server public key. */
     bool manageServerX25519PublicKey(uint8_t pk_out[X25519_PK_SIZE],
                                      const uint8_t hardcoded_pk[X25519_PK_SIZE]);
@@ -92,9 +174,11 @@ private:
     void generateX25519KeyPair(uint8_t publicKeyOut[X25519_PK_SIZE],
                                uint8_t secretKeyOut[X25519_SK_SIZE]);
 
-    /** @brief Derives the shared AEAD key from our private key and the server public key. */
-    bool deriveAEADSharedKey(uint8_t sharedKeyOut[SHARED_KEY_SIZE],
-                             const uint8_t x25519SecretKey[X25519_SK_SIZE],
+    /**
+     * @brief Derives the directional AEAD subkeys from the shared secret of our private key and
+     * the server public key.
+     */
+    bool deriveAEADSharedKey(AeadKeys& keysOut, const uint8_t x25519SecretKey[X25519_SK_SIZE],
                              const uint8_t serverX25519PublicKey[X25519_PK_SIZE]);
 
     /** @brief Helper to load a key from NVS. */
@@ -106,6 +190,9 @@ private:
     /** @brief Helper to print a key to the serial monitor for debugging. */
     void printKey(const size_t keyLength, const uint8_t* key) const;
 
+    /// @brief The cryptographic primitives.
+    const ICryptoBackend& _backend;
+
     /// @brief Handle to the NVS storage library.
     Preferences _prefs;
 
@@ -127,14 +214,30 @@ private:
     /// @brief The server public key for Diffie-Hellman key exchange (X25519).
     uint8_t _serverX25519Pk[X25519_PK_SIZE];
 
-    /// @brief The derived shared secret key for symmetric encryption (AEAD).
-    uint8_t _aeadKey[SHARED_KEY_SIZE];
+    /// @brief Guards the AEAD subkeys, their epoch and the rotation state.
+    SemaphoreHandle_t _mutex = nullptr;
+
+    /// @brief The AEAD subkeys derived from the active key pair.
+    AeadKeys _aeadKeys;
 
     /// @brief The temporary X25519 secret key to be used for key rotation.
     uint8_t _new_x25519Sk[X25519_SK_SIZE];
 
     /// @brief The temporary X25519 public key to be used for key rotation.
     uint8_t _new_x25519Pk[X25519_PK_SIZE];
+
+    /// @brief The AEAD subkeys derived from the temporary X25519 secret key.
+    AeadKeys _pendingAeadKeys;
+
+    /// @brief True between the preparation and the activation of a new key pair.
+    bool _rotationPending = false;
+
+    /// @brief The epoch of the active AEAD subkeys.
+    uint8_t _keyEpoch = 0;
+
+    /// @brief The last retired AEAD subkeys, the next ones replace `_retired[_nextRetired]`.
+    RetiredKey _retired[RETIRED_KEYS];
+    size_t _nextRetired = 0;
 };
 
 #endif  // KEY_STORAGE_H
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "latency_tracker.h"
+
+#include <string.h>
+
+namespace {
+/// @brief The upper bounds (inclusive) of the buckets, in ms. The last bucket has none.
+constexpr uint32_t BUCKET_BOUNDS_MS[LatencyTracker::NUM_BUCKETS - 1] = {1,  2,   5,   10,  20,
+                                                                         50, 100, 200, 500, 1000};
+
+/// @brief The JSON keys of the stages, in Stage order.
+constexpr const char* STAGE_KEYS[LatencyTracker::NUM_STAGES] = {"queue", "verify", "sign", "send",
+                                                                 "total"};
+}  // namespace
+
+void LatencyTracker::markArrival(uint32_t writeUs, uint32_t dequeueUs) {
+    _lastWriteUs = writeUs;
+    _lastDequeueUs = dequeueUs;
+}
+
+uint32_t LatencyTracker::lastWriteUs() const {
+    return _lastWriteUs;
+}
+
+uint32_t LatencyTracker::lastDequeueUs() const {
+    return _lastDequeueUs;
+}
+
+void LatencyTracker::record(Stage stage, uint32_t startUs, uint32_t endUs) {
+    // Unsigned arithmetic handles the wrap of micros().
+    size_t bucket = bucketOf(endUs - startUs);
+
+    taskENTER_CRITICAL(&_lock);
+    _counts[static_cast<size_t>(stage)][bucket]++;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void LatencyTracker::report(JsonObject& out, bool reset) {
+    uint32_t counts[NUM_STAGES][NUM_BUCKETS];
+    taskENTER_CRITICAL(&_lock);
+    memcpy(counts, _counts, sizeof(counts));
+    if (reset) {
+        memset(_counts, 0, sizeof(_counts));
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    JsonArray bounds = out["le_ms"].to<JsonArray>();
+    for (uint32_t bound : BUCKET_BOUNDS_MS) {
+        bounds.add(bound);
+    }
+
+    for (size_t stage = 0; stage < NUM_STAGES; ++stage) {
+        JsonArray histogram = out[STAGE_KEYS[stage]].to<JsonArray>();
+        for (uint32_t count : counts[stage]) {
+            histogram.add(count);
+        }
+    }
+
+    // The alerting percentiles, as the bucket bound holding them (-1 for the overflow bucket).
+    const uint32_t* total = counts[static_cast<size_t>(Stage::Total)];
+    uint32_t p95 = percentileMs(total, 95);
+    uint32_t p99 = percentileMs(total, 99);
+    out["p95_ms"] = p95 == UINT32_MAX ? -1 : (int32_t)p95;
+    out["p99_ms"] = p99 == UINT32_MAX ? -1 : (int32_t)p99;
+    out["reset"] = reset;
+}
+
+size_t LatencyTracker::bucketOf(uint32_t durationUs) {
+    for (size_t i = 0; i < NUM_BUCKETS - 1; ++i) {
+        if (durationUs <= BUCKET_BOUNDS_MS[i] * 1000) {
+            return i;
+        }
+    }
+    return NUM_BUCKETS - 1;
+}
+
+uint32_t LatencyTracker::percentileMs(const uint32_t counts[NUM_BUCKETS], uint8_t percent) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    // The smallest bucket covering the percentile, rounding the rank up.
+    uint64_t rank = (total * percent + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < NUM_BUCKETS - 1; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return BUCKET_BOUNDS_MS[i];
+        }
+    }
+    return UINT32_MAX;
+}
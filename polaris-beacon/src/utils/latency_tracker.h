@@ -0,0 +1,100 @@
+#ifndef LATENCY_TRACKER_H
+#define LATENCY_TRACKER_H
+
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class LatencyTracker
+ * @brief Fixed-bucket histograms of the token issuance latency, per stage.
+ *
+ * A token goes through these timestamps: the write callback of the request characteristic, the
+ * dequeue by the token processor task, the end of the batch verification, the end of the batch
+ * signing, and the return of the last indication of the response (on Bluedroid, `indicate` returns
+ * once the phone confirmed it). The stages are the intervals between them, plus the total.
+ *
+ * The histograms share the bucket bounds reported with them (1 ms to 1 s, in 1-2-5 steps), the
+ * last bucket counts everything above. They are reported by the status command, and only reset
+ * when the command asks for it ("reset_latency"), so the server chooses the intervals it computes
+ * its percentiles over and a plain status request loses nothing.
+ *
+ * The token processor task records, the encrypted processor task reports: every access to the
+ * histograms is guarded by a critical section.
+ */
+class LatencyTracker {
+public:
+    /**
+     * @enum Stage
+     * @brief The measured intervals of a token.
+     */
+    enum class Stage : uint8_t {
+        Queue,   ///< From the write callback to the dequeue.
+        Verify,  ///< From the dequeue to the end of the batch verification.
+        Sign,    ///< From the end of the verification to the end of the signing.
+        Send,    ///< From the end of the signing to the last indication.
+        Total    ///< From the write callback to the last indication.
+    };
+
+    /// @brief The number of stages.
+    static constexpr size_t NUM_STAGES = 5;
+
+    /// @brief The number of buckets of a histogram, including the overflow bucket.
+    static constexpr size_t NUM_BUCKETS = 11;
+
+    /**
+     * @brief Records the arrival of the request chunk about to be processed.
+     *
+     * Called by the token processor task before handing the chunk to the handler, which reads
+     * the timestamps back with `lastWriteUs` and `lastDequeueUs`.
+     * @param writeUs The time (micros) of the write callback.
+     * @param dequeueUs The time (micros) of the dequeue.
+     */
+    void markArrival(uint32_t writeUs, uint32_t dequeueUs);
+
+    /** @brief The write time (micros) of the last chunk passed to `markArrival`. */
+    uint32_t lastWriteUs() const;
+
+    /** @brief The dequeue time (micros) of the last chunk passed to `markArrival`. */
+    uint32_t lastDequeueUs() const;
+
+    /**
+     * @brief Adds an interval to the histogram of a stage.
+     * @param stage The stage.
+     * @param startUs The start of the interval (micros).
+     * @param endUs The end of the interval (micros).
+     */
+    void record(Stage stage, uint32_t startUs, uint32_t endUs);
+
+    /**
+     * @brief Writes the histograms into a status object.
+     * @param out The object receiving the bucket bounds, the histograms, the total percentiles
+     * and whether the histograms were reset.
+     * @param reset True to reset the histograms once read, atomically.
+     */
+    void report(JsonObject& out, bool reset);
+
+private:
+    /** @brief Returns the bucket of a duration. */
+    static size_t bucketOf(uint32_t durationUs);
+
+    /**
+     * @brief Returns the upper bound of the bucket holding a percentile.
+     * @return The bound in ms, 0 if the histogram is empty, UINT32_MAX if it is the overflow
+     * bucket.
+     */
+    static uint32_t percentileMs(const uint32_t counts[NUM_BUCKETS], uint8_t percent);
+
+    /// @brief Protects the histograms.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The bucket counts of each stage.
+    uint32_t _counts[NUM_STAGES][NUM_BUCKETS] = {};
+
+    /// @brief The arrival of the last chunk, only used by the token processor task.
+    uint32_t _lastWriteUs = 0;
+    uint32_t _lastDequeueUs = 0;
+};
+
+#endif  // LATENCY_TRACKER_H
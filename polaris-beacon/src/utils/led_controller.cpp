@@ -7,6 +7,7 @@ LedController* LedController::instance = nullptr;
 
 LedController::LedController() : _pixels(NUM_NEOPIXELS, PIN_NEOPIXEL, NEO_GRB + NEO_KHZ800) {
     instance = this;
+    _mutex = xSemaphoreCreateMutex();
 }
 
 void LedController::begin() {
@@ -21,9 +22,11 @@ void LedController::begin() {
 }
 
 void LedController::startBlinking(float frequency, uint32_t color) {
-    stopBlinking();  // Always stop any previous ticker before starting a new one.
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    stopBlinkingLocked();  // Always stop any previous ticker before starting a new one.
 
     if (frequency <= 0) {
+        xSemaphoreGive(_mutex);
         Serial.printf("%s Frequency is zero or negative. Stopping blink.", TAG);
         return;
     }
@@ -31,13 +34,22 @@ void LedController::startBlinking(float frequency, uint32_t color) {
     _blinkColor = color;
     _ledState = false;  // Start with the LED off, so the first tick turns it on.
 
-    uint32_t period_ms = 500 / frequency;
-    _ticker.attach_ms(period_ms, onTickStatic);
+    _periodMs = 500 / frequency;
+    if (!_isPaused) {
+        _ticker.attach_ms(_periodMs, onTickStatic);
+    }
+    xSemaphoreGive(_mutex);
 
     Serial.printf("%s Started blinking at %.2f Hz with color 0x%06X.\n", TAG, frequency, color);
 }
 
 void LedController::stopBlinking() {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    stopBlinkingLocked();
+    xSemaphoreGive(_mutex);
+}
+
+void LedController::stopBlinkingLocked() {
     if (_isBlinking) {
         _ticker.detach();
         _isBlinking = false;
@@ -46,6 +58,22 @@ void LedController::stopBlinking() {
     }
 }
 
+void LedController::setPaused(bool paused) {
+    xSemaphoreTake(_mutex, portMAX_DELAY);
+    if (paused != _isPaused) {
+        _isPaused = paused;
+        if (_isBlinking && paused) {
+            _ticker.detach();
+            _pixels.clear();
+            _pixels.show();
+        } else if (_isBlinking) {
+            _ledState = false;
+            _ticker.attach_ms(_periodMs, onTickStatic);
+        }
+    }
+    xSemaphoreGive(_mutex);
+}
+
 void LedController::onTickStatic() {
     if (instance) {
         instance->handleTick();
@@ -53,8 +81,13 @@ void LedController::onTickStatic() {
 }
 
 void LedController::handleTick() {
-    if (!_isBlinking)
+    // The timer task must not block: a tick racing with a start, stop or pause is skipped.
+    if (xSemaphoreTake(_mutex, 0) != pdTRUE)
         return;
+    if (!_isBlinking) {
+        xSemaphoreGive(_mutex);
+        return;
+    }
 
     _ledState = !_ledState;
 
@@ -64,4 +97,5 @@ void LedController::handleTick() {
         _pixels.clear();
     }
     _pixels.show();
+    xSemaphoreGive(_mutex);
 }
\ No newline at end of file
@@ -3,6 +3,8 @@
 
 #include <Adafruit_NeoPixel.h>
 #include <Ticker.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
 
 #include "protocol/pol_constants.h"
 
@@ -13,6 +15,9 @@
  * This class provides a high-level interface to control the built-in NeoPixel,
  * abstracting the details of the Adafruit_NeoPixel library. It supports starting
  * and stopping a non-blocking blinking effect at a specified frequency and color.
+ *
+ * The blink is started and stopped by the command handlers and paused by the load shedder, from
+ * different tasks: these calls are serialized by a mutex.
  */
 class LedController {
 public:
@@ -40,7 +45,18 @@ public:
      */
     void stopBlinking();
 
+    /**
+     * @brief Pauses or resumes the blinking effect, to save CPU time under load.
+     *
+     * A blink started while paused is remembered, and starts when resumed.
+     * @param paused True to pause.
+     */
+    void setPaused(bool paused);
+
 private:
+    /// @brief Stops the blinking effect. Called with the mutex held.
+    void stopBlinkingLocked();
+
     /// @brief Static trampoline function for the Ticker callback.
     static void onTickStatic();
 
@@ -50,6 +66,9 @@ private:
     /// @brief The underlying NeoPixel driver object from the Adafruit library.
     Adafruit_NeoPixel _pixels;
 
+    /// @brief Guards the ticker and the blink state against concurrent start, stop and pause.
+    SemaphoreHandle_t _mutex = nullptr;
+
     /// @brief The Ticker object that drives the blinking effect.
     Ticker _ticker;
 
@@ -62,6 +81,12 @@ private:
     /// @brief The color to use for the blinking effect.
     volatile uint32_t _blinkColor = 0;
 
+    /// @brief The period of the blinking ticker.
+    uint32_t _periodMs = 0;
+
+    /// @brief True while the blinking is paused.
+    volatile bool _isPaused = false;
+
     /// @brief A tag used for logging from this class.
     static constexpr const char* TAG = "[LedController]";
 
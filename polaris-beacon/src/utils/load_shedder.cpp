@@ -0,0 +1,145 @@
+#include "load_shedder.h"
+
+#include <HardwareSerial.h>
+
+#include <algorithm>
+
+void LoadShedder::begin(LevelChangeCallback callback) {
+    _onLevelChange = callback;
+}
+
+void LoadShedder::reportTokenQueue(size_t pending, size_t capacity, bool dropped) {
+    taskENTER_CRITICAL(&_lock);
+    if (pending > _peakPending) {
+        _peakPending = pending;
+    }
+    _queueCapacity = capacity;
+    _dropped = _dropped || dropped;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void LoadShedder::addTokenBusyTime(uint32_t busyUs) {
+    taskENTER_CRITICAL(&_lock);
+    _busyUs += busyUs;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+void LoadShedder::update(uint32_t nowMs, size_t outgoingDepth, uint32_t freeHeap) {
+    taskENTER_CRITICAL(&_lock);
+    size_t peak = _peakPending;
+    size_t capacity = _queueCapacity;
+    bool dropped = _dropped;
+    uint32_t busyUs = _busyUs;
+    _peakPending = 0;
+    _dropped = false;
+    _busyUs = 0;
+    taskEXIT_CRITICAL(&_lock);
+
+    uint32_t elapsedMs = _lastSampleMs == 0 ? 0 : nowMs - _lastSampleMs;
+    _lastSampleMs = nowMs;
+
+    Level sample = std::max(std::max(queueLevel(peak, capacity, dropped),
+                                     busyLevel(busyUs, elapsedMs)),
+                            std::max(outgoingLevel(outgoingDepth), heapLevel(freeHeap)));
+
+    // Only the main loop changes the level, it can be read here without the lock.
+    Level previous = _level;
+    Level next = previous;
+    if (sample >= previous) {
+        next = sample;
+        _calmSamples = 0;
+    } else if (++_calmSamples >= CALM_SAMPLES) {
+        next = static_cast<Level>(static_cast<uint8_t>(previous) - 1);
+        _calmSamples = 0;
+    }
+    if (next == previous) {
+        return;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    _level = next;
+    taskEXIT_CRITICAL(&_lock);
+
+    Serial.printf("%s Load level %s -> %s (queue %u/%u%s, busy %u ms in %u ms, outgoing %u, "
+                  "heap %u).\n",
+                  TAG, nameOf(previous), nameOf(next), (unsigned)peak, (unsigned)capacity,
+                  dropped ? " dropped" : "", busyUs / 1000, elapsedMs, (unsigned)outgoingDepth,
+                  freeHeap);
+    if (_onLevelChange) {
+        _onLevelChange(previous, next);
+    }
+}
+
+LoadShedder::Level LoadShedder::getLevel() {
+    taskENTER_CRITICAL(&_lock);
+    Level level = _level;
+    taskEXIT_CRITICAL(&_lock);
+    return level;
+}
+
+bool LoadShedder::defersUi() {
+    return getLevel() >= Level::Elevated;
+}
+
+bool LoadShedder::defersBackgroundMessages() {
+    return getLevel() >= Level::High;
+}
+
+bool LoadShedder::refusesPullRequests() {
+    return getLevel() >= Level::Critical;
+}
+
+LoadShedder::Level LoadShedder::queueLevel(size_t peak, size_t capacity, bool dropped) {
+    if (dropped) {
+        return Level::Critical;
+    }
+    if (capacity == 0 || peak * 2 < capacity) {
+        return Level::Normal;
+    }
+    return peak >= capacity ? Level::High : Level::Elevated;
+}
+
+LoadShedder::Level LoadShedder::busyLevel(uint32_t busyUs, uint32_t elapsedMs) {
+    if (elapsedMs == 0) {
+        return Level::Normal;
+    }
+    uint32_t percent = busyUs / 10 / elapsedMs;
+    if (percent >= BUSY_CRITICAL_PERCENT) {
+        return Level::Critical;
+    }
+    if (percent >= BUSY_HIGH_PERCENT) {
+        return Level::High;
+    }
+    return percent >= BUSY_ELEVATED_PERCENT ? Level::Elevated : Level::Normal;
+}
+
+LoadShedder::Level LoadShedder::outgoingLevel(size_t depth) {
+    if (depth >= OUTGOING_HIGH) {
+        return Level::High;
+    }
+    return depth >= OUTGOING_ELEVATED ? Level::Elevated : Level::Normal;
+}
+
+LoadShedder::Level LoadShedder::heapLevel(uint32_t freeHeap) {
+    if (freeHeap < HEAP_CRITICAL_BYTES) {
+        return Level::Critical;
+    }
+    if (freeHeap < HEAP_HIGH_BYTES) {
+        return Level::High;
+    }
+    return freeHeap < HEAP_ELEVATED_BYTES ? Level::Elevated : Level::Normal;
+}
+
+const char* LoadShedder::nameOf(Level level) {
+    switch (level) {
+        case Level::Normal:
+            return "normal";
+        case Level::Elevated:
+            return "elevated";
+        case Level::High:
+            return "high";
+        case Level::Critical:
+            return "critical";
+    }
+    return "?";
+}
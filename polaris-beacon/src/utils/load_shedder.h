@@ -0,0 +1,151 @@
+#ifndef LOAD_SHEDDER_H
+#define LOAD_SHEDDER_H
+
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+
+/**
+ * @class LoadShedder
+ * @brief Moves the beacon through load levels, so that everything but the token service is shed
+ * under saturation.
+ *
+ * Each sample (`update`, called by the main loop) takes the worst of four signals:
+ * - the peak token queue occupancy since the previous sample, and whether a request was dropped,
+ * - the share of the sample the token processor task spent processing requests,
+ * - the depth of the outgoing message queue,
+ * - the free heap.
+ *
+ * The level rises at once to the level of the sample, and falls one level at a time after
+ * CALM_SAMPLES samples below the current level, so that it does not flap at a threshold.
+ *
+ * The levels shed, cumulatively:
+ * - Elevated: the display and LED updates are deferred.
+ * - High: the non-urgent outgoing messages (token journal, visitor sketches) are deferred.
+ * - Critical: the data pull requests are refused. The level is published in the advertisement
+ *   so that phones retry later.
+ *
+ * The token requests are never shed. The reports come from the BLE callbacks and the token
+ * processor task, every method is guarded by a critical section.
+ */
+class LoadShedder {
+public:
+    /**
+     * @brief The load levels, ordered.
+     */
+    enum class Level : uint8_t {
+        Normal = 0,
+        Elevated = 1,
+        High = 2,
+        Critical = 3,
+    };
+
+    /**
+     * @brief A function type notified of each level change, from the main loop.
+     * @param previous The previous level.
+     * @param level The new level.
+     */
+    using LevelChangeCallback = std::function<void(Level previous, Level level)>;
+
+    /// @brief The number of samples below the current level needed to fall one level.
+    static constexpr uint8_t CALM_SAMPLES = 3;
+
+    /// @brief The token processor busy share (percent) of the Elevated, High and Critical levels.
+    static constexpr uint32_t BUSY_ELEVATED_PERCENT = 40;
+    static constexpr uint32_t BUSY_HIGH_PERCENT = 60;
+    static constexpr uint32_t BUSY_CRITICAL_PERCENT = 80;
+
+    /// @brief The outgoing queue depth of the Elevated and High levels.
+    static constexpr size_t OUTGOING_ELEVATED = 8;
+    static constexpr size_t OUTGOING_HIGH = 16;
+
+    /// @brief The free heap (bytes) under which the Elevated, High and Critical levels start.
+    static constexpr uint32_t HEAP_ELEVATED_BYTES = 48 * 1024;
+    static constexpr uint32_t HEAP_HIGH_BYTES = 32 * 1024;
+    static constexpr uint32_t HEAP_CRITICAL_BYTES = 16 * 1024;
+
+    /**
+     * @brief Sets the callback notified of the level changes.
+     */
+    void begin(LevelChangeCallback callback);
+
+    /**
+     * @brief Reports the token queue occupancy.
+     * @param pending The number of requests waiting.
+     * @param capacity The capacity of the queue.
+     * @param dropped True if a request was just dropped.
+     */
+    void reportTokenQueue(size_t pending, size_t capacity, bool dropped);
+
+    /**
+     * @brief Adds time spent by the token processor task on requests.
+     * @param busyUs The duration (micros).
+     */
+    void addTokenBusyTime(uint32_t busyUs);
+
+    /**
+     * @brief Samples the load signals and updates the level.
+     * @param nowMs The current time (millis).
+     * @param outgoingDepth The number of messages in the outgoing queue.
+     * @param freeHeap The free heap (bytes).
+     */
+    void update(uint32_t nowMs, size_t outgoingDepth, uint32_t freeHeap);
+
+    /** @brief Returns the current level. */
+    Level getLevel();
+
+    /** @brief True if the display and LED updates must be deferred. */
+    bool defersUi();
+
+    /** @brief True if the non-urgent outgoing messages must be deferred. */
+    bool defersBackgroundMessages();
+
+    /** @brief True if the data pull requests must be refused. */
+    bool refusesPullRequests();
+
+private:
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[LoadShedder]";
+
+    /** @brief Returns the level of the token queue signals. */
+    static Level queueLevel(size_t peak, size_t capacity, bool dropped);
+
+    /** @brief Returns the level of the token processor busy share. */
+    static Level busyLevel(uint32_t busyUs, uint32_t elapsedMs);
+
+    /** @brief Returns the level of the outgoing queue depth. */
+    static Level outgoingLevel(size_t depth);
+
+    /** @brief Returns the level of the free heap. */
+    static Level heapLevel(uint32_t freeHeap);
+
+    /** @brief Returns the name of a level, for the logs. */
+    static const char* nameOf(Level level);
+
+    /// @brief Protects the reported signals and the level.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The callback notified of the level changes.
+    LevelChangeCallback _onLevelChange;
+
+    /// @brief The current level.
+    Level _level = Level::Normal;
+
+    /// @brief The number of consecutive samples below the current level.
+    uint8_t _calmSamples = 0;
+
+    /// @brief The token queue signals since the previous sample.
+    size_t _peakPending = 0;
+    size_t _queueCapacity = 0;
+    bool _dropped = false;
+
+    /// @brief The token processor busy time since the previous sample.
+    uint32_t _busyUs = 0;
+
+    /// @brief The time (millis) of the previous sample, 0 before the first one.
+    uint32_t _lastSampleMs = 0;
+};
+
+#endif  // LOAD_SHEDDER_H
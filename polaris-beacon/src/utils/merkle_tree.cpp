@@ -0,0 +1,74 @@
+#include "merkle_tree.h"
+
+#include <sodium.h>
+#include <string.h>
+
+namespace {
+constexpr uint8_t LEAF_DOMAIN = 0x00;
+constexpr uint8_t NODE_DOMAIN = 0x01;
+}  // namespace
+
+void MerkleTree::hashLeaf(uint8_t out[MERKLE_HASH_SIZE], const uint8_t* data, size_t len) {
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, MERKLE_HASH_SIZE);
+    crypto_generichash_update(&state, &LEAF_DOMAIN, sizeof(LEAF_DOMAIN));
+    crypto_generichash_update(&state, data, len);
+    crypto_generichash_final(&state, out, MERKLE_HASH_SIZE);
+}
+
+void MerkleTree::hashNode(uint8_t out[MERKLE_HASH_SIZE], const uint8_t left[MERKLE_HASH_SIZE],
+                          const uint8_t right[MERKLE_HASH_SIZE]) {
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, MERKLE_HASH_SIZE);
+    crypto_generichash_update(&state, &NODE_DOMAIN, sizeof(NODE_DOMAIN));
+    crypto_generichash_update(&state, left, MERKLE_HASH_SIZE);
+    crypto_generichash_update(&state, right, MERKLE_HASH_SIZE);
+    crypto_generichash_final(&state, out, MERKLE_HASH_SIZE);
+}
+
+bool MerkleTree::build(const uint8_t leaves[][MERKLE_HASH_SIZE], size_t count,
+                       uint8_t rootOut[MERKLE_HASH_SIZE], MerkleProof proofsOut[]) {
+    if (count == 0 || count > MERKLE_MAX_LEAVES) {
+        return false;
+    }
+
+    // The current level, computed in place: level[i] is the node covering the leaves of node i.
+    uint8_t level[MERKLE_MAX_LEAVES][MERKLE_HASH_SIZE];
+    memcpy(level, leaves, count * MERKLE_HASH_SIZE);
+
+    // The position of each leaf ancestor in the current level.
+    size_t position[MERKLE_MAX_LEAVES];
+    for (size_t i = 0; i < count; ++i) {
+        proofsOut[i].leafIndex = (uint8_t)i;
+        proofsOut[i].leafCount = (uint8_t)count;
+        proofsOut[i].pathLen = 0;
+        position[i] = i;
+    }
+
+    size_t width = count;
+    while (width > 1) {
+        // Record the sibling of each leaf ancestor before the level is overwritten.
+        for (size_t i = 0; i < count; ++i) {
+            size_t sibling = position[i] ^ 1;
+            if (sibling < width) {
+                memcpy(proofsOut[i].path[proofsOut[i].pathLen++], level[sibling],
+                       MERKLE_HASH_SIZE);
+            }
+            position[i] /= 2;
+        }
+
+        size_t next = 0;
+        for (size_t i = 0; i < width; i += 2) {
+            if (i + 1 < width) {
+                hashNode(level[next], level[i], level[i + 1]);
+            } else {
+                memmove(level[next], level[i], MERKLE_HASH_SIZE);  // Promoted
+            }
+            next++;
+        }
+        width = next;
+    }
+
+    memcpy(rootOut, level[0], MERKLE_HASH_SIZE);
+    return true;
+}
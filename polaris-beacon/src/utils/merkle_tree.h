@@ -0,0 +1,63 @@
+#ifndef MERKLE_TREE_H
+#define MERKLE_TREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../protocol/pol_constants.h"
+
+/**
+ * @struct MerkleProof
+ * @brief The authentication path of a leaf, from the leaf level up to the root.
+ */
+struct MerkleProof {
+    /// @brief The position of the leaf.
+    uint8_t leafIndex = 0;
+
+    /// @brief The number of leaves in the tree.
+    uint8_t leafCount = 0;
+
+    /// @brief The number of hashes in `path`.
+    uint8_t pathLen = 0;
+
+    /// @brief The sibling hashes, leaf level first.
+    uint8_t path[MERKLE_MAX_DEPTH][MERKLE_HASH_SIZE];
+};
+
+/**
+ * @class MerkleTree
+ * @brief A small binary hash tree, used to sign a batch of tokens with one signature.
+ *
+ * Hashes are BLAKE2b-256 (`crypto_generichash`), with a domain byte separating leaves (0x00) from
+ * inner nodes (0x01). A node without sibling at a level is promoted unchanged to the next level,
+ * so the path of a leaf has no entry for that level. A verifier walks up from the leaf using the
+ * leaf index and the leaf count to know on which side each sibling is.
+ */
+class MerkleTree {
+public:
+    /**
+     * @brief Hashes the data of a leaf.
+     * @param out Receives the leaf hash.
+     * @param data The leaf data.
+     * @param len The length of the data.
+     */
+    static void hashLeaf(uint8_t out[MERKLE_HASH_SIZE], const uint8_t* data, size_t len);
+
+    /**
+     * @brief Computes the root of a tree and the proof of each leaf.
+     * @param leaves The leaf hashes.
+     * @param count The number of leaves, at most MERKLE_MAX_LEAVES.
+     * @param rootOut Receives the root.
+     * @param proofsOut Receives the proof of each leaf, `count` entries.
+     * @return False if `count` is 0 or too large.
+     */
+    static bool build(const uint8_t leaves[][MERKLE_HASH_SIZE], size_t count,
+                      uint8_t rootOut[MERKLE_HASH_SIZE], MerkleProof proofsOut[]);
+
+private:
+    /** @brief Hashes two child nodes. */
+    static void hashNode(uint8_t out[MERKLE_HASH_SIZE], const uint8_t left[MERKLE_HASH_SIZE],
+                         const uint8_t right[MERKLE_HASH_SIZE]);
+};
+
+#endif  // MERKLE_TREE_H
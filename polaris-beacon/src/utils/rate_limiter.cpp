@@ -0,0 +1,78 @@
+#include "rate_limiter.h"
+
+bool RateLimiter::allows(uint64_t phoneId, uint32_t now, uint32_t* retryAfterMs) {
+    bool allowed = true;
+
+    taskENTER_CRITICAL(&_lock);
+    Bucket* bucket = find(phoneId);
+    if (bucket) {
+        refill(*bucket, now);
+        allowed = bucket->tokens > 0;
+        if (!allowed && retryAfterMs) {
+            *retryAfterMs = REFILL_INTERVAL_MS - (now - bucket->refilledAtMs);
+        }
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    return allowed;
+}
+
+void RateLimiter::consume(uint64_t phoneId, uint32_t now) {
+    taskENTER_CRITICAL(&_lock);
+    Bucket* bucket = find(phoneId);
+    if (!bucket) {
+        // Take a free entry, or evict the least recently served phone.
+        bucket = &_buckets[0];
+        for (Bucket& candidate : _buckets) {
+            if (!candidate.used) {
+                bucket = &candidate;
+                break;
+            }
+            if (now - candidate.servedAtMs > now - bucket->servedAtMs) {
+                bucket = &candidate;
+            }
+        }
+        bucket->used = true;
+        bucket->phoneId = phoneId;
+        bucket->tokens = BURST;
+        bucket->refilledAtMs = now;
+    }
+
+    refill(*bucket, now);
+    if (bucket->tokens > 0) {
+        bucket->tokens--;
+    }
+    bucket->servedAtMs = now;
+    taskEXIT_CRITICAL(&_lock);
+}
+
+bool RateLimiter::wasServedRecently(uint64_t phoneId, uint32_t now) {
+    taskENTER_CRITICAL(&_lock);
+    Bucket* bucket = find(phoneId);
+    bool recent = bucket && now - bucket->servedAtMs < RECENTLY_SERVED_MS;
+    taskEXIT_CRITICAL(&_lock);
+    return recent;
+}
+
+RateLimiter::Bucket* RateLimiter::find(uint64_t phoneId) {
+    for (Bucket& bucket : _buckets) {
+        if (bucket.used && bucket.phoneId == phoneId) {
+            return &bucket;
+        }
+    }
+    return nullptr;
+}
+
+void RateLimiter::refill(Bucket& bucket, uint32_t now) {
+    uint32_t earned = (now - bucket.refilledAtMs) / REFILL_INTERVAL_MS;
+    if (earned == 0) {
+        return;
+    }
+    if (bucket.tokens + earned >= BURST) {
+        bucket.tokens = BURST;
+        bucket.refilledAtMs = now;
+    } else {
+        bucket.tokens += earned;
+        bucket.refilledAtMs += earned * REFILL_INTERVAL_MS;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @class RateLimiter
+ * @brief A per-phone token bucket limiting the PoL tokens issued to each phone.
+ *
+ * Each phone gets BURST tokens, refilled at one token per REFILL_INTERVAL_MS. The buckets live in
+ * a fixed table of MAX_PHONES entries, and the least recently served phone is evicted when a new
+ * phone needs an entry (its bucket is then full again, which is the state of an unknown phone).
+ *
+ * Only `consume` creates entries. It must be called once a request was verified, so that forged
+ * requests can neither drain the bucket of another phone nor evict it.
+ *
+ * The table is shared by the token processor task and the BLE callbacks (queue admission), every
+ * method is guarded by a critical section.
+ */
+class RateLimiter {
+public:
+    /// @brief The number of phones tracked.
+    static constexpr size_t MAX_PHONES = 16;
+
+    /// @brief The number of tokens a phone can get in a row.
+    static constexpr uint8_t BURST = 3;
+
+    /// @brief The time needed to refill one token.
+    static constexpr uint32_t REFILL_INTERVAL_MS = 5000;
+
+    /// @brief A phone served less than this long ago is not admitted in the last queue slot.
+    static constexpr uint32_t RECENTLY_SERVED_MS = 10000;
+
+    /**
+     * @brief Checks whether a phone has a token left, without consuming it.
+     * @param phoneId The phone ID.
+     * @param now The current time (millis).
+     * @param retryAfterMs If not null, receives the time until the next token when none is left.
+     * @return True if a request of the phone can be served.
+     */
+    bool allows(uint64_t phoneId, uint32_t now, uint32_t* retryAfterMs = nullptr);
+
+    /**
+     * @brief Consumes a token of a phone, creating its entry if needed.
+     * @param phoneId The phone ID.
+     * @param now The current time (millis).
+     */
+    void consume(uint64_t phoneId, uint32_t now);
+
+    /**
+     * @brief Checks whether a phone was served less than RECENTLY_SERVED_MS ago.
+     * @param phoneId The phone ID.
+     * @param now The current time (millis).
+     */
+    bool wasServedRecently(uint64_t phoneId, uint32_t now);
+
+private:
+    /**
+     * @struct Bucket
+     * @brief The token bucket of a phone.
+     */
+    struct Bucket {
+        bool used = false;
+        uint64_t phoneId = 0;
+
+        /// @brief The tokens left at `refilledAtMs`.
+        uint8_t tokens = 0;
+
+        /// @brief The time (millis) the tokens were last refilled.
+        uint32_t refilledAtMs = 0;
+
+        /// @brief The time (millis) of the last consumed token, for the LRU eviction.
+        uint32_t servedAtMs = 0;
+    };
+
+    /** @brief Finds the bucket of a phone. Must be called in the critical section. */
+    Bucket* find(uint64_t phoneId);
+
+    /** @brief Adds the tokens earned since the last refill. */
+    static void refill(Bucket& bucket, uint32_t now);
+
+    /// @brief The buckets.
+    Bucket _buckets[MAX_PHONES];
+
+    /// @brief Protects the buckets.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+};
+
+#endif  // RATE_LIMITER_H
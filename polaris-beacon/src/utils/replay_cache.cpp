@@ -0,0 +1,58 @@
+#include "replay_cache.h"
+
+#include <string.h>
+
+ReplayCache::ReplayCache() {
+    crypto_shorthash_keygen(_key);
+}
+
+bool ReplayCache::contains(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                           uint64_t epoch) const {
+    uint64_t fp = fingerprint(phoneId, nonce);
+    const Bucket& bucket = _buckets[fp & (NUM_BUCKETS - 1)];
+
+    for (const Entry& entry : bucket.ways) {
+        if (entry.used && entry.epoch == (uint32_t)epoch && entry.fingerprint == fp) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ReplayCache::insert(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                         uint64_t epoch) {
+    uint64_t fp = fingerprint(phoneId, nonce);
+    Bucket& bucket = _buckets[fp & (NUM_BUCKETS - 1)];
+
+    // Prefer a free way, or one left over from a previous epoch.
+    Entry* target = nullptr;
+    for (Entry& entry : bucket.ways) {
+        if (!entry.used || entry.epoch != (uint32_t)epoch) {
+            target = &entry;
+            break;
+        }
+    }
+
+    if (!target) {
+        target = &bucket.ways[bucket.next];
+        bucket.next = (bucket.next + 1) % BUCKET_WAYS;
+    }
+
+    target->fingerprint = fp;
+    target->epoch = (uint32_t)epoch;
+    target->used = true;
+}
+
+uint64_t ReplayCache::fingerprint(uint64_t phoneId,
+                                  const uint8_t nonce[PROTOCOL_NONCE_SIZE]) const {
+    uint8_t input[sizeof(phoneId) + PROTOCOL_NONCE_SIZE];
+    memcpy(input, &phoneId, sizeof(phoneId));
+    memcpy(input + sizeof(phoneId), nonce, PROTOCOL_NONCE_SIZE);
+
+    uint8_t hash[crypto_shorthash_BYTES];
+    crypto_shorthash(hash, input, sizeof(input), _key);
+
+    uint64_t fp;
+    memcpy(&fp, hash, sizeof(fp));
+    return fp;
+}
@@ -0,0 +1,94 @@
+#ifndef REPLAY_CACHE_H
+#define REPLAY_CACHE_H
+
+#include <sodium.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../protocol/pol_constants.h"
+
+/**
+ * @class ReplayCache
+ * @brief A fixed-size set of the PoL requests answered during the current counter epoch.
+ *
+ * Requests are keyed on `(phoneId, nonce)`. The key is reduced to a 64-bit fingerprint with
+ * SipHash (`crypto_shorthash`) under a random per-boot key, so that phones cannot choose which
+ * bucket they fill. The set is 4-way set-associative: a lookup or an insertion touches a single
+ * bucket, and a full bucket overwrites its ways round-robin.
+ *
+ * Each entry is tagged with the counter epoch it was inserted in, and entries of another epoch
+ * are treated as empty, so moving to a new epoch clears the cache in O(1).
+ *
+ * The table is a member array (about 4.5 KB), nothing is allocated.
+ *
+ * Must be constructed after `sodium_init()`.
+ */
+class ReplayCache {
+public:
+    /// @brief The number of buckets. Must be a power of two.
+    static constexpr size_t NUM_BUCKETS = 64;
+
+    /// @brief The number of entries per bucket.
+    static constexpr size_t BUCKET_WAYS = 4;
+
+    /// @brief The maximum number of requests remembered per epoch.
+    static constexpr size_t CAPACITY = NUM_BUCKETS * BUCKET_WAYS;
+
+    ReplayCache();
+
+    /**
+     * @brief Checks whether a request was already recorded during an epoch.
+     * @param phoneId The phone ID of the request.
+     * @param nonce The nonce of the request.
+     * @param epoch The current counter value.
+     * @return True if the request is a replay.
+     */
+    bool contains(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE],
+                  uint64_t epoch) const;
+
+    /**
+     * @brief Records an answered request.
+     * @param phoneId The phone ID of the request.
+     * @param nonce The nonce of the request.
+     * @param epoch The current counter value.
+     */
+    void insert(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE], uint64_t epoch);
+
+private:
+    /**
+     * @struct Entry
+     * @brief A recorded request.
+     */
+    struct Entry {
+        /// @brief The SipHash of `(phoneId, nonce)`.
+        uint64_t fingerprint = 0;
+
+        /// @brief The low 32 bits of the epoch the entry belongs to.
+        uint32_t epoch = 0;
+
+        /// @brief False until the entry is written for the first time.
+        bool used = false;
+    };
+
+    /**
+     * @struct Bucket
+     * @brief The ways sharing the same fingerprint bits.
+     */
+    struct Bucket {
+        Entry ways[BUCKET_WAYS];
+
+        /// @brief The next way to overwrite when the bucket is full.
+        uint8_t next = 0;
+    };
+
+    /** @brief Computes the fingerprint of a request. */
+    uint64_t fingerprint(uint64_t phoneId, const uint8_t nonce[PROTOCOL_NONCE_SIZE]) const;
+
+    /// @brief The per-boot SipHash key.
+    uint8_t _key[crypto_shorthash_KEYBYTES];
+
+    /// @brief The table.
+    Bucket _buckets[NUM_BUCKETS];
+};
+
+#endif  // REPLAY_CACHE_H
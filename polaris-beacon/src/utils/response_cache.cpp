@@ -0,0 +1,45 @@
+#include "response_cache.h"
+
+#include <string.h>
+
+ResponseCache::ResponseCache() {
+    crypto_shorthash_keygen(_key);
+}
+
+bool ResponseCache::lookup(const uint8_t* request, size_t len, uint64_t counter, uint8_t* out,
+                           size_t& outLen) const {
+    uint64_t fp = fingerprint(request, len);
+
+    for (const Entry& entry : _entries) {
+        if (entry.used && entry.counter == counter && entry.fingerprint == fp) {
+            memcpy(out, entry.response, entry.responseLen);
+            outLen = entry.responseLen;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ResponseCache::store(const uint8_t* request, size_t len, uint64_t counter,
+                          const uint8_t* response, size_t responseLen) {
+    if (responseLen > sizeof(Entry::response)) {
+        return;
+    }
+
+    Entry& entry = _entries[_next];
+    entry.used = true;
+    entry.fingerprint = fingerprint(request, len);
+    entry.counter = counter;
+    memcpy(entry.response, response, responseLen);
+    entry.responseLen = responseLen;
+    _next = (_next + 1) % CAPACITY;
+}
+
+uint64_t ResponseCache::fingerprint(const uint8_t* request, size_t len) const {
+    uint8_t hash[crypto_shorthash_BYTES];
+    crypto_shorthash(hash, request, len, _key);
+
+    uint64_t fp;
+    memcpy(&fp, hash, sizeof(fp));
+    return fp;
+}
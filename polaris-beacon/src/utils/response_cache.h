@@ -0,0 +1,86 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <sodium.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../protocol/messages/pol_response.h"
+
+/**
+ * @class ResponseCache
+ * @brief Keeps the last PoL responses (signed or session tokens), to answer exact retries without
+ * any crypto.
+ *
+ * A phone that missed the indication resends the identical request. Entries are keyed on a
+ * SipHash of the complete serialized request (signature or MAC included, so only an exact copy
+ * matches) under a random per-boot key, and are only valid while the counter keeps the value the
+ * response was issued with. The oldest entry is overwritten when the cache is full.
+ *
+ * Must be constructed after `sodium_init()`.
+ */
+class ResponseCache {
+public:
+    /// @brief The number of responses kept.
+    static constexpr size_t CAPACITY = 4;
+
+    ResponseCache();
+
+    /**
+     * @brief Looks up the response to a request.
+     * @param request The serialized request.
+     * @param len The length of the request.
+     * @param counter The current counter value.
+     * @param out Receives the serialized response on a hit, `PoLResponse::MAX_PACKED_SIZE` bytes.
+     * @param outLen Receives the length of the response on a hit.
+     * @return True on a hit.
+     */
+    bool lookup(const uint8_t* request, size_t len, uint64_t counter, uint8_t* out,
+                size_t& outLen) const;
+
+    /**
+     * @brief Stores the response to a request.
+     * @param request The serialized request.
+     * @param len The length of the request.
+     * @param counter The counter value in the response.
+     * @param response The serialized response.
+     * @param responseLen The length of the response, at most `PoLResponse::MAX_PACKED_SIZE`.
+     */
+    void store(const uint8_t* request, size_t len, uint64_t counter, const uint8_t* response,
+               size_t responseLen);
+
+private:
+    /**
+     * @struct Entry
+     * @brief A cached response.
+     */
+    struct Entry {
+        bool used = false;
+
+        /// @brief The SipHash of the request.
+        uint64_t fingerprint = 0;
+
+        /// @brief The counter value the response was signed with.
+        uint64_t counter = 0;
+
+        /// @brief The serialized response.
+        uint8_t response[PoLResponse::MAX_PACKED_SIZE];
+
+        /// @brief The length of the serialized response.
+        size_t responseLen = 0;
+    };
+
+    /** @brief Computes the fingerprint of a request. */
+    uint64_t fingerprint(const uint8_t* request, size_t len) const;
+
+    /// @brief The per-boot SipHash key.
+    uint8_t _key[crypto_shorthash_KEYBYTES];
+
+    /// @brief The cached responses.
+    Entry _entries[CAPACITY];
+
+    /// @brief The next entry to overwrite.
+    size_t _next = 0;
+};
+
+#endif  // RESPONSE_CACHE_H
@@ -0,0 +1,137 @@
+#include "revocation_filter.h"
+
+#include <HardwareSerial.h>
+#include <sodium.h>
+#include <string.h>
+
+void RevocationFilter::begin(Preferences* prefs) {
+    _prefs = prefs;
+
+    uint8_t hashes = _prefs->getUChar(NVS_HASHES_KEY, 0);
+    if (hashes == 0 || hashes > MAX_HASHES ||
+        _prefs->getBytes(NVS_BITS_KEY, _bits, FILTER_BYTES) != FILTER_BYTES) {
+        Serial.printf("%s No revocation filter stored.\n", TAG);
+        return;
+    }
+    _hashes = hashes;
+    _version = _prefs->getUInt(NVS_VERSION_KEY, 0);
+    Serial.printf("%s Loaded filter version %u (%u hashes).\n", TAG, _version, _hashes);
+}
+
+bool RevocationFilter::isRevoked(uint64_t phoneId, const uint8_t* phonePk) {
+    taskENTER_CRITICAL(&_lock);
+    bool empty = _hashes == 0;
+    taskEXIT_CRITICAL(&_lock);
+    if (empty) {
+        return false;
+    }
+
+    // The hashes are computed out of the critical section, only the bit reads are guarded.
+    ItemHash idHash =
+        hashItem(ITEM_PHONE_ID, reinterpret_cast<const uint8_t*>(&phoneId), sizeof(phoneId));
+    ItemHash pkHash = {};
+    if (phonePk) {
+        pkHash = hashItem(ITEM_PHONE_KEY, phonePk, Ed25519_PK_SIZE);
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    bool revoked = containsLocked(idHash) || (phonePk && containsLocked(pkHash));
+    taskEXIT_CRITICAL(&_lock);
+    return revoked;
+}
+
+bool RevocationFilter::replace(uint32_t version, uint8_t hashes, const uint8_t bits[FILTER_BYTES]) {
+    if (hashes > MAX_HASHES) {
+        Serial.printf("%s Invalid hash count %u.\n", TAG, hashes);
+        return false;
+    }
+
+    taskENTER_CRITICAL(&_lock);
+    memcpy(_bits, bits, FILTER_BYTES);
+    _hashes = hashes;
+    _version = version;
+    taskEXIT_CRITICAL(&_lock);
+
+    persist();
+    Serial.printf("%s Filter replaced, version %u (%u hashes).\n", TAG, version, hashes);
+    return true;
+}
+
+bool RevocationFilter::beginDelta(uint32_t baseVersion) {
+    // Only the command task writes the filter, so it can be read here without the lock.
+    if (_hashes == 0 || baseVersion != _version) {
+        Serial.printf("%s Delta for version %u rejected, current version %u.\n", TAG, baseVersion,
+                      _version);
+        return false;
+    }
+    memcpy(_pending, _bits, FILTER_BYTES);
+    return true;
+}
+
+void RevocationFilter::addPhoneId(uint64_t phoneId) {
+    addToDelta(
+        hashItem(ITEM_PHONE_ID, reinterpret_cast<const uint8_t*>(&phoneId), sizeof(phoneId)));
+}
+
+void RevocationFilter::addPhoneKey(const uint8_t phonePk[Ed25519_PK_SIZE]) {
+    addToDelta(hashItem(ITEM_PHONE_KEY, phonePk, Ed25519_PK_SIZE));
+}
+
+void RevocationFilter::commitDelta(uint32_t version) {
+    taskENTER_CRITICAL(&_lock);
+    memcpy(_bits, _pending, FILTER_BYTES);
+    _version = version;
+    taskEXIT_CRITICAL(&_lock);
+
+    persist();
+    Serial.printf("%s Delta applied, version %u.\n", TAG, version);
+}
+
+uint32_t RevocationFilter::getVersion() {
+    taskENTER_CRITICAL(&_lock);
+    uint32_t version = _version;
+    taskEXIT_CRITICAL(&_lock);
+    return version;
+}
+
+RevocationFilter::ItemHash RevocationFilter::hashItem(uint8_t tag, const uint8_t* value,
+                                                      size_t len) {
+    uint8_t digest[sizeof(ItemHash)];
+    crypto_generichash_state state;
+    crypto_generichash_init(&state, nullptr, 0, sizeof(digest));
+    crypto_generichash_update(&state, &tag, sizeof(tag));
+    crypto_generichash_update(&state, value, len);
+    crypto_generichash_final(&state, digest, sizeof(digest));
+
+    ItemHash hash;
+    memcpy(&hash.h1, digest, sizeof(hash.h1));
+    memcpy(&hash.h2, digest + sizeof(hash.h1), sizeof(hash.h2));
+    hash.h2 |= 1;  // An odd step visits distinct bits.
+    return hash;
+}
+
+bool RevocationFilter::containsLocked(const ItemHash& hash) const {
+    for (uint8_t i = 0; i < _hashes; ++i) {
+        uint32_t bit = (hash.h1 + i * hash.h2) % FILTER_BITS;
+        if (!(_bits[bit / 8] & (1u << (bit % 8)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RevocationFilter::addToDelta(const ItemHash& hash) {
+    for (uint8_t i = 0; i < _hashes; ++i) {
+        uint32_t bit = (hash.h1 + i * hash.h2) % FILTER_BITS;
+        _pending[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+}
+
+void RevocationFilter::persist() {
+    if (!_prefs) {
+        return;
+    }
+    _prefs->putBytes(NVS_BITS_KEY, _bits, FILTER_BYTES);
+    _prefs->putUChar(NVS_HASHES_KEY, _hashes);
+    _prefs->putUInt(NVS_VERSION_KEY, _version);
+}
@@ -0,0 +1,138 @@
+#ifndef REVOCATION_FILTER_H
+#define REVOCATION_FILTER_H
+
+#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol/pol_constants.h"
+
+/**
+ * @class RevocationFilter
+ * @brief A Bloom filter of the phone IDs and phone public keys revoked by the server.
+ *
+ * The token processor consults it before any curve operation, so a revoked phone costs two short
+ * BLAKE2b hashes per request instead of a verification and a signature. A false positive rejects a
+ * legitimate phone; the server sizes the filter (hash count) to keep this rate low.
+ *
+ * An item is hashed with BLAKE2b-128 over [tag][value], the tag being ITEM_PHONE_ID followed by the
+ * phone ID (8 bytes, little-endian), or ITEM_PHONE_KEY followed by the Ed25519 public key. The two
+ * 64-bit little-endian halves h1, h2 of the hash give the bit positions (h1 + i * (h2 | 1)) mod
+ * FILTER_BITS, for i < hash count. Bit n is bit (n % 8) of byte n / 8.
+ *
+ * The server replaces the whole filter with a version number, then adds items with deltas applying
+ * to a given version only. Items cannot be removed from a Bloom filter: an unrevocation is a new
+ * full filter. The filter and its version are kept in NVS, so they survive reboots.
+ *
+ * The filter is read by the token processor task and written by the encrypted processor task; the
+ * bits are guarded by a critical section.
+ */
+class RevocationFilter {
+public:
+    /// @brief The size of the filter.
+    static constexpr size_t FILTER_BYTES = 256;
+    static constexpr size_t FILTER_BITS = FILTER_BYTES * 8;
+
+    /// @brief The maximum number of hash functions.
+    static constexpr uint8_t MAX_HASHES = 16;
+
+    /// @brief The tags of the hashed items.
+    static constexpr uint8_t ITEM_PHONE_ID = 0x01;
+    static constexpr uint8_t ITEM_PHONE_KEY = 0x02;
+
+    /**
+     * @brief Loads the filter from NVS.
+     * @param prefs The opened NVS namespace.
+     */
+    void begin(Preferences* prefs);
+
+    /**
+     * @brief Checks whether a phone is revoked.
+     * @param phoneId The ID of the phone.
+     * @param phonePk The Ed25519 public key of the phone, or nullptr if the request carries none.
+     * @return True if the phone ID or the key is (probably) in the filter.
+     */
+    bool isRevoked(uint64_t phoneId, const uint8_t* phonePk);
+
+    /**
+     * @brief Replaces the filter, and persists it.
+     * @param version The version of the new filter.
+     * @param hashes The number of hash functions, 0 for an empty filter.
+     * @param bits The FILTER_BYTES of the filter.
+     * @return False if the parameters are invalid.
+     */
+    bool replace(uint32_t version, uint8_t hashes, const uint8_t bits[FILTER_BYTES]);
+
+    /**
+     * @brief Starts a delta. The items are added to a copy of the filter until `commitDelta`.
+     * @param baseVersion The version the delta applies to.
+     * @return False if the delta does not apply to the current filter.
+     */
+    bool beginDelta(uint32_t baseVersion);
+
+    /** @brief Adds a phone ID to the pending delta. */
+    void addPhoneId(uint64_t phoneId);
+
+    /** @brief Adds a phone public key to the pending delta. */
+    void addPhoneKey(const uint8_t phonePk[Ed25519_PK_SIZE]);
+
+    /**
+     * @brief Applies the pending delta, and persists the filter.
+     * @param version The version of the updated filter.
+     */
+    void commitDelta(uint32_t version);
+
+    /** @brief Returns the version of the current filter, 0 if the server never sent one. */
+    uint32_t getVersion();
+
+private:
+    /**
+     * @struct ItemHash
+     * @brief The two hashes giving the bit positions of an item.
+     */
+    struct ItemHash {
+        uint64_t h1;
+        uint64_t h2;
+    };
+
+    /** @brief Hashes an item. */
+    static ItemHash hashItem(uint8_t tag, const uint8_t* value, size_t len);
+
+    /** @brief Checks the bits of an item. Must be called within the critical section. */
+    bool containsLocked(const ItemHash& hash) const;
+
+    /** @brief Sets the bits of an item in the pending delta. */
+    void addToDelta(const ItemHash& hash);
+
+    /** @brief Writes the filter to NVS. */
+    void persist();
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[Revocation]";
+
+    /// @brief NVS keys of the filter.
+    static constexpr const char* NVS_BITS_KEY = "rvk_bits";
+    static constexpr const char* NVS_VERSION_KEY = "rvk_ver";
+    static constexpr const char* NVS_HASHES_KEY = "rvk_k";
+
+    /// @brief The NVS storage.
+    Preferences* _prefs = nullptr;
+
+    /// @brief Protects the filter, its version and its hash count.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The filter bits.
+    uint8_t _bits[FILTER_BYTES] = {};
+
+    /// @brief The number of hash functions, 0 while the filter is empty.
+    uint8_t _hashes = 0;
+
+    /// @brief The version of the filter.
+    uint32_t _version = 0;
+
+    /// @brief The filter being updated by a delta, written by the command task only.
+    uint8_t _pending[FILTER_BYTES] = {};
+};
+
+#endif  // REVOCATION_FILTER_H
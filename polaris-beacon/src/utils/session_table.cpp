@@ -0,0 +1,44 @@
+#include "session_table.h"
+
+#include <sodium.h>
+#include <string.h>
+
+SessionTable::~SessionTable() {
+    sodium_memzero(_sessions, sizeof(_sessions));
+}
+
+void SessionTable::open(uint64_t phoneId, const uint8_t key[SESSION_KEY_SIZE], uint32_t now) {
+    // Renew the session of the phone, or take a free entry, or evict the oldest session.
+    Session* session = &_sessions[0];
+    for (Session& candidate : _sessions) {
+        if (candidate.used && candidate.phoneId == phoneId) {
+            session = &candidate;
+            break;
+        }
+        if (!isOpen(*session, now)) {
+            continue;
+        }
+        if (!isOpen(candidate, now) || now - candidate.openedAtMs > now - session->openedAtMs) {
+            session = &candidate;
+        }
+    }
+
+    sodium_memzero(session->key, SESSION_KEY_SIZE);
+    session->used = true;
+    session->phoneId = phoneId;
+    session->openedAtMs = now;
+    memcpy(session->key, key, SESSION_KEY_SIZE);
+}
+
+const uint8_t* SessionTable::find(uint64_t phoneId, uint32_t now) const {
+    for (const Session& session : _sessions) {
+        if (session.used && session.phoneId == phoneId) {
+            return isOpen(session, now) ? session.key : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+bool SessionTable::isOpen(const Session& session, uint32_t now) {
+    return session.used && now - session.openedAtMs < LIFETIME_MS;
+}
@@ -0,0 +1,69 @@
+#ifndef SESSION_TABLE_H
+#define SESSION_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../protocol/pol_constants.h"
+
+/**
+ * @class SessionTable
+ * @brief The session keys of the phones that opened a session with a signed PoL request.
+ *
+ * A session lasts LIFETIME_MS from its opening. The keys live in a fixed table of MAX_SESSIONS
+ * entries: a phone opening a new session replaces its previous one, otherwise a free or expired
+ * entry is used, and the oldest session is evicted when the table is full. A phone whose session
+ * was evicted gets PoLErrorCode::UnknownSession and falls back to a signed request.
+ *
+ * Only used by the token processor task, so there is no locking. Keys are wiped when replaced.
+ */
+class SessionTable {
+public:
+    /// @brief The number of sessions kept.
+    static constexpr size_t MAX_SESSIONS = 16;
+
+    /// @brief The lifetime of a session.
+    static constexpr uint32_t LIFETIME_MS = 60 * 60 * 1000;
+
+    ~SessionTable();
+
+    /**
+     * @brief Opens (or renews) the session of a phone.
+     * @param phoneId The phone ID.
+     * @param key The session key.
+     * @param now The current time (millis).
+     */
+    void open(uint64_t phoneId, const uint8_t key[SESSION_KEY_SIZE], uint32_t now);
+
+    /**
+     * @brief Finds the key of the open session of a phone.
+     * @param phoneId The phone ID.
+     * @param now The current time (millis).
+     * @return The session key, or nullptr if the phone has no open session.
+     */
+    const uint8_t* find(uint64_t phoneId, uint32_t now) const;
+
+private:
+    /**
+     * @struct Session
+     * @brief The session of a phone.
+     */
+    struct Session {
+        bool used = false;
+        uint64_t phoneId = 0;
+
+        /// @brief The time (millis) the session was opened.
+        uint32_t openedAtMs = 0;
+
+        /// @brief The key authenticating the requests and the tokens.
+        uint8_t key[SESSION_KEY_SIZE];
+    };
+
+    /** @brief Checks whether a session is open at a given time. */
+    static bool isOpen(const Session& session, uint32_t now);
+
+    /// @brief The sessions.
+    Session _sessions[MAX_SESSIONS];
+};
+
+#endif  // SESSION_TABLE_H
@@ -3,7 +3,7 @@
 #include <esp_chip_info.h>
 #include <esp_heap_caps.h>
 
-void SystemMonitor::getStatus(JsonObject& statusObject) {
+void SystemMonitor::getStatus(JsonObject& statusObject, bool resetLatency) {
     // Get Free Heap Memory
     statusObject["free_heap"] = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
 
@@ -15,5 +15,15 @@ void SystemMonitor::getStatus(JsonObject& statusObject) {
     esp_chip_info(&chip_info);
     statusObject["chip_rev"] = chip_info.revision;
 
+    // Get the token latency histograms since the last reset
+    if (_tokenLatency) {
+        JsonObject latency = statusObject["token_latency"].to<JsonObject>();
+        _tokenLatency->report(latency, resetLatency);
+    }
+
     Serial.printf("%s: Gathered system status.\n", TAG);
+}
+
+void SystemMonitor::setTokenLatencyTracker(LatencyTracker* tracker) {
+    _tokenLatency = tracker;
 }
\ No newline at end of file
@@ -4,6 +4,8 @@
 #include <ArduinoJson.h>
 #include <stdint.h>
 
+#include "latency_tracker.h"
+
 /**
  * @class SystemMonitor
  * @brief A utility for gathering and reporting beacon system status.
@@ -16,12 +18,22 @@ public:
      * @brief Populates a JSON object with the current system status.
      * @param statusObject A reference to a `JsonObject` which will be populated
      *                     with key-value pairs representing the system status.
+     * @param resetLatency True to reset the token latency histograms once reported.
      */
-    void getStatus(JsonObject& statusObject);
+    void getStatus(JsonObject& statusObject, bool resetLatency = false);
+
+    /**
+     * @brief Registers the token latency tracker. Its histograms are added to the status under
+     * "token_latency".
+     */
+    void setTokenLatencyTracker(LatencyTracker* tracker);
 
 private:
     /// @brief A tag used for logging from this class.
     static constexpr const char* TAG = "[SysMonitor]";
+
+    /// @brief The token latency tracker, if any.
+    LatencyTracker* _tokenLatency = nullptr;
 };
 
 #endif  // SYSTEM_MONITOR_H
\ No newline at end of file
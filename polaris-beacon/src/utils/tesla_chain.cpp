@@ -0,0 +1,56 @@
+#include "tesla_chain.h"
+
+#include <sodium.h>
+#include <string.h>
+
+void TeslaChain::start(const uint8_t lastKey[TESLA_KEY_SIZE]) {
+    if (_started) {
+        memcpy(_previousTail, _keys[INTERVALS - DISCLOSURE_DELAY + 1], sizeof(_previousTail));
+        _hasPrevious = true;
+    }
+
+    memcpy(_keys[INTERVALS], lastKey, TESLA_KEY_SIZE);
+    for (int i = INTERVALS; i > 0; --i) {
+        crypto_generichash(_keys[i - 1], TESLA_KEY_SIZE, _keys[i], TESLA_KEY_SIZE, nullptr, 0);
+    }
+    _started = true;
+}
+
+void TeslaChain::draw(uint8_t lastKeyOut[TESLA_KEY_SIZE], uint8_t anchorOut[TESLA_KEY_SIZE]) {
+    randombytes_buf(lastKeyOut, TESLA_KEY_SIZE);
+    uint8_t key[TESLA_KEY_SIZE];
+    memcpy(key, lastKeyOut, TESLA_KEY_SIZE);
+    for (int i = INTERVALS; i > 0; --i) {
+        crypto_generichash(anchorOut, TESLA_KEY_SIZE, key, TESLA_KEY_SIZE, nullptr, 0);
+        memcpy(key, anchorOut, TESLA_KEY_SIZE);
+    }
+    sodium_memzero(key, sizeof(key));
+}
+
+const uint8_t* TeslaChain::anchor() const {
+    return _keys[0];
+}
+
+void TeslaChain::computeTag(uint8_t tagOut[TESLA_TAG_SIZE], uint8_t interval, uint32_t beaconId,
+                            uint64_t counter) const {
+    uint8_t data[sizeof(beaconId) + sizeof(counter) + sizeof(interval)];
+    memcpy(data, &beaconId, sizeof(beaconId));
+    memcpy(data + sizeof(beaconId), &counter, sizeof(counter));
+    data[sizeof(beaconId) + sizeof(counter)] = interval;
+
+    crypto_generichash(tagOut, TESLA_TAG_SIZE, data, sizeof(data), _keys[interval],
+                       TESLA_KEY_SIZE);
+}
+
+const uint8_t* TeslaChain::disclosedKey(uint8_t interval, uint8_t& index) const {
+    if (interval > DISCLOSURE_DELAY) {
+        index = interval - DISCLOSURE_DELAY;
+        return _keys[index];
+    }
+    if (_hasPrevious) {
+        index = INTERVALS - DISCLOSURE_DELAY + interval;
+        return _previousTail[interval - 1];
+    }
+    index = 0;
+    return _keys[0];
+}
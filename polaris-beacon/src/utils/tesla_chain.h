@@ -0,0 +1,95 @@
+#ifndef TESLA_CHAIN_H
+#define TESLA_CHAIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol/pol_constants.h"
+
+/**
+ * @class TeslaChain
+ * @brief The one-way key chain authenticating the broadcast intervals of a counter epoch (TESLA).
+ *
+ * A counter epoch is split in INTERVALS intervals of INTERVAL_MS. For each epoch, the beacon draws
+ * a random key K_n (n = INTERVALS), and computes K_(i-1) = BLAKE2b-128(K_i) down to the anchor
+ * K_0, which is signed once per epoch with the counter.
+ *
+ * During interval i (1 to n), the broadcast carries the tag of the interval, BLAKE2b-128 keyed
+ * with K_i over [beacon ID (4)][counter (8)][i (1)], and discloses the key of interval i -
+ * DISCLOSURE_DELAY. A phone stores the tag; once the key is disclosed, it checks that the key
+ * hashes to the signed anchor in i steps and that the tag matches. As nobody but the beacon knew
+ * K_i before its disclosure, a tag received in time proves the beacon was in range during
+ * interval i, without any connection or per-phone signature.
+ *
+ * The last DISCLOSURE_DELAY keys of an epoch are not disclosed during the epoch: interval i of the
+ * first DISCLOSURE_DELAY intervals of the next epoch discloses K_(n - DISCLOSURE_DELAY + i) of the
+ * previous chain instead, so that every key is disclosed exactly DISCLOSURE_DELAY intervals after
+ * its use.
+ *
+ * Not thread-safe: used by the advertising updater task only.
+ */
+class TeslaChain {
+public:
+    /// @brief The number of intervals of a counter epoch.
+    static constexpr uint8_t INTERVALS = 60;
+
+    /// @brief The length of an interval.
+    static constexpr uint32_t INTERVAL_MS = 1000;
+
+    /// @brief The number of intervals between the use of a key and its disclosure.
+    static constexpr uint8_t DISCLOSURE_DELAY = 2;
+
+    /**
+     * @brief Starts a new epoch with a chain drawn ahead of time by `draw`. The last keys of the
+     * current chain are kept for the disclosures of the first intervals.
+     * @param lastKey The last key (K_n) of the new chain, from which the other keys are hashed.
+     */
+    void start(const uint8_t lastKey[TESLA_KEY_SIZE]);
+
+    /**
+     * @brief Draws the last key of a future chain and computes its anchor, so that the anchor can
+     * be signed before the epoch starts. Thread-safe, the chain state is not touched.
+     * @param lastKeyOut Receives the last key (K_n), secret until its disclosure.
+     * @param anchorOut Receives the anchor (K_0).
+     */
+    static void draw(uint8_t lastKeyOut[TESLA_KEY_SIZE], uint8_t anchorOut[TESLA_KEY_SIZE]);
+
+    /** @brief Returns the anchor (K_0) of the current chain. */
+    const uint8_t* anchor() const;
+
+    /**
+     * @brief Computes the tag of an interval.
+     * @param tagOut Receives the tag.
+     * @param interval The interval, 1 to INTERVALS.
+     * @param beaconId The beacon ID.
+     * @param counter The counter of the epoch.
+     */
+    void computeTag(uint8_t tagOut[TESLA_TAG_SIZE], uint8_t interval, uint32_t beaconId,
+                    uint64_t counter) const;
+
+    /**
+     * @brief Returns the key disclosed during an interval.
+     * @param interval The interval, 1 to INTERVALS.
+     * @param index Receives the index of the disclosed key. During the first DISCLOSURE_DELAY
+     * intervals, it is the index INTERVALS - DISCLOSURE_DELAY + interval in the previous chain, or
+     * 0 (the anchor) after a reboot.
+     * @return The disclosed key.
+     */
+    const uint8_t* disclosedKey(uint8_t interval, uint8_t& index) const;
+
+private:
+    /// @brief The keys of the current chain, K_0 to K_n.
+    uint8_t _keys[INTERVALS + 1][TESLA_KEY_SIZE] = {};
+
+    /// @brief The last DISCLOSURE_DELAY keys of the previous chain, K_(n - DISCLOSURE_DELAY + 1) to
+    /// K_n.
+    uint8_t _previousTail[DISCLOSURE_DELAY][TESLA_KEY_SIZE] = {};
+
+    /// @brief True once a chain was replaced, so that `_previousTail` is valid.
+    bool _hasPrevious = false;
+
+    /// @brief True once a chain was drawn.
+    bool _started = false;
+};
+
+#endif  // TESLA_CHAIN_H
@@ -0,0 +1,122 @@
+#include "visitor_sketch.h"
+
+#include <ArduinoJson.h>
+#include <HardwareSerial.h>
+#include <math.h>
+#include <sodium.h>
+#include <string.h>
+
+void VisitorSketch::begin(OutgoingMessageService* outgoing) {
+    _outgoing = outgoing;
+}
+
+void VisitorSketch::record(uint64_t phoneId, uint64_t counter) {
+    uint8_t digest[crypto_generichash_BYTES_MIN];
+    crypto_generichash(digest, sizeof(digest), reinterpret_cast<const uint8_t*>(&phoneId),
+                       sizeof(phoneId), nullptr, 0);
+    uint64_t hash;
+    memcpy(&hash, digest, sizeof(hash));
+
+    size_t index = hash >> (64 - PRECISION);
+    uint64_t rest = hash << PRECISION;
+    // The rank of the remaining bits, capped when they are all zero.
+    uint8_t rank = 1;
+    while (rank <= 64 - PRECISION && !(rest & (1ULL << 63))) {
+        rest <<= 1;
+        rank++;
+    }
+
+    uint64_t window = counter / WINDOW_LENGTH;
+    bool dropped = false;
+    uint64_t droppedWindow = 0;
+    taskENTER_CRITICAL(&_lock);
+    if (_open.used && _open.window != window) {
+        // The window ended before the main loop sealed it.
+        if (_sealed.used) {
+            dropped = true;
+            droppedWindow = _sealed.window;
+        }
+        _sealed = _open;
+        _open.used = false;
+    }
+    if (!_open.used) {
+        memset(_open.registers, 0, sizeof(_open.registers));
+        _open.window = window;
+        _open.used = true;
+    }
+    if (rank > _open.registers[index]) {
+        _open.registers[index] = rank;
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    // Logged out of the critical section, the UART must not be driven with interrupts masked.
+    if (dropped) {
+        Serial.printf("%s Sketch of window %llu dropped.\n", TAG, droppedWindow);
+    }
+}
+
+void VisitorSketch::upload(uint64_t counter) {
+    if (!_outgoing) {
+        return;
+    }
+
+    Sketch sealed[2];
+    size_t count = 0;
+    taskENTER_CRITICAL(&_lock);
+    if (_sealed.used) {
+        sealed[count++] = _sealed;
+        _sealed.used = false;
+    }
+    if (_open.used && _open.window != counter / WINDOW_LENGTH) {
+        sealed[count++] = _open;
+        _open.used = false;
+    }
+    taskEXIT_CRITICAL(&_lock);
+
+    for (size_t i = 0; i < count; ++i) {
+        queue(sealed[i]);
+    }
+}
+
+uint32_t VisitorSketch::estimate(const uint8_t registers[NUM_REGISTERS]) {
+    const float m = (float)NUM_REGISTERS;
+    const float alpha = 0.7213f / (1.0f + 1.079f / m);
+
+    float sum = 0.0f;
+    size_t zeros = 0;
+    for (size_t i = 0; i < NUM_REGISTERS; ++i) {
+        sum += ldexpf(1.0f, -(int)registers[i]);
+        if (registers[i] == 0) {
+            zeros++;
+        }
+    }
+
+    float estimate = alpha * m * m / sum;
+    // Small range correction (linear counting).
+    if (estimate <= 2.5f * m && zeros > 0) {
+        estimate = m * logf(m / (float)zeros);
+    }
+    return (uint32_t)lroundf(estimate);
+}
+
+void VisitorSketch::queue(const Sketch& sketch) {
+    char encoded[sodium_base64_ENCODED_LEN(NUM_REGISTERS, sodium_base64_VARIANT_ORIGINAL)];
+    sodium_bin2base64(encoded, sizeof(encoded), sketch.registers, NUM_REGISTERS,
+                      sodium_base64_VARIANT_ORIGINAL);
+    uint32_t visitors = estimate(sketch.registers);
+
+    JsonDocument doc;
+    JsonObject payload = doc.to<JsonObject>();
+    payload["w"] = sketch.window;
+    payload["len"] = WINDOW_LENGTH;
+    payload["p"] = PRECISION;
+    payload["n"] = visitors;
+    payload["r"] = encoded;
+
+    if (!_outgoing->queueMessage(OperationType::VisitorSketch, payload)) {
+        Serial.printf("%s Failed to queue the sketch of window %llu.\n", TAG, sketch.window);
+        return;
+    }
+    Serial.printf("%s Sketch of window %llu queued, about %u visitor(s).\n", TAG, sketch.window,
+                  visitors);
+}
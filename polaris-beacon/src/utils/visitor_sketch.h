@@ -0,0 +1,96 @@
+#ifndef VISITOR_SKETCH_H
+#define VISITOR_SKETCH_H
+
+#include <freertos/FreeRTOS.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "protocol/handlers/outgoing_message_service.h"
+
+/**
+ * @class VisitorSketch
+ * @brief HyperLogLog sketches of the distinct phones served per time window.
+ *
+ * Each issued token adds its phone ID to the sketch of the current window (WINDOW_LENGTH counter
+ * values). The sketch has 2^PRECISION one-byte registers, indexed by the first PRECISION bits of
+ * the 64-bit BLAKE2b hash of the phone ID (8 bytes, little-endian); a register keeps the highest
+ * rank (position of the first set bit, from 1) seen in the remaining bits. Its size does not depend
+ * on the crowd, and its standard error is 1.04 / sqrt(2^PRECISION), about 6.5%.
+ *
+ * Once its window is over, a sketch is sealed and queued as a VisitorSketch message:
+ *
+ * {"w": window index (counter / WINDOW_LENGTH), "len": WINDOW_LENGTH, "p": PRECISION,
+ *  "n": estimate, "r": base64 registers}
+ *
+ * The server can merge the sketches of several windows, or beacons, by taking the maximum of each
+ * register. The open sketch lives in RAM: a reboot loses the phones of the current window.
+ *
+ * `record` is called by the token processor task, `upload` by the main loop. The sketches are
+ * guarded by a critical section.
+ */
+class VisitorSketch {
+public:
+    /// @brief The number of index bits.
+    static constexpr uint8_t PRECISION = 8;
+
+    /// @brief The number of registers.
+    static constexpr size_t NUM_REGISTERS = 1u << PRECISION;
+
+    /// @brief The length of a window, in counter values (minutes).
+    static constexpr uint64_t WINDOW_LENGTH = 60;
+
+    /**
+     * @brief Sets the service the sealed sketches are uploaded through.
+     */
+    void begin(OutgoingMessageService* outgoing);
+
+    /**
+     * @brief Adds a served phone to the sketch of the window of a counter value.
+     * @param phoneId The phone ID.
+     * @param counter The counter value of the token.
+     */
+    void record(uint64_t phoneId, uint64_t counter);
+
+    /**
+     * @brief Seals the sketch of a finished window and queues the sealed sketch for upload.
+     * @param counter The current counter value.
+     */
+    void upload(uint64_t counter);
+
+    /**
+     * @brief Estimates the number of distinct phones of a sketch.
+     * @param registers The NUM_REGISTERS registers.
+     */
+    static uint32_t estimate(const uint8_t registers[NUM_REGISTERS]);
+
+private:
+    /**
+     * @struct Sketch
+     * @brief The registers of one window.
+     */
+    struct Sketch {
+        uint64_t window;
+        bool used;
+        uint8_t registers[NUM_REGISTERS];
+    };
+
+    /** @brief Queues a sealed sketch as a VisitorSketch message. */
+    void queue(const Sketch& sketch);
+
+    /// @brief A tag used for logging from this class.
+    static constexpr const char* TAG = "[Visitors]";
+
+    /// @brief The service the sketches are uploaded through.
+    OutgoingMessageService* _outgoing = nullptr;
+
+    /// @brief Protects the sketches.
+    portMUX_TYPE _lock = portMUX_INITIALIZER_UNLOCKED;
+
+    /// @brief The sketch of the current window.
+    Sketch _open = {};
+
+    /// @brief A sketch sealed by `record`, waiting for `upload`.
+    Sketch _sealed = {};
+};
+
+#endif  // VISITOR_SKETCH_H
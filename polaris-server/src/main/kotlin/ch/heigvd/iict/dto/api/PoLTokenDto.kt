@@ -19,5 +19,10 @@ data class PoLTokenDto(
     @Serializable(with = UByteArrayAsBase64StringSerializer::class)
     val phoneSig: UByteArray,
     @Serializable(with = UByteArrayAsBase64StringSerializer::class)
-    val beaconSig: UByteArray
+    val beaconSig: UByteArray,
+    // Merkle proof, for tokens signed in a batch (flags & 0x01)
+    val merkleLeafIndex: UByte = 0u,
+    val merkleLeafCount: UByte = 0u,
+    @Serializable(with = UByteArrayAsBase64StringSerializer::class)
+    val merklePath: UByteArray = UByteArray(0)
 )
\ No newline at end of file
@@ -42,6 +42,51 @@ class Beacon : PanacheEntityBase {
     @Column(name = "public_key_x25519", columnDefinition = "BYTEA", nullable = true, unique = true)
     var publicKeyX25519: ByteArray? = null
 
+    /**
+     * The epoch of the X25519 key, sent in the header of each encrypted message (modulo 256).
+     * It starts at 0 with a provisioned key and is incremented by each key rotation, like on the beacon.
+     */
+    @Column(nullable = false)
+    var keyEpoch: Int = 0
+
+    /** The counter of the next message sealed for this beacon, in the key epoch [aeadTxEpoch]. */
+    @Column(nullable = false)
+    var aeadTxCounter: Long = 0L
+
+    /** The key epoch of [aeadTxCounter], a new epoch starts again at 0. */
+    @Column(nullable = false)
+    var aeadTxEpoch: Int = 0
+
+    /** The replay window of the messages from this beacon in the key epoch [aeadRxEpoch]: highest counter + 1. */
+    @Column(nullable = false)
+    var aeadRxTop: Long = 0L
+
+    /** The replay window bitmap of the counters below [aeadRxTop]. */
+    @Column(nullable = false)
+    var aeadRxBits: Long = 0L
+
+    /** The key epoch of the persisted replay window. The windows of the retired epochs are only kept in memory. */
+    @Column(nullable = false)
+    var aeadRxEpoch: Int = 0
+
+    /**
+     * The cipher suites announced by the last authenticated message of this beacon (high nibble of the suite byte,
+     * see [ch.heigvd.iict.services.crypto.model.SealedMessage]). ChaCha20-Poly1305 only until it announces more.
+     */
+    @Column(nullable = false)
+    var aeadSuites: Int = 0x10
+
+    /** The version of the last revocation filter command sent to this beacon (0 before the first one). */
+    @Column(nullable = false)
+    var revocationVersion: Long = 0L
+
+    /**
+     * The version of the last revocation filter command acknowledged by this beacon. A delta is only sent on top of
+     * it when no other command is in flight, a full filter otherwise.
+     */
+    @Column(nullable = false)
+    var revocationAckedVersion: Long = 0L
+
     /**
      * The most recent monotonic counter value received from this beacon.
      * This is used to prevent replay attacks on PoL tokens.
@@ -40,6 +40,9 @@ class RegisteredPhone : PanacheEntityBase {
     /** The timestamp of the last time this phone interacted with the server. */
     var lastSeenAt: Instant? = null
 
+    /** The timestamp when this phone was revoked, pushed to the beacons in their revocation filter. */
+    var revokedAt: Instant? = null
+
     /** The timestamp when this phone record was first created. */
     @Column(nullable = false, updatable = false)
     lateinit var createdAt: Instant
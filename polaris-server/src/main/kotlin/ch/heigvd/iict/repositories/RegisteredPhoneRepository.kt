@@ -30,4 +30,12 @@ class RegisteredPhoneRepository : PanacheRepository<RegisteredPhone> {
     fun findByApiKey(apiKey: String): RegisteredPhone? {
         return find("apiKey", apiKey).firstResult()
     }
-}
\ No newline at end of file
+
+    /**
+     * Lists the revoked phones.
+     * @return The [RegisteredPhone]s with a revocation timestamp.
+     */
+    fun listRevoked(): List<RegisteredPhone> {
+        return list("revokedAt is not null")
+    }
+}
@@ -120,18 +120,32 @@ class BeaconAdminService {
      * Updates the X25519 public key of an existing beacon.
      * This is typically done during a key rotation process.
      *
+     * A rotated key gets the next key epoch. A different key set by hand is a new provisioning, whose
+     * epoch and message counters start again at 0 like on a beacon generating a new key pair.
+     *
      * @param id The database ID of the beacon to update.
      * @param publicKeyX25519 The new 32-byte X25519 public key.
+     * @param rotated `true` if the key comes from a key rotation.
      * @return The updated [Beacon] entity, or `null` if not found.
      * @throws IllegalArgumentException if the key has an invalid size.
      */
     @Transactional
-    fun updateBeaconX25519Key(id: Long, publicKeyX25519: ByteArray): Beacon? {
+    fun updateBeaconX25519Key(id: Long, publicKeyX25519: ByteArray, rotated: Boolean = false): Beacon? {
         if (publicKeyX25519.size != 32) {
             throw IllegalArgumentException("X25519 Public key must be 32 bytes.")
         }
         val beacon = beaconRepository.findById(id)
         beacon?.let {
+            if (rotated) {
+                it.keyEpoch = (it.keyEpoch + 1) and 0xFF
+            } else if (it.publicKeyX25519?.contentEquals(publicKeyX25519) != true) {
+                it.keyEpoch = 0
+                it.aeadTxEpoch = 0
+                it.aeadTxCounter = 0L
+                it.aeadRxEpoch = 0
+                it.aeadRxTop = 0L
+                it.aeadRxBits = 0L
+            }
             it.publicKeyX25519 = publicKeyX25519
         }
         return beacon
@@ -0,0 +1,75 @@
+package ch.heigvd.iict.services.admin
+
+import ch.heigvd.iict.entities.Beacon
+import ch.heigvd.iict.repositories.BeaconRepository
+import ch.heigvd.iict.repositories.RegisteredPhoneRepository
+import ch.heigvd.iict.services.payload.PayloadService
+import ch.heigvd.iict.services.protocol.OperationType
+import ch.heigvd.iict.services.protocol.RevocationFilter
+import io.quarkus.logging.Log
+import jakarta.enterprise.context.ApplicationScoped
+import jakarta.transaction.Transactional
+import jakarta.ws.rs.NotFoundException
+import java.time.Instant
+
+/**
+ * Service revoking phones and pushing the revocations to the beacons, with the commands built by
+ * [RevocationFilter].
+ *
+ * A beacon applies a delta only on top of the filter version it was built on. A delta is therefore sent only when
+ * the beacon acknowledged the last command; otherwise (first revocation, command in flight or lost) the full filter
+ * of all the revoked phones is sent, which the beacon accepts at any version.
+ */
+@ApplicationScoped
+class RevocationService(
+    private val phoneRepository: RegisteredPhoneRepository,
+    private val beaconRepository: BeaconRepository,
+    private val payloadService: PayloadService,
+) {
+
+    /**
+     * Revokes a phone and queues the revocation for every beacon with an encrypted channel.
+     *
+     * @param phoneId The database ID (`phoneId`) of the phone.
+     * @return The number of beacons a command was queued for.
+     * @throws NotFoundException if the phone does not exist.
+     * @throws IllegalStateException if the phone is already revoked.
+     */
+    @Transactional
+    fun revokePhone(phoneId: Long): Int {
+        val phone = phoneRepository.findById(phoneId)
+            ?: throw NotFoundException("Phone with ID $phoneId not found.")
+        check(phone.revokedAt == null) { "Phone $phoneId is already revoked." }
+        phone.revokedAt = Instant.now()
+
+        val revoked = phoneRepository.listRevoked().filter { it.id != phoneId } + phone
+        var queued = 0
+        for (beacon in beaconRepository.listAll()) {
+            if (beacon.publicKeyX25519 == null) continue
+            pushRevocation(beacon, phoneId, phone.publicKey, revoked.map { it.id!! }, revoked.map { it.publicKey })
+            queued++
+        }
+        Log.info("Phone $phoneId revoked, revocation queued for $queued beacons.")
+        return queued
+    }
+
+    private fun pushRevocation(
+        beacon: Beacon,
+        phoneId: Long,
+        publicKey: ByteArray,
+        revokedIds: List<Long>,
+        revokedKeys: List<ByteArray>,
+    ) {
+        val base = beacon.revocationVersion
+        val version = base + 1
+        val canDelta = base > 0 && beacon.revocationAckedVersion == base
+        val (command, opType) = if (canDelta) {
+            RevocationFilter.deltaCommand(base, version, listOf(phoneId), listOf(publicKey)) to
+                OperationType.ADD_REVOCATIONS
+        } else {
+            RevocationFilter.fullCommand(version, revokedIds, revokedKeys) to OperationType.SET_REVOCATION_FILTER
+        }
+        payloadService.createOutboundMessage(beacon.beaconId, command, opType)
+        beacon.revocationVersion = version
+    }
+}
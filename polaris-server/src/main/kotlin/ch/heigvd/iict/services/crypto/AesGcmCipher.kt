@@ -0,0 +1,47 @@
+package ch.heigvd.iict.services.crypto
+
+import com.ionspin.kotlin.crypto.aead.AeadCorrupedOrTamperedDataException
+import javax.crypto.AEADBadTagException
+import javax.crypto.Cipher
+import javax.crypto.spec.GCMParameterSpec
+import javax.crypto.spec.SecretKeySpec
+
+/**
+ * AES-256-GCM, the cipher suite negotiated with the beacons that have an AES accelerator.
+ *
+ * libsodium only offers AES-256-GCM on CPUs with AES instructions, so the JVM provider is used instead. The output
+ * layout is the one of libsodium and of the beacon (ciphertext followed by the 16-byte tag), and a bad tag throws the
+ * same exception as [LibsodiumBridge.aeadDecrypt].
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+object AesGcmCipher {
+
+    private const val TRANSFORMATION = "AES/GCM/NoPadding"
+    private const val TAG_BITS = 128
+
+    /**
+     * Encrypts and authenticates a message.
+     * @return The combined ciphertext and authentication tag.
+     */
+    fun encrypt(message: UByteArray, associatedData: UByteArray, nonce: UByteArray, key: UByteArray): UByteArray =
+        cipher(Cipher.ENCRYPT_MODE, associatedData, nonce, key).doFinal(message.asByteArray()).asUByteArray()
+
+    /**
+     * Decrypts and verifies a ciphertext.
+     * @return The original plaintext if decryption and authentication succeed.
+     * @throws AeadCorrupedOrTamperedDataException if the ciphertext is invalid.
+     */
+    fun decrypt(ciphertextWithTag: UByteArray, associatedData: UByteArray, nonce: UByteArray, key: UByteArray): UByteArray {
+        return try {
+            cipher(Cipher.DECRYPT_MODE, associatedData, nonce, key).doFinal(ciphertextWithTag.asByteArray()).asUByteArray()
+        } catch (_: AEADBadTagException) {
+            throw AeadCorrupedOrTamperedDataException()
+        }
+    }
+
+    private fun cipher(mode: Int, associatedData: UByteArray, nonce: UByteArray, key: UByteArray): Cipher =
+        Cipher.getInstance(TRANSFORMATION).apply {
+            init(mode, SecretKeySpec(key.asByteArray(), "AES"), GCMParameterSpec(TAG_BITS, nonce.asByteArray()))
+            updateAAD(associatedData.asByteArray())
+        }
+}
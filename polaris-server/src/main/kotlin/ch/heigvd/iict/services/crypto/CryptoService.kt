@@ -55,6 +55,40 @@ class CryptoService {
         return isValid
     }
 
+    /**
+     * Recomputes the root of a beacon Merkle batch from the data of one leaf and its authentication path.
+     *
+     * Leaves are `BLAKE2b-256(0x00 || data)` and inner nodes `BLAKE2b-256(0x01 || left || right)`. A node
+     * without sibling is promoted unchanged, so the path has no entry for that level.
+     *
+     * @param leafData The data of the leaf, i.e. the payload the beacon would have signed alone.
+     * @param leafIndex The position of the leaf in the batch.
+     * @param leafCount The number of leaves in the batch.
+     * @param path The concatenated sibling hashes, leaf level first.
+     * @return The root, or `null` if the path does not match the leaf position and count.
+     */
+    fun merkleRoot(leafData: UByteArray, leafIndex: Int, leafCount: Int, path: UByteArray): UByteArray? {
+        ensureCoreInitialized()
+        if (leafIndex >= leafCount) return null
+
+        var index = leafIndex
+        var count = leafCount
+        var node = LibsodiumBridge.genericHash(ubyteArrayOf(MERKLE_LEAF_DOMAIN) + leafData, MERKLE_HASH_SIZE)
+        var offset = 0
+        while (count > 1) {
+            if (index % 2 == 1 || index + 1 < count) {
+                if (offset + MERKLE_HASH_SIZE > path.size) return null
+                val sibling = path.sliceArray(offset until offset + MERKLE_HASH_SIZE)
+                offset += MERKLE_HASH_SIZE
+                val (left, right) = if (index % 2 == 1) sibling to node else node to sibling
+                node = LibsodiumBridge.genericHash(ubyteArrayOf(MERKLE_NODE_DOMAIN) + left + right, MERKLE_HASH_SIZE)
+            }
+            index /= 2
+            count = (count + 1) / 2
+        }
+        return if (offset == path.size) node else null
+    }
+
     private fun ensureCoreInitialized() {
         if (!LibsodiumBridge.isInitialized) {
             Log.warn("LibsodiumBridge was not initialized prior to use. This should not happen if onStart worked.")
@@ -64,4 +98,10 @@ class CryptoService {
             }
         }
     }
+
+    private companion object {
+        const val MERKLE_HASH_SIZE = 32
+        const val MERKLE_LEAF_DOMAIN: UByte = 0x00u
+        const val MERKLE_NODE_DOMAIN: UByte = 0x01u
+    }
 }
@@ -3,19 +3,35 @@ package ch.heigvd.iict.services.crypto
 import ch.heigvd.iict.entities.Beacon
 
 /**
- * Defines the contract for a service that can provide a shared secret key for communicating
+ * Defines the contract for a service that can provide the shared secret keys for communicating
  * with a specific beacon.
+ *
+ * The X25519 shared secret is not used as an AEAD key: one subkey per direction and cipher suite is derived from it,
+ * so that the server and the beacon never encrypt with the same key, and a key is never used by two algorithms
+ * (see [ch.heigvd.iict.services.crypto.model.SealedMessage]).
  */
 interface ISharedKeyManager {
 
     /**
-     * Retrieves the shared secret key for a given beacon.
+     * Retrieves the key sealing the messages for a given beacon (server to beacon), of its current key epoch.
      *
      * Implementations are responsible for performing the key exchange (e.g., ECDH)
      * and may employ caching strategies for performance.
      *
-     * @param beacon The beacon for which the shared key is needed.
-     * @return A byte array containing the 32-byte shared secret.
+     * @param beacon The beacon for which the key is needed.
+     * @param suite The cipher suite of the message.
+     * @return A byte array containing the 32-byte subkey.
      */
-    fun getSharedKeyForBeacon(beacon: Beacon): ByteArray
-}
\ No newline at end of file
+    fun getSealKeyForBeacon(beacon: Beacon, suite: Int): ByteArray
+
+    /**
+     * Retrieves the key opening the messages of a beacon (beacon to server), of a key epoch as found in the header
+     * of a sealed message.
+     *
+     * @param beacon The beacon which sealed the message.
+     * @param keyEpoch The key epoch of the message.
+     * @param suite The cipher suite of the message.
+     * @return The 32-byte subkey, or `null` if the epoch is neither the current one nor a recently retired one.
+     */
+    fun getOpenKeyForEpoch(beacon: Beacon, keyEpoch: Int, suite: Int): ByteArray?
+}
@@ -2,6 +2,8 @@ package ch.heigvd.iict.services.crypto
 
 import com.ionspin.kotlin.crypto.LibsodiumInitializer
 import com.ionspin.kotlin.crypto.aead.AuthenticatedEncryptionWithAssociatedData
+import com.ionspin.kotlin.crypto.generichash.GenericHash
+import com.ionspin.kotlin.crypto.kdf.Kdf
 import com.ionspin.kotlin.crypto.scalarmult.ScalarMultiplication
 import com.ionspin.kotlin.crypto.signature.Signature
 import com.ionspin.kotlin.crypto.signature.SignatureKeyPair
@@ -74,6 +76,12 @@ object LibsodiumBridge {
         }
     }
 
+    /** Computes the BLAKE2b hash (`crypto_generichash`) of a message, unkeyed. */
+    fun genericHash(message: UByteArray, size: Int): UByteArray {
+        ensureInitialized()
+        return GenericHash.genericHash(message, size)
+    }
+
     /**
      * Computes a public key from a secret key using Curve25519 base point multiplication.
      * Used for generating an X25519 public key.
@@ -92,6 +100,15 @@ object LibsodiumBridge {
         return ScalarMultiplication.scalarMultiplication(secretKey, publicKey)
     }
 
+    /**
+     * Derives a subkey from a master key (`crypto_kdf_derive_from_key`, BLAKE2b).
+     * @param context The 8-character context of the derivation.
+     */
+    fun kdfDerive(masterKey: UByteArray, subkeyId: ULong, context: String, size: Int): UByteArray {
+        ensureInitialized()
+        return Kdf.deriveFromKey(subkeyId, size, context, masterKey)
+    }
+
     /**
      * Encrypts and authenticates a message using ChaCha20-Poly1305 (IETF variant).
      * @return The combined ciphertext and authentication tag.
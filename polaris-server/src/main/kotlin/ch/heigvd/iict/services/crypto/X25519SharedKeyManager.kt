@@ -1,6 +1,7 @@
 package ch.heigvd.iict.services.crypto
 
 import ch.heigvd.iict.entities.Beacon
+import ch.heigvd.iict.services.crypto.model.SealedMessage
 import io.quarkus.logging.Log
 import jakarta.enterprise.context.ApplicationScoped
 import java.util.concurrent.ConcurrentHashMap
@@ -9,42 +10,89 @@ import java.util.concurrent.ConcurrentHashMap
  * Manages the derivation and caching of shared secrets for end-to-end encryption.
  *
  * This service implements the [ISharedKeyManager] interface and uses a cache to avoid
- * re-computing the expensive Diffie-Hellman key exchange for every message.
+ * re-computing the expensive Diffie-Hellman key exchange for every message. The X25519 shared secret
+ * is the master key of a KDF deriving one subkey per direction and cipher suite, like on the beacon.
  *
  * @property keyManager The service that holds the server's private key.
  */
 @ApplicationScoped
 class X25519SharedKeyManager(private val keyManager: KeyManager) : ISharedKeyManager {
 
-    private val sharedKeyCache = ConcurrentHashMap<Long, ByteArray>()
+    /** The directional subkeys of a beacon key, indexed by cipher suite, with its epoch. */
+    private class EpochKey(val epoch: Int, val beaconPk: ByteArray, val sealKeys: List<ByteArray>, val openKeys: List<ByteArray>)
+
+    private val sharedKeyCache = ConcurrentHashMap<Long, EpochKey>()
+
+    /** The last keys replaced by a rotation, still accepted for the messages sealed before it. */
+    private val retiredKeyCache = ConcurrentHashMap<Long, List<EpochKey>>()
 
     /**
-     * Retrieves the shared secret for a given beacon, computing and caching it if necessary.
+     * Retrieves the server-to-beacon subkey for a given beacon, computing and caching it if necessary.
      *
-     * @param beacon The target [Beacon] for which to get the shared key.
-     * @return The 32-byte shared secret key.
+     * @param beacon The target [Beacon] for which to get the key.
+     * @return The 32-byte subkey.
      * @throws IllegalStateException if the target beacon has not been provisioned with an X25519 public key.
      */
-    @OptIn(ExperimentalUnsignedTypes::class)
-    override fun getSharedKeyForBeacon(beacon: Beacon): ByteArray {
-        return sharedKeyCache.getOrPut(beacon.id!!) {
-            val beaconPk = beacon.publicKeyX25519
-                ?: throw IllegalStateException("Beacon ${beacon.id} does not have an X25519 public key provisioned.")
-            LibsodiumBridge.scalarMult(
-                keyManager.serverPrivateKey.asUByteArray(),
-                beaconPk.asUByteArray()
-            ).asByteArray()
-        }
+    override fun getSealKeyForBeacon(beacon: Beacon, suite: Int): ByteArray = currentKey(beacon).sealKeys[suite]
+
+    /**
+     * Retrieves the beacon-to-server subkey of a key epoch: the current one, or one of the [RETIRED_KEYS] last ones.
+     * The retired keys are only kept in memory.
+     */
+    override fun getOpenKeyForEpoch(beacon: Beacon, keyEpoch: Int, suite: Int): ByteArray? {
+        val current = currentKey(beacon)
+        if (current.epoch == keyEpoch) return current.openKeys.getOrNull(suite)
+        return retiredKeyCache[beacon.id!!]?.firstOrNull { it.epoch == keyEpoch }?.openKeys?.getOrNull(suite)
     }
 
     /**
      * Removes the cached shared key for a specific beacon.
      * This should be called when a beacon's X25519 key is rotated to force re-computation of the shared secret.
+     * The removed key is retired, not forgotten.
      *
      * @param beacon The [Beacon] whose cached key should be invalidated.
      */
     fun invalidateCacheForBeacon(beacon: Beacon) {
-        sharedKeyCache.remove(beacon.id)
+        sharedKeyCache.remove(beacon.id)?.let { retire(beacon.id!!, it) }
         Log.info("Cache invalidated for beacon ${beacon.id}")
     }
-}
\ No newline at end of file
+
+    @OptIn(ExperimentalUnsignedTypes::class)
+    private fun currentKey(beacon: Beacon): EpochKey {
+        val beaconPk = beacon.publicKeyX25519
+            ?: throw IllegalStateException("Beacon ${beacon.id} does not have an X25519 public key provisioned.")
+        val cached = sharedKeyCache[beacon.id!!]
+        if (cached != null && cached.epoch == beacon.keyEpoch && cached.beaconPk.contentEquals(beaconPk)) return cached
+
+        val sharedSecret = LibsodiumBridge.scalarMult(keyManager.serverPrivateKey.asUByteArray(), beaconPk.asUByteArray())
+        fun derive(direction: Int) = SUITES.map { suite ->
+            LibsodiumBridge.kdfDerive(sharedSecret, SealedMessage.subkeyId(direction, suite), SealedMessage.KDF_CONTEXT, 32)
+                .asByteArray()
+        }
+        val derived = EpochKey(
+            beacon.keyEpoch,
+            beaconPk.copyOf(),
+            derive(SealedMessage.SERVER_TO_BEACON),
+            derive(SealedMessage.BEACON_TO_SERVER)
+        )
+        // The epoch changed without invalidation (other instance, reload): the cached key is retired.
+        // A key provisioned by hand in the same epoch replaces it.
+        if (cached != null && cached.epoch != beacon.keyEpoch) retire(beacon.id!!, cached)
+        sharedKeyCache[beacon.id!!] = derived
+        return derived
+    }
+
+    private fun retire(beaconId: Long, key: EpochKey) {
+        retiredKeyCache.compute(beaconId) { _, retired ->
+            (listOf(key) + (retired ?: emptyList()).filter { it.epoch != key.epoch }).take(RETIRED_KEYS)
+        }
+    }
+
+    companion object {
+        /** The number of retired keys accepted per beacon, as on the beacon firmware. */
+        const val RETIRED_KEYS = 2
+
+        /** The cipher suites, in the order of their subkeys. */
+        private val SUITES = listOf(SealedMessage.SUITE_CHACHA20_POLY1305, SealedMessage.SUITE_AES256_GCM)
+    }
+}
@@ -0,0 +1,42 @@
+package ch.heigvd.iict.services.crypto.model
+
+/**
+ * A sliding window detecting the replayed message counters of a beacon, without storing the counters.
+ *
+ * It keeps the highest counter received and a bitmap of the [WINDOW_BITS] counters before it, so that the messages
+ * relayed out of order by different phones are still accepted once. Same algorithm as the beacon firmware.
+ *
+ * @property top The highest counter received + 1, 0 before the first message.
+ * @property bits Bit i is set if the counter `top - 1 - i` was received.
+ */
+class ReplayWindow(var top: Long = 0L, var bits: Long = 0L) {
+
+    /** Checks whether a counter was not received yet and is recent enough for the window. */
+    fun isFresh(counter: Long): Boolean {
+        if (counter >= top) return true
+        val age = top - 1 - counter
+        return age < WINDOW_BITS && (bits and (1L shl age.toInt())) == 0L
+    }
+
+    /**
+     * Records the counter of an authenticated message.
+     * @return `false` if the counter is not fresh, the message is a replay.
+     */
+    fun mark(counter: Long): Boolean {
+        if (!isFresh(counter)) return false
+        if (counter >= top) {
+            val shift = counter - top + 1
+            bits = if (shift >= WINDOW_BITS) 0L else bits shl shift.toInt()
+            bits = bits or 1L
+            top = counter + 1
+        } else {
+            bits = bits or (1L shl (top - 1 - counter).toInt())
+        }
+        return true
+    }
+
+    companion object {
+        /** The number of counters below the highest one still accepted once, as on the beacon. */
+        const val WINDOW_BITS = 64
+    }
+}
@@ -10,31 +10,112 @@ import java.nio.ByteOrder
  * and the encrypted payload itself. Its binary format is designed to match the `EncryptedMessage`
  * structure on the beacon firmware.
  *
+ * The 12-byte AEAD nonce is not sent: both sides build it from the direction and the counter,
+ * `direction (1) || 0 (3) || counter (4, LE) || 0 (4)`. Each direction has its own subkey per key epoch and suite,
+ * so a counter only has to be unique per direction and epoch.
+ *
+ * The suite byte negotiates the cipher: its low nibble is the suite of the message ([SUITE_CHACHA20_POLY1305] or
+ * [SUITE_AES256_GCM]), its high nibble the suites the sender can open (bit 4 + suite). Each side seals with
+ * AES-256-GCM once an authenticated message of the other announced it.
+ *
  * @property beaconId The ID of the beacon, used as Associated Data in the AEAD operation.
- * @property nonce The 12-byte nonce used for this specific encryption. Must be unique per message.
+ * @property keyEpoch The epoch of the beacon X25519 key (0 to 255), used as Associated Data after the beacon ID.
+ * It selects the shared key directly, without trial decryption.
+ * @property suite The cipher suite of the message.
+ * @property senderSuites The suites the sender can open, as the high nibble of the suite byte.
+ * @property counter The message counter of the direction and epoch (unsigned 32 bits).
  * @property ciphertextWithTag The combined ciphertext and authentication tag produced by the AEAD algorithm.
  */
 @OptIn(ExperimentalUnsignedTypes::class)
 data class SealedMessage(
     val beaconId: Int,
-    val nonce: UByteArray, // 12 bytes for IETF
+    val keyEpoch: Int,
+    val suite: Int,
+    val senderSuites: Int,
+    val counter: Long,
     val ciphertextWithTag: UByteArray
 ) {
+    /** The associated data of the message: `beaconId (4 bytes, LE) || keyEpoch (1 byte) || suite (1 byte)`. */
+    fun associatedData(): UByteArray =
+        ByteBuffer.allocate(AD_SIZE).order(ByteOrder.LITTLE_ENDIAN)
+            .putInt(beaconId)
+            .put(keyEpoch.toByte())
+            .put(suiteByte())
+            .array().asUByteArray()
+
+    private fun suiteByte(): Byte = (suite or senderSuites).toByte()
+
+    /**
+     * Builds the AEAD nonce of the message.
+     * @param direction [BEACON_TO_SERVER] or [SERVER_TO_BEACON].
+     */
+    fun nonce(direction: Int): UByteArray =
+        ByteBuffer.allocate(NONCE_SIZE).order(ByteOrder.LITTLE_ENDIAN)
+            .put(0, direction.toByte())
+            .putInt(4, counter.toInt())
+            .array().asUByteArray()
+
     /**
      * Serializes this object into a single byte array (a "blob") for transmission.
-     * The format is `beaconId (4 bytes) || nonce (12 bytes) || ciphertext`.
+     * The format is `beaconId (4 bytes) || keyEpoch (1 byte) || suite (1 byte) || counter (4 bytes) || ciphertext`.
      * @return The serialized message as a [ByteArray].
      */
     fun toBlob(): ByteArray {
-        val buffer = ByteBuffer.allocate(4 + 12 + ciphertextWithTag.size)
+        val buffer = ByteBuffer.allocate(AD_SIZE + COUNTER_SIZE + ciphertextWithTag.size)
             .order(ByteOrder.LITTLE_ENDIAN) // ESP32 works with little endian
         buffer.putInt(beaconId)
-        buffer.put(nonce.asByteArray())
+        buffer.put(keyEpoch.toByte())
+        buffer.put(suiteByte())
+        buffer.putInt(counter.toInt())
         buffer.put(ciphertextWithTag.asByteArray())
         return buffer.array()
     }
 
     companion object {
+        private const val AD_SIZE = 6
+        private const val COUNTER_SIZE = 4
+        private const val NONCE_SIZE = 12
+
+        /** The context of the subkeys derivation (`crypto_kdf`), as on the beacon. */
+        const val KDF_CONTEXT = "PolAEAD_"
+
+        /** The subkey ID of the beacon messages, also the first byte of their nonces. */
+        const val BEACON_TO_SERVER = 1
+
+        /** The subkey ID of the server messages, also the first byte of their nonces. */
+        const val SERVER_TO_BEACON = 2
+
+        /** The cipher suites, as on the beacon. */
+        const val SUITE_CHACHA20_POLY1305 = 0
+        const val SUITE_AES256_GCM = 1
+
+        /** The subkey IDs of a suite are the direction IDs + suite * stride (AES-256-GCM uses 3 and 4). */
+        const val SUITE_SUBKEY_STRIDE = 2
+
+        private const val SUITE_ID_MASK = 0x0F
+
+        /** The bit of a suite in the high nibble of the suite byte. */
+        fun suiteBit(suite: Int): Int = 1 shl (4 + suite)
+
+        /** The suites the server can open: both, AES-256-GCM being provided by the JVM. */
+        val SERVER_SUITES = suiteBit(SUITE_CHACHA20_POLY1305) or suiteBit(SUITE_AES256_GCM)
+
+        /** The suites assumed for a beacon until it announces its own. */
+        val DEFAULT_SUITES = suiteBit(SUITE_CHACHA20_POLY1305)
+
+        /** The KDF subkey ID of a direction and a suite. */
+        fun subkeyId(direction: Int, suite: Int): ULong = (direction + suite * SUITE_SUBKEY_STRIDE).toULong()
+
+        /**
+         * Chooses the suite sealing a message for a beacon: AES-256-GCM if the beacon announced it,
+         * ChaCha20-Poly1305 otherwise.
+         */
+        fun negotiateSuite(beaconSuites: Int): Int =
+            if ((beaconSuites and SERVER_SUITES and suiteBit(SUITE_AES256_GCM)) != 0) SUITE_AES256_GCM
+            else SUITE_CHACHA20_POLY1305
+
+        /** The largest counter value, after which the key must be rotated. */
+        const val MAX_COUNTER = 0xFFFFFFFFL
 
         /**
          * Deserializes a raw byte blob into a [SealedMessage] object.
@@ -44,9 +125,13 @@ data class SealedMessage(
         fun fromBlob(blob: ByteArray): SealedMessage {
             val buffer = ByteBuffer.wrap(blob).order(ByteOrder.LITTLE_ENDIAN)
             val beaconId = buffer.int
-            val nonce = UByteArray(12).apply { buffer.get(this.asByteArray()) }
+            val keyEpoch = buffer.get().toInt() and 0xFF
+            val suiteByte = buffer.get().toInt() and 0xFF
+            val counter = buffer.int.toLong() and MAX_COUNTER
             val ciphertext = UByteArray(buffer.remaining()).apply { buffer.get(this.asByteArray()) }
-            return SealedMessage(beaconId, nonce, ciphertext)
+            return SealedMessage(
+                beaconId, keyEpoch, suiteByte and SUITE_ID_MASK, suiteByte and SUITE_ID_MASK.inv(), counter, ciphertext
+            )
         }
     }
-}
\ No newline at end of file
+}
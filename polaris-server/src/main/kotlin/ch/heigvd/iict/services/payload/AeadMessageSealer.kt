@@ -1,43 +1,74 @@
 package ch.heigvd.iict.services.payload
 
 import ch.heigvd.iict.entities.Beacon
+import ch.heigvd.iict.services.crypto.AesGcmCipher
 import ch.heigvd.iict.services.crypto.ISharedKeyManager
 import ch.heigvd.iict.services.crypto.LibsodiumBridge
 import ch.heigvd.iict.services.crypto.model.*
-import ch.heigvd.iict.util.PoLUtils.toUByteArrayLE
 import jakarta.enterprise.context.ApplicationScoped
+import jakarta.persistence.EntityManager
+import jakarta.persistence.LockModeType
 
 /**
- * Concrete implementation of [IMessageSealer] using ChaCha20-Poly1305 AEAD.
+ * Concrete implementation of [IMessageSealer] using ChaCha20-Poly1305 AEAD, or AES-256-GCM for the beacons that
+ * announced it.
  *
  * This service handles the process of encrypting a plaintext message for a specific beacon,
- * including key derivation, nonce generation, and serialization into a transportable format.
+ * including key derivation, nonce construction, and serialization into a transportable format.
  *
  * @property keyManager The manager used to retrieve the correct shared secret for the target beacon.
+ * @property entityManager Used to lock the beacon while its message counter is taken.
  */
 @ApplicationScoped
-class AeadMessageSealer(private val keyManager: ISharedKeyManager) : IMessageSealer {
+class AeadMessageSealer(
+    private val keyManager: ISharedKeyManager,
+    private val entityManager: EntityManager
+) : IMessageSealer {
 
     /**
      * Seals a [PlaintextMessage] using AEAD encryption.
      *
+     * The nonce is built from the next server-to-beacon counter of the beacon key epoch, persisted on the beacon
+     * row. Must be called in a transaction, the row stays locked until its end so that no counter is used twice.
+     * The suite is negotiated from the suites announced by the last authenticated message of the beacon.
+     *
      * @param plaintext The message to encrypt.
      * @param targetBeacon The destination beacon, used to fetch the shared encryption key.
      * @return A [SealedMessage] containing the resulting ciphertext and metadata.
+     * @throws IllegalStateException if the counters of the key epoch are exhausted (the key must be rotated).
      */
     @OptIn(ExperimentalUnsignedTypes::class)
     override fun seal(plaintext: PlaintextMessage, targetBeacon: Beacon): SealedMessage {
-        val sharedKey = keyManager.getSharedKeyForBeacon(targetBeacon)
-        val nonce = LibsodiumBridge.generateNonce(12) // 12 bytes for IETF
-        val associatedData = targetBeacon.beaconId.toUInt().toUByteArrayLE()
+        // Reload the counters under a row lock, after writing the pending changes (e.g. a new key epoch)
+        entityManager.flush()
+        entityManager.refresh(targetBeacon, LockModeType.PESSIMISTIC_WRITE)
+
+        if (targetBeacon.aeadTxEpoch != targetBeacon.keyEpoch) {
+            // New subkeys, new counter space
+            targetBeacon.aeadTxEpoch = targetBeacon.keyEpoch
+            targetBeacon.aeadTxCounter = 0L
+        }
+        val counter = targetBeacon.aeadTxCounter
+        if (counter > SealedMessage.MAX_COUNTER) {
+            throw IllegalStateException("Message counters of beacon ${targetBeacon.id} exhausted, rotate its key.")
+        }
+        targetBeacon.aeadTxCounter = counter + 1
 
-        val ciphertextWithTag = LibsodiumBridge.aeadEncrypt(
-            message = plaintext.toBytes(),
-            associatedData = associatedData,
-            nonce = nonce,
-            key = sharedKey.asUByteArray()
+        val suite = SealedMessage.negotiateSuite(targetBeacon.aeadSuites)
+        val sealKey = keyManager.getSealKeyForBeacon(targetBeacon, suite)
+        val header = SealedMessage(
+            targetBeacon.beaconId, targetBeacon.keyEpoch, suite, SealedMessage.SERVER_SUITES, counter, UByteArray(0)
         )
 
-        return SealedMessage(targetBeacon.beaconId, nonce, ciphertextWithTag)
+        val message = plaintext.toBytes()
+        val associatedData = header.associatedData()
+        val nonce = header.nonce(SealedMessage.SERVER_TO_BEACON)
+        val ciphertextWithTag = if (suite == SealedMessage.SUITE_AES256_GCM) {
+            AesGcmCipher.encrypt(message, associatedData, nonce, sealKey.asUByteArray())
+        } else {
+            LibsodiumBridge.aeadEncrypt(message, associatedData, nonce, sealKey.asUByteArray())
+        }
+
+        return header.copy(ciphertextWithTag = ciphertextWithTag)
     }
-}
\ No newline at end of file
+}
@@ -1,43 +1,115 @@
 package ch.heigvd.iict.services.payload
 
 import ch.heigvd.iict.entities.Beacon
+import ch.heigvd.iict.services.crypto.AesGcmCipher
 import ch.heigvd.iict.services.crypto.ISharedKeyManager
 import ch.heigvd.iict.services.crypto.LibsodiumBridge
 import ch.heigvd.iict.services.crypto.model.PlaintextMessage
+import ch.heigvd.iict.services.crypto.model.ReplayWindow
 import ch.heigvd.iict.services.crypto.model.SealedMessage
-import ch.heigvd.iict.util.PoLUtils.toUByteArrayLE
 import jakarta.enterprise.context.ApplicationScoped
+import jakarta.persistence.EntityManager
+import jakarta.persistence.LockModeType
+import java.util.concurrent.ConcurrentHashMap
 
 /**
- * Concrete implementation of [IMessageUnsealer] using ChaCha20-Poly1305 AEAD.
+ * Concrete implementation of [IMessageUnsealer] using ChaCha20-Poly1305 or AES-256-GCM AEAD, as selected by the
+ * suite byte of the message.
  *
  * This service decrypts and verifies an encrypted message blob, returning the original plaintext.
+ * The replayed messages are detected by a [ReplayWindow] over the beacon-to-server counters. The suites announced by
+ * an authenticated message are recorded on the beacon, for the negotiation of the next sealed messages.
  *
  * @property keyManager The manager used to retrieve the correct shared secret for the source beacon.
+ * @property entityManager Used to lock the beacon while its replay window is updated.
  */
 @ApplicationScoped
-class AeadMessageUnsealer(private val keyManager: ISharedKeyManager) : IMessageUnsealer {
+class AeadMessageUnsealer(
+    private val keyManager: ISharedKeyManager,
+    private val entityManager: EntityManager
+) : IMessageUnsealer {
+
+    /**
+     * The replay windows of the retired key epochs, per beacon ID and epoch. Only kept in memory, like their keys.
+     * A window is only used under the lock of its beacon row.
+     */
+    private val retiredWindows = ConcurrentHashMap<Pair<Long, Int>, ReplayWindow>()
 
     /**
      * Unseals a [SealedMessage] by decrypting and verifying its content.
      *
+     * Must be called in a transaction, the beacon row stays locked until its end.
+     *
      * @param sealed The encrypted message to process.
      * @param sourceBeacon The beacon that originated the message, used to fetch the shared key.
      * @return The original [PlaintextMessage] if decryption is successful.
      * @throws com.ionspin.kotlin.crypto.aead.AeadCorrupedOrTamperedDataException if verification fails.
+     * @throws IllegalStateException if the key epoch or the suite of the message is not live, or if the message is
+     * a replay.
      */
     @OptIn(ExperimentalUnsignedTypes::class)
     override fun unseal(sealed: SealedMessage, sourceBeacon: Beacon): PlaintextMessage {
-        val sharedKey = keyManager.getSharedKeyForBeacon(sourceBeacon)
-        val associatedData = sourceBeacon.beaconId.toUInt().toUByteArrayLE()
+        if ((SealedMessage.SERVER_SUITES and SealedMessage.suiteBit(sealed.suite)) == 0) {
+            throw IllegalStateException("Unsupported cipher suite ${sealed.suite} from beacon ${sourceBeacon.id}")
+        }
+
+        // The key is selected by the epoch of the header, without trial decryption
+        val openKey = keyManager.getOpenKeyForEpoch(sourceBeacon, sealed.keyEpoch, sealed.suite)
+            ?: throw IllegalStateException("No live key of epoch ${sealed.keyEpoch} for beacon ${sourceBeacon.id}")
+
+        entityManager.flush()
+        entityManager.refresh(sourceBeacon, LockModeType.PESSIMISTIC_WRITE)
+
+        // A replay costs no decryption
+        val window = windowFor(sourceBeacon, sealed.keyEpoch)
+        if (!window.isFresh(sealed.counter)) {
+            throw IllegalStateException("Replayed counter ${sealed.counter} of epoch ${sealed.keyEpoch} from beacon ${sourceBeacon.id}")
+        }
 
-        val plaintextBytes = LibsodiumBridge.aeadDecrypt(
-            ciphertextWithTag = sealed.ciphertextWithTag,
-            associatedData = associatedData,
-            nonce = sealed.nonce,
-            key = sharedKey.asUByteArray()
-        ).asByteArray()
+        val associatedData = sealed.associatedData()
+        val nonce = sealed.nonce(SealedMessage.BEACON_TO_SERVER)
+        val plaintextBytes = if (sealed.suite == SealedMessage.SUITE_AES256_GCM) {
+            AesGcmCipher.decrypt(sealed.ciphertextWithTag, associatedData, nonce, openKey.asUByteArray())
+        } else {
+            LibsodiumBridge.aeadDecrypt(sealed.ciphertextWithTag, associatedData, nonce, openKey.asUByteArray())
+        }.asByteArray()
+
+        // Only an authenticated counter moves the window
+        window.mark(sealed.counter)
+        if (sealed.keyEpoch == sourceBeacon.aeadRxEpoch) {
+            sourceBeacon.aeadRxTop = window.top
+            sourceBeacon.aeadRxBits = window.bits
+        }
+        // Authenticated: the suites the beacon can open (a reflashed beacon announces its new ones)
+        sourceBeacon.aeadSuites = sealed.senderSuites or SealedMessage.DEFAULT_SUITES
 
         return PlaintextMessage.fromBytes(plaintextBytes)
     }
-}
\ No newline at end of file
+
+    /**
+     * Returns the replay window of an epoch. The window of the current epoch is persisted on the beacon row; when the
+     * first message of a new epoch arrives, the previous window is moved to memory with the retired key.
+     */
+    private fun windowFor(beacon: Beacon, keyEpoch: Int): ReplayWindow {
+        if (keyEpoch != beacon.aeadRxEpoch) {
+            if (keyEpoch != beacon.keyEpoch) {
+                // A retired epoch: its window was moved to memory with this process, or it is no longer accepted
+                return retiredWindows[beacon.id!! to keyEpoch]
+                    ?: throw IllegalStateException("No replay window for epoch $keyEpoch of beacon ${beacon.id}")
+            }
+            retiredWindows[beacon.id!! to beacon.aeadRxEpoch] = ReplayWindow(beacon.aeadRxTop, beacon.aeadRxBits)
+            retiredWindows.keys.removeIf { (id, epoch) ->
+                id == beacon.id && ((keyEpoch - epoch) and 0xFF) > RETIRED_WINDOWS
+            }
+            beacon.aeadRxEpoch = keyEpoch
+            beacon.aeadRxTop = 0L
+            beacon.aeadRxBits = 0L
+        }
+        return ReplayWindow(beacon.aeadRxTop, beacon.aeadRxBits)
+    }
+
+    companion object {
+        /** The number of retired epochs whose window is kept, as for their keys. */
+        private const val RETIRED_WINDOWS = 2
+    }
+}
@@ -12,6 +12,7 @@ import ch.heigvd.iict.services.crypto.model.PlaintextMessage
 import ch.heigvd.iict.services.crypto.model.SealedMessage
 import ch.heigvd.iict.services.protocol.MessageType
 import ch.heigvd.iict.services.protocol.OperationType
+import ch.heigvd.iict.util.PoLUtils.toUIntLE
 import ch.heigvd.iict.web.demo.DemoEvent
 import ch.heigvd.iict.web.demo.DemoSseResource
 import com.ionspin.kotlin.crypto.aead.AeadCorrupedOrTamperedDataException
@@ -127,6 +128,8 @@ class PayloadAckProcessor(
             handleRotateInitAck(plaintext, delivery)
         } else if (message.opType == OperationType.ROTATE_KEY_FINISH && plaintext.msgType == MessageType.ACK) {
             handleRotateFinishAck(delivery)
+        } else if (message.opType in REVOCATION_OPS && plaintext.msgType == MessageType.ACK) {
+            handleRevocationAck(plaintext, delivery)
         } else {
             handleGenericAck(plaintext, delivery)
         }
@@ -147,9 +150,9 @@ class PayloadAckProcessor(
         }
 
         // Update key in db
-        beaconAdminService.updateBeaconX25519Key(beacon.id!!, newPublicKey)
+        beaconAdminService.updateBeaconX25519Key(beacon.id!!, newPublicKey, rotated = true)
 
-        // Invalidate cache to force new derivation
+        // Invalidate cache to force new derivation, the previous key stays live for the messages sealed before
         keyManager.invalidateCacheForBeacon(beacon)
 
         // Mark this job as AKC, but not global process
@@ -182,6 +185,29 @@ class PayloadAckProcessor(
         )
     }
 
+    /**
+     * Records the revocation filter version applied by the beacon, the 4-byte little-endian payload of the ACK, so
+     * that the next revocation can be sent as a delta on top of it
+     * (see [ch.heigvd.iict.services.admin.RevocationService]).
+     */
+    @OptIn(ExperimentalUnsignedTypes::class)
+    private fun handleRevocationAck(plaintext: PlaintextMessage, delivery: MessageDelivery) {
+        val beacon = delivery.outboundMessage.beacon
+        if (plaintext.payload.size != 4) {
+            Log.error("Invalid version size in revocation ACK payload.")
+            delivery.ackStatus = AckStatus.PROCESSING_ERROR
+            delivery.outboundMessage.status = MessageStatus.FAILED
+            return
+        }
+
+        val version = plaintext.payload.toUByteArray().toUIntLE().toLong()
+        if (version > beacon.revocationAckedVersion) {
+            beacon.revocationAckedVersion = version
+            beacon.persist()
+        }
+        handleGenericAck(plaintext, delivery)
+    }
+
     private fun handleGenericAck(plaintext: PlaintextMessage, delivery: MessageDelivery) {
         when (plaintext.msgType) {
             MessageType.ACK -> {
@@ -202,4 +228,8 @@ class PayloadAckProcessor(
             }
         }
     }
-}
\ No newline at end of file
+
+    private companion object {
+        val REVOCATION_OPS = setOf(OperationType.SET_REVOCATION_FILTER, OperationType.ADD_REVOCATIONS)
+    }
+}
@@ -24,8 +24,16 @@ enum class OperationType(val code: UByte) {
     ROTATE_KEY_INIT(0x10u),
     /** The final step of the key rotation, confirming completion. */
     ROTATE_KEY_FINISH(0x11u),
+    /** Replaces the revocation filter of the beacon: `{"v", "k", "f"}` (see [RevocationFilter]). */
+    SET_REVOCATION_FILTER(0x12u),
+    /** Adds revoked phones to the revocation filter of the beacon: `{"base", "v", "ids", "pks"}`. */
+    ADD_REVOCATIONS(0x13u),
     /** A response from a beacon containing its status, sent after a [REQUEST_BEACON_STATUS]. */
     RESPONSE_BEACON_STATUS(0x80u),
+    /** A block of the beacon's token issuance journal: `{"seq", "c0", "n", "d"}` (see the beacon README). */
+    ISSUANCE_LOG(0x81u),
+    /** A HyperLogLog sketch of the distinct phones a beacon served in a window: `{"w", "len", "p", "n", "r"}`. */
+    VISITOR_SKETCH(0x82u),
     /** An unknown or unsupported operation type. */
     UNKNOWN(0xFFu);
 
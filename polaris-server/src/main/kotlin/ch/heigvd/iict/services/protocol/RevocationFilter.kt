@@ -0,0 +1,101 @@
+package ch.heigvd.iict.services.protocol
+
+import ch.heigvd.iict.services.crypto.LibsodiumBridge
+import ch.heigvd.iict.util.PoLUtils.toULongLE
+import ch.heigvd.iict.util.PoLUtils.toUByteArrayLE
+import kotlinx.serialization.json.JsonObject
+import kotlinx.serialization.json.add
+import kotlinx.serialization.json.buildJsonObject
+import kotlinx.serialization.json.put
+import kotlinx.serialization.json.putJsonArray
+import java.util.Base64
+import kotlin.math.ln
+import kotlin.math.roundToInt
+
+/**
+ * Builds the parameters of the [OperationType.SET_REVOCATION_FILTER] and [OperationType.ADD_REVOCATIONS]
+ * commands: a Bloom filter of the revoked phone IDs and phone public keys, checked by the beacons before any
+ * curve operation.
+ *
+ * The hashing must match the beacon firmware (`RevocationFilter`): BLAKE2b-128 over `[tag][value]`, the
+ * two 64-bit little-endian halves `h1`, `h2` giving the bits `(h1 + i * (h2 | 1)) mod FILTER_BITS`.
+ */
+@OptIn(ExperimentalUnsignedTypes::class)
+object RevocationFilter {
+    /** The size of the filter on the beacons. */
+    const val FILTER_BYTES = 256
+    const val FILTER_BITS = FILTER_BYTES * 8
+
+    /** The maximum number of hash functions accepted by the beacons. */
+    const val MAX_HASHES = 16
+
+    private const val ITEM_PHONE_ID: UByte = 0x01u
+    private const val ITEM_PHONE_KEY: UByte = 0x02u
+
+    /** The hash count minimizing the false positive rate for [itemCount] items. */
+    fun optimalHashes(itemCount: Int): Int {
+        if (itemCount == 0) return 1
+        return (FILTER_BITS.toDouble() / itemCount * ln(2.0)).roundToInt().coerceIn(1, MAX_HASHES)
+    }
+
+    /**
+     * Parameters of a full filter: `{"v", "k", "f"}`.
+     *
+     * @param version The version of the filter, greater than the previous one.
+     * @param phoneIds The revoked phone IDs.
+     * @param phoneKeys The revoked Ed25519 public keys.
+     * @param hashes The hash count, kept by the following deltas.
+     */
+    fun fullCommand(
+        version: Long,
+        phoneIds: Collection<Long>,
+        phoneKeys: Collection<ByteArray>,
+        hashes: Int = optimalHashes(phoneIds.size + phoneKeys.size),
+    ): JsonObject {
+        require(hashes in 1..MAX_HASHES) { "Invalid hash count" }
+        val bits = UByteArray(FILTER_BYTES)
+        phoneIds.forEach { setBits(bits, hashes, phoneIdItem(it)) }
+        phoneKeys.forEach { setBits(bits, hashes, phoneKeyItem(it)) }
+
+        return buildJsonObject {
+            put("v", version)
+            put("k", hashes)
+            put("f", Base64.getEncoder().encodeToString(bits.asByteArray()))
+        }
+    }
+
+    /**
+     * Parameters of a delta: `{"base", "v", "ids", "pks"}`. The beacon rejects it if its filter is not at
+     * [baseVersion]; the server then sends a [fullCommand].
+     */
+    fun deltaCommand(
+        baseVersion: Long,
+        version: Long,
+        phoneIds: Collection<Long>,
+        phoneKeys: Collection<ByteArray>,
+    ): JsonObject {
+        require(version > baseVersion) { "The version of a delta must increase" }
+        return buildJsonObject {
+            put("base", baseVersion)
+            put("v", version)
+            putJsonArray("ids") { phoneIds.forEach { add(it) } }
+            putJsonArray("pks") { phoneKeys.forEach { add(Base64.getEncoder().encodeToString(it)) } }
+        }
+    }
+
+    private fun phoneIdItem(phoneId: Long): UByteArray =
+        ubyteArrayOf(ITEM_PHONE_ID) + phoneId.toULong().toUByteArrayLE()
+
+    private fun phoneKeyItem(publicKey: ByteArray): UByteArray =
+        ubyteArrayOf(ITEM_PHONE_KEY) + publicKey.toUByteArray()
+
+    private fun setBits(bits: UByteArray, hashes: Int, item: UByteArray) {
+        val digest = LibsodiumBridge.genericHash(item, 16)
+        val h1 = digest.sliceArray(0 until 8).toULongLE()
+        val h2 = digest.sliceArray(8 until 16).toULongLE() or 1uL
+        for (i in 0 until hashes) {
+            val bit = ((h1 + i.toULong() * h2) % FILTER_BITS.toULong()).toInt()
+            bits[bit / 8] = bits[bit / 8] or (1 shl (bit % 8)).toUByte()
+        }
+    }
+}
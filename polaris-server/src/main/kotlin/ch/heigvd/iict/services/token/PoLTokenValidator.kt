@@ -51,9 +51,20 @@ class PoLTokenValidator @Inject constructor(
             errs += "Beacon public key mismatch"
         }
 
-        // verify beacon signature
-        val beaconMsg = SignedPayload.forBeacon(dto)
-        if (!crypto.verifyEd25519Signature(dto.beaconSig, beaconMsg, dto.beaconPk)) {
+        // verify beacon signature, over the Merkle root of the batch for batched tokens
+        val beaconMsg = if (dto.flags and FLAG_MERKLE != 0.toUByte()) {
+            crypto.merkleRoot(
+                SignedPayload.forBeacon(dto),
+                dto.merkleLeafIndex.toInt(),
+                dto.merkleLeafCount.toInt(),
+                dto.merklePath
+            )?.let { MERKLE_SIGNATURE_CONTEXT.encodeToByteArray().toUByteArray() + it }
+        } else {
+            SignedPayload.forBeacon(dto)
+        }
+        if (beaconMsg == null) {
+            errs += "Malformed Merkle proof"
+        } else if (!crypto.verifyEd25519Signature(dto.beaconSig, beaconMsg, dto.beaconPk)) {
             errs += "Invalid beacon signature"
         }
 
@@ -69,4 +80,12 @@ class PoLTokenValidator @Inject constructor(
 
         return errs
     }
+
+    private companion object {
+        /** Token flag: the beacon signed the root of a Merkle batch of responses. */
+        const val FLAG_MERKLE: UByte = 0x01u
+
+        /** Prefix of the signed Merkle root, separating it from the other beacon signatures. */
+        const val MERKLE_SIGNATURE_CONTEXT = "polaris-merkle"
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 package ch.heigvd.iict.web.demo
 
 import ch.heigvd.iict.repositories.*
+import ch.heigvd.iict.services.admin.RevocationService
 import ch.heigvd.iict.services.payload.PayloadService
 import ch.heigvd.iict.services.protocol.OperationType
 import ch.heigvd.iict.util.InstantSerializer
@@ -25,6 +26,8 @@ class DemoApiResource {
     lateinit var payloadService: PayloadService
     @Inject
     lateinit var inboundRepo: InboundMessageRepository
+    @Inject
+    lateinit var revocationService: RevocationService
 
     @Serializable
     data class SummaryDto(
@@ -201,6 +204,21 @@ class DemoApiResource {
         }
     }
 
+    @POST
+    @Path("/phones/{id}/revoke")
+    fun revokePhone(@PathParam("id") id: Long): Response {
+        return try {
+            val beacons = revocationService.revokePhone(id)
+            Response.ok(SimpleMessage("Téléphone #$id révoqué, filtre envoyé à $beacons balise(s)."))
+                .build()
+
+        } catch (e: Exception) {
+            Response.status(Response.Status.BAD_REQUEST)
+                .entity(e.message ?: "An unknown error occurred.")
+                .build()
+        }
+    }
+
     @Serializable
     data class DeliveryDetailDto(
         val phoneId: Long,
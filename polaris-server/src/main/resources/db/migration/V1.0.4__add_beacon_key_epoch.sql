@@ -0,0 +1,2 @@
+ALTER TABLE beacons
+    ADD COLUMN key_epoch INTEGER NOT NULL DEFAULT 0;
@@ -0,0 +1,6 @@
+ALTER TABLE beacons
+    ADD COLUMN aead_tx_counter BIGINT NOT NULL DEFAULT 0,
+    ADD COLUMN aead_tx_epoch INTEGER NOT NULL DEFAULT 0,
+    ADD COLUMN aead_rx_top BIGINT NOT NULL DEFAULT 0,
+    ADD COLUMN aead_rx_bits BIGINT NOT NULL DEFAULT 0,
+    ADD COLUMN aead_rx_epoch INTEGER NOT NULL DEFAULT 0;
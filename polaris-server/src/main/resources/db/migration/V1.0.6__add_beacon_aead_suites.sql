@@ -0,0 +1,2 @@
+ALTER TABLE beacons
+    ADD COLUMN aead_suites INTEGER NOT NULL DEFAULT 16;
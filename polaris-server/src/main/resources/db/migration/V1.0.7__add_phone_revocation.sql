@@ -0,0 +1,6 @@
+ALTER TABLE registered_phones
+    ADD COLUMN revoked_at TIMESTAMP WITH TIME ZONE;
+
+ALTER TABLE beacons
+    ADD COLUMN revocation_version BIGINT NOT NULL DEFAULT 0,
+    ADD COLUMN revocation_acked_version BIGINT NOT NULL DEFAULT 0;